@@ -0,0 +1,488 @@
+#include "PRKFPerkCache.h"
+#include "main.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace PRKFPerkCache
+{
+	enum TermType
+	{
+		kTerm_None,
+		kTerm_ActorValue,
+		kTerm_Sex
+	};
+
+	// one condition of a rank, the text is rendered once and only coloured per evaluation
+	struct Term
+	{
+		UInt8				type;
+		UInt8				op;
+		float				compareValue;
+		UInt32				u32;			// GetIsSex parameter
+		ActorValueInfo		* av;
+		std::string			text;			// "Strength&gt;=5"
+		const char			* separator;	// joins to the next term, nullptr for the last one
+	};
+
+	struct Rank
+	{
+		BGSPerk				* perk;
+		std::vector<Term>	terms;
+		int					filterFlag;		// eligibility is added per evaluation
+		std::string			label;			// "$Rank: 2"
+		std::string			levelReq;		// ". $PRKF_Requires: $PRKF_Level 10"
+		std::string			levelReqHigh;	// same with the level highlighted
+		std::string			description;
+	};
+
+	struct Entry
+	{
+		BGSPerk				* basePerk;
+		UInt32				special;		// actor value of the SPECIAL perks, 0 otherwise
+		bool				multiRank;		// one form carrying every rank
+		bool				isVolatile;		// has conditions we can't track, evaluated on every refresh
+		int					numRanks;
+		std::vector<Rank>	ranks;
+
+		// last evaluation
+		bool				dirty;
+		int					level;
+		const Rank			* rank;			// rank on offer, nullptr if there is nothing to take
+		perkData			data;			// of the rank on offer
+		std::string			ranksInfo;
+	};
+
+	std::vector<Entry>	entries;
+	std::unordered_map<UInt32, std::vector<UInt32>>	perkDependents;	// perk formID -> entries
+	std::unordered_map<UInt32, std::vector<UInt32>>	avDependents;	// actor value formID -> entries
+
+	// player state the entries were last evaluated against
+	UInt32	lastLevel = 0;
+	UInt8	lastSex = 0xFF;
+	int		lastSpecial[7] = { -1, -1, -1, -1, -1, -1, -1 };
+
+	int * const specialValues[7] = { &pSTR, &pPER, &pEND, &pCHA, &pINT, &pAGI, &pLCK };
+
+	const int	kMaxRanks = 256;	// guards against broken nextPerk rings
+
+	UInt32 GetSpecialAV(UInt32 perkFormID)
+	{
+		switch (perkFormID)
+		{
+		case StrengthPerkID:		return StrengthID;
+		case PerceptionPerkID:		return PerceptionID;
+		case EndurancePerkID:		return EnduranceID;
+		case CharismaPerkID:		return CharismaID;
+		case IntelligencePerkID:	return IntelligenceID;
+		case AgilityPerkID:			return AgilityID;
+		case LuckPerkID:			return LuckID;
+		default:					return 0;
+		}
+	}
+
+	int GetFilterFlag(UInt32 avFormID)
+	{
+		switch (avFormID)
+		{
+		case StrengthID:		return filterFlag_S;
+		case PerceptionID:		return filterFlag_P;
+		case EnduranceID:		return filterFlag_E;
+		case CharismaID:		return filterFlag_C;
+		case IntelligenceID:	return filterFlag_I;
+		case AgilityID:			return filterFlag_A;
+		case LuckID:			return filterFlag_L;
+		default:				return filterFlag_NonSpecial;
+		}
+	}
+
+	void AddDependent(std::unordered_map<UInt32, std::vector<UInt32>> & map, UInt32 formID, UInt32 entryIndex)
+	{
+		std::vector<UInt32> & dependents = map[formID];
+		if (dependents.empty() || dependents.back() != entryIndex)
+			dependents.push_back(entryIndex);
+	}
+
+	void BuildRank(Entry & entry, UInt32 entryIndex, BGSPerk * perk, int rankNumber)
+	{
+		entry.ranks.emplace_back();
+		Rank & rank = entry.ranks.back();
+
+		rank.perk = perk;
+		rank.filterFlag = 0;
+		rank.label = "$Rank: " + std::to_string(rankNumber);
+		rank.levelReq = ". $PRKF_Requires: $PRKF_Level " + std::to_string(perk->perkLevel);
+		rank.levelReqHigh = ". $PRKF_Requires: <font color=\'#fa8e47\'>$PRKF_Level " + std::to_string(perk->perkLevel) + "</font>";
+		rank.description = GetDescription(perk).c_str();
+
+		AddDependent(perkDependents, perk->formID, entryIndex);
+
+		for (Condition * condition = perk->condition; condition; condition = condition->next)
+		{
+			Term term;
+			term.type = kTerm_None;
+			term.op = condition->comparisonType.op;
+			term.compareValue = condition->compareValue;
+			term.u32 = condition->param1.u32;
+			term.av = nullptr;
+
+			switch (condition->functionId)
+			{
+			case kFunction_GetPermanentValue:
+			case kFunction_GetBaseValue:
+			case kFunction_GetValue:
+				term.av = DYNAMIC_CAST(condition->param1.form, TESForm, ActorValueInfo);
+				if (!term.av)
+				{
+					entry.isVolatile = true;
+					break;
+				}
+				term.type = kTerm_ActorValue;
+				if (term.av->fullName.name == BSFixedString(""))
+					term.text = term.av->avName;
+				else
+					term.text = GetName(term.av).c_str();
+				if (term.op < 6)
+					term.text += compareops[term.op];
+				term.text += std::to_string((int)term.compareValue);
+
+				rank.filterFlag |= GetFilterFlag(term.av->formID);
+				AddDependent(avDependents, term.av->formID, entryIndex);
+				break;
+			case kFunction_GetIsSex:
+				term.type = kTerm_Sex;
+				break;
+			case kFunction_HasPerk:
+				if (condition->param1.form)
+					AddDependent(perkDependents, condition->param1.form->formID, entryIndex);
+				break;
+			default:
+				entry.isVolatile = true;
+				break;
+			}
+
+			if (condition->next)
+				term.separator = (condition->comparisonType.flags & 1) == 0 ? ", " : " $PRKF_or ";
+			else
+				term.separator = nullptr;
+
+			rank.terms.push_back(term);
+		}
+
+		if (rank.filterFlag == 0)
+			rank.filterFlag = filterFlag_Other;
+	}
+
+	void BuildEntry(BGSPerk * basePerk, UInt32 entryIndex)
+	{
+		entries.emplace_back();
+		Entry & entry = entries.back();
+
+		entry.basePerk = basePerk;
+		entry.special = GetSpecialAV(basePerk->formID);
+		entry.multiRank = false;
+		entry.isVolatile = false;
+		entry.numRanks = basePerk->numRanks;
+		entry.dirty = true;
+		entry.level = 0;
+		entry.rank = nullptr;
+
+		if (entry.special)
+		{
+			entry.numRanks = 9;
+			AddDependent(avDependents, entry.special, entryIndex);
+
+			BGSPerk * perk = basePerk;
+			for (int i = 0; i < basePerk->numRanks && perk; i++, perk = perk->nextPerk)
+				BuildRank(entry, entryIndex, perk, i + 1);
+			return;
+		}
+
+		// broken perks with a wrong numRanks, and single entry multi level perks
+		if (basePerk->numRanks > 1 && (basePerk->nextPerk == basePerk || basePerk->nextPerk == nullptr))
+		{
+			entry.multiRank = true;
+			BuildRank(entry, entryIndex, basePerk, 1);
+			return;
+		}
+
+		BGSPerk * perk = basePerk;
+		do
+		{
+			BuildRank(entry, entryIndex, perk, entry.ranks.size() + 1);
+			perk = perk->nextPerk;
+		} while (perk && perk != basePerk && entry.ranks.size() < kMaxRanks);
+
+		entry.numRanks = entry.ranks.size();
+	}
+
+	void Sync()
+	{
+		bool changed = Perks.count < entries.size();
+		for (UInt32 i = 0; i < entries.size() && !changed; i++)
+			changed = entries[i].basePerk != Perks.entries[i];
+
+		if (changed)
+		{
+			entries.clear();
+			perkDependents.clear();
+			avDependents.clear();
+		}
+
+		if (entries.size() == Perks.count)
+			return;
+
+		entries.reserve(Perks.count);
+		for (UInt32 i = entries.size(); i < Perks.count; i++)
+			BuildEntry(Perks.entries[i], i);
+
+		UInt32 numVolatile = 0;
+		for (auto & entry : entries)
+			numVolatile += entry.isVolatile ? 1 : 0;
+
+		_MESSAGE("perk cache: %i perks, %i evaluated on every refresh", (UInt32)entries.size(), numVolatile);
+	}
+
+	void InvalidateAll()
+	{
+		for (auto & entry : entries)
+			entry.dirty = true;
+	}
+
+	void InvalidateDependents(std::unordered_map<UInt32, std::vector<UInt32>> & map, UInt32 formID)
+	{
+		auto it = map.find(formID);
+		if (it == map.end())
+			return;
+
+		for (UInt32 entryIndex : it->second)
+			entries[entryIndex].dirty = true;
+	}
+
+	void InvalidatePerk(BGSPerk * perk)
+	{
+		if (perk)
+			InvalidateDependents(perkDependents, perk->formID);
+	}
+
+	void InvalidateActorValue(UInt32 formID)
+	{
+		InvalidateDependents(avDependents, formID);
+	}
+
+	bool Compare(float value, UInt8 op, float compareValue)
+	{
+		switch (op)
+		{
+		case kCompareOp_Equal:			return value == compareValue;
+		case kCompareOp_NotEqual:		return value != compareValue;
+		case kCompareOp_Greater:		return value > compareValue;
+		case kCompareOp_GreaterEqual:	return value >= compareValue;
+		case kCompareOp_Less:			return value < compareValue;
+		case kCompareOp_LessEqual:		return value <= compareValue;
+		default:						return true;
+		}
+	}
+
+	void EvaluateRank(const Rank & rank, perkData & result)
+	{
+		PlayerCharacter * pPC = (*g_player);
+		bool isAllowable = true;
+		bool isHighLevel = rank.perk->perkLevel > pLVL;
+
+		result.reqs = ", ";
+		for (auto & term : rank.terms)
+		{
+			switch (term.type)
+			{
+			case kTerm_ActorValue:
+				if (!Compare(GetBaseAV(term.av, pPC), term.op, term.compareValue))
+				{
+					result.reqs += "<font color=\'#fa8e47\'>";
+					result.reqs += term.text;
+					result.reqs += "</font>";
+				}
+				else
+				{
+					result.reqs += term.text;
+				}
+				break;
+			case kTerm_Sex:
+				isAllowable = isAllowable && (pSex != (term.u32 ^ (int)term.compareValue ^ (term.op != kCompareOp_Equal)));
+				break;
+			default:
+				break;
+			}
+
+			if (term.separator)
+				result.reqs += term.separator;
+		}
+
+		result.isEligible = !isHighLevel & EvaluationConditions(&(rank.perk->condition), pPC, pPC);
+		result.isAllowable = isAllowable;
+		result.isHighLevel = isHighLevel;
+		result.filterFlag = rank.filterFlag | (result.isEligible ? 1 : 2);
+		result.reqlevel = rank.perk->perkLevel;
+		result.SWFPath = rank.perk->swfPath;
+	}
+
+	void AppendRankInfo(std::string & ranksInfo, const Rank & rank)
+	{
+		ranksInfo += '\n';
+		ranksInfo += rank.description;
+		ranksInfo += '\n';
+	}
+
+	void Evaluate(Entry & entry)
+	{
+		entry.dirty = false;
+		entry.level = 0;
+		entry.rank = nullptr;
+		entry.ranksInfo.clear();
+
+		if (entry.special)
+		{
+			int value = *specialValues[entry.special - StrengthID];
+			int index = value > 1 ? value - 1 : 0;
+			if (value > entry.basePerk->numRanks || index >= (int)entry.ranks.size())
+				return;
+
+			entry.rank = &entry.ranks[index];
+			entry.level = value;
+			EvaluateRank(*entry.rank, entry.data);
+			return;
+		}
+
+		if (entry.multiRank)
+		{
+			int hasRank = HasPerk(*g_player, entry.basePerk);
+			if (hasRank < entry.numRanks)
+			{
+				entry.rank = &entry.ranks[0];
+				entry.level = hasRank + 1;
+				EvaluateRank(*entry.rank, entry.data);
+			}
+			return;
+		}
+
+		bool learned = false;
+		perkData data;
+
+		for (int i = 0; i < entry.numRanks; i++)
+		{
+			const Rank & rank = entry.ranks[i];
+
+			if (HasPerk(*g_player, rank.perk))
+			{
+				if (!learned)
+				{
+					learned = true;
+					entry.ranksInfo += "<u>$PRKF_Learned:</u>\n";
+				}
+				entry.ranksInfo += rank.label;
+				AppendRankInfo(entry.ranksInfo, rank);
+				continue;
+			}
+
+			// the first rank not learned is the one on offer
+			perkData & rankData = entry.rank ? data : entry.data;
+			if (!entry.rank)
+			{
+				entry.ranksInfo += learned ? "\n<u>$PRKF_NotLearned:</u>\n" : "<u>$PRKF_NotLearned:</u>\n";
+				entry.rank = &rank;
+				entry.level = i + 1;
+			}
+
+			EvaluateRank(rank, rankData);
+
+			entry.ranksInfo += rank.label;
+			if (!rankData.isEligible)
+			{
+				entry.ranksInfo += rankData.reqlevel > pLVL ? rank.levelReqHigh : rank.levelReq;
+				entry.ranksInfo += rankData.reqs;
+			}
+			AppendRankInfo(entry.ranksInfo, rank);
+		}
+	}
+
+	// marks whatever the player state changes since the last refresh touched
+	void CheckPlayerState()
+	{
+		if (pSex != lastSex)
+		{
+			InvalidateAll();
+			lastSex = pSex;
+		}
+
+		if (pLVL != lastLevel)
+		{
+			UInt32 low = pLVL < lastLevel ? pLVL : lastLevel;
+			UInt32 high = pLVL < lastLevel ? lastLevel : pLVL;
+
+			for (auto & entry : entries)
+			{
+				for (auto & rank : entry.ranks)
+				{
+					if (rank.perk->perkLevel > low && rank.perk->perkLevel <= high)
+					{
+						entry.dirty = true;
+						break;
+					}
+				}
+			}
+			lastLevel = pLVL;
+		}
+
+		for (int i = 0; i < 7; i++)
+		{
+			if (*specialValues[i] != lastSpecial[i])
+			{
+				InvalidateActorValue(StrengthID + i);
+				lastSpecial[i] = *specialValues[i];
+			}
+		}
+	}
+
+	void PopulatePerkEntries(GFxValue * dst, GFxMovieRoot * root)
+	{
+		Sync();
+		CheckPlayerState();
+
+		UInt32 numEvaluated = 0;
+		for (auto & entry : entries)
+		{
+			if (entry.dirty || entry.isVolatile)
+			{
+				Evaluate(entry);
+				numEvaluated++;
+			}
+		}
+		_DMESSAGE("perk cache: evaluated %i of %i perks", numEvaluated, (UInt32)entries.size());
+
+		for (auto & entry : entries)
+		{
+			if (!entry.rank || !entry.data.isAllowable)
+				continue;
+
+			BGSPerk * perk = entry.rank->perk;
+			GFxValue arrArg;
+			root->CreateObject(&arrArg);
+
+			RegisterString(&arrArg, root, "text", perk->fullName.name);
+			RegisterString(&arrArg, root, "reqs", entry.data.reqs.c_str());
+			RegisterInt(&arrArg, "filterFlag", entry.data.filterFlag);
+			RegisterBool(&arrArg, "iselig", entry.data.isEligible);
+			RegisterBool(&arrArg, "isHighLevel", entry.data.isHighLevel);
+			RegisterInt(&arrArg, "reqlevel", entry.data.reqlevel);
+			RegisterInt(&arrArg, "qname", entry.basePerk->formID);
+			RegisterInt(&arrArg, "formid", perk->formID);
+			RegisterInt(&arrArg, "level", entry.level);
+			RegisterString(&arrArg, root, "SWFPath", entry.data.SWFPath.c_str());
+			RegisterInt(&arrArg, "numranks", entry.numRanks);
+			RegisterInt(&arrArg, "type", type_default);
+			RegisterString(&arrArg, root, "ranksInfo", entry.ranksInfo.c_str());
+			RegisterString(&arrArg, root, "description", entry.rank->description.c_str());
+			dst->PushBack(&arrArg);
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "f4se/ScaleformValue.h"
+#include "f4se/ScaleformMovie.h"
+
+class BGSPerk;
+
+// Flattened perk graph for the level up menu.
+// Rank chains, requirement terms and description text are read from the forms once, only the
+// entries whose inputs changed are re-evaluated when the menu is refreshed.
+namespace PRKFPerkCache
+{
+	// picks up perks added to the perk list since the last call
+	void Sync();
+
+	void InvalidateAll();
+	void InvalidatePerk(BGSPerk * perk);
+	void InvalidateActorValue(UInt32 formID);
+
+	void PopulatePerkEntries(GFxValue * dst, GFxMovieRoot * root);
+}
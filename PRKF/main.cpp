@@ -4,10 +4,14 @@
 #include "f4se/PapyrusNativeFunctions.h"
 
 #include "f4se/GameSettings.h"
+#include "f4se_common/Utilities.h"
 #include "common/IDirectoryIterator.h"
 
 #include "PRKFSerialization.h"
 #include "PRKFTranslator.h"
+#include "PRKFPerkCache.h"
+
+IDEBUGLOG_MODULE("PRKF");
 
 std::string mName = "PRKFVR";
 UInt32 mVer = 1;
@@ -102,6 +106,7 @@ EventResult	TESLoadGameHandler::ReceiveEvent(TESLoadGameEvent * evn, void * disp
 	}
 
 	GetBasicData();
+	PRKFPerkCache::InvalidateAll();
 	return kEvent_Continue;
 }
 
@@ -156,328 +161,6 @@ inline void ModPerkPointsAV(SInt32 count)
 	}
 }
 
-AvailablePerk GetSpecialPerk(BGSPerk* aPerk, int aVal) {
-	AvailablePerk result;
-	if (aVal > aPerk->numRanks)
-	{
-		result.Perk = nullptr;
-		result.Level = 0;
-		result.NumRanks = 0;
-		result.ranksInfo = BSFixedString("");
-		return result;
-	}
-	BGSPerk* tempperk = aPerk;
-	for (int i = 0; i < aVal - 1; i++)
-	{
-		tempperk = tempperk->nextPerk;
-	}
-	result.Perk = tempperk;
-	result.Level = aVal;
-	result.NumRanks = 9;
-	result.ranksInfo = BSFixedString("");
-	return result;
-}
-
-AvailablePerk GetAvailablePerk(BGSPerk* aPerk) {
-	AvailablePerk result;
-
-	result.Level = 0;
-	result.Perk = nullptr;
-	result.ranksInfo = BSFixedString("");
-	result.NumRanks = aPerk->numRanks;
-	std::string tempRanksInfo = "";
-	BGSPerk* tempperk;
-	switch (aPerk->formID)
-	{
-	case StrengthPerkID:
-		return GetSpecialPerk(aPerk, pSTR);
-		break;
-	case PerceptionPerkID:
-		return GetSpecialPerk(aPerk, pPER);
-		break;
-	case EndurancePerkID:
-		return GetSpecialPerk(aPerk, pEND);
-		break;
-	case CharismaPerkID:
-		return GetSpecialPerk(aPerk, pCHA);
-		break;
-	case IntelligencePerkID:
-		return GetSpecialPerk(aPerk, pINT);
-		break;
-	case AgilityPerkID:
-		return GetSpecialPerk(aPerk, pAGI);
-		break;
-	case LuckPerkID:
-		return GetSpecialPerk(aPerk, pLCK);
-		break;
-	default:
-
-		bool gotresult = false;
-		bool learned = false;
-		tempperk = aPerk;
-		// workaround for broken perks with wrong numranks and support one entry multylevel perks
-		if (aPerk->numRanks > 1 && (aPerk->nextPerk == aPerk || aPerk->nextPerk == nullptr))
-		{
-			int hasRank = HasPerk(*g_player, tempperk);
-			if (hasRank < aPerk->numRanks)
-			{
-				result.Level = hasRank+1;
-				result.Perk = aPerk;
-				return result;
-			}
-			else
-			{
-				return result;
-			}
-		}
-		else
-		{
-			int counter = 0;
-			while (true)
-			{
-				tempperk = tempperk->nextPerk;
-				counter++;
-				if (tempperk == aPerk || tempperk == nullptr)
-				{
-					break;
-				}
-			}
-			if (counter != aPerk->numRanks)
-			{
-				result.NumRanks = counter;
-			}
-		}
-		// end
-		tempperk = aPerk;
-
-		for (int i = 0; i < result.NumRanks; i++)
-		{
-			if (!HasPerk(*g_player, tempperk))
-			{
-				if (!gotresult)
-				{
-					gotresult = true;
-					if (learned)
-					{
-						tempRanksInfo += "\n<u>$PRKF_NotLearned:</u>\n";
-					}
-					else
-					{
-						tempRanksInfo += "<u>$PRKF_NotLearned:</u>\n";
-					}
-					result.Perk = tempperk;
-					result.Level = i + 1;
-				}
-				auto perkdata = getperkreqs_internal(tempperk);
-				if (perkdata.isEligible)
-				{
-					tempRanksInfo += "$Rank: " + std::to_string(i + 1) + "\n" + std::string(GetDescription(tempperk)) + "\n";
-				}
-				else
-				{
-					if (perkdata.reqlevel > pLVL)
-					{
-						tempRanksInfo += "$Rank: " + std::to_string(i + 1) + ". $PRKF_Requires: <font color=\'#fa8e47\'>$PRKF_Level " + std::to_string(perkdata.reqlevel) + "</font>" + perkdata.reqs + "\n" + std::string(GetDescription(tempperk)) + "\n";
-					}
-					else
-					{
-						tempRanksInfo += "$Rank: " + std::to_string(i + 1) + ". $PRKF_Requires: $PRKF_Level " + std::to_string(perkdata.reqlevel) + "" + perkdata.reqs + "\n" + std::string(GetDescription(tempperk)) + "\n";
-					}
-
-				}
-				//return result;
-			}
-			else
-			{
-				if (!learned)
-				{
-					learned = true;
-					tempRanksInfo += "<u>$PRKF_Learned:</u>\n";
-				}
-				tempRanksInfo += "$Rank: " + std::to_string(i + 1) + "\n" + std::string(GetDescription(tempperk)) + "\n";
-			}
-			tempperk = tempperk->nextPerk;
-		}
-		break;
-	}
-	result.ranksInfo = BSFixedString(tempRanksInfo.c_str());
-	return result;
-}
-
-perkData getperkreqs_internal(BGSPerk* thisPerk) {
-
-	perkData result;
-	PlayerCharacter* pPC = (*g_player);
-	bool isAllowable = true;
-	bool isHighLevel = thisPerk->perkLevel > pLVL;
-	bool isEligible = !isHighLevel;
-	int filterFlag = 0;
-	result.reqlevel = thisPerk->perkLevel;
-	std::string str = ", ";
-	/*if (isHighLevel)
-		str = "$PRKF_Requires: <font color=\'#fa8e47\'>";// fa8e47
-	else
-		str = "$PRKF_Requires: ";
-	str += "$PRKF_Level " + std::to_string(thisPerk->perkLevel);
-	if (isHighLevel)
-		str += "</font>";*/
-	Condition* tempcondition = thisPerk->condition;
-	bool lastFlag = false; // and
-	while (tempcondition) {
-		UInt32 functionId = tempcondition->functionId;
-		float compareValue = tempcondition->compareValue;
-		TESForm * param1 = tempcondition->param1.form;
-		UInt32 u321 = tempcondition->param1.u32;
-		UInt8 op = tempcondition->comparisonType.op;
-		UInt8 flag = tempcondition->comparisonType.flags;
-		ActorValueInfo * tempav;
-		bool iselig = true;
-		switch (functionId)
-		{
-		case kFunction_GetPermanentValue:
-		case kFunction_GetBaseValue:
-		case kFunction_GetValue:
-			tempav = DYNAMIC_CAST(param1, TESForm, ActorValueInfo);
-			switch (op)
-			{
-			case kCompareOp_Equal:
-				iselig = GetBaseAV(tempav, pPC) == compareValue;
-				break;
-			case kCompareOp_NotEqual:
-				iselig = GetBaseAV(tempav, pPC) != compareValue;
-				break;
-			case kCompareOp_Greater:
-				iselig = GetBaseAV(tempav, pPC) > compareValue;
-				break;
-			case kCompareOp_GreaterEqual:
-				iselig = GetBaseAV(tempav, pPC) >= compareValue;
-				break;
-			case kCompareOp_Less:
-				iselig = GetBaseAV(tempav, pPC) < compareValue;
-				break;
-			case kCompareOp_LessEqual:
-				iselig = GetBaseAV(tempav, pPC) <= compareValue;
-				break;
-			default:
-				break;
-			}
-			switch (tempav->formID)
-			{
-			case StrengthID:
-				filterFlag |= filterFlag_S;
-				break;
-			case PerceptionID:
-				filterFlag |= filterFlag_P;
-				break;
-			case EnduranceID:
-				filterFlag |= filterFlag_E;
-				break;
-			case CharismaID:
-				filterFlag |= filterFlag_C;
-				break;
-			case IntelligenceID:
-				filterFlag |= filterFlag_I;
-				break;
-			case AgilityID:
-				filterFlag |= filterFlag_A;
-				break;
-			case LuckID:
-				filterFlag |= filterFlag_L;
-				break;
-			default:
-				filterFlag |= filterFlag_NonSpecial;
-				break;
-			}
-
-			//	if (iselig)
-			//		str += "";
-			//	else
-			//		str += "<font color=\'#fa8e47\'>";// fa8e47
-			if (!iselig)
-				str += "<font color=\'#fa8e47\'>";// fa8e47
-			if (tempav->fullName.name == BSFixedString(""))
-			{
-				str += tempav->avName;
-			}
-			else {
-				str += GetName(tempav).c_str();
-			}
-
-			str += compareops[op] + std::to_string((int)compareValue);
-			if (!iselig)
-				str += "</font>";
-			break;
-		case kFunction_GetIsSex:
-			isAllowable = isAllowable && (pSex != (u321 ^ (int)compareValue ^ (op != kCompareOp_Equal)));
-			break;
-		case kFunction_HasPerk:
-
-			break;
-		default:
-			break;
-		}
-		lastFlag = ((flag & 1) == 0);
-		tempcondition = tempcondition->next;
-		if (tempcondition)
-		{
-			if (lastFlag)
-			{
-				str += ", ";
-			}
-			else
-			{
-				str += " $PRKF_or ";
-			}
-		}
-	}
-	result.isEligible = isEligible & EvaluationConditions(&(thisPerk->condition), pPC, pPC);
-	result.isAllowable = isAllowable;
-	result.isHighLevel = isHighLevel;
-	if (filterFlag == 0) filterFlag |= filterFlag_Other;
-	result.filterFlag = filterFlag | (result.isEligible ? 1 : 2);
-	result.reqs = str;
-	result.SWFPath = thisPerk->swfPath;
-	return result;
-}
-
-void PopulatePerkEntry(GFxValue * dst, GFxMovieRoot * root, BGSPerk * basePerk) {
-	//_DMESSAGE("PopulatePerkEntry %s", basePerk->fullName.name.c_str());
-	AvailablePerk curperk = GetAvailablePerk(basePerk);
-	if (curperk.Perk != nullptr)
-	{
-
-		perkData tempperkdata = getperkreqs_internal(curperk.Perk);
-		GFxValue arrArg;
-		root->CreateObject(&arrArg);
-
-		RegisterString(&arrArg, root, "text", curperk.Perk->fullName.name);
-		RegisterString(&arrArg, root, "reqs", tempperkdata.reqs.c_str());
-		RegisterInt(&arrArg, "filterFlag", tempperkdata.filterFlag); //,tempperkdata.isEligible? 1:2);
-		RegisterBool(&arrArg, "iselig", tempperkdata.isEligible);
-		RegisterBool(&arrArg, "isHighLevel", tempperkdata.isHighLevel);
-		RegisterInt(&arrArg, "reqlevel", tempperkdata.reqlevel);
-		RegisterInt(&arrArg, "qname", basePerk->formID);
-		RegisterInt(&arrArg, "formid", curperk.Perk->formID);
-		RegisterInt(&arrArg, "level", curperk.Level);
-		RegisterString(&arrArg, root, "SWFPath", tempperkdata.SWFPath.c_str());
-		RegisterInt(&arrArg, "numranks", curperk.NumRanks);
-
-		//if (basePerk->formID == IntenseTrainingPerkID) {
-		//	RegisterInt(&arrArg, "type", type_intensetraining);
-		//}
-		//else {
-		RegisterInt(&arrArg, "type", type_default);
-		//}
-
-		RegisterString(&arrArg, root, "ranksInfo", curperk.ranksInfo);
-		RegisterString(&arrArg, root, "description", GetDescription(curperk.Perk).c_str());
-		if (tempperkdata.isAllowable)// && !tempperkdata.isHighLevel)
-		{
-			dst->PushBack(&arrArg);
-		}
-	}
-}
-
 void PopulateSkillEntry(GFxValue * dst, GFxMovieRoot * root, ActorValueInfo * baseSkill)
 {
 	GFxValue arrArg;
@@ -556,11 +239,7 @@ bool processLists(GFxMovieRoot * root) {
 	GetBasicData();
 	GFxValue arrArgs[5];
 	root->CreateArray(&arrArgs[0]);
-	for (int i = 0; i < Perks.count; i++)
-	{
-		BGSPerk * basePerk = Perks.entries[i];
-		PopulatePerkEntry(&arrArgs[0], root, basePerk);
-	}
+	PRKFPerkCache::PopulatePerkEntries(&arrArgs[0], root);
 	root->CreateArray(&arrArgs[1]);
 	for (int j = 0; j < Skills.count; j++)
 	{
@@ -683,6 +362,7 @@ public:
 			TESForm * aForm = LookupFormByID(args->args[0].GetUInt());
 			BGSPerk* aPerk = DYNAMIC_CAST(aForm, TESForm, BGSPerk);
 			AddPerk(*g_player, aPerk, 0);
+			PRKFPerkCache::InvalidatePerk(aPerk);
 			break;
 		}
 		//ModPerkPointsAV(-1);
@@ -700,6 +380,7 @@ public:
 		TESForm * aForm = LookupFormByID(args->args[0].GetUInt());
 		BGSPerk* aPerk = DYNAMIC_CAST(aForm, TESForm, BGSPerk);
 		AddPerk(*g_player, aPerk, 0);
+		PRKFPerkCache::InvalidatePerk(aPerk);
 	}
 };
 
@@ -722,6 +403,7 @@ public:
 			arrayelement.GetMember("ivalue", &objelementvalue);
 			//_DMESSAGE("formid: %i, value: %i", objelementformid.GetInt(), objelementvalue.GetInt());
 			ModBaseAVByFormID(objelementformid.GetInt(), *g_player, objelementvalue.GetInt());
+			PRKFPerkCache::InvalidateActorValue(objelementformid.GetInt());
 		}
 		UpdateMenu_int();
 	}
@@ -814,6 +496,7 @@ public:
 		_MESSAGE("type1 %i type2 %i", args->args[0].GetType(), args->args[1].GetType());
 		PRKFSerialization::AddTS(args->args[0].GetUInt());
 		SetBaseAVByFormID(args->args[0].GetUInt(), *g_player, args->args[1].GetUInt());
+		PRKFPerkCache::InvalidateActorValue(args->args[0].GetUInt());
 		_DMESSAGE("tagskill: %08X setbasevalue to %i", args->args[0].GetUInt(), args->args[1].GetUInt());
 	}
 };
@@ -827,6 +510,7 @@ public:
 		_MESSAGE("type1 %i type2 %i", args->args[0].GetType(), args->args[1].GetType());
 		PRKFSerialization::RemoveTS(args->args[0].GetUInt());
 		SetBaseAVByFormID(args->args[0].GetUInt(), *g_player, args->args[1].GetUInt());
+		PRKFPerkCache::InvalidateActorValue(args->args[0].GetUInt());
 		_DMESSAGE("untagskill: %08X setbasevalue to %i", args->args[0].GetUInt(), args->args[1].GetUInt());
 	}
 };
@@ -1120,6 +804,7 @@ void fillarrays()
 	_DMESSAGE("Total SP to add per level: %i ", SPPerLevelToAdd);
 	_MESSAGE("total perks count: %i", Perks.count);
 	_MESSAGE("total skills count: %i", Skills.count);
+	PRKFPerkCache::Sync();
 	PRKFReadyMessage message;
 	g_messaging->Dispatch(g_pluginHandle, PRKFReadyMessage::kMessage_PRKFReady, (void*)&message, sizeof(PRKFReadyMessage*), nullptr);
 }
@@ -1553,6 +1238,8 @@ UInt32 LevelupMenuProcessMessage_Hook(LevelUpMenu * menu, UIMessage * message) {
 	if (message->type == 1)
 	{
 		RegisterForInput(true);
+		// anything may have changed while the menu was closed
+		PRKFPerkCache::InvalidateAll();
 		UpdateMenu_int();
 	}
 	else if (message->type == 3)
@@ -1569,6 +1256,7 @@ extern "C"
 	bool F4SEPlugin_Query(const F4SEInterface * f4se, PluginInfo * info)
 	{
 		gLog.OpenRelative(CSIDL_MYDOCUMENTS, (const char*)("\\My Games\\Fallout4VR\\F4SE\\" + mName + ".log").c_str());
+		gLog.ReadModuleLevels(GetConfigPath().c_str(), "Logging");
 
 		logMessage("query");
 
@@ -24,11 +24,20 @@ public:
 };
 
 
+extern tArray<BGSPerk*> Perks;
+
+// player state read by GetBasicData
+extern UInt32 pLVL;
+extern UInt8 pSex;
+extern int pSTR;
+extern int pPER;
+extern int pEND;
+extern int pCHA;
+extern int pINT;
+extern int pAGI;
+extern int pLCK;
+
 void GetBasicData();
-AvailablePerk GetSpecialPerk(BGSPerk* aPerk, int aVal);
-AvailablePerk GetAvailablePerk(BGSPerk* aPerk);
-void PopulatePerkEntry(GFxValue * dst, GFxMovieRoot * root, BGSPerk * basePerk);
-perkData getperkreqs_internal(BGSPerk* thisPerk);
 void PopulateSkillEntry(GFxValue * dst, GFxMovieRoot * root, ActorValueInfo * baseSkill);
 
 bool processLists(GFxMovieRoot * root);
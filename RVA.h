@@ -84,10 +84,20 @@ public:
     static void UpdateAddresses(UInt32 runtimeVersion) {
         RVAUtils::Timer tmr; tmr.start();
 
+        // resolve every signature that will need a scan in one pass over the executable
+        std::vector<const char*> sigs;
+        for (auto rvaData : m_rvaDataVec()) {
+            if (rvaData->effectiveAddress || !rvaData->sig) continue;
+            if (SHOW_ADDR != 1 && rvaData->addr.count(runtimeVersion) > 0) continue;
+            sigs.push_back(rvaData->sig);
+        }
+        Utility::pattern::prefetch(sigs, 1);
+
         for (auto rvaData : m_rvaDataVec()) {
             if (rvaData->effectiveAddress) continue;
             UpdateSingle(rvaData, runtimeVersion);
         }
+        Utility::pattern::save_hints();
 
         if (SHOW_ADDR) _MESSAGE("Sigscan elapsed: %llu ms.", tmr.stop());
     }
@@ -0,0 +1,265 @@
+#include "IBufferedReadStream.h"
+#include <string.h>
+
+IBufferedReadStream::IBufferedReadStream(UInt32 inBlockSize)
+:stream(NULL), blockBuf(NULL), blockSize(inBlockSize), blockOffset(0), blockPos(0), blockLength(0)
+{
+	ASSERT_STR(blockSize > 0, "IBufferedReadStream: zero block size");
+
+	blockBuf = new UInt8[blockSize];
+}
+
+IBufferedReadStream::IBufferedReadStream(IDataStream * inStream, UInt32 inBlockSize)
+:stream(NULL), blockBuf(NULL), blockSize(inBlockSize), blockOffset(0), blockPos(0), blockLength(0)
+{
+	ASSERT_STR(blockSize > 0, "IBufferedReadStream: zero block size");
+
+	blockBuf = new UInt8[blockSize];
+
+	Attach(inStream);
+}
+
+IBufferedReadStream::~IBufferedReadStream()
+{
+	delete [] blockBuf;
+}
+
+/**
+ *	Wraps a stream, starting at its current position
+ *
+ *	The stream's length is taken once, here.
+ */
+void IBufferedReadStream::Attach(IDataStream * inStream)
+{
+	stream = inStream;
+
+	streamLength = inStream->GetLength();
+	streamOffset = inStream->GetOffset();
+
+	blockOffset = streamOffset;
+	blockPos = 0;
+	blockLength = 0;
+}
+
+/**
+ *	Reads the next block from the wrapped stream
+ *
+ *	@return false at the end of the stream
+ */
+bool IBufferedReadStream::Fill(void)
+{
+	blockOffset = streamOffset;
+	blockPos = 0;
+	blockLength = 0;
+
+	SInt64	remain = streamLength - streamOffset;
+	if(remain <= 0)
+		return false;
+
+	UInt32	length = blockSize;
+	if(remain < length)
+		length = remain;
+
+	if(stream->GetOffset() != streamOffset)
+		stream->SetOffset(streamOffset);
+
+	stream->ReadBuf(blockBuf, length);
+
+	// a short read leaves the rest for the next fill
+	blockLength = stream->GetOffset() - streamOffset;
+
+	return blockLength > 0;
+}
+
+UInt8 IBufferedReadStream::Read8(void)
+{
+	if((blockPos == blockLength) && !Fill())
+		return 0;
+
+	streamOffset++;
+
+	return blockBuf[blockPos++];
+}
+
+/**
+ *	Returns the first of up to four terminators in a block of data
+ *
+ *	Each terminator gets a memchr, and each search after the first only looks as
+ *	far as the nearest match so far.
+ */
+static const UInt8 * FindTerminator(const UInt8 * src, UInt32 length, const char * terminators, UInt32 numTerminators)
+{
+	const UInt8	* result = NULL;
+
+	for(UInt32 i = 0; i < numTerminators; i++)
+	{
+		const UInt8	* found = (const UInt8 *)memchr(src, (UInt8)terminators[i], length);
+		if(found)
+		{
+			result = found;
+			length = found - src;
+		}
+	}
+
+	return result;
+}
+
+/**
+ *	Reads a null-or-return-terminated string from the stream
+ *
+ *	Gives the same results as IDataStream::ReadString, scanning the buffered
+ *	block rather than reading a byte at a time.
+ *
+ *	@param buf the output buffer
+ *	@param bufLength the size of the output buffer
+ *	@return the number of characters written to the buffer
+ */
+UInt32 IBufferedReadStream::ReadString(char * buf, UInt32 bufLength, char altTerminator, char altTerminator2)
+{
+	bool	breakOnReturns = (altTerminator == '\n') || (altTerminator2 == '\n');
+
+	ASSERT_STR(bufLength > 0, "IBufferedReadStream::ReadString: zero-sized buffer");
+
+	if(bufLength == 1)
+	{
+		buf[0] = 0;
+		return 0;
+	}
+
+	bufLength--;
+
+	// the line ending first, it finds the end of the string soonest
+	char	terminators[4];
+	UInt32	numTerminators = 0;
+
+	if(altTerminator)
+		terminators[numTerminators++] = altTerminator;
+	if(altTerminator2 && (altTerminator2 != altTerminator))
+		terminators[numTerminators++] = altTerminator2;
+	if(breakOnReturns && (altTerminator != '\r') && (altTerminator2 != '\r'))
+		terminators[numTerminators++] = '\r';
+
+	terminators[numTerminators++] = 0;
+
+	UInt32	length = 0;
+
+	while(length < bufLength)
+	{
+		if((blockPos == blockLength) && !Fill())
+			break;
+
+		const UInt8	* src = blockBuf + blockPos;
+		UInt32		srcLength = blockLength - blockPos;
+
+		if(srcLength > bufLength - length)
+			srcLength = bufLength - length;
+
+		const UInt8	* terminator = FindTerminator(src, srcLength, terminators, numTerminators);
+		UInt32		copyLength = terminator ? terminator - src : srcLength;
+
+		memcpy(buf + length, src, copyLength);
+
+		length += copyLength;
+		blockPos += copyLength;
+		streamOffset += copyLength;
+
+		if(terminator)
+		{
+			blockPos++;
+			streamOffset++;
+
+			if(breakOnReturns && (*terminator == 0x0D))
+			{
+				if(!HitEOF() && (Peek8() == 0x0A))
+					Skip(1);
+			}
+
+			break;
+		}
+	}
+
+	buf[length] = 0;
+
+	return length;
+}
+
+void IBufferedReadStream::ReadBuf(void * buf, UInt32 inLength)
+{
+	UInt8	* out = (UInt8 *)buf;
+
+	while(inLength > 0)
+	{
+		if(blockPos == blockLength)
+		{
+			// reads a block or longer skip the buffer
+			if(inLength >= blockSize)
+			{
+				if(stream->GetOffset() != streamOffset)
+					stream->SetOffset(streamOffset);
+
+				stream->ReadBuf(out, inLength);
+
+				streamOffset = stream->GetOffset();
+				blockOffset = streamOffset;
+				blockPos = 0;
+				blockLength = 0;
+
+				break;
+			}
+
+			if(!Fill())
+				break;
+		}
+
+		UInt32	length = blockLength - blockPos;
+		if(length > inLength)
+			length = inLength;
+
+		memcpy(out, blockBuf + blockPos, length);
+
+		out += length;
+		inLength -= length;
+		blockPos += length;
+		streamOffset += length;
+	}
+}
+
+UInt8 IBufferedReadStream::Peek8(void)
+{
+	if((blockPos == blockLength) && !Fill())
+		return 0;
+
+	return blockBuf[blockPos];
+}
+
+void IBufferedReadStream::PeekBuf(void * buf, UInt32 inLength)
+{
+	if(inLength <= blockLength - blockPos)
+		memcpy(buf, blockBuf + blockPos, inLength);
+	else
+		IDataStream::PeekBuf(buf, inLength);
+}
+
+void IBufferedReadStream::WriteBuf(const void * buf, UInt32 inLength)
+{
+	HALT("IBufferedReadStream::WriteBuf: writing unsupported");
+}
+
+/**
+ *	Moves the current offset, keeping the block if the offset is in it
+ */
+void IBufferedReadStream::SetOffset(SInt64 inOffset)
+{
+	if((inOffset >= blockOffset) && (inOffset <= blockOffset + blockLength))
+	{
+		blockPos = inOffset - blockOffset;
+	}
+	else
+	{
+		blockOffset = inOffset;
+		blockPos = 0;
+		blockLength = 0;
+	}
+
+	streamOffset = inOffset;
+}
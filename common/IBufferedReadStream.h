@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/IDataStream.h"
+
+/**
+ *	A read-ahead buffer in front of another stream
+ *
+ *	Reads from the wrapped stream a block at a time, so byte and string reads
+ *	are served from memory instead of going to the stream (and for an
+ *	IFileStream, to ReadFile) once per byte. Offsets are the wrapped stream's
+ *	offsets. The wrapped stream's own position is undefined while it is
+ *	attached.
+ */
+class IBufferedReadStream : public IDataStream
+{
+	public:
+		enum
+		{
+			kDefaultBlockSize =	64 * 1024,
+		};
+
+		IBufferedReadStream(UInt32 inBlockSize = kDefaultBlockSize);
+		IBufferedReadStream(IDataStream * inStream, UInt32 inBlockSize = kDefaultBlockSize);
+		~IBufferedReadStream();
+
+		void	Attach(IDataStream * inStream);
+
+		virtual UInt8	Read8(void);
+		virtual UInt32	ReadString(char * buf, UInt32 bufLength, char altTerminator = 0, char altTerminator2 = 0);
+		virtual void	ReadBuf(void * buf, UInt32 inLength);
+
+		virtual UInt8	Peek8(void);
+		virtual void	PeekBuf(void * buf, UInt32 inLength);
+
+		virtual void	WriteBuf(const void * buf, UInt32 inLength);
+		virtual void	SetOffset(SInt64 inOffset);
+
+		// reads up to the next \n, \r\n or \r, the same as ReadString(buf, bufLength, '\n', '\r')
+		UInt32	ReadLine(char * buf, UInt32 bufLength)	{ return ReadString(buf, bufLength, '\n', '\r'); }
+
+		virtual IDataStream *	GetParent(void)	{ return stream; }
+
+	private:
+		IBufferedReadStream(const IBufferedReadStream & rhs);
+		IBufferedReadStream & operator=(const IBufferedReadStream & rhs);
+
+		bool	Fill(void);
+
+		IDataStream	* stream;
+
+		UInt8	* blockBuf;
+		UInt32	blockSize;
+
+		SInt64	blockOffset;	//!< stream offset of blockBuf[0]
+		UInt32	blockPos;		//!< read position in blockBuf
+		UInt32	blockLength;	//!< bytes in blockBuf
+};
@@ -2,6 +2,7 @@
 #include <share.h>
 #include "common/IFileStream.h"
 #include <shlobj.h>
+#include <atomic>
 
 std::FILE			* IDebugLog::logFile = NULL;
 char				IDebugLog::sourceBuf[16] = { 0 };
@@ -14,6 +15,628 @@ int					IDebugLog::inBlock = 0;
 bool				IDebugLog::autoFlush = true;
 IDebugLog::LogLevel	IDebugLog::logLevel = IDebugLog::kLevel_DebugMessage;
 IDebugLog::LogLevel	IDebugLog::printLevel = IDebugLog::kLevel_Message;
+IDebugLog::Module	IDebugLog::defaultModule("default", (2 << kLevel_DebugMessage) - 1);	// constant initialized, static constructors log
+IDebugLog::Module	* IDebugLog::modules = NULL;
+
+// asynchronous logging
+// every thread that logs gets a ring of its own and is the only one writing to it. a log call copies the format string
+// and its arguments in to the ring, formatting and file writes happen on the writer thread, which drains all of the
+// rings in the order the records were queued. a record that doesn't fit is dropped and counted, the writer reports
+// the count in the log. rings are never freed, the ring of a thread that exits goes to the next new thread, so memory
+// is bounded by kMaxRings rings
+
+namespace
+{
+	enum
+	{
+		kRingSize =			128 * 1024,		// power of two
+		kMaxRings =			64,
+		kMaxRecordSize =	8 * 1024 + 64,	// formatBuf and a header
+		kMaxSpecLength =	32,
+
+		kWriterInterval =	10,		// ms between drains when nothing wakes the writer early
+		kCrashWait =		100,	// ms a crashing or exiting thread waits for the writer to finish a drain
+	};
+
+	enum
+	{
+		kRecord_Wrap = 0,		// padding to the end of the ring
+		kRecord_Format,			// format string and packed arguments
+		kRecord_Text,			// preformatted text
+		kRecord_SetSource,
+		kRecord_ClearSource,
+		kRecord_Indent,
+		kRecord_Outdent,
+		kRecord_OpenBlock,
+		kRecord_CloseBlock,
+	};
+
+	enum
+	{
+		kFlag_Log =		1 << 0,
+		kFlag_Print =	1 << 1,
+		kFlag_NewLine =	1 << 2,
+	};
+
+	struct Ring
+	{
+		alignas(64) std::atomic <UInt32>	head;	// bytes queued, producer
+		UInt32								cachedTail;	// producer, reloaded when the ring looks full
+		alignas(64) std::atomic <UInt32>	tail;	// bytes drained, writer
+		std::atomic <UInt32>	numDropped;
+		std::atomic <bool>		inUse;
+		Ring					* next;
+
+		UInt8	scratch[kMaxRecordSize];	// producer, records are packed here before they are copied in
+		UInt8	data[kRingSize];
+	};
+
+	// gives the thread's ring back when it exits
+	struct RingHolder
+	{
+		Ring	* ring = nullptr;
+
+		~RingHolder()
+		{
+			if(ring)
+				ring->inUse.store(false, std::memory_order_release);
+		}
+	};
+
+	std::atomic <Ring *>	s_rings(nullptr);
+	std::atomic <UInt32>	s_numRings(0);
+	thread_local RingHolder	s_threadRing;
+
+	std::atomic <UInt64>	s_sequence(0);
+	std::atomic <UInt32>	s_numDroppedNoRing(0);	// threads past kMaxRings
+	std::atomic <UInt64>	s_numDropped(0);		// reported so far
+
+	std::atomic <bool>		s_async(false);
+	std::atomic <bool>		s_stopWriter(false);
+	std::atomic <DWORD>		s_drainOwner(0);		// thread id, drains and file changes are serialized on it
+	HANDLE					s_writerThread = NULL;
+	HANDLE					s_wakeEvent = NULL;
+	bool					s_crashFilterSet = false;
+	LPTOP_LEVEL_EXCEPTION_FILTER	s_prevCrashFilter = NULL;
+
+	UInt32 AlignRecord(UInt32 size)
+	{
+		return (size + 7) & ~7;
+	}
+
+	Ring * GetThreadRing(void)
+	{
+		RingHolder	& holder = s_threadRing;
+
+		if(holder.ring)
+			return holder.ring;
+
+		for(Ring * ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next)
+		{
+			bool	expected = false;
+
+			if(!ring->inUse.load(std::memory_order_relaxed) && ring->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+				return holder.ring = ring;
+		}
+
+		if(s_numRings.fetch_add(1, std::memory_order_relaxed) >= kMaxRings)
+		{
+			s_numRings.fetch_sub(1, std::memory_order_relaxed);
+			return NULL;
+		}
+
+		Ring	* ring = new Ring;
+
+		ring->head.store(0, std::memory_order_relaxed);
+		ring->tail.store(0, std::memory_order_relaxed);
+		ring->cachedTail = 0;
+		ring->numDropped.store(0, std::memory_order_relaxed);
+		ring->inUse.store(true, std::memory_order_relaxed);
+		ring->next = s_rings.load(std::memory_order_relaxed);
+
+		while(!s_rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) { }
+
+		return holder.ring = ring;
+	}
+
+	bool LockDrain(UInt32 maxWait)
+	{
+		DWORD	threadID = GetCurrentThreadId();
+		UInt32	waited = 0;
+
+		while(true)
+		{
+			DWORD	expected = 0;
+
+			if(s_drainOwner.compare_exchange_strong(expected, threadID, std::memory_order_acquire))
+				return true;
+
+			// a thread crashing in the middle of its own drain
+			if(expected == threadID || waited >= maxWait)
+				return false;
+
+			Sleep(1);
+			waited++;
+		}
+	}
+
+	void UnlockDrain(void)
+	{
+		s_drainOwner.store(0, std::memory_order_release);
+	}
+
+	// printf conversions, parsed the same way when the arguments are packed and when they are formatted
+
+	enum
+	{
+		kArg_None,		// %%
+		kArg_Int,
+		kArg_Long,
+		kArg_LongLong,
+		kArg_SizeT,
+		kArg_Double,
+		kArg_String,
+		kArg_Pointer,
+		kArg_Unsupported,	// wide strings, long doubles, %n, formatted on the calling thread
+	};
+
+	enum
+	{
+		kNullString =	0xFFFFFFFF,
+	};
+
+	enum
+	{
+		kPrecision_None =	-1,
+		kPrecision_Star =	-2,		// the last star argument
+	};
+
+	struct FormatSpec
+	{
+		UInt32	length;		// from the '%' through the conversion
+		UInt32	numStars;	// int arguments taken by the width and precision
+		UInt32	arg;
+		int		precision;	// kPrecision_None, kPrecision_Star or the digits after the '.'
+	};
+
+	void ParseSpec(const char * fmt, FormatSpec * spec)
+	{
+		const char	* p = fmt + 1;
+		UInt32		size = kArg_Int;
+		bool		wide = false;
+		bool		longDouble = false;
+
+		spec->numStars = 0;
+		spec->arg = kArg_Unsupported;
+		spec->precision = kPrecision_None;
+
+		while(*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+			p++;
+
+		if(*p == '*')
+		{
+			spec->numStars++;
+			p++;
+		}
+		else
+		{
+			while(*p >= '0' && *p <= '9')
+				p++;
+		}
+
+		if(*p == '.')
+		{
+			p++;
+
+			if(*p == '*')
+			{
+				spec->numStars++;
+				spec->precision = kPrecision_Star;
+				p++;
+			}
+			else
+			{
+				spec->precision = 0;
+
+				while(*p >= '0' && *p <= '9')
+				{
+					if(spec->precision < 0x10000000)
+						spec->precision = spec->precision * 10 + (*p - '0');
+					p++;
+				}
+			}
+		}
+
+		switch(*p)
+		{
+			case 'h':
+				p++;
+				if(*p == 'h')
+					p++;
+				break;
+
+			case 'l':
+				p++;
+				if(*p == 'l')
+				{
+					p++;
+					size = kArg_LongLong;
+				}
+				else
+				{
+					size = kArg_Long;
+				}
+				break;
+
+			case 'j':
+				p++;
+				size = kArg_LongLong;
+				break;
+
+			case 'z':
+			case 't':
+				p++;
+				size = kArg_SizeT;
+				break;
+
+			case 'L':
+				p++;
+				longDouble = true;
+				break;
+
+			case 'w':
+				p++;
+				wide = true;
+				break;
+
+			case 'I':
+				if(p[1] == '6' && p[2] == '4')
+				{
+					p += 3;
+					size = kArg_LongLong;
+				}
+				else if(p[1] == '3' && p[2] == '2')
+				{
+					p += 3;
+				}
+				else
+				{
+					p++;
+					size = kArg_SizeT;
+				}
+				break;
+		}
+
+		char	conversion = *p;
+		if(conversion)
+			p++;
+
+		spec->length = p - fmt;
+
+		switch(conversion)
+		{
+			case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+				spec->arg = size;
+				break;
+
+			case 'c':
+				if(size == kArg_Int && !wide)
+					spec->arg = kArg_Int;
+				break;
+
+			case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+				if(!longDouble)
+					spec->arg = kArg_Double;
+				break;
+
+			case 's':
+				if(size == kArg_Int && !wide)
+					spec->arg = kArg_String;
+				break;
+
+			case 'p':
+				spec->arg = kArg_Pointer;
+				break;
+
+			case '%':
+				if(spec->length == 2)
+					spec->arg = kArg_None;
+				break;
+		}
+	}
+
+	template <typename T>
+	bool PackValue(UInt8 * dst, UInt32 dstLength, UInt32 * offset, T value)
+	{
+		if(sizeof(T) > dstLength - *offset)
+			return false;
+
+		memcpy(dst + *offset, &value, sizeof(T));
+		*offset += sizeof(T);
+
+		return true;
+	}
+
+	template <typename T>
+	T UnpackValue(const UInt8 * src, UInt32 * offset)
+	{
+		T	value;
+
+		memcpy(&value, src + *offset, sizeof(T));
+		*offset += sizeof(T);
+
+		return value;
+	}
+
+	// the format string, then each argument in the order the format takes them
+	// returns the packed length, 0 if the format needs the calling thread or the arguments don't fit
+	UInt32 PackFormat(UInt8 * dst, UInt32 dstLength, const char * fmt, va_list args)
+	{
+		UInt32	offset = strlen(fmt) + 1;
+
+		if(offset > dstLength)
+			return 0;
+
+		memcpy(dst, fmt, offset);
+
+		const char	* p = fmt;
+
+		while(*p)
+		{
+			if(*p != '%')
+			{
+				p++;
+				continue;
+			}
+
+			FormatSpec	spec;
+			ParseSpec(p, &spec);
+
+			if(spec.arg == kArg_Unsupported || spec.length >= kMaxSpecLength)
+				return 0;
+
+			p += spec.length;
+
+			int	star = 0;
+
+			for(UInt32 i = 0; i < spec.numStars; i++)
+			{
+				star = va_arg(args, int);
+
+				if(!PackValue(dst, dstLength, &offset, star))
+					return 0;
+			}
+
+			bool	packed = true;
+
+			switch(spec.arg)
+			{
+				case kArg_Int:		packed = PackValue(dst, dstLength, &offset, va_arg(args, int));			break;
+				case kArg_Long:		packed = PackValue(dst, dstLength, &offset, va_arg(args, long));		break;
+				case kArg_LongLong:	packed = PackValue(dst, dstLength, &offset, va_arg(args, long long));	break;
+				case kArg_SizeT:	packed = PackValue(dst, dstLength, &offset, va_arg(args, size_t));		break;
+				case kArg_Double:	packed = PackValue(dst, dstLength, &offset, va_arg(args, double));		break;
+				case kArg_Pointer:	packed = PackValue(dst, dstLength, &offset, va_arg(args, void *));		break;
+
+				case kArg_String:
+					{
+						const char	* str = va_arg(args, const char *);
+						int			precision = spec.precision == kPrecision_Star ? star : spec.precision;
+						UInt32		length = kNullString;
+
+						// "%.4s" with a four character code needn't be terminated, read no further than printf would
+						if(str)
+							length = precision >= 0 ? strnlen(str, precision) : strlen(str);
+
+						packed = PackValue(dst, dstLength, &offset, length);
+
+						if(packed && str)
+						{
+							packed = length < dstLength - offset;
+
+							if(packed)
+							{
+								memcpy(dst + offset, str, length);
+								dst[offset + length] = 0;
+								offset += length + 1;
+							}
+						}
+					}
+					break;
+			}
+
+			if(!packed)
+				return 0;
+		}
+
+		return offset;
+	}
+
+	template <typename T>
+	int FormatValue(char * dst, UInt32 dstLength, const char * spec, UInt32 numStars, const int * stars, T value)
+	{
+		switch(numStars)
+		{
+			case 0:		return _snprintf_s(dst, dstLength, _TRUNCATE, spec, value);
+			case 1:		return _snprintf_s(dst, dstLength, _TRUNCATE, spec, stars[0], value);
+			default:	return _snprintf_s(dst, dstLength, _TRUNCATE, spec, stars[0], stars[1], value);
+		}
+	}
+
+	// the writer's half of PackFormat, output is truncated to fit like vsprintf_s would
+	void FormatPacked(const UInt8 * src, char * dst, UInt32 dstLength)
+	{
+		const char	* p = (const char *)src;
+		UInt32		offset = strlen(p) + 1;
+		UInt32		length = 0;
+
+		while(*p && length + 1 < dstLength)
+		{
+			if(*p != '%')
+			{
+				dst[length++] = *p++;
+				continue;
+			}
+
+			FormatSpec	spec;
+			ParseSpec(p, &spec);
+
+			char	specText[kMaxSpecLength];
+			memcpy(specText, p, spec.length);
+			specText[spec.length] = 0;
+
+			p += spec.length;
+
+			int	stars[2];
+			for(UInt32 i = 0; i < spec.numStars; i++)
+				stars[i] = UnpackValue <int>(src, &offset);
+
+			char	* out = dst + length;
+			UInt32	outLength = dstLength - length;
+			int		written = 0;
+
+			switch(spec.arg)
+			{
+				case kArg_None:		*out = '%'; written = 1;	break;
+				case kArg_Int:		written = FormatValue(out, outLength, specText, spec.numStars, stars, UnpackValue <int>(src, &offset));			break;
+				case kArg_Long:		written = FormatValue(out, outLength, specText, spec.numStars, stars, UnpackValue <long>(src, &offset));		break;
+				case kArg_LongLong:	written = FormatValue(out, outLength, specText, spec.numStars, stars, UnpackValue <long long>(src, &offset));	break;
+				case kArg_SizeT:	written = FormatValue(out, outLength, specText, spec.numStars, stars, UnpackValue <size_t>(src, &offset));		break;
+				case kArg_Double:	written = FormatValue(out, outLength, specText, spec.numStars, stars, UnpackValue <double>(src, &offset));		break;
+				case kArg_Pointer:	written = FormatValue(out, outLength, specText, spec.numStars, stars, UnpackValue <void *>(src, &offset));		break;
+
+				case kArg_String:
+					{
+						UInt32		strLength = UnpackValue <UInt32>(src, &offset);
+						const char	* str = NULL;
+
+						if(strLength != kNullString)
+						{
+							str = (const char *)src + offset;
+							offset += strLength + 1;
+						}
+
+						written = FormatValue(out, outLength, specText, spec.numStars, stars, str);
+					}
+					break;
+			}
+
+			// truncated
+			if(written < 0 || (UInt32)written >= outLength)
+			{
+				length = dstLength - 1;
+				break;
+			}
+
+			length += written;
+		}
+
+		dst[length] = 0;
+	}
+}
+
+struct IDebugLog::Record
+{
+	UInt32	size;		// including the header, a multiple of 8
+	UInt8	type;
+	UInt8	flags;
+	UInt16	pad;
+	UInt64	sequence;
+
+	// the format string and packed arguments or a terminated string follow
+
+	const char *	Text(void) const	{ return (const char *)(this + 1); }
+};
+
+class IDebugLog::Writer
+{
+public:
+	static DWORD WINAPI ThreadProc(LPVOID param)
+	{
+		while(!s_stopWriter.load(std::memory_order_acquire))
+		{
+			WaitForSingleObject(s_wakeEvent, kWriterInterval);
+
+			IDebugLog::Flush();
+		}
+
+		return 0;
+	}
+
+	// get whatever the crash left queued in to the file before the process goes
+	// an unhandled exception filter only runs once nothing else has handled the exception, first chance
+	// exceptions that an __except block catches never get here
+	static LONG WINAPI CrashFilter(EXCEPTION_POINTERS * info)
+	{
+		if(LockDrain(kCrashWait))
+		{
+			IDebugLog::DrainRings();
+			UnlockDrain();
+		}
+
+		return s_prevCrashFilter ? s_prevCrashFilter(info) : EXCEPTION_CONTINUE_SEARCH;
+	}
+
+	static Record * Peek(Ring * ring, UInt32 * tail, UInt32 head)
+	{
+		while(*tail != head)
+		{
+			Record	* record = (Record *)(ring->data + (*tail & (kRingSize - 1)));
+
+			if(record->type != kRecord_Wrap)
+				return record;
+
+			*tail += record->size;
+		}
+
+		return NULL;
+	}
+
+	static bool Push(Ring * ring, Record * record)
+	{
+		UInt32	head = ring->head.load(std::memory_order_relaxed);
+		UInt32	offset = head & (kRingSize - 1);
+		UInt32	contiguous = kRingSize - offset;
+		UInt32	needed = record->size + (contiguous < record->size ? contiguous : 0);
+
+		// the writer's tail is only read when the last one seen doesn't leave room, it's on another core's cache line
+		if(needed > kRingSize - (head - ring->cachedTail))
+		{
+			ring->cachedTail = ring->tail.load(std::memory_order_acquire);
+
+			if(needed > kRingSize - (head - ring->cachedTail))
+			{
+				ring->numDropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+		UInt32	used = head - ring->cachedTail;
+
+		if(contiguous < record->size)
+		{
+			Record	* wrap = (Record *)(ring->data + offset);
+
+			wrap->size = contiguous;
+			wrap->type = kRecord_Wrap;
+
+			head += contiguous;
+			offset = 0;
+		}
+
+		record->sequence = s_sequence.fetch_add(1, std::memory_order_relaxed);
+
+		memcpy(ring->data + offset, record, record->size);
+
+		ring->head.store(head + record->size, std::memory_order_release);
+
+		// wake the writer early when the ring passes half full
+		if(used < kRingSize / 2 && used + needed >= kRingSize / 2)
+			SetEvent(s_wakeEvent);
+
+		return true;
+	}
+};
 
 IDebugLog::IDebugLog()
 {
@@ -27,12 +650,33 @@ IDebugLog::IDebugLog(const char * name)
 
 IDebugLog::~IDebugLog()
 {
-	if(logFile)
-		fclose(logFile);
+	// at process exit the writer thread is already gone, maybe in the middle of a drain, don't wait long on it
+	s_async.store(false, std::memory_order_release);
+
+	if(LockDrain(kCrashWait))
+	{
+		DrainRings();
+
+		if(logFile)
+		{
+			fclose(logFile);
+			logFile = NULL;
+		}
+
+		UnlockDrain();
+	}
 }
 
 void IDebugLog::Open(const char * path)
 {
+	LockDrain(INFINITE);
+
+	// anything still queued belongs to the old file
+	DrainRings();
+
+	if(logFile)
+		fclose(logFile);
+
 	logFile = _fsopen(path, "w", _SH_DENYWR);
 
 	if(!logFile)
@@ -50,6 +694,8 @@ void IDebugLog::Open(const char * path)
 		}
 		while(!logFile && (id < 5));
 	}
+
+	UnlockDrain();
 }
 
 void IDebugLog::OpenRelative(int folderID, const char * relPath)
@@ -81,6 +727,17 @@ void IDebugLog::Message(const char * message, const char * source, bool newLine)
 	if(source)
 		SetSource(source);
 
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		Queue(kRecord_Text, kFlag_Log | (newLine ? kFlag_NewLine : 0), message);
+		return;
+	}
+
+	WriteMessage(message, newLine);
+}
+
+void IDebugLog::WriteMessage(const char * message, bool newLine)
+{
 	if(inBlock)
 	{
 		SeekCursor(RoundToTab((indentLevel * 4) + strlen(headerText)));
@@ -109,8 +766,7 @@ void IDebugLog::FormattedMessage(const char * fmt, ...)
 	va_list	argList;
 
 	va_start(argList, fmt);
-	vsprintf_s(formatBuf, sizeof(formatBuf), fmt, argList);
-	Message(formatBuf);
+	FormattedMessage(fmt, argList);
 	va_end(argList);
 }
 
@@ -122,44 +778,82 @@ void IDebugLog::FormattedMessage(const char * fmt, ...)
  */
 void IDebugLog::FormattedMessage(const char * fmt, va_list args)
 {
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		QueueFormat(kFlag_Log | kFlag_NewLine, fmt, args);
+		return;
+	}
+
 	vsprintf_s(formatBuf, sizeof(formatBuf), fmt, args);
 	Message(formatBuf);
 }
 
 void IDebugLog::Log(LogLevel level, const char * fmt, va_list args)
 {
-	bool	log = (level <= logLevel);
-	bool	print = (level <= printLevel);
+	LogArgs(level, logLevel, printLevel, true, fmt, args);
+}
 
-	if(log || print)
-		vsprintf_s(formatBuf, sizeof(formatBuf), fmt, args);
+/**
+ *	Output a message through a module, the log call macros come here
+ *	
+ *	@note The caller has checked the module's level mask.
+ */
+void IDebugLog::Log(const Module & module, LogLevel level, const char * fmt, ...)
+{
+	va_list	args;
 
-	if(log)
-		Message(formatBuf);
-	
-	if(print)
-		printf("%s\n", formatBuf);
+	va_start(args, fmt);
+	if(module.level >= 0)
+		LogArgs(level, module.level, module.level < printLevel ? module.level : printLevel, true, fmt, args);
+	else
+		LogArgs(level, logLevel, printLevel, true, fmt, args);
+	va_end(args);
 }
 
 void IDebugLog::LogNNL(LogLevel level, const char * fmt, va_list args)
 {
-	bool	log = (level <= logLevel);
-	bool	print = (level <= printLevel);
+	LogArgs(level, logLevel, printLevel, false, fmt, args);
+}
+
+void IDebugLog::LogArgs(LogLevel level, int fileLevel, int consoleLevel, bool newLine, const char * fmt, va_list args)
+{
+	bool	log = (level <= fileLevel);
+	bool	print = (level <= consoleLevel);
+
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		if(log || print)
+			QueueFormat((log ? kFlag_Log : 0) | (print ? kFlag_Print : 0) | (newLine ? kFlag_NewLine : 0), fmt, args);
+
+		// the process may not live long enough for the writer to get to it
+		if(level == kLevel_FatalError)
+			Flush();
+
+		return;
+	}
 
 	if(log || print)
 		vsprintf_s(formatBuf, sizeof(formatBuf), fmt, args);
 
 	if(log)
-		Message(formatBuf, NULL, false);
+		Message(formatBuf, NULL, newLine);
 	
 	if(print)
-		printf("%s", formatBuf);
+		printf(newLine ? "%s\n" : "%s", formatBuf);
 }
 
 /**
  *	Set the current message source
  */
 void IDebugLog::SetSource(const char * source)
+{
+	if(s_async.load(std::memory_order_relaxed))
+		Queue(kRecord_SetSource, 0, source);
+	else
+		WriteSource(source);
+}
+
+void IDebugLog::WriteSource(const char * source)
 {
 	strcpy_s(sourceBuf, sizeof(sourceBuf), source);
 	strcpy_s(headerText, sizeof(headerText), "[        ]\t");
@@ -176,6 +870,12 @@ void IDebugLog::SetSource(const char * source)
  */
 void IDebugLog::ClearSource(void)
 {
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		Queue(kRecord_ClearSource, 0, NULL);
+		return;
+	}
+
 	sourceBuf[0] = 0;
 }
 
@@ -184,6 +884,12 @@ void IDebugLog::ClearSource(void)
  */
 void IDebugLog::Indent(void)
 {
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		Queue(kRecord_Indent, 0, NULL);
+		return;
+	}
+
 	indentLevel++;
 }
 
@@ -192,6 +898,12 @@ void IDebugLog::Indent(void)
  */
 void IDebugLog::Outdent(void)
 {
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		Queue(kRecord_Outdent, 0, NULL);
+		return;
+	}
+
 	if(indentLevel)
 		indentLevel--;
 }
@@ -201,6 +913,12 @@ void IDebugLog::Outdent(void)
  */
 void IDebugLog::OpenBlock(void)
 {
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		Queue(kRecord_OpenBlock, 0, NULL);
+		return;
+	}
+
 	SeekCursor(indentLevel * 4);
 
 	PrintText(headerText);
@@ -213,6 +931,12 @@ void IDebugLog::OpenBlock(void)
  */
 void IDebugLog::CloseBlock(void)
 {
+	if(s_async.load(std::memory_order_relaxed))
+	{
+		Queue(kRecord_CloseBlock, 0, NULL);
+		return;
+	}
+
 	inBlock = 0;
 }
 
@@ -226,6 +950,385 @@ void IDebugLog::SetAutoFlush(bool inAutoFlush)
 	autoFlush = inAutoFlush;
 }
 
+/**
+ *	Set the least important level written to the file
+ *	
+ *	Modules without a level of their own follow it.
+ */
+void IDebugLog::SetLogLevel(LogLevel in)
+{
+	logLevel = in;
+
+	UpdateLevelMask(&defaultModule);
+
+	for(Module * module = modules; module; module = module->next)
+		UpdateLevelMask(module);
+}
+
+/**
+ *	Set the least important level printed to the console
+ */
+void IDebugLog::SetPrintLevel(LogLevel in)
+{
+	printLevel = in;
+
+	UpdateLevelMask(&defaultModule);
+
+	for(Module * module = modules; module; module = module->next)
+		UpdateLevelMask(module);
+}
+
+/**
+ *	Set the least important level a module writes or prints
+ *	
+ *	The module's level replaces the global log level and caps the print level.
+ *	
+ *	@param name the name the module was declared with
+ */
+void IDebugLog::SetModuleLevel(const char * name, LogLevel in)
+{
+	for(Module * module = modules; module; module = module->next)
+	{
+		if(!_stricmp(module->name, name))
+		{
+			module->level = in;
+			UpdateLevelMask(module);
+		}
+	}
+}
+
+/**
+ *	Read the global and per module log levels from an ini file
+ *	
+ *	iLogLevel sets the global level, iLogLevel_<module> the level of a module,
+ *	both as a LogLevel number. Keys that aren't there leave the level alone.
+ *	Call this once, after the modules have been constructed.
+ */
+void IDebugLog::ReadModuleLevels(const char * iniPath, const char * section)
+{
+	int	level = (int)GetPrivateProfileInt(section, "iLogLevel", -1, iniPath);
+	if(level >= kLevel_FatalError && level <= kLevel_DebugMessage)
+		SetLogLevel((LogLevel)level);
+
+	for(Module * module = modules; module; module = module->next)
+	{
+		char	key[64];
+		sprintf_s(key, sizeof(key), "iLogLevel_%s", module->name);
+
+		level = (int)GetPrivateProfileInt(section, key, -1, iniPath);
+		if(level >= kLevel_FatalError && level <= kLevel_DebugMessage)
+			SetModuleLevel(module->name, (LogLevel)level);
+	}
+}
+
+/**
+ *	Declare a module
+ *	
+ *	@note Modules are static objects, this runs before anything can log through it.
+ */
+IDebugLog::Module::Module(const char * inName)
+	:name(inName), level(-1), levelMask(0), next(modules)
+{
+	modules = this;
+
+	UpdateLevelMask(this);
+}
+
+/**
+ *	Rebuild a module's mask of the levels that are written or printed
+ */
+void IDebugLog::UpdateLevelMask(Module * module)
+{
+	int	maxLevel = logLevel > printLevel ? logLevel : printLevel;
+	if(module->level >= 0)
+		maxLevel = module->level;
+
+	module->levelMask = maxLevel >= 0 ? (2 << maxLevel) - 1 : 0;
+}
+
+/**
+ *	Enable/disable asynchronous logging
+ *	
+ *	When enabled, log calls only queue the message, a background thread formats it
+ *	and writes it to the file. Messages from one thread stay in order, messages that
+ *	find the queue full are dropped and counted. Fatal errors are written before
+ *	the call returns. Set this before other threads start logging.
+ *	
+ *	@param inAsync asynchronous state
+ */
+void IDebugLog::SetAsync(bool inAsync)
+{
+	if(inAsync == s_async.load(std::memory_order_relaxed))
+		return;
+
+	if(inAsync)
+	{
+		s_stopWriter.store(false, std::memory_order_relaxed);
+		s_wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		s_writerThread = CreateThread(NULL, 0, Writer::ThreadProc, NULL, 0, NULL);
+
+		// stay synchronous
+		if(!s_writerThread)
+		{
+			CloseHandle(s_wakeEvent);
+			s_wakeEvent = NULL;
+			return;
+		}
+
+		// chained to whatever filter was there, a filter set later has to chain to this one for it to run
+		if(!s_crashFilterSet)
+		{
+			s_prevCrashFilter = SetUnhandledExceptionFilter(Writer::CrashFilter);
+			s_crashFilterSet = true;
+		}
+
+		s_async.store(true, std::memory_order_release);
+	}
+	else
+	{
+		s_async.store(false, std::memory_order_release);
+
+		s_stopWriter.store(true, std::memory_order_release);
+		SetEvent(s_wakeEvent);
+		WaitForSingleObject(s_writerThread, INFINITE);
+
+		CloseHandle(s_writerThread);
+		CloseHandle(s_wakeEvent);
+		s_writerThread = NULL;
+		s_wakeEvent = NULL;
+
+		Flush();
+	}
+}
+
+/**
+ *	Write out everything queued so far and flush the file
+ */
+void IDebugLog::Flush(void)
+{
+	if(!LockDrain(INFINITE))
+		return;
+
+	DrainRings();
+
+	UnlockDrain();
+}
+
+/**
+ *	Returns the number of messages dropped because their queue was full
+ *	
+ *	@note Flushes first, so drops still waiting to be reported are counted.
+ */
+UInt64 IDebugLog::GetNumDropped(void)
+{
+	Flush();
+
+	return s_numDropped.load(std::memory_order_relaxed);
+}
+
+/**
+ *	Queue a record with optional text for the writer thread
+ */
+void IDebugLog::Queue(UInt8 type, UInt8 flags, const char * text)
+{
+	Ring	* ring = GetThreadRing();
+	if(!ring)
+	{
+		s_numDroppedNoRing.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Record	* record = (Record *)ring->scratch;
+	UInt32	length = 0;
+
+	if(text)
+	{
+		length = strlen(text) + 1;
+
+		// the same limit as formatBuf
+		if(length > sizeof(formatBuf))
+			length = sizeof(formatBuf);
+
+		memcpy(record + 1, text, length);
+		((char *)(record + 1))[length - 1] = 0;
+	}
+
+	record->size = AlignRecord(sizeof(Record) + length);
+	record->type = type;
+	record->flags = flags;
+
+	Writer::Push(ring, record);
+}
+
+/**
+ *	Queue a formatted message for the writer thread
+ *	
+ *	The arguments are packed as they are, formats with arguments that can't be
+ *	packed are formatted here.
+ */
+void IDebugLog::QueueFormat(UInt8 flags, const char * fmt, va_list args)
+{
+	Ring	* ring = GetThreadRing();
+	if(!ring)
+	{
+		s_numDroppedNoRing.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Record	* record = (Record *)ring->scratch;
+	char	* payload = (char *)(record + 1);
+	UInt32	payloadLength = sizeof(ring->scratch) - sizeof(Record);
+
+	va_list	argsCopy;
+	va_copy(argsCopy, args);
+
+	UInt32	length = PackFormat((UInt8 *)payload, payloadLength, fmt, argsCopy);
+
+	va_end(argsCopy);
+
+	if(length)
+	{
+		record->type = kRecord_Format;
+	}
+	else
+	{
+		_vsnprintf_s(payload, sizeof(formatBuf), _TRUNCATE, fmt, args);
+
+		length = strlen(payload) + 1;
+		record->type = kRecord_Text;
+	}
+
+	record->size = AlignRecord(sizeof(Record) + length);
+	record->flags = flags;
+
+	Writer::Push(ring, record);
+}
+
+/**
+ *	Write a queued record, on the writer thread
+ */
+void IDebugLog::ApplyRecord(const Record * record)
+{
+	const char	* text = record->Text();
+
+	switch(record->type)
+	{
+		case kRecord_Format:
+			FormatPacked((const UInt8 *)text, formatBuf, sizeof(formatBuf));
+			text = formatBuf;
+			break;
+
+		case kRecord_Text:
+			break;
+
+		case kRecord_SetSource:		WriteSource(text);	return;
+		case kRecord_ClearSource:	sourceBuf[0] = 0;	return;
+
+		case kRecord_Indent:		indentLevel++;	return;
+		case kRecord_Outdent:		if(indentLevel) indentLevel--;	return;
+
+		case kRecord_OpenBlock:
+			SeekCursor(indentLevel * 4);
+			PrintText(headerText);
+			inBlock = 1;
+			return;
+
+		case kRecord_CloseBlock:	inBlock = 0;	return;
+
+		default:
+			return;
+	}
+
+	bool	newLine = (record->flags & kFlag_NewLine) != 0;
+
+	if(record->flags & kFlag_Log)
+		WriteMessage(text, newLine);
+
+	if(record->flags & kFlag_Print)
+		printf(newLine ? "%s\n" : "%s", text);
+}
+
+/**
+ *	Write out every queued record, oldest first across all threads
+ *	
+ *	@note The caller holds the drain lock.
+ */
+void IDebugLog::DrainRings(void)
+{
+	Ring	* rings[kMaxRings];
+	UInt32	heads[kMaxRings];
+	UInt32	tails[kMaxRings];
+	UInt32	numRings = 0;
+
+	for(Ring * ring = s_rings.load(std::memory_order_acquire); ring && numRings < kMaxRings; ring = ring->next)
+	{
+		UInt32	head = ring->head.load(std::memory_order_acquire);
+		UInt32	tail = ring->tail.load(std::memory_order_relaxed);
+
+		if(head != tail)
+		{
+			rings[numRings] = ring;
+			heads[numRings] = head;
+			tails[numRings] = tail;
+			numRings++;
+		}
+	}
+
+	while(numRings)
+	{
+		UInt32	oldest = 0;
+		Record	* oldestRecord = NULL;
+
+		for(UInt32 i = 0; i < numRings; )
+		{
+			Record	* record = Writer::Peek(rings[i], &tails[i], heads[i]);
+
+			if(!record)
+			{
+				rings[i]->tail.store(tails[i], std::memory_order_release);
+
+				numRings--;
+				rings[i] = rings[numRings];
+				heads[i] = heads[numRings];
+				tails[i] = tails[numRings];
+				continue;
+			}
+
+			if(!oldestRecord || record->sequence < oldestRecord->sequence)
+			{
+				oldest = i;
+				oldestRecord = record;
+			}
+
+			i++;
+		}
+
+		if(!oldestRecord)
+			break;
+
+		ApplyRecord(oldestRecord);
+
+		tails[oldest] += oldestRecord->size;
+		rings[oldest]->tail.store(tails[oldest], std::memory_order_release);
+	}
+
+	UInt64	numDropped = s_numDroppedNoRing.exchange(0, std::memory_order_relaxed);
+
+	for(Ring * ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next)
+		numDropped += ring->numDropped.exchange(0, std::memory_order_relaxed);
+
+	if(numDropped)
+	{
+		s_numDropped.fetch_add(numDropped, std::memory_order_relaxed);
+
+		sprintf_s(formatBuf, sizeof(formatBuf), "(%llu log messages dropped, the queue was full)", (unsigned long long)numDropped);
+		WriteMessage(formatBuf, true);
+	}
+
+	if(logFile)
+		fflush(logFile);
+}
+
 /**
  *	Print spaces to the log
  *	
@@ -263,7 +1366,7 @@ void IDebugLog::PrintText(const char * buf)
 	if(logFile)
 	{
 		fputs(buf, logFile);
-		if(autoFlush)
+		if(autoFlush && !s_async.load(std::memory_order_relaxed))
 			fflush(logFile);
 	}
 
@@ -288,7 +1391,7 @@ void IDebugLog::NewLine(void)
 	{
 		fputc('\n', logFile);
 
-		if(autoFlush)
+		if(autoFlush && !s_async.load(std::memory_order_relaxed))
 			fflush(logFile);
 	}
 
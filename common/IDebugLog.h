@@ -32,7 +32,32 @@ class IDebugLog
 			kLevel_DebugMessage
 		};
 
+		/**
+		 *	A named group of log calls with a level of its own
+		 *	
+		 *	The level mask has a bit for each level that is either written or
+		 *	printed, so a filtered call is rejected before its arguments are
+		 *	evaluated. See IDEBUGLOG_MODULE.
+		 */
+		class Module
+		{
+			public:
+				Module(const char * inName);
+				constexpr Module(const char * inName, UInt32 inLevelMask)
+					:name(inName), level(-1), levelMask(inLevelMask), next(NULL) { }
+
+				bool	IsEnabled(LogLevel in) const	{ return (levelMask >> in) & 1; }
+
+				const char	* name;
+				int			level;		//!< least important level to write or print, -1 to use the global levels
+				UInt32		levelMask;	//!< levels written or printed, rebuilt when a level changes
+				Module		* next;
+		};
+
+		static Module		defaultModule;	//!< used by source files that don't declare a module
+
 		static void			Log(LogLevel level, const char * fmt, va_list args);
+		static void			Log(const Module & module, LogLevel level, const char * fmt, ...);
 		static void			LogNNL(LogLevel level, const char * fmt, va_list args); // No new line
 
 		static void			SetSource(const char * source);
@@ -46,8 +71,14 @@ class IDebugLog
 
 		static void			SetAutoFlush(bool inAutoFlush);
 
-		static void			SetLogLevel(LogLevel in)	{ logLevel = in; }
-		static void			SetPrintLevel(LogLevel in)	{ printLevel = in; }
+		static void			SetAsync(bool inAsync);
+		static void			Flush(void);
+		static UInt64		GetNumDropped(void);
+
+		static void			SetLogLevel(LogLevel in);
+		static void			SetPrintLevel(LogLevel in);
+		static void			SetModuleLevel(const char * name, LogLevel in);
+		static void			ReadModuleLevels(const char * iniPath, const char * section);
 
 	private:
 		static void			PrintSpaces(int numSpaces);
@@ -59,6 +90,22 @@ class IDebugLog
 		static int			TabSize(void);
 		static int			RoundToTab(int spaces);
 
+		struct Record;
+
+		static void			LogArgs(LogLevel level, int fileLevel, int consoleLevel, bool newLine, const char * fmt, va_list args);
+		static void			UpdateLevelMask(Module * module);
+
+		static Module		* modules;			//!< declared modules, not including defaultModule
+
+		static void			Queue(UInt8 type, UInt8 flags, const char * text);
+		static void			QueueFormat(UInt8 flags, const char * fmt, va_list args);
+		static void			ApplyRecord(const Record * record);
+		static void			WriteMessage(const char * message, bool newLine);
+		static void			WriteSource(const char * source);
+		static void			DrainRings(void);
+
+		class Writer;
+
 		static FILE			* logFile;			//!< the output file
 
 		static char			sourceBuf[16];		//!< name of current source, used in prefix
@@ -78,56 +125,64 @@ class IDebugLog
 
 extern IDebugLog gLog;
 
-inline void _FATALERROR(const char * fmt, ...)
-{
-	va_list args;
-
-	va_start(args, fmt);
-	gLog.Log(IDebugLog::kLevel_FatalError, fmt, args);
-	va_end(args);
-}
-
-inline void _ERROR(const char * fmt, ...)
-{
-	va_list args;
-
-	va_start(args, fmt);
-	gLog.Log(IDebugLog::kLevel_Error, fmt, args);
-	va_end(args);
-}
-
-inline void _WARNING(const char * fmt, ...)
-{
-	va_list args;
-
-	va_start(args, fmt);
-	gLog.Log(IDebugLog::kLevel_Warning, fmt, args);
-	va_end(args);
-}
-
-inline void _MESSAGE(const char * fmt, ...)
-{
-	va_list args;
-
-	va_start(args, fmt);
-	gLog.Log(IDebugLog::kLevel_Message, fmt, args);
-	va_end(args);
-}
-
-inline void _VMESSAGE(const char * fmt, ...)
-{
-	va_list args;
-
-	va_start(args, fmt);
-	gLog.Log(IDebugLog::kLevel_VerboseMessage, fmt, args);
-	va_end(args);
-}
-
-inline void _DMESSAGE(const char * fmt, ...)
-{
-	va_list args;
-
-	va_start(args, fmt);
-	gLog.Log(IDebugLog::kLevel_DebugMessage, fmt, args);
-	va_end(args);
-}
+// log calls
+// 
+// a call checks its module's level mask before anything else, a filtered call costs one branch and its arguments
+// are never evaluated. calls less important than IDEBUGLOG_MAX_LEVEL are compiled out entirely
+//
+// log calls in a source file go through IDebugLog::defaultModule, which follows the global log and print levels.
+// a file that wants a level of its own declares a module at file scope after its includes:
+//
+//	IDEBUGLOG_MODULE("MCMInput");
+//
+// its level is then set by SetModuleLevel, or by iLogLevel_MCMInput in the section given to ReadModuleLevels
+
+#ifndef IDEBUGLOG_MAX_LEVEL
+#define IDEBUGLOG_MAX_LEVEL	5	// IDebugLog::kLevel_DebugMessage
+#endif
+
+inline IDebugLog::Module & GetLogModule(const void *)	{ return IDebugLog::defaultModule; }
+
+// an exact match for the call in IDEBUGLOG_CALL, so it wins over the default in the file that declares it
+#define IDEBUGLOG_MODULE(name) \
+	static IDebugLog::Module	s_logModule(name); \
+	static IDebugLog::Module & GetLogModule(IDebugLog::Module *)	{ return s_logModule; }
+
+#define IDEBUGLOG_CALL(level, ...) \
+	(GetLogModule((IDebugLog::Module *)NULL).IsEnabled(level) ? IDebugLog::Log(GetLogModule((IDebugLog::Module *)NULL), level, __VA_ARGS__) : (void)0)
+
+#if IDEBUGLOG_MAX_LEVEL >= 0
+#define _FATALERROR(...)	IDEBUGLOG_CALL(IDebugLog::kLevel_FatalError, __VA_ARGS__)
+#else
+#define _FATALERROR(...)	((void)0)
+#endif
+
+#if IDEBUGLOG_MAX_LEVEL >= 1
+#define _ERROR(...)			IDEBUGLOG_CALL(IDebugLog::kLevel_Error, __VA_ARGS__)
+#else
+#define _ERROR(...)			((void)0)
+#endif
+
+#if IDEBUGLOG_MAX_LEVEL >= 2
+#define _WARNING(...)		IDEBUGLOG_CALL(IDebugLog::kLevel_Warning, __VA_ARGS__)
+#else
+#define _WARNING(...)		((void)0)
+#endif
+
+#if IDEBUGLOG_MAX_LEVEL >= 3
+#define _MESSAGE(...)		IDEBUGLOG_CALL(IDebugLog::kLevel_Message, __VA_ARGS__)
+#else
+#define _MESSAGE(...)		((void)0)
+#endif
+
+#if IDEBUGLOG_MAX_LEVEL >= 4
+#define _VMESSAGE(...)		IDEBUGLOG_CALL(IDebugLog::kLevel_VerboseMessage, __VA_ARGS__)
+#else
+#define _VMESSAGE(...)		((void)0)
+#endif
+
+#if IDEBUGLOG_MAX_LEVEL >= 5
+#define _DMESSAGE(...)		IDEBUGLOG_CALL(IDebugLog::kLevel_DebugMessage, __VA_ARGS__)
+#else
+#define _DMESSAGE(...)		((void)0)
+#endif
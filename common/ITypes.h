@@ -7,11 +7,19 @@
 
 typedef unsigned char		UInt8;		//!< An unsigned 8-bit integer value
 typedef unsigned short		UInt16;		//!< An unsigned 16-bit integer value
+#ifdef _WIN32
 typedef unsigned long		UInt32;		//!< An unsigned 32-bit integer value
+#else
+typedef unsigned int		UInt32;		// long is 64 bits on LP64 targets, only the tests build there
+#endif
 typedef unsigned long long	UInt64;		//!< An unsigned 64-bit integer value
 typedef signed char			SInt8;		//!< A signed 8-bit integer value
 typedef signed short		SInt16;		//!< A signed 16-bit integer value
+#ifdef _WIN32
 typedef signed long			SInt32;		//!< A signed 32-bit integer value
+#else
+typedef signed int			SInt32;
+#endif
 typedef signed long long	SInt64;		//!< A signed 64-bit integer value
 typedef float				Float32;	//!< A 32-bit floating point value
 typedef double				Float64;	//!< A 64-bit floating point value
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+
+#include "common/ITypes.h"
+
+// Open addressed index from a "modName:name" key hash to an entry number, for the stores that keep their entries
+// in a vector. Linear probing, power of two size, resized by the owner to keep the load factor at or below 1/2.
+// A slot only holds the low bits of the hash and the entry number, the owner compares the keys.
+class KeyIndex
+{
+public:
+	enum : UInt32 { kNotFound = 0xFFFFFFFF };
+
+	// FNV-1a over "modName:name", each byte mapped through fold first (a lowercase for case insensitive keys)
+	template <typename Fold>
+	static UInt64 Hash(const char* modName, size_t modLength, const char* name, size_t nameLength, Fold fold) {
+		UInt64 hash = 14695981039346656037ULL;
+
+		for (size_t i = 0; i < modLength; i++) {
+			hash ^= (UInt8)fold(modName[i]);
+			hash *= 1099511628211ULL;
+		}
+
+		hash ^= ':';
+		hash *= 1099511628211ULL;
+
+		for (size_t i = 0; i < nameLength; i++) {
+			hash ^= (UInt8)fold(name[i]);
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	static UInt64 Hash(const char* modName, size_t modLength, const char* name, size_t nameLength) {
+		return Hash(modName, modLength, name, nameLength, [](char c) { return c; });
+	}
+
+	// true once count entries would take it over half full
+	bool NeedsResize(size_t count) const { return count * 2 > m_slots.size(); }
+
+	// empties the index and sizes it for count entries
+	void Reset(size_t count) {
+		size_t size = 16;
+		while (size < count * 2) {
+			size *= 2;
+		}
+
+		m_slots.assign(size, Slot());
+	}
+
+	// the entry with this hash that matches(entry) accepts, kNotFound if there isn't one
+	template <typename Matches>
+	UInt32 Find(UInt64 hash, Matches matches) const {
+		if (m_slots.empty()) return kNotFound;
+
+		size_t mask = m_slots.size() - 1;
+
+		for (size_t slot = hash & mask; m_slots[slot].entry; slot = (slot + 1) & mask) {
+			if (m_slots[slot].hash == (UInt32)hash && matches(m_slots[slot].entry - 1)) {
+				return m_slots[slot].entry - 1;
+			}
+		}
+
+		return kNotFound;
+	}
+
+	// adds entry, or replaces an entry that matches(entry) accepts as having the same key
+	template <typename Matches>
+	void Insert(UInt64 hash, UInt32 entry, Matches matches) {
+		size_t mask = m_slots.size() - 1;
+		size_t slot = hash & mask;
+
+		while (m_slots[slot].entry && !(m_slots[slot].hash == (UInt32)hash && matches(m_slots[slot].entry - 1))) {
+			slot = (slot + 1) & mask;
+		}
+
+		m_slots[slot].hash = (UInt32)hash;
+		m_slots[slot].entry = entry + 1;
+	}
+
+	// adds an entry whose key isn't in the index yet
+	void Insert(UInt64 hash, UInt32 entry) {
+		Insert(hash, entry, [](UInt32) { return false; });
+	}
+
+private:
+	struct Slot {
+		UInt32	hash	= 0;	// low bits of the key hash
+		UInt32	entry	= 0;	// entry number + 1, 0 if the slot is empty
+	};
+
+	std::vector<Slot>	m_slots;
+};
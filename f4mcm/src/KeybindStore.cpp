@@ -0,0 +1,423 @@
+#include "KeybindStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+
+#include "json/json.h"
+
+namespace
+{
+	const UInt32 kCacheMagic	= 'KBDC';
+	const UInt32 kCacheVersion	= 1;
+
+	inline char Lower(char c) {
+		return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+	}
+
+	bool EqualsNoCase(const std::string& a, const char* b) {
+		size_t i = 0;
+		for (; i < a.size(); i++) {
+			if (!b[i] || Lower(a[i]) != Lower(b[i])) return false;
+		}
+		return !b[i];
+	}
+
+	bool ReadWholeFile(const char* path, std::string& data) {
+		HANDLE handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (handle == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		bool result = GetFileSizeEx(handle, &size) && !size.HighPart;
+		if (result) {
+			DWORD bytesRead = 0;
+			data.resize(size.LowPart);
+			result = !size.LowPart || (ReadFile(handle, &data[0], size.LowPart, &bytesRead, NULL) && bytesRead == size.LowPart);
+		}
+
+		CloseHandle(handle);
+		return result;
+	}
+
+	// Bounds checked, a truncated or corrupt cache reads as a failure and is rebuilt.
+	class CacheReader
+	{
+	public:
+		CacheReader(const std::string& data) : m_p(data.data()), m_end(data.data() + data.size()) { }
+
+		bool Read(void* dst, size_t size) {
+			if ((size_t)(m_end - m_p) < size) return false;
+			memcpy(dst, m_p, size);
+			m_p += size;
+			return true;
+		}
+
+		template <typename T>
+		bool Read(T& value) { return Read(&value, sizeof(T)); }
+
+		bool Read(std::string& str) {
+			UInt32 length;
+			if (!Read(length) || (size_t)(m_end - m_p) < length) return false;
+			str.assign(m_p, length);
+			m_p += length;
+			return true;
+		}
+
+	private:
+		const char*	m_p;
+		const char*	m_end;
+	};
+
+	class CacheWriter
+	{
+	public:
+		template <typename T>
+		void Write(const T& value) { m_data.append((const char*)&value, sizeof(T)); }
+
+		void Write(const std::string& str) {
+			Write((UInt32)str.size());
+			m_data.append(str);
+		}
+
+		const std::string& GetData() const { return m_data; }
+
+	private:
+		std::string	m_data;
+	};
+}
+
+void KeybindStore::Build(const char* configDir, const char* cachePath)
+{
+	LARGE_INTEGER countStart, countEnd, frequency;
+	QueryPerformanceCounter(&countStart);
+	QueryPerformanceFrequency(&frequency);
+
+	std::vector<SourceFile> files;
+	FindSourceFiles(configDir, files);
+
+	// Reuse the cached definitions of every file that hasn't changed since the cache was written.
+	std::vector<SourceFile> cached;
+	ReadCache(cachePath, cached);
+
+	std::map<std::string, SourceFile*> cachedByFolder;
+	for (auto& file : cached) {
+		cachedByFolder[file.folder] = &file;
+	}
+
+	m_numFilesCached = 0;
+	for (auto& file : files) {
+		auto entry = cachedByFolder.find(file.folder);
+		if (entry != cachedByFolder.end() && file.writeTime && entry->second->size == file.size && entry->second->writeTime == file.writeTime) {
+			file.definitions.swap(entry->second->definitions);
+			m_numFilesCached++;
+		} else {
+			file.parsed = true;
+		}
+	}
+
+	ParseSourceFiles(files);
+	m_numFilesParsed = files.size() - m_numFilesCached;
+
+	if (m_numFilesParsed || cached.size() != files.size()) {
+		if (!WriteCache(cachePath, files)) {
+			_WARNING("Warning: Could not write the keybind definition cache %s.", cachePath);
+		}
+	}
+
+	m_definitions.clear();
+	for (auto& file : files) {
+		for (auto& definition : file.definitions) {
+			m_definitions.push_back(std::move(definition));
+		}
+	}
+
+	BuildIndex();
+
+	QueryPerformanceCounter(&countEnd);
+	_MESSAGE("Indexed %d keybind definitions from %d files (%d parsed, %d cached) in %llu ms.",
+		(UInt32)m_definitions.size(), (UInt32)files.size(), m_numFilesParsed, m_numFilesCached,
+		(countEnd.QuadPart - countStart.QuadPart) / (frequency.QuadPart / 1000));
+}
+
+const KeybindDefinition* KeybindStore::Find(const char* modName, const char* keybindID) const
+{
+	if (!modName || !keybindID) return nullptr;
+
+	UInt32 found = m_index.Find(HashKey(modName, strlen(modName), keybindID, strlen(keybindID)), [&](UInt32 i) {
+		return EqualsNoCase(m_definitions[i].modName, modName) && EqualsNoCase(m_definitions[i].keybindID, keybindID);
+	});
+
+	return found != KeyIndex::kNotFound ? &m_definitions[found] : nullptr;
+}
+
+//----------------------
+// Private Functions
+//----------------------
+
+void KeybindStore::FindSourceFiles(const char* configDir, std::vector<SourceFile>& files)
+{
+	HANDLE hFind;
+	WIN32_FIND_DATA data;
+
+	hFind = FindFirstFile((std::string(configDir) + "*").c_str(), &data);
+	if (hFind != INVALID_HANDLE_VALUE) {
+		do {
+			if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) continue;
+			if (!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, "..")) continue;
+
+			std::string path = std::string(configDir) + data.cFileName + "\\keybinds.json";
+
+			// The file's own find data has its size and write time.
+			WIN32_FIND_DATA fileData;
+			HANDLE hFile = FindFirstFile(path.c_str(), &fileData);
+			if (hFile == INVALID_HANDLE_VALUE) continue;
+			FindClose(hFile);
+
+			files.emplace_back();
+			files.back().folder		= data.cFileName;
+			files.back().path		= path;
+			files.back().size		= ((UInt64)fileData.nFileSizeHigh << 32) | fileData.nFileSizeLow;
+			files.back().writeTime	= ((UInt64)fileData.ftLastWriteTime.dwHighDateTime << 32) | fileData.ftLastWriteTime.dwLowDateTime;
+		} while (FindNextFile(hFind, &data));
+		FindClose(hFind);
+	}
+}
+
+void KeybindStore::ParseSourceFiles(std::vector<SourceFile>& files)
+{
+	// Each file is parsed on its own, spread them over a few threads.
+	std::vector<SourceFile*> pending;
+	for (auto& file : files) {
+		if (file.parsed) pending.push_back(&file);
+	}
+
+	std::atomic<UInt32> nextFile(0);
+
+	auto worker = [&pending, &nextFile]() {
+		UInt32 i;
+		while ((i = nextFile++) < pending.size()) {
+			ParseSourceFile(*pending[i]);
+		}
+	};
+
+	UInt32 numWorkers = std::thread::hardware_concurrency();
+	if (numWorkers > 8) numWorkers = 8;
+	if (numWorkers > pending.size()) numWorkers = pending.size();
+
+	std::vector<std::thread> workers;
+	for (UInt32 i = 1; i < numWorkers; i++) {
+		workers.emplace_back(worker);
+	}
+
+	worker();
+
+	for (auto& thread : workers) {
+		thread.join();
+	}
+
+	for (auto file : pending) {
+		for (auto& message : file->messages) {
+			if (message.warning) {
+				_WARNING("%s", message.text.c_str());
+			} else {
+				_MESSAGE("%s", message.text.c_str());
+			}
+		}
+		file->messages.clear();
+	}
+}
+
+bool KeybindStore::ParseSourceFile(SourceFile& file)
+{
+	try {
+		std::string text;
+		if (!ReadWholeFile(file.path.c_str(), text)) {
+			file.messages.push_back({ true, "Warning: Could not read " + file.path + "." });
+			return false;
+		}
+
+		Json::Value json, keybinds;
+		Json::Reader reader;
+		reader.parse(text, json);
+
+		keybinds = json["keybinds"];
+		if (!keybinds.isArray()) return false;
+
+		std::string modName = json["modName"].asString();
+
+		for (int i = 0; i < keybinds.size(); i++) {
+			const Json::Value& keybind = keybinds[i];
+			const Json::Value& action = keybind["action"];
+
+			KeybindDefinition definition;
+			definition.modName		= modName;
+			definition.keybindID	= keybind["id"].asString();
+			definition.keybindDesc	= keybind["desc"].asString();
+			definition.actionType	= action["type"].asString();
+			definition.form			= action["form"].asString();
+			definition.function		= action["function"].asString();
+			definition.script		= action["script"].asString();
+			definition.command		= action["command"].asString();
+
+			const Json::Value& params = action["params"];
+			if (params.isArray()) {
+				for (int j = 0; j < params.size(); j++) {
+					KeybindDefinition::Param param = {};
+					switch (params[j].type()) {
+						case Json::intValue:
+							param.type = KeybindDefinition::Param::kType_Int;
+							param.iValue = params[j].asInt();
+							break;
+						case Json::booleanValue:
+							param.type = KeybindDefinition::Param::kType_Bool;
+							param.bValue = params[j].asBool();
+							break;
+						case Json::realValue:
+							param.type = KeybindDefinition::Param::kType_Float;
+							param.fValue = params[j].asFloat();
+							break;
+						case Json::stringValue:
+							param.type = KeybindDefinition::Param::kType_String;
+							param.sValue = params[j].asString();
+							break;
+						default:
+							file.messages.push_back({ false, "Cannot register unknown parameter value type: " + std::to_string(params[j].type()) });
+							continue;
+					}
+					definition.params.push_back(param);
+				}
+			}
+
+			file.definitions.push_back(std::move(definition));
+		}
+
+		return true;
+	} catch (...) {
+		file.messages.push_back({ true, "Warning: Failed to parse malformed keybind definition file " + file.path + "." });
+		file.definitions.clear();
+		return false;
+	}
+}
+
+bool KeybindStore::ReadCache(const char* cachePath, std::vector<SourceFile>& files)
+{
+	std::string data;
+	if (!ReadWholeFile(cachePath, data)) return false;
+
+	CacheReader reader(data);
+
+	UInt32 magic, version, numFiles;
+	if (!reader.Read(magic) || magic != kCacheMagic) return false;
+	if (!reader.Read(version) || version != kCacheVersion) return false;
+	if (!reader.Read(numFiles)) return false;
+
+	for (UInt32 i = 0; i < numFiles; i++) {
+		SourceFile file;
+		UInt32 numDefinitions;
+
+		if (!reader.Read(file.folder) || !reader.Read(file.size) || !reader.Read(file.writeTime) || !reader.Read(numDefinitions)) {
+			files.clear();
+			return false;
+		}
+
+		for (UInt32 j = 0; j < numDefinitions; j++) {
+			KeybindDefinition definition;
+			UInt32 numParams;
+
+			bool ok = reader.Read(definition.modName) && reader.Read(definition.keybindID) && reader.Read(definition.keybindDesc) &&
+				reader.Read(definition.actionType) && reader.Read(definition.form) && reader.Read(definition.function) &&
+				reader.Read(definition.script) && reader.Read(definition.command) && reader.Read(numParams);
+
+			for (UInt32 k = 0; ok && k < numParams; k++) {
+				KeybindDefinition::Param param = {};
+				ok = reader.Read(param.type) && reader.Read(param.iValue) && reader.Read(param.fValue) && reader.Read(param.bValue) && reader.Read(param.sValue);
+				definition.params.push_back(param);
+			}
+
+			if (!ok) {
+				files.clear();
+				return false;
+			}
+
+			file.definitions.push_back(std::move(definition));
+		}
+
+		files.push_back(std::move(file));
+	}
+
+	return true;
+}
+
+bool KeybindStore::WriteCache(const char* cachePath, const std::vector<SourceFile>& files)
+{
+	CacheWriter writer;
+	writer.Write(kCacheMagic);
+	writer.Write(kCacheVersion);
+	writer.Write((UInt32)files.size());
+
+	for (auto& file : files) {
+		writer.Write(file.folder);
+		writer.Write(file.size);
+		writer.Write(file.writeTime);
+		writer.Write((UInt32)file.definitions.size());
+
+		for (auto& definition : file.definitions) {
+			writer.Write(definition.modName);
+			writer.Write(definition.keybindID);
+			writer.Write(definition.keybindDesc);
+			writer.Write(definition.actionType);
+			writer.Write(definition.form);
+			writer.Write(definition.function);
+			writer.Write(definition.script);
+			writer.Write(definition.command);
+			writer.Write((UInt32)definition.params.size());
+
+			for (auto& param : definition.params) {
+				writer.Write(param.type);
+				writer.Write(param.iValue);
+				writer.Write(param.fValue);
+				writer.Write(param.bValue);
+				writer.Write(param.sValue);
+			}
+		}
+	}
+
+	// Written to the side and moved over the old cache, so a crash never leaves a half written one.
+	std::string tempPath = std::string(cachePath) + ".tmp";
+	const std::string& data = writer.GetData();
+
+	HANDLE handle = CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+
+	DWORD bytesWritten = 0;
+	bool result = WriteFile(handle, data.data(), data.size(), &bytesWritten, NULL) && bytesWritten == data.size();
+
+	CloseHandle(handle);
+
+	if (result) result = MoveFileEx(tempPath.c_str(), cachePath, MOVEFILE_REPLACE_EXISTING) != 0;
+	if (!result) DeleteFile(tempPath.c_str());
+
+	return result;
+}
+
+UInt64 KeybindStore::HashKey(const char* modName, size_t modLength, const char* keybindID, size_t idLength)
+{
+	// lowercased, so any case finds the definition
+	return KeyIndex::Hash(modName, modLength, keybindID, idLength, Lower);
+}
+
+void KeybindStore::BuildIndex()
+{
+	m_index.Reset(m_definitions.size());
+
+	for (UInt32 i = 0; i < m_definitions.size(); i++) {
+		const KeybindDefinition& definition = m_definitions[i];
+		UInt64 hash = HashKey(definition.modName.data(), definition.modName.size(), definition.keybindID.data(), definition.keybindID.size());
+
+		// a later definition of the same keybind replaces the earlier one
+		m_index.Insert(hash, i, [&](UInt32 other) {
+			return EqualsNoCase(m_definitions[other].modName, definition.modName.c_str()) && EqualsNoCase(m_definitions[other].keybindID, definition.keybindID.c_str());
+		});
+	}
+}
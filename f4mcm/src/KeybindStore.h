@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/ITypes.h"
+
+#include "KeyIndex.h"
+
+// A keybind as defined in Data\MCM\Config\<Mod>\keybinds.json, before its form or script is resolved.
+struct KeybindDefinition
+{
+	struct Param {
+		enum Type {
+			kType_Int,
+			kType_Float,
+			kType_String,
+			kType_Bool,
+		};
+
+		UInt8		type;
+		SInt32		iValue;
+		float		fValue;
+		bool		bValue;
+		std::string	sValue;
+	};
+
+	std::string			modName;		// the file's modName, not its folder
+	std::string			keybindID;
+	std::string			keybindDesc;
+	std::string			actionType;		// "CallFunction", "CallGlobalFunction", "RunConsoleCommand" or "SendEvent"
+	std::string			form;			// form identifier for CallFunction and SendEvent
+	std::string			function;
+	std::string			script;
+	std::string			command;
+	std::vector<Param>	params;
+};
+
+// Every keybind definition of every mod, built once at startup and looked up by mod name and keybind ID.
+// Files are parsed in parallel, and the parsed definitions are cached in a binary file together with each source
+// file's size and write time, so the next launch only parses the files that changed.
+class KeybindStore
+{
+public:
+	static KeybindStore& GetInstance() {
+		static KeybindStore instance;
+		return instance;
+	}
+
+	// configDir holds one folder per mod, e.g. "Data\\MCM\\Config\\"
+	void Build(const char* configDir, const char* cachePath);
+
+	// Case insensitive. Null if no mod defines it.
+	const KeybindDefinition* Find(const char* modName, const char* keybindID) const;
+
+	UInt32 GetNumDefinitions() const { return m_definitions.size(); }
+	UInt32 GetNumFilesParsed() const { return m_numFilesParsed; }
+	UInt32 GetNumFilesCached() const { return m_numFilesCached; }
+
+	KeybindStore() { }
+
+	KeybindStore(KeybindStore const&)	= delete;
+	void operator=(KeybindStore const&) = delete;
+
+private:
+	struct SourceFile {
+		std::string	folder;
+		std::string	path;
+		UInt64		size		= 0;
+		UInt64		writeTime	= 0;
+		bool		parsed		= false;
+		std::vector<KeybindDefinition>	definitions;
+
+		// from the parse worker, logged by the calling thread once every file is done
+		struct Message {
+			bool		warning;
+			std::string	text;
+		};
+		std::vector<Message>	messages;
+	};
+
+	static void FindSourceFiles(const char* configDir, std::vector<SourceFile>& files);
+	static void ParseSourceFiles(std::vector<SourceFile>& files);
+	static bool ParseSourceFile(SourceFile& file);
+
+	static bool ReadCache(const char* cachePath, std::vector<SourceFile>& files);
+	static bool WriteCache(const char* cachePath, const std::vector<SourceFile>& files);
+
+	static UInt64 HashKey(const char* modName, size_t modLength, const char* keybindID, size_t idLength);
+	void BuildIndex();
+
+	std::vector<KeybindDefinition>	m_definitions;
+	KeyIndex						m_index;		// of m_definitions
+	UInt32							m_numFilesParsed = 0;
+	UInt32							m_numFilesCached = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "common/ITypes.h"
+
+// Dense keycode+modifiers lookup for key presses, built whole by KeybindManager and read only afterwards.
+// Each keycode has one slot per combination of the three modifier bits, plus a mask of the combinations bound
+// on it, so a press on an unbound key is answered without reading the modifier state at all.
+template <typename A>
+class KeybindTable
+{
+public:
+	enum {
+		kNumModifierSets	= 8,	// Keybind::kModifier_Shift | kModifier_Control | kModifier_Alt
+		kMaxKeycode			= 0x10000,
+	};
+
+	// returns false for keycodes and modifiers no key press can produce
+	bool Add(UInt32 keycode, UInt8 modifiers, const A & action) {
+		if (keycode >= kMaxKeycode || modifiers >= kNumModifierSets)
+			return false;
+
+		if (keycode >= m_modifierSets.size()) {
+			m_modifierSets.resize(keycode + 1, 0);
+			m_slots.resize((keycode + 1) * kNumModifierSets, 0);
+		}
+
+		UInt32& slot = m_slots[keycode * kNumModifierSets + modifiers];
+		if (slot) {
+			m_actions[slot - 1] = action;
+		} else {
+			m_actions.push_back(action);
+			slot = m_actions.size();
+		}
+
+		m_modifierSets[keycode] |= 1 << modifiers;
+		return true;
+	}
+
+	// bit n is set if the keycode is bound with modifiers n
+	UInt8 GetModifierSets(UInt32 keycode) const {
+		return keycode < m_modifierSets.size() ? m_modifierSets[keycode] : 0;
+	}
+
+	const A* Find(UInt32 keycode, UInt8 modifiers) const {
+		if (!(GetModifierSets(keycode) & (1 << modifiers)))
+			return nullptr;
+
+		return &m_actions[m_slots[keycode * kNumModifierSets + modifiers] - 1];
+	}
+
+	UInt32 Size() const { return m_actions.size(); }
+
+private:
+	std::vector<A>			m_actions;
+	std::vector<UInt32>		m_slots;			// action index + 1, 0 if unbound
+	std::vector<UInt8>		m_modifierSets;		// per keycode
+};
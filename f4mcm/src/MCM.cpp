@@ -4,6 +4,8 @@
 
 #include "f4se/PluginManager.h"
 
+#include "f4se_common/Utilities.h"
+
 #include "f4se_common/f4se_version.h"
 
 #include "f4se/ScaleformValue.h"
@@ -24,6 +26,7 @@
 #include "PapyrusMCM.h"
 #include "ScaleformMCM.h"
 #include "SettingStore.h"
+#include "KeybindStore.h"
 #include "MCMInput.h"
 #include "MCMSerialization.h"
 #include "MCMTranslator.h"
@@ -68,6 +71,13 @@ bool F4SEPlugin_Query(const F4SEInterface * f4se, PluginInfo * info)
 {
 	gLog.OpenRelative(CSIDL_MYDOCUMENTS, "\\My Games\\Fallout4VR\\F4SE\\MCMVR.log");
 
+	// input and menu navigation log on every event, the same switch as F4SE's own log
+	UInt32 asyncLog = 1;
+	GetConfigOption_UInt32("Logging", "bAsyncLog", &asyncLog);
+	gLog.SetAsync(asyncLog != 0);
+
+	gLog.ReadModuleLevels(GetConfigPath().c_str(), "Logging");
+
 	_MESSAGE("MCM VR v%s", PLUGIN_VERSION_STRING);
 	_MESSAGE("MCM VR query");
 
@@ -152,6 +162,11 @@ bool F4SEPlugin_Load(const F4SEInterface *f4se)
 
     SettingStore::GetInstance().ReadSettings();
 
+    // The keybind definition cache lives next to the user settings.
+    if (GetFileAttributes("Data\\MCM\\Settings") == INVALID_FILE_ATTRIBUTES)
+        CreateDirectory("Data\\MCM\\Settings", NULL);
+    KeybindStore::GetInstance().Build("Data\\MCM\\Config\\", "Data\\MCM\\Settings\\Keybinds.cache");
+
     return true;
 }
 
@@ -12,6 +12,8 @@
 #include "Globals.h"
 #include "Utils.h"
 
+IDEBUGLOG_MODULE("MCMInput");
+
 void MCMInput::RegisterForInput(bool bRegister)
 {
 	tArray<BSInputEventUser*>* inputEvents = &((*G::menuControls)->inputEvents);
@@ -29,24 +31,56 @@ void MCMInput::RegisterForInput(bool bRegister)
 	}
 }
 
-void PackArgs(VMArray<VMVariable> & arguments, KeybindParameters & kp) {
-	for (int i = 0; i < kp.actionParams.size(); i++) {
-		VMVariable var;
-		switch (kp.actionParams[i].paramType) {
-			case ActionParameters::kType_Int:
-				var.Set(&kp.actionParams[i].iValue);
-				break;
-			case ActionParameters::kType_Bool:
-				var.Set(&kp.actionParams[i].bValue);
-				break;
-			case ActionParameters::kType_Float:
-				var.Set(&kp.actionParams[i].fValue);
-				break;
-			case ActionParameters::kType_String:
-				var.Set(&kp.actionParams[i].sValue);
-				break;
+static void RunKeyDownAction(const KeybindAction & action)
+{
+	switch (action.type) {
+		case KeybindParameters::kType_CallFunction:
+		{
+			TESForm* form = LookupFormByID(action.targetFormID);
+			if (form) {
+				VirtualMachine * vm = (*G::gameVM)->m_virtualMachine;
+				VMValue receiver;
+				PackValue(&receiver, &form, vm);
+				if (receiver.IsIdentifier() && receiver.data.id) {
+					VMValue args = action.args;
+					CallFunctionNoWait_Internal(vm, 0, receiver.data.id, &action.callbackName, &args);
+				}
+			} else {
+				_WARNING("Warning: Cannot call a function on a None form.");
+			}
+			break;
+		}
+		case KeybindParameters::kType_CallGlobalFunction:
+		{
+			if (action.callbackName.c_str()[0]) {
+				VirtualMachine * vm = (*G::gameVM)->m_virtualMachine;
+				VMValue args = action.args;
+				CallGlobalFunctionNoWait_Internal(vm, 0, 0, &action.scriptName, &action.callbackName, &args);
+			}
+			break;
 		}
-		arguments.Push(&var);
+		case KeybindParameters::kType_RunConsoleCommand:
+		{
+			if (action.callbackName.c_str()[0]) {
+				MCMUtils::ExecuteCommand(action.callbackName.c_str());
+			}
+			break;
+		}
+		case KeybindParameters::kType_SendEvent:
+		{
+			TESForm* form = LookupFormByID(action.targetFormID);
+			if (form) {
+				UInt64 handle = PapyrusVM::GetHandleFromObject(form, TESForm::kTypeID);
+				BSFixedString keybindID = action.keybindID;
+				SendPapyrusEvent1<BSFixedString>(handle, "ScriptObject", "OnControlDown", keybindID);
+			} else {
+				_WARNING("Warning: Cannot send an event to a None form.");
+			}
+			break;
+		}
+		default:
+			_WARNING("Warning: Cannot execute a keybind with unknown action type.");
+			break;
 	}
 }
 
@@ -60,7 +94,7 @@ void MCMInput::OnButtonEvent(ButtonEvent * inputEvent)
 	static int logCount = 0;
 	if (logCount < 50) {
 		BSFixedString* controlID = inputEvent->GetControlID();
-		_MESSAGE("MCMInput: Button event - deviceType=%u keyMask=%u isDown=%.1f timer=%.2f control=%s", 
+		_DMESSAGE("MCMInput: Button event - deviceType=%u keyMask=%u isDown=%.1f timer=%.2f control=%s", 
 			deviceType, keyMask, inputEvent->isDown, inputEvent->timer,
 			controlID ? controlID->c_str() : "null");
 		logCount++;
@@ -94,68 +128,20 @@ void MCMInput::OnButtonEvent(ButtonEvent * inputEvent)
 
 			default: {
 				if ((*G::ui)->numPauseGame == 0) {
-					Keybind kb = {};
-					kb.keycode = keyCode;
-					if (GetAsyncKeyState(VK_SHIFT) & 0x8000)		kb.modifiers |= Keybind::kModifier_Shift;
-					if (GetAsyncKeyState(VK_CONTROL) & 0x8000)	kb.modifiers |= Keybind::kModifier_Control;
-					if (GetAsyncKeyState(VK_MENU) & 0x8000)		kb.modifiers |= Keybind::kModifier_Alt;
-
-					g_keybindManager.Lock();
-					if (g_keybindManager.m_data.count(kb) > 0) {
-						KeybindParameters kp = g_keybindManager.m_data[kb];
-						g_keybindManager.Release();
-
-						switch (kp.type) {
-							case KeybindParameters::kType_CallFunction:
-							{
-								TESForm* form = LookupFormByID(kp.targetFormID);
-								if (form) {
-									VMArray<VMVariable> arguments;
-									PackArgs(arguments, kp);
-									CallFunctionNoWait<TESForm>(form, kp.callbackName, arguments);
-								} else {
-									_WARNING("Warning: Cannot call a function on a None form.");
-								}
-								break;
-							}
-							case KeybindParameters::kType_CallGlobalFunction:
-							{
-								if (strlen(kp.callbackName.c_str()) > 0) {
-									VirtualMachine * vm = (*G::gameVM)->m_virtualMachine;
-									VMArray<VMVariable> arguments;
-									PackArgs(arguments, kp);
-									VMValue args;
-									PackValue(&args, &arguments, vm);
-									CallGlobalFunctionNoWait_Internal(vm, 0, 0, &kp.scriptName, &kp.callbackName, &args);
-								}
-								break;
-							}
-							case KeybindParameters::kType_RunConsoleCommand:
-							{
-								if (strlen(kp.callbackName.c_str()) > 0) {
-									MCMUtils::ExecuteCommand(kp.callbackName.c_str());
-								}
-								break;
-							}
-							case KeybindParameters::kType_SendEvent:
-							{
-								TESForm* form = LookupFormByID(kp.targetFormID);
-								if (form) {
-									UInt64 handle = PapyrusVM::GetHandleFromObject(form, TESForm::kTypeID);
-									SendPapyrusEvent1<BSFixedString>(handle, "ScriptObject", "OnControlDown", kp.keybindID);
-								} else {
-									_WARNING("Warning: Cannot send an event to a None form.");
-								}
-								break;
-							}
-							default:
-								_WARNING("Warning: Cannot execute a keybind with unknown action type.");
-								break;
-						}
-						
-					} else {
-						g_keybindManager.Release();
-					}
+					KeybindManager::ActionTableSnapshot actions = g_keybindManager.GetActionTable();
+
+					// nothing bound on this key, skip reading the modifier state
+					if (!actions || !actions->GetModifierSets(keyCode))
+						break;
+
+					UInt8 modifiers = 0;
+					if (GetAsyncKeyState(VK_SHIFT) & 0x8000)		modifiers |= Keybind::kModifier_Shift;
+					if (GetAsyncKeyState(VK_CONTROL) & 0x8000)	modifiers |= Keybind::kModifier_Control;
+					if (GetAsyncKeyState(VK_MENU) & 0x8000)		modifiers |= Keybind::kModifier_Alt;
+
+					const KeybindAction* action = actions->Find(keyCode, modifiers);
+					if (action)
+						RunKeyDownAction(*action);
 				}
 
 				break;
@@ -175,30 +161,18 @@ void MCMInput::OnButtonEvent(ButtonEvent * inputEvent)
 
 			default: {
 				if ((*G::ui)->numPauseGame == 0) {
-					Keybind kb = {};
-					kb.keycode = keyCode;
-					kb.modifiers = 0;
-
-					g_keybindManager.Lock();
-					if (g_keybindManager.m_data.count(kb) > 0) {
-						KeybindParameters kp = g_keybindManager.m_data[kb];
-						g_keybindManager.Release();
-
-						switch (kp.type) {
-							case KeybindParameters::kType_SendEvent:
-							{
-								TESForm* form = LookupFormByID(kp.targetFormID);
-								if (form) {
-									UInt64 handle = PapyrusVM::GetHandleFromObject(form, TESForm::kTypeID);
-									SendPapyrusEvent2<BSFixedString, float>(handle, "ScriptObject", "OnControlUp", kp.keybindID, timer);
-								} else {
-									_WARNING("Warning: Cannot send an event to a None form.");
-								}
-								break;
-							}
+					KeybindManager::ActionTableSnapshot actions = g_keybindManager.GetActionTable();
+
+					const KeybindAction* action = actions ? actions->Find(keyCode, 0) : nullptr;
+					if (action && action->type == KeybindParameters::kType_SendEvent) {
+						TESForm* form = LookupFormByID(action->targetFormID);
+						if (form) {
+							UInt64 handle = PapyrusVM::GetHandleFromObject(form, TESForm::kTypeID);
+							BSFixedString keybindID = action->keybindID;
+							SendPapyrusEvent2<BSFixedString, float>(handle, "ScriptObject", "OnControlUp", keybindID, timer);
+						} else {
+							_WARNING("Warning: Cannot send an event to a None form.");
 						}
-					} else {
-						g_keybindManager.Release();
 					}
 				}
 
@@ -1,8 +1,10 @@
 #include "MCMKeybinds.h"
 #include <fstream>
+#include <sstream>
 #include <algorithm>
 
 #include "Globals.h"
+#include "KeybindStore.h"
 #include "Utils.h"
 
 #include "json/json.h"
@@ -16,6 +18,7 @@ void KeybindManager::Register(Keybind key, KeybindParameters & params)
 {
 	Lock();
 	m_data[key] = params;
+	PublishActions();
 	Release();
 }
 
@@ -23,9 +26,62 @@ void KeybindManager::Clear(void)
 {
 	Lock();
 	m_data.clear();
+	PublishActions();
 	Release();
 }
 
+static void PackActionParams(VMValue & dst, KeybindParameters & kp)
+{
+	VMArray<VMVariable> arguments;
+	for (auto& ap : kp.actionParams) {
+		VMVariable var;
+		switch (ap.paramType) {
+			case ActionParameters::kType_Int:
+				var.Set(&ap.iValue);
+				break;
+			case ActionParameters::kType_Bool:
+				var.Set(&ap.bValue);
+				break;
+			case ActionParameters::kType_Float:
+				var.Set(&ap.fValue);
+				break;
+			case ActionParameters::kType_String:
+				var.Set(&ap.sValue);
+				break;
+		}
+		arguments.Push(&var);
+	}
+
+	PackValue(&dst, &arguments, (*G::gameVM)->m_virtualMachine);
+}
+
+void KeybindManager::PublishActions()
+{
+	auto table = std::make_shared<ActionTable>();
+
+	m_boundKeys.clear();
+
+	for (auto& entry : m_data) {
+		KeybindParameters& kp = entry.second;
+
+		m_boundKeys[std::make_pair(kp.modName, kp.keybindID)] = entry.first;
+
+		KeybindAction action;
+		action.type			= kp.type;
+		action.targetFormID	= kp.targetFormID;
+		action.keybindID	= kp.keybindID;
+		action.callbackName	= kp.callbackName;
+		action.scriptName	= kp.scriptName;
+
+		if (kp.type == KeybindParameters::kType_CallFunction || kp.type == KeybindParameters::kType_CallGlobalFunction)
+			PackActionParams(action.args, kp);
+
+		table->Add(entry.first.keycode, entry.first.modifiers, action);
+	}
+
+	std::atomic_store(&m_actionTable, ActionTableSnapshot(table));
+}
+
 //------------------------------
 // Serialization
 //------------------------------
@@ -55,37 +111,61 @@ std::string KeybindManager::ToJSON()
 }
 
 bool KeybindManager::FromJSON(std::string jsonStr)
+{
+	std::vector<StoredKeybind> keybinds;
+	if (!ParseKeybinds(jsonStr, keybinds)) return false;
+
+	ApplyKeybinds(keybinds);
+	return true;
+}
+
+bool KeybindManager::LoadKeybinds(const char* path)
+{
+	UInt64 size, writeTime;
+	if (!GetFileStamp(path, size, writeTime)) return false;
+
+	if (!m_storedWriteTime || size != m_storedSize || writeTime != m_storedWriteTime) {
+		std::ifstream file(path);
+		if (!file.is_open()) return false;
+
+		std::stringstream ss;
+		ss << file.rdbuf();
+		file.close();
+
+		std::vector<StoredKeybind> keybinds;
+		if (!ParseKeybinds(ss.str(), keybinds)) return false;
+
+		m_storedKeybinds.swap(keybinds);
+		m_storedSize = size;
+		m_storedWriteTime = writeTime;
+	}
+
+	ApplyKeybinds(m_storedKeybinds);
+	return true;
+}
+
+bool KeybindManager::ParseKeybinds(const std::string& jsonStr, std::vector<StoredKeybind>& keybinds)
 {
 	try {
-		Json::Value json, keybinds;
+		Json::Value json, keybindsJson;
 		Json::Reader reader;
 		reader.parse(jsonStr, json);
 
 		if (json["version"].asInt() < 1) return false;
 
-		keybinds = json["keybinds"];
-		if (!keybinds.isArray()) return false;
-
-		for (int i = 0; i < keybinds.size(); i++) {
-			const Json::Value& keybind = keybinds[i];
-
-			Keybind kb = {};
-			KeybindParameters kp = {};
+		keybindsJson = json["keybinds"];
+		if (!keybindsJson.isArray()) return false;
 
-			kb.keycode		= keybind["keycode"].asInt();
-			kb.modifiers	= keybind["modifiers"].asInt();
+		for (int i = 0; i < keybindsJson.size(); i++) {
+			const Json::Value& keybind = keybindsJson[i];
 
-			std::string modName		= keybind["modName"].asString();
-			std::string keybindID	= keybind["id"].asString();
+			StoredKeybind stored = {};
+			stored.kb.keycode	= keybind["keycode"].asInt();
+			stored.kb.modifiers	= keybind["modifiers"].asInt();
+			stored.modName		= keybind["modName"].asString();
+			stored.keybindID	= keybind["id"].asString();
 
-			if (GetKeybindData(modName, keybindID, &kp)) {
-				Lock();
-				m_data[kb] = kp;
-				Release();
-			} else {
-				_MESSAGE("Warning: Failed to get keybind data for %s with keybind ID %s", modName.c_str(), keybindID.c_str());
-				continue;
-			}
+			keybinds.push_back(stored);
 		}
 
 		return true;
@@ -95,6 +175,39 @@ bool KeybindManager::FromJSON(std::string jsonStr)
 	}
 }
 
+void KeybindManager::ApplyKeybinds(const std::vector<StoredKeybind>& keybinds)
+{
+	std::vector<std::pair<Keybind, KeybindParameters>> resolved;
+
+	for (auto& stored : keybinds) {
+		KeybindParameters kp = {};
+		if (GetKeybindData(stored.modName, stored.keybindID, &kp)) {
+			resolved.emplace_back(stored.kb, kp);
+		} else {
+			_MESSAGE("Warning: Failed to get keybind data for %s with keybind ID %s", stored.modName.c_str(), stored.keybindID.c_str());
+		}
+	}
+
+	Lock();
+	for (auto& entry : resolved) {
+		m_data[entry.first] = entry.second;
+	}
+	PublishActions();
+	Release();
+}
+
+bool KeybindManager::GetFileStamp(const char* path, UInt64& size, UInt64& writeTime)
+{
+	WIN32_FIND_DATA data;
+	HANDLE hFind = FindFirstFile(path, &data);
+	if (hFind == INVALID_HANDLE_VALUE) return false;
+	FindClose(hFind);
+
+	size		= ((UInt64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	writeTime	= ((UInt64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
 void KeybindManager::CommitKeybinds()
 {
 	if (m_keybindsDirty) {
@@ -113,6 +226,14 @@ void KeybindManager::CommitKeybinds()
 			file << jsonStr;
 			file.close();
 			m_keybindsDirty = false;
+
+			// What was just written is what the next load would read back.
+			m_storedKeybinds.clear();
+			for (auto& entry : m_data) {
+				m_storedKeybinds.push_back({ entry.first, entry.second.modName.c_str(), entry.second.keybindID.c_str() });
+			}
+			if (!GetFileStamp("Data\\MCM\\Settings\\Keybinds.json", m_storedSize, m_storedWriteTime))
+				m_storedWriteTime = 0;
 		} catch (...) {
 			_MESSAGE("Warning: An error occurred when serializing keybinds.");
 		}
@@ -125,153 +246,97 @@ void KeybindManager::CommitKeybinds()
 
 bool KeybindManager::GetKeybindData(std::string modName, std::string keybindID, KeybindParameters * kp)
 {
-	// Check if we've already cached the data.
-	std::string keyName = modName + keybindID;
-	std::transform(keyName.begin(), keyName.end(), keyName.begin(), ::tolower);
-	if (m_keybindData.count(keyName) == 0) {
-		try {
-			// Not in the cache. Load from disk.
-			auto idx = modName.find_last_of('.');	// Strip trailing .esp / .esm
-			std::string filePath = "Data\\MCM\\Config\\" + modName.substr(0, idx) + "\\keybinds.json";
-			_MESSAGE("Loading keybind definitions for %s", modName.c_str());
-			std::ifstream file(filePath);
-			if (file.is_open()) {
-				Json::Value json, keybinds;
-				Json::Reader reader;
-				reader.parse(file, json);
-
-				keybinds = json["keybinds"];
-				if (!keybinds.isArray()) return false;
-
-				for (int i = 0; i < keybinds.size(); i++) {
-					const Json::Value& keybind = keybinds[i];
-
-					KeybindParameters kp = {};
-					kp.modName		= json["modName"].asCString();
-					kp.keybindID	= keybind["id"].asCString();
-					kp.keybindDesc	= keybind["desc"].asCString();
-					//kp.flags		= keybind["flags"].asInt();
-					kp.type			= -1;
-
-					std::string typeStr = keybind["action"]["type"].asString();
-					if		(typeStr == "CallFunction")			kp.type = KeybindParameters::kType_CallFunction;
-					else if (typeStr == "CallGlobalFunction")	kp.type = KeybindParameters::kType_CallGlobalFunction;
-					else if (typeStr == "RunConsoleCommand")	kp.type = KeybindParameters::kType_RunConsoleCommand;
-					else if (typeStr == "SendEvent")			kp.type = KeybindParameters::kType_SendEvent;
-
-					switch (kp.type) {
-						case KeybindParameters::kType_CallFunction:
-						{
-							TESForm* form = MCMUtils::GetFormFromIdentifier(keybind["action"]["form"].asString());
-							if (form) {
-								kp.targetFormID = form->formID;
-								kp.callbackName = keybind["action"]["function"].asCString();
-
-								Json::Value actionParams = keybind["action"]["params"];
-								if (!actionParams.isNull()) SetActionParams(actionParams, kp);
-							} else {
-								// Invalid form.
-								continue;
-							}
-							break;
-						}
-						case KeybindParameters::kType_CallGlobalFunction:
-						{
-							kp.scriptName = keybind["action"]["script"].asCString();
-							kp.callbackName = keybind["action"]["function"].asCString();
-
-							Json::Value actionParams = keybind["action"]["params"];
-							if (!actionParams.isNull()) SetActionParams(actionParams, kp);
-							
-							break;
-						}
-						case KeybindParameters::kType_RunConsoleCommand:
-						{
-							kp.callbackName = keybind["action"]["command"].asCString();
-							break;
-						}
-						case KeybindParameters::kType_SendEvent:
-						{
-							TESForm* form = MCMUtils::GetFormFromIdentifier(keybind["action"]["form"].asString());
-							if (form) {
-								kp.targetFormID = form->formID;
-							} else {
-								// Invalid form.
-								continue;
-							}
-							break;
-						}
-						default:
-						{
-							_WARNING("Warning: Cannot deserialize invalid keybind action type %s.", typeStr.c_str());
-							continue;
-							break;
-						}
-					}
-
-					std::string keyName = json["modName"].asString() + keybind["id"].asString();
-					std::transform(keyName.begin(), keyName.end(), keyName.begin(), ::tolower);
-					m_keybindData[keyName] = kp;
-				}
-			} else {
-				// Keybinds file doesn't exist.
+	const KeybindDefinition* definition = KeybindStore::GetInstance().Find(modName.c_str(), keybindID.c_str());
+	if (!definition) {
+		// The keybind doesn't exist anymore.
+		return false;
+	}
+
+	KeybindParameters params = {};
+	params.modName		= definition->modName.c_str();
+	params.keybindID	= definition->keybindID.c_str();
+	params.keybindDesc	= definition->keybindDesc.c_str();
+	params.type			= -1;
+
+	const std::string& typeStr = definition->actionType;
+	if		(typeStr == "CallFunction")			params.type = KeybindParameters::kType_CallFunction;
+	else if (typeStr == "CallGlobalFunction")	params.type = KeybindParameters::kType_CallGlobalFunction;
+	else if (typeStr == "RunConsoleCommand")	params.type = KeybindParameters::kType_RunConsoleCommand;
+	else if (typeStr == "SendEvent")			params.type = KeybindParameters::kType_SendEvent;
+
+	switch (params.type) {
+		case KeybindParameters::kType_CallFunction:
+		case KeybindParameters::kType_SendEvent:
+		{
+			TESForm* form = MCMUtils::GetFormFromIdentifier(definition->form);
+			if (!form) {
+				// Invalid form.
 				return false;
 			}
-		} catch (...) {
-			_WARNING("Warning: Failed to parse malformed keybind definition file for mod %s.", modName.c_str());
+			params.targetFormID = form->formID;
+
+			if (params.type == KeybindParameters::kType_CallFunction) {
+				params.callbackName = definition->function.c_str();
+				SetActionParams(*definition, params);
+			}
+			break;
+		}
+		case KeybindParameters::kType_CallGlobalFunction:
+		{
+			params.scriptName = definition->script.c_str();
+			params.callbackName = definition->function.c_str();
+			SetActionParams(*definition, params);
+			break;
+		}
+		case KeybindParameters::kType_RunConsoleCommand:
+		{
+			params.callbackName = definition->command.c_str();
+			break;
+		}
+		default:
+		{
+			_WARNING("Warning: Cannot deserialize invalid keybind action type %s.", typeStr.c_str());
 			return false;
 		}
 	}
 
-	if (m_keybindData.count(keyName) > 0) {
-		*kp = m_keybindData[keyName];
-		return true;
-	} else {
-		// The keybind doesn't exist anymore.
-		return false;
-	}
+	*kp = params;
+	return true;
 }
 
-void KeybindManager::SetActionParams(Json::Value & actionParams, KeybindParameters & kp)
+void KeybindManager::SetActionParams(const KeybindDefinition & definition, KeybindParameters & kp)
 {
-	if (actionParams.isArray()) {
-		for (int i = 0; i < actionParams.size(); i++) {
-			ActionParameters ap;
-			switch (actionParams[i].type()) {
-			case Json::intValue:
-				ap.paramType = ActionParameters::kType_Int;
-				ap.iValue = actionParams[i].asInt();
-				break;
-			case Json::booleanValue:
-				ap.paramType = ActionParameters::kType_Bool;
-				ap.bValue = actionParams[i].asBool();
-				break;
-			case Json::realValue:
-				ap.paramType = ActionParameters::kType_Float;
-				ap.fValue = actionParams[i].asFloat();
-				break;
-			case Json::stringValue:
-				ap.paramType = ActionParameters::kType_String;
-				ap.sValue = actionParams[i].asCString();
-				break;
-			default:
-				// Unknown value type
-				_MESSAGE("Cannot register unknown parameter value type: %s", actionParams[i].type());
-				break;
-			}
-			if (ap.paramType != ActionParameters::kType_None) {
-				kp.actionParams.push_back(ap);
-			}
+	for (auto& param : definition.params) {
+		ActionParameters ap;
+		switch (param.type) {
+		case KeybindDefinition::Param::kType_Int:
+			ap.paramType = ActionParameters::kType_Int;
+			ap.iValue = param.iValue;
+			break;
+		case KeybindDefinition::Param::kType_Bool:
+			ap.paramType = ActionParameters::kType_Bool;
+			ap.bValue = param.bValue;
+			break;
+		case KeybindDefinition::Param::kType_Float:
+			ap.paramType = ActionParameters::kType_Float;
+			ap.fValue = param.fValue;
+			break;
+		case KeybindDefinition::Param::kType_String:
+			ap.paramType = ActionParameters::kType_String;
+			ap.sValue = param.sValue.c_str();
+			break;
+		}
+		if (ap.paramType != ActionParameters::kType_None) {
+			kp.actionParams.push_back(ap);
 		}
 	}
 }
 
 KeybindInfo KeybindManager::GetKeybind(BSFixedString modName, BSFixedString keybindID)
 {
-	for (RegMap::iterator iter = m_data.begin(); iter != m_data.end(); iter++) {
-		if (iter->second.modName == modName && iter->second.keybindID == keybindID) {
-			return GetKeybind(iter->first);
-		}
+	auto bound = m_boundKeys.find(std::make_pair(modName, keybindID));
+	if (bound != m_boundKeys.end()) {
+		return GetKeybind(bound->second);
 	}
 	KeybindInfo ki = {};
 	return ki;
@@ -361,6 +426,7 @@ bool KeybindManager::RegisterKeybind(Keybind kb, BSFixedString modName, BSFixedS
 	if (GetKeybindData(modName.c_str(), keybindID.c_str(), &kp)) {
 		Lock();
 		m_data[kb] = kp;
+		PublishActions();
 		Release();
 		m_keybindsDirty = true;
 		return true;
@@ -371,12 +437,12 @@ bool KeybindManager::RegisterKeybind(Keybind kb, BSFixedString modName, BSFixedS
 
 bool KeybindManager::ClearKeybind(BSFixedString modName, BSFixedString keybindID)
 {
-	for (RegMap::iterator iter = m_data.begin(); iter != m_data.end(); iter++) {
-		if (iter->second.modName == modName && iter->second.keybindID == keybindID) {
-			m_data.erase(iter);
-			m_keybindsDirty = true;
-			return true;
-		}
+	auto bound = m_boundKeys.find(std::make_pair(modName, keybindID));
+	if (bound != m_boundKeys.end()) {
+		m_data.erase(bound->second);
+		PublishActions();
+		m_keybindsDirty = true;
+		return true;
 	}
 	return false;
 }
@@ -386,6 +452,7 @@ bool KeybindManager::ClearKeybind(Keybind kb)
 	auto iter = m_data.find(kb);
 	if (iter != m_data.end()) {
 		m_data.erase(iter);
+		PublishActions();
 		m_keybindsDirty = true;
 		return true;
 	} else {
@@ -395,15 +462,15 @@ bool KeybindManager::ClearKeybind(Keybind kb)
 
 bool KeybindManager::RemapKeybind(BSFixedString modName, BSFixedString keybindID, Keybind newKeybind)
 {
-	for (RegMap::iterator iter = m_data.begin(); iter != m_data.end(); iter++) {
-		if (iter->second.modName == modName && iter->second.keybindID == keybindID) {
-			Keybind oldKeybind = iter->first;
-			if (oldKeybind == newKeybind) return false;
-			m_data[newKeybind] = iter->second;
-			m_data.erase(iter);
-			m_keybindsDirty = true;
-			return true;
-		}
+	auto bound = m_boundKeys.find(std::make_pair(modName, keybindID));
+	if (bound != m_boundKeys.end()) {
+		Keybind oldKeybind = bound->second;
+		if (oldKeybind == newKeybind) return false;
+		m_data[newKeybind] = m_data[oldKeybind];
+		m_data.erase(oldKeybind);
+		PublishActions();
+		m_keybindsDirty = true;
+		return true;
 	}
 	return false;
 }
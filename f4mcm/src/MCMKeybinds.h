@@ -1,12 +1,13 @@
 #pragma once
+#include <memory>
+#include <string>
 #include <vector>
 #include "f4se/PapyrusEvents.h"
 #include "f4se/GameTypes.h"
 
-// Forward-declaration
-namespace Json {
-	class Value;
-}
+#include "KeybindTable.h"
+
+struct KeybindDefinition;
 
 class Keybind
 {
@@ -115,11 +116,28 @@ struct KeybindInfo
 	};
 };
 
+// What a key press runs, precompiled from KeybindParameters when the keybinds change.
+struct KeybindAction
+{
+	UInt8			type;			// KeybindParameters::Type
+	UInt32			targetFormID;
+	BSFixedString	keybindID;
+	BSFixedString	callbackName;
+	BSFixedString	scriptName;
+	VMValue			args;			// actionParams, packed once and passed to every call
+};
+
 class KeybindManager : public SafeDataHolder<std::map<Keybind, KeybindParameters>>
 {
 	typedef std::map<Keybind, KeybindParameters> RegMap;
 
 public:
+	typedef KeybindTable<KeybindAction>				ActionTable;
+	typedef std::shared_ptr<const ActionTable>		ActionTableSnapshot;
+
+	// Thread-safe, doesn't lock. The snapshot stays valid for as long as the caller holds it.
+	ActionTableSnapshot GetActionTable() const { return std::atomic_load(&m_actionTable); }
+
 	// Thread-safe
 	void Register(Keybind key, KeybindParameters & params);
 	void Clear(void);
@@ -129,9 +147,9 @@ public:
 	// Serialization
 	std::string ToJSON();
 	bool FromJSON(std::string jsonStr);
+	bool LoadKeybinds(const char* path);	// FromJSON on the file, skipping the read and parse if it hasn't changed since the last load or commit.
 	void CommitKeybinds();	// Saves registered keybinds to disk if data was changed. (m_keybindsDirty)
-	bool GetKeybindData(std::string modName, std::string keybindID, KeybindParameters* kp);		// Retrieves keybind data from Config\ModName\keybinds.json
-	void SetActionParams(Json::Value & actionParams, KeybindParameters & kp);
+	bool GetKeybindData(std::string modName, std::string keybindID, KeybindParameters* kp);		// Retrieves keybind data from the KeybindStore
 
 	// Not thread-safe. Explicitly lock before calling these.
 	KeybindInfo GetKeybind(BSFixedString modName, BSFixedString keybindID);
@@ -149,10 +167,32 @@ public:
 	bool m_keybindsDirty = false;
 
 private:
-	// Maps a concatentation of modName+keybindID to keybind parameters.
-	// Data is lazy-loaded. Mod keybind data is loaded from disk into this map when first requested and cached here for future fast lookup.
-	std::map<std::string, KeybindParameters> m_keybindData;
+	// A registration as stored in Keybinds.json
+	struct StoredKeybind {
+		Keybind		kb;
+		std::string	modName;
+		std::string	keybindID;
+	};
+
+	// Rebuilds the action table and the bound key index from m_data. Called with the lock held after every change.
+	void PublishActions();
+
+	static void SetActionParams(const KeybindDefinition & definition, KeybindParameters & kp);
+
+	bool ParseKeybinds(const std::string& jsonStr, std::vector<StoredKeybind>& keybinds);
+	void ApplyKeybinds(const std::vector<StoredKeybind>& keybinds);
+
+	static bool GetFileStamp(const char* path, UInt64& size, UInt64& writeTime);
+
+	ActionTableSnapshot m_actionTable;
+
+	// Maps modName+keybindID to the key it's bound to, for the lookups by ID.
+	std::map<std::pair<BSFixedString, BSFixedString>, Keybind> m_boundKeys;
 
+	// Keybinds.json as last loaded or committed, and its size and write time at that point.
+	std::vector<StoredKeybind>	m_storedKeybinds;
+	UInt64						m_storedSize = 0;
+	UInt64						m_storedWriteTime = 0;		// 0 if nothing is stored
 };
 
 extern KeybindManager g_keybindManager;
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "MCMSerialization.h"
 #include "MCMKeybinds.h"
+#include "SettingStore.h"
 
 const char* KEYBIND_LOCATION = "Data\\MCM\\Settings\\Keybinds.json";
 
@@ -30,13 +31,7 @@ namespace MCMSerialization
 		QueryPerformanceFrequency(&frequency);
 
 		// Load keybind registrations.
-		std::ifstream file(KEYBIND_LOCATION);
-		std::stringstream ss;
-		if (file.is_open()) {
-			ss << file.rdbuf();
-			file.close();
-			g_keybindManager.FromJSON(ss.str());
-		} else {
+		if (!g_keybindManager.LoadKeybinds(KEYBIND_LOCATION)) {
 			_MESSAGE("Keybind storage could not be opened or does not exist.");
 		}
 
@@ -47,6 +42,8 @@ namespace MCMSerialization
 	void SaveCallback(const F4SESerializationInterface * intfc)
 	{
 		g_keybindManager.CommitKeybinds();
+		SettingStore::GetInstance().FlushModSettings();
+		gLog.Flush();
 	}
 	
 }
\ No newline at end of file
@@ -25,6 +25,8 @@
 
 #include <chrono>
 
+IDEBUGLOG_MODULE("ScaleformMCM");
+
 // Debounce timer for GoBackOneMenu to prevent double-trigger
 static std::chrono::steady_clock::time_point g_lastGoBackTime;
 static bool g_goBackTimeInitialized = false;
@@ -95,9 +97,13 @@ namespace ScaleformMCM {
 	class OnMCMClose : public GFxFunctionHandler {
 	public:
 		virtual void Invoke(Args* args) {
-			// Save modified keybinds.
+			// Save modified keybinds and settings.
 			g_keybindManager.CommitKeybinds();
+			SettingStore::GetInstance().FlushModSettings();
 			RegisterForInput(false);
+
+			// MCM's log isn't F4SE's, nothing else writes out what's queued before a quit
+			gLog.Flush();
 		}
 	};
 
@@ -850,7 +856,7 @@ public:
 		// Debug: Log ALL button events to understand what's coming through
 		static int allLogCount = 0;
 		if (allLogCount < 100) {
-			_MESSAGE("F4SEInput: deviceType=%u control='%s' keyMask=%u isDown=%.1f timer=%.2f", 
+			_DMESSAGE("F4SEInput: deviceType=%u control='%s' keyMask=%u isDown=%.1f timer=%.2f", 
 				deviceType, controlName, keyMask, inputEvent->isDown, timer);
 			allLogCount++;
 		}
@@ -858,7 +864,7 @@ public:
 		// VR Controller handling (deviceType 4 = Kinect/VR)
 		if (deviceType == 4) {
 			// Debug: Log VR button events
-			_MESSAGE("MCM VR Button: control='%s' keyMask=%u isDown=%.1f timer=%.2f", 
+			_DMESSAGE("MCM VR Button: control='%s' keyMask=%u isDown=%.1f timer=%.2f", 
 				controlName, keyMask, inputEvent->isDown, timer);
 
 			// Check if we're in remap mode (binding hotkeys)
@@ -1071,7 +1077,7 @@ public:
 				const char* releaseName = GetControlNameForDirection(lastDirection);
 				if (releaseName)
 				{
-					_MESSAGE("MCM Thumbstick: Release %s (stick=%s)", releaseName, isLeftStick ? "left" : "right");
+					_DMESSAGE("MCM Thumbstick: Release %s (stick=%s)", releaseName, isLeftStick ? "left" : "right");
 					ScaleformMCM::ProcessUserEvent(releaseName, false, InputEvent::kDeviceType_Gamepad);
 				}
 				
@@ -1089,7 +1095,7 @@ public:
 				const char* pressName = GetControlNameForDirection(currentDirection);
 				if (pressName)
 				{
-					_MESSAGE("MCM Thumbstick: Press %s (stick=%s, x=%.2f, y=%.2f)", 
+					_DMESSAGE("MCM Thumbstick: Press %s (stick=%s, x=%.2f, y=%.2f)", 
 					         pressName, isLeftStick ? "left" : "right", inputEvent->x, inputEvent->y);
 					
 					// Left thumbstick only handles left/right for slider control
@@ -1099,7 +1105,7 @@ public:
 					
 					if (isLeftStick && isUpDown) {
 						// Skip up/down on left thumbstick - don't navigate
-						_MESSAGE("MCM Thumbstick: Skipping up/down on left stick");
+						_DMESSAGE("MCM Thumbstick: Skipping up/down on left stick");
 					} else {
 						// Use NavigateList for right stick (all directions) and left stick (left/right only)
 						ScaleformMCM::NavigateList(currentDirection);
@@ -1133,7 +1139,7 @@ public:
 					if (isLeftStick && isUpDown) {
 						// Skip up/down on left thumbstick
 					} else {
-						_MESSAGE("MCM Thumbstick: Repeat %s (elapsed=%lu, rate=%lu)", 
+						_DMESSAGE("MCM Thumbstick: Repeat %s (elapsed=%lu, rate=%lu)", 
 						         GetControlNameForDirection(currentDirection), elapsed, sinceLastRepeat);
 						ScaleformMCM::NavigateList(currentDirection);
 						m_lastRepeatTime = currentTime;
@@ -1197,104 +1203,104 @@ F4SEInputHandler g_scaleformInputHandler;
 
 void ScaleformMCM::ProcessKeyEvent(UInt32 keyCode, bool isDown)
 {
-	_MESSAGE("ProcessKeyEvent ENTER: keyCode=%u isDown=%d", keyCode, isDown);
+	_DMESSAGE("ProcessKeyEvent ENTER: keyCode=%u isDown=%d", keyCode, isDown);
 	
-	_MESSAGE("ProcessKeyEvent: Checking G::ui.GetUIntPtr()");
+	_DMESSAGE("ProcessKeyEvent: Checking G::ui.GetUIntPtr()");
 	uintptr_t uiAddr = G::ui.GetUIntPtr();
-	_MESSAGE("ProcessKeyEvent: G::ui addr = 0x%llX", uiAddr);
+	_DMESSAGE("ProcessKeyEvent: G::ui addr = 0x%llX", uiAddr);
 	if (uiAddr == 0) {
-		_MESSAGE("ProcessKeyEvent: G::ui not resolved, returning");
+		_DMESSAGE("ProcessKeyEvent: G::ui not resolved, returning");
 		return;
 	}
 	
-	_MESSAGE("ProcessKeyEvent: Dereferencing G::ui");
+	_DMESSAGE("ProcessKeyEvent: Dereferencing G::ui");
 	UI* uiPtr = *G::ui;
-	_MESSAGE("ProcessKeyEvent: UI* = 0x%p", uiPtr);
+	_DMESSAGE("ProcessKeyEvent: UI* = 0x%p", uiPtr);
 	if (!uiPtr) {
-		_MESSAGE("ProcessKeyEvent: UI* is null, returning");
+		_DMESSAGE("ProcessKeyEvent: UI* is null, returning");
 		return;
 	}
 	
-	_MESSAGE("ProcessKeyEvent: Creating BSFixedString");
+	_DMESSAGE("ProcessKeyEvent: Creating BSFixedString");
 	BSFixedString mainMenuStr("PauseMenu");
-	_MESSAGE("ProcessKeyEvent: Calling IsMenuOpen");
+	_DMESSAGE("ProcessKeyEvent: Calling IsMenuOpen");
 	bool menuOpen = uiPtr->IsMenuOpen(mainMenuStr);
-	_MESSAGE("ProcessKeyEvent: IsMenuOpen = %d", menuOpen);
+	_DMESSAGE("ProcessKeyEvent: IsMenuOpen = %d", menuOpen);
 	
 	if (menuOpen) {
-		_MESSAGE("ProcessKeyEvent: Calling GetMenu");
+		_DMESSAGE("ProcessKeyEvent: Calling GetMenu");
 		IMenu* menu = uiPtr->GetMenu(mainMenuStr);
-		_MESSAGE("ProcessKeyEvent: menu = 0x%p", menu);
-		if (!menu) { _MESSAGE("ProcessKeyEvent: menu null"); return; }
-		_MESSAGE("ProcessKeyEvent: menu->movie = 0x%p", menu->movie);
-		if (!menu->movie) { _MESSAGE("ProcessKeyEvent: movie null"); return; }
-		_MESSAGE("ProcessKeyEvent: menu->movie->movieRoot = 0x%p", menu->movie->movieRoot);
-		if (!menu->movie->movieRoot) { _MESSAGE("ProcessKeyEvent: movieRoot null"); return; }
+		_DMESSAGE("ProcessKeyEvent: menu = 0x%p", menu);
+		if (!menu) { _DMESSAGE("ProcessKeyEvent: menu null"); return; }
+		_DMESSAGE("ProcessKeyEvent: menu->movie = 0x%p", menu->movie);
+		if (!menu->movie) { _DMESSAGE("ProcessKeyEvent: movie null"); return; }
+		_DMESSAGE("ProcessKeyEvent: menu->movie->movieRoot = 0x%p", menu->movie->movieRoot);
+		if (!menu->movie->movieRoot) { _DMESSAGE("ProcessKeyEvent: movieRoot null"); return; }
 		
 		GFxMovieRoot* movieRoot = menu->movie->movieRoot;
-		_MESSAGE("ProcessKeyEvent: Setting up args");
+		_DMESSAGE("ProcessKeyEvent: Setting up args");
 		GFxValue args[2];
 		args[0].SetInt(keyCode);
 		args[1].SetBool(isDown);
 		
-		_MESSAGE("ProcessKeyEvent: Invoking mcm_loader.content.ProcessKeyEvent");
+		_DMESSAGE("ProcessKeyEvent: Invoking mcm_loader.content.ProcessKeyEvent");
 		movieRoot->Invoke("root.mcm_loader.content.ProcessKeyEvent", nullptr, args, 2);
-		_MESSAGE("ProcessKeyEvent: Invoking Menu_mc.ProcessKeyEvent");
+		_DMESSAGE("ProcessKeyEvent: Invoking Menu_mc.ProcessKeyEvent");
 		movieRoot->Invoke("root.Menu_mc.ProcessKeyEvent", nullptr, args, 2);
-		_MESSAGE("ProcessKeyEvent: Invoking root.ProcessKeyEvent");
+		_DMESSAGE("ProcessKeyEvent: Invoking root.ProcessKeyEvent");
 		movieRoot->Invoke("root.ProcessKeyEvent", nullptr, args, 2);
-		_MESSAGE("ProcessKeyEvent: All invokes complete");
+		_DMESSAGE("ProcessKeyEvent: All invokes complete");
 	}
-	_MESSAGE("ProcessKeyEvent EXIT");
+	_DMESSAGE("ProcessKeyEvent EXIT");
 }
 
 void ScaleformMCM::ProcessUserEvent(const char * controlName, bool isDown, int deviceType)
 {
-	_MESSAGE("ProcessUserEvent ENTER: control=%s isDown=%d device=%d", controlName, isDown, deviceType);
+	_DMESSAGE("ProcessUserEvent ENTER: control=%s isDown=%d device=%d", controlName, isDown, deviceType);
 	
-	_MESSAGE("ProcessUserEvent: Checking G::ui.GetUIntPtr()");
+	_DMESSAGE("ProcessUserEvent: Checking G::ui.GetUIntPtr()");
 	uintptr_t uiAddr = G::ui.GetUIntPtr();
-	_MESSAGE("ProcessUserEvent: G::ui addr = 0x%llX", uiAddr);
+	_DMESSAGE("ProcessUserEvent: G::ui addr = 0x%llX", uiAddr);
 	if (uiAddr == 0) {
-		_MESSAGE("ProcessUserEvent: G::ui not resolved, returning");
+		_DMESSAGE("ProcessUserEvent: G::ui not resolved, returning");
 		return;
 	}
 	
-	_MESSAGE("ProcessUserEvent: Dereferencing G::ui");
+	_DMESSAGE("ProcessUserEvent: Dereferencing G::ui");
 	UI* uiPtr = *G::ui;
-	_MESSAGE("ProcessUserEvent: UI* = 0x%p", uiPtr);
+	_DMESSAGE("ProcessUserEvent: UI* = 0x%p", uiPtr);
 	if (!uiPtr) {
-		_MESSAGE("ProcessUserEvent: UI* is null, returning");
+		_DMESSAGE("ProcessUserEvent: UI* is null, returning");
 		return;
 	}
 	
-	_MESSAGE("ProcessUserEvent: Creating BSFixedString");
+	_DMESSAGE("ProcessUserEvent: Creating BSFixedString");
 	BSFixedString mainMenuStr("PauseMenu");
-	_MESSAGE("ProcessUserEvent: Calling IsMenuOpen");
+	_DMESSAGE("ProcessUserEvent: Calling IsMenuOpen");
 	bool menuOpen = uiPtr->IsMenuOpen(mainMenuStr);
-	_MESSAGE("ProcessUserEvent: IsMenuOpen = %d", menuOpen);
+	_DMESSAGE("ProcessUserEvent: IsMenuOpen = %d", menuOpen);
 	
 	if (menuOpen) {
-		_MESSAGE("ProcessUserEvent: Calling GetMenu");
+		_DMESSAGE("ProcessUserEvent: Calling GetMenu");
 		IMenu* menu = uiPtr->GetMenu(mainMenuStr);
-		_MESSAGE("ProcessUserEvent: menu = 0x%p", menu);
-		if (!menu) { _MESSAGE("ProcessUserEvent: menu null"); return; }
-		_MESSAGE("ProcessUserEvent: menu->movie = 0x%p", menu->movie);
-		if (!menu->movie) { _MESSAGE("ProcessUserEvent: movie null"); return; }
-		_MESSAGE("ProcessUserEvent: menu->movie->movieRoot = 0x%p", menu->movie->movieRoot);
-		if (!menu->movie->movieRoot) { _MESSAGE("ProcessUserEvent: movieRoot null"); return; }
+		_DMESSAGE("ProcessUserEvent: menu = 0x%p", menu);
+		if (!menu) { _DMESSAGE("ProcessUserEvent: menu null"); return; }
+		_DMESSAGE("ProcessUserEvent: menu->movie = 0x%p", menu->movie);
+		if (!menu->movie) { _DMESSAGE("ProcessUserEvent: movie null"); return; }
+		_DMESSAGE("ProcessUserEvent: menu->movie->movieRoot = 0x%p", menu->movie->movieRoot);
+		if (!menu->movie->movieRoot) { _DMESSAGE("ProcessUserEvent: movieRoot null"); return; }
 		
 		GFxMovieRoot* movieRoot = menu->movie->movieRoot;
-		_MESSAGE("ProcessUserEvent: Setting up args");
+		_DMESSAGE("ProcessUserEvent: Setting up args");
 		GFxValue args[3];
 		args[0].SetString(controlName);
 		args[1].SetBool(isDown);
 		args[2].SetInt(deviceType);
-		_MESSAGE("ProcessUserEvent: Invoking mcm_loader.content.ProcessUserEvent");
+		_DMESSAGE("ProcessUserEvent: Invoking mcm_loader.content.ProcessUserEvent");
 		movieRoot->Invoke("root.mcm_loader.content.ProcessUserEvent", nullptr, args, 3);
-		_MESSAGE("ProcessUserEvent: Invoke complete");
+		_DMESSAGE("ProcessUserEvent: Invoke complete");
 	}
-	_MESSAGE("ProcessUserEvent EXIT");
+	_DMESSAGE("ProcessUserEvent EXIT");
 }
 
 bool ScaleformMCM::IsInRemapMode()
@@ -1348,7 +1354,7 @@ void ScaleformMCM::NavigateList(int direction)
 	// Get the MCM menu content
 	GFxValue mcmContent;
 	if (!movieRoot->GetVariable(&mcmContent, "root.mcm_loader.content.mcmMenu")) {
-		_MESSAGE("MCM NavigateList: Failed to get mcmMenu");
+		_DMESSAGE("MCM NavigateList: Failed to get mcmMenu");
 		return;
 	}
 	
@@ -1379,7 +1385,7 @@ void ScaleformMCM::NavigateList(int direction)
 		}
 	}
 	
-	_MESSAGE("MCM NavigateList: dir=%d configIndex=%d, helpIndex=%d", direction, configIndex, helpIndex);
+	_DMESSAGE("MCM NavigateList: dir=%d configIndex=%d, helpIndex=%d", direction, configIndex, helpIndex);
 	
 	// Determine which list is active
 	bool configActive = (hasConfigList && configIndex >= 0);
@@ -1392,10 +1398,10 @@ void ScaleformMCM::NavigateList(int direction)
 			// Path: configList.selectedEntry.clipIndex -> GetClipByIndex -> child OptionItem -> Decrement()
 			GFxValue selectedEntry;
 			if (configList.GetMember("selectedEntry", &selectedEntry) && !selectedEntry.IsNull() && !selectedEntry.IsUndefined()) {
-				_MESSAGE("MCM NavigateList LEFT: Got selectedEntry, type=%d", selectedEntry.GetType());
+				_DMESSAGE("MCM NavigateList LEFT: Got selectedEntry, type=%d", selectedEntry.GetType());
 				GFxValue clipIndex;
 				bool hasClipIndex = selectedEntry.GetMember("clipIndex", &clipIndex);
-				_MESSAGE("MCM NavigateList LEFT: hasClipIndex=%d, clipIndex type=%d", hasClipIndex, clipIndex.GetType());
+				_DMESSAGE("MCM NavigateList LEFT: hasClipIndex=%d, clipIndex type=%d", hasClipIndex, clipIndex.GetType());
 				
 				// clipIndex can be Int, UInt, Number, or String - handle all cases
 				int clipIndexValue = -1;
@@ -1404,32 +1410,32 @@ void ScaleformMCM::NavigateList(int direction)
 					    clipIndex.GetType() == GFxValue::kType_UInt || 
 					    clipIndex.GetType() == GFxValue::kType_Number) {
 						clipIndexValue = (int)clipIndex.GetNumber();
-						_MESSAGE("MCM NavigateList LEFT: clipIndex from number = %d", clipIndexValue);
+						_DMESSAGE("MCM NavigateList LEFT: clipIndex from number = %d", clipIndexValue);
 					} else if (clipIndex.GetType() == GFxValue::kType_String) {
 						const char* str = clipIndex.GetString();
-						_MESSAGE("MCM NavigateList LEFT: clipIndex string = '%s'", str ? str : "NULL");
+						_DMESSAGE("MCM NavigateList LEFT: clipIndex string = '%s'", str ? str : "NULL");
 						if (str) clipIndexValue = atoi(str);
 					} else {
-						_MESSAGE("MCM NavigateList LEFT: clipIndex unknown type %d", clipIndex.GetType());
+						_DMESSAGE("MCM NavigateList LEFT: clipIndex unknown type %d", clipIndex.GetType());
 					}
 				}
-				_MESSAGE("MCM NavigateList LEFT: clipIndexValue = %d", clipIndexValue);
+				_DMESSAGE("MCM NavigateList LEFT: clipIndexValue = %d", clipIndexValue);
 				
 				if (clipIndexValue >= 0) {
 					
-					_MESSAGE("MCM NavigateList LEFT: clipIndex = %d", clipIndexValue);
+					_DMESSAGE("MCM NavigateList LEFT: clipIndex = %d", clipIndexValue);
 					
 					GFxValue args[1], settingsOptionItem;
 					args[0].SetNumber(clipIndexValue);
 					bool gotClip = configList.Invoke("GetClipByIndex", &settingsOptionItem, args, 1);
-					_MESSAGE("MCM NavigateList LEFT: GetClipByIndex returned %d, result type=%d", gotClip, settingsOptionItem.GetType());
+					_DMESSAGE("MCM NavigateList LEFT: GetClipByIndex returned %d, result type=%d", gotClip, settingsOptionItem.GetType());
 					
 					if (!settingsOptionItem.IsNull() && !settingsOptionItem.IsUndefined()) {
 						// SettingsOptionItem has OptionItem as child (added via addChild)
 						GFxValue numChildren;
 						if (settingsOptionItem.GetMember("numChildren", &numChildren)) {
 							int childCount = (int)numChildren.GetNumber();
-							_MESSAGE("MCM NavigateList LEFT: SettingsOptionItem has %d children", childCount);
+							_DMESSAGE("MCM NavigateList LEFT: SettingsOptionItem has %d children", childCount);
 							
 							// Try each child - OptionItem is usually added as a child
 							bool found = false;
@@ -1443,7 +1449,7 @@ void ScaleformMCM::NavigateList(int direction)
 									GFxValue result;
 									bool success = child.Invoke("Decrement", &result, nullptr, 0);
 									if (success) {
-										_MESSAGE("MCM NavigateList LEFT: Called Decrement on child %d - SUCCESS", i);
+										_DMESSAGE("MCM NavigateList LEFT: Called Decrement on child %d - SUCCESS", i);
 										found = true;
 										break;
 									}
@@ -1457,7 +1463,7 @@ void ScaleformMCM::NavigateList(int direction)
 											GFxValue newIdx;
 											newIdx.SetNumber(currentIdx - 1);
 											child.SetMember("index", &newIdx);
-											_MESSAGE("MCM NavigateList LEFT: Decremented stepper index from %d to %d", currentIdx, currentIdx - 1);
+											_DMESSAGE("MCM NavigateList LEFT: Decremented stepper index from %d to %d", currentIdx, currentIdx - 1);
 											found = true;
 											break;
 										}
@@ -1465,20 +1471,20 @@ void ScaleformMCM::NavigateList(int direction)
 								}
 							}
 							if (!found) {
-								_MESSAGE("MCM NavigateList LEFT: No slider/stepper child found");
+								_DMESSAGE("MCM NavigateList LEFT: No slider/stepper child found");
 							}
 						}
 					}
 				}
 			} else {
-				_MESSAGE("MCM NavigateList LEFT: No selectedEntry");
+				_DMESSAGE("MCM NavigateList LEFT: No selectedEntry");
 			}
-			_MESSAGE("MCM NavigateList: LEFT in configList for slider/stepper");
+			_DMESSAGE("MCM NavigateList: LEFT in configList for slider/stepper");
 		} else if (helpActive) {
 			// In HelpList (root menu): LEFT does nothing - use grip/B button to go back/close
 			// Don't call GoBackOneMenu() here as it can corrupt the input event queue
 			// when sending Cancel events while still inside PerformInputProcessing
-			_MESSAGE("MCM NavigateList: LEFT in HelpList - ignored (use grip to close)");
+			_DMESSAGE("MCM NavigateList: LEFT in HelpList - ignored (use grip to close)");
 		}
 		return;
 	}
@@ -1488,10 +1494,10 @@ void ScaleformMCM::NavigateList(int direction)
 			// In configList: adjust sliders/steppers by calling Increment() on the OptionItem
 			GFxValue selectedEntry;
 			if (configList.GetMember("selectedEntry", &selectedEntry) && !selectedEntry.IsNull() && !selectedEntry.IsUndefined()) {
-				_MESSAGE("MCM NavigateList RIGHT: Got selectedEntry, type=%d", selectedEntry.GetType());
+				_DMESSAGE("MCM NavigateList RIGHT: Got selectedEntry, type=%d", selectedEntry.GetType());
 				GFxValue clipIndex;
 				bool hasClipIndex = selectedEntry.GetMember("clipIndex", &clipIndex);
-				_MESSAGE("MCM NavigateList RIGHT: hasClipIndex=%d, clipIndex type=%d", hasClipIndex, clipIndex.GetType());
+				_DMESSAGE("MCM NavigateList RIGHT: hasClipIndex=%d, clipIndex type=%d", hasClipIndex, clipIndex.GetType());
 				
 				// clipIndex can be Int, UInt, Number, or String - handle all cases
 				int clipIndexValue = -1;
@@ -1500,31 +1506,31 @@ void ScaleformMCM::NavigateList(int direction)
 					    clipIndex.GetType() == GFxValue::kType_UInt || 
 					    clipIndex.GetType() == GFxValue::kType_Number) {
 						clipIndexValue = (int)clipIndex.GetNumber();
-						_MESSAGE("MCM NavigateList RIGHT: clipIndex from number = %d", clipIndexValue);
+						_DMESSAGE("MCM NavigateList RIGHT: clipIndex from number = %d", clipIndexValue);
 					} else if (clipIndex.GetType() == GFxValue::kType_String) {
 						const char* str = clipIndex.GetString();
-						_MESSAGE("MCM NavigateList RIGHT: clipIndex string = '%s'", str ? str : "NULL");
+						_DMESSAGE("MCM NavigateList RIGHT: clipIndex string = '%s'", str ? str : "NULL");
 						if (str) clipIndexValue = atoi(str);
 					} else {
-						_MESSAGE("MCM NavigateList RIGHT: clipIndex unknown type %d", clipIndex.GetType());
+						_DMESSAGE("MCM NavigateList RIGHT: clipIndex unknown type %d", clipIndex.GetType());
 					}
 				}
-				_MESSAGE("MCM NavigateList RIGHT: clipIndexValue = %d", clipIndexValue);
+				_DMESSAGE("MCM NavigateList RIGHT: clipIndexValue = %d", clipIndexValue);
 				
 				if (clipIndexValue >= 0) {
 					
-					_MESSAGE("MCM NavigateList RIGHT: clipIndex = %d", clipIndexValue);
+					_DMESSAGE("MCM NavigateList RIGHT: clipIndex = %d", clipIndexValue);
 					
 					GFxValue args[1], settingsOptionItem;
 					args[0].SetNumber(clipIndexValue);
 					bool gotClip = configList.Invoke("GetClipByIndex", &settingsOptionItem, args, 1);
-					_MESSAGE("MCM NavigateList RIGHT: GetClipByIndex returned %d, result type=%d", gotClip, settingsOptionItem.GetType());
+					_DMESSAGE("MCM NavigateList RIGHT: GetClipByIndex returned %d, result type=%d", gotClip, settingsOptionItem.GetType());
 					
 					if (!settingsOptionItem.IsNull() && !settingsOptionItem.IsUndefined()) {
 						GFxValue numChildren;
 						if (settingsOptionItem.GetMember("numChildren", &numChildren)) {
 							int childCount = (int)numChildren.GetNumber();
-							_MESSAGE("MCM NavigateList RIGHT: SettingsOptionItem has %d children", childCount);
+							_DMESSAGE("MCM NavigateList RIGHT: SettingsOptionItem has %d children", childCount);
 							
 							bool found = false;
 							for (int i = childCount - 1; i >= 0 && !found; i--) {
@@ -1537,7 +1543,7 @@ void ScaleformMCM::NavigateList(int direction)
 									GFxValue result;
 									bool success = child.Invoke("Increment", &result, nullptr, 0);
 									if (success) {
-										_MESSAGE("MCM NavigateList RIGHT: Called Increment on child %d - SUCCESS", i);
+										_DMESSAGE("MCM NavigateList RIGHT: Called Increment on child %d - SUCCESS", i);
 										found = true;
 										break;
 									}
@@ -1551,27 +1557,27 @@ void ScaleformMCM::NavigateList(int direction)
 										GFxValue newIdx;
 										newIdx.SetNumber(currentIdx + 1);
 										child.SetMember("index", &newIdx);
-										_MESSAGE("MCM NavigateList RIGHT: Incremented stepper index from %d to %d", currentIdx, currentIdx + 1);
+										_DMESSAGE("MCM NavigateList RIGHT: Incremented stepper index from %d to %d", currentIdx, currentIdx + 1);
 										found = true;
 										break;
 									}
 								}
 							}
 							if (!found) {
-								_MESSAGE("MCM NavigateList RIGHT: No slider/stepper child found");
+								_DMESSAGE("MCM NavigateList RIGHT: No slider/stepper child found");
 							}
 						}
 					}
 				}
 			} else {
-				_MESSAGE("MCM NavigateList RIGHT: No selectedEntry");
+				_DMESSAGE("MCM NavigateList RIGHT: No selectedEntry");
 			}
-			_MESSAGE("MCM NavigateList: RIGHT in configList for slider/stepper");
+			_DMESSAGE("MCM NavigateList: RIGHT in configList for slider/stepper");
 		} else if (helpActive) {
 			// In HelpList: enter submenu (same as trigger/RShoulder)
 			GFxValue result;
 			mcmContent.Invoke("RShoulderPressed", &result, nullptr, 0);
-			_MESSAGE("MCM NavigateList: RIGHT in HelpList = Enter submenu");
+			_DMESSAGE("MCM NavigateList: RIGHT in HelpList = Enter submenu");
 		}
 		return;
 	}
@@ -1596,7 +1602,7 @@ void ScaleformMCM::NavigateList(int direction)
 			GFxValue stage;
 			if (movieRoot->GetVariable(&stage, "root.mcm_loader.content.mcmMenu.stage")) {
 				stage.SetMember("focus", targetList);
-				_MESSAGE("MCM NavigateList: Set stage.focus to HelpList_mc");
+				_DMESSAGE("MCM NavigateList: Set stage.focus to HelpList_mc");
 			}
 		}
 		
@@ -1604,9 +1610,9 @@ void ScaleformMCM::NavigateList(int direction)
 		GFxValue result;
 		targetList->Invoke(method, &result, nullptr, 0);
 		
-		_MESSAGE("MCM NavigateList: Called %s.%s", listName, method);
+		_DMESSAGE("MCM NavigateList: Called %s.%s", listName, method);
 	} else {
-		_MESSAGE("MCM NavigateList: Could not determine which list to navigate");
+		_DMESSAGE("MCM NavigateList: Could not determine which list to navigate");
 	}
 }
 
@@ -1,13 +1,17 @@
 #include "SettingStore.h"
 
 #include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 // reg2k
+// The store's settings are destroyed with it at unload, so the type has to be read before the name goes.
 Setting::~Setting() {
-    delete name;
     if (GetType() == kType_String) {
         delete data.s;
     }
+    delete name;
 }
 
 SettingStore::SettingStore()
@@ -15,7 +19,7 @@ SettingStore::SettingStore()
 	_MESSAGE("ModSettingStore initializing.");
 }
 
-SInt32 SettingStore::GetModSettingInt(std::string modName, std::string settingName)
+SInt32 SettingStore::GetModSettingInt(const char* modName, const char* settingName)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms) {
@@ -24,16 +28,17 @@ SInt32 SettingStore::GetModSettingInt(std::string modName, std::string settingNa
 	return -1;
 }
 
-void SettingStore::SetModSettingInt(std::string modName, std::string settingName, SInt32 newValue)
+void SettingStore::SetModSettingInt(const char* modName, const char* settingName, SInt32 newValue)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms && ms->data.s32 != newValue) {
+		IScopedCriticalSection lock(&m_commitLock);
 		ms->data.s32 = newValue;
 		CommitModSetting(modName, ms);
 	}
 }
 
-bool SettingStore::GetModSettingBool(std::string modName, std::string settingName)
+bool SettingStore::GetModSettingBool(const char* modName, const char* settingName)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms) {
@@ -42,16 +47,17 @@ bool SettingStore::GetModSettingBool(std::string modName, std::string settingNam
 	return false;
 }
 
-void SettingStore::SetModSettingBool(std::string modName, std::string settingName, bool newValue)
+void SettingStore::SetModSettingBool(const char* modName, const char* settingName, bool newValue)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms && ms->data.u8 != (newValue ? 1 : 0)) {
+		IScopedCriticalSection lock(&m_commitLock);
 		ms->data.u8 = newValue;
 		CommitModSetting(modName, ms);
 	}
 }
 
-float SettingStore::GetModSettingFloat(std::string modName, std::string settingName)
+float SettingStore::GetModSettingFloat(const char* modName, const char* settingName)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms) {
@@ -60,16 +66,17 @@ float SettingStore::GetModSettingFloat(std::string modName, std::string settingN
 	return -1;
 }
 
-void SettingStore::SetModSettingFloat(std::string modName, std::string settingName, float newValue)
+void SettingStore::SetModSettingFloat(const char* modName, const char* settingName, float newValue)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms && ms->data.f32 != newValue) {
+		IScopedCriticalSection lock(&m_commitLock);
 		ms->data.f32 = newValue;
 		CommitModSetting(modName, ms);
 	}
 }
 
-char* SettingStore::GetModSettingString(std::string modName, std::string settingName)
+char* SettingStore::GetModSettingString(const char* modName, const char* settingName)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms) {
@@ -78,10 +85,11 @@ char* SettingStore::GetModSettingString(std::string modName, std::string setting
 	return nullptr;
 }
 
-void SettingStore::SetModSettingString(std::string modName, std::string settingName, const char* newValue)
+void SettingStore::SetModSettingString(const char* modName, const char* settingName, const char* newValue)
 {
 	Setting* ms = GetModSetting(modName, settingName);
 	if (ms && strcmp(ms->data.s, newValue) != 0) {
+		IScopedCriticalSection lock(&m_commitLock);
 		if (ms->data.s) delete ms->data.s;
 		ms->data.s = new char[strlen(newValue)+1];
 		strcpy_s(ms->data.s, strlen(newValue) + 1, newValue);
@@ -91,31 +99,56 @@ void SettingStore::SetModSettingString(std::string modName, std::string settingN
 
 // Read ModSettings from filesystem.
 void SettingStore::ReadSettings() {
-	// - Load defaults from MCM\Config\Mod\defaults.ini
+	// - Load defaults from MCM\Config\Mod\settings.ini
 	// - Load user settings from MCM\Settings\Mod.ini
-	// - For each file:
-	// 		- Get all section names with GetPrivateProfileSectionNames
-	//		- Get all key/value pairs in each section with GetPrivateProfileSection
-	// - Store them in m_settingStore
+	// - Map and tokenize every file in one pass, spread across worker threads
+	// - Register the key/value pairs in file order so user settings override defaults
 
 	LARGE_INTEGER countStart, countEnd, frequency;
 	QueryPerformanceCounter(&countStart);
 	QueryPerformanceFrequency(&frequency);
 
-	LoadDefaults();
-	LoadUserSettings();
+	std::vector<IniFile> files;
+	LoadDefaults(files);
+	LoadUserSettings(files);
+	LoadINIFiles(files);
 
 	QueryPerformanceCounter(&countEnd);
 	long long int elapsed = (countEnd.QuadPart - countStart.QuadPart) / (frequency.QuadPart / 1000);
-	_MESSAGE("Registered %d mod settings in %llu ms.", m_settingStore.size(), elapsed);
+	_MESSAGE("Registered %d mod settings in %llu ms.", m_numSettings, elapsed);
 }
 
 //----------------------
 // Private Functions
 //----------------------
 
-void SettingStore::LoadDefaults() {
-	// Find all defaults.ini files.
+struct SettingStore::IniFile
+{
+	struct Entry {
+		const char*	section;
+		const char*	key;
+		const char*	value;
+		UInt32		sectionLength;
+		UInt32		keyLength;
+		UInt32		valueLength;
+	};
+
+	std::string			modName;
+	std::string			path;
+
+	HANDLE				handle	= INVALID_HANDLE_VALUE;
+	HANDLE				mapping	= NULL;
+	const char*			view	= nullptr;
+	UInt32				size	= 0;
+
+	std::vector<Entry>	entries;	// points in to the mapped view
+
+	// set by a worker when the file can't be read, logged once the workers are done
+	const char*			error	= nullptr;
+};
+
+void SettingStore::LoadDefaults(std::vector<IniFile>& files) {
+	// Find all settings.ini files.
 	HANDLE hFind;
 	WIN32_FIND_DATA data;
 
@@ -132,121 +165,277 @@ void SettingStore::LoadDefaults() {
 
 			//_MESSAGE("name %s path %s", data.cFileName, fullPath);
 
-			// Read into settings
-			ReadINI(data.cFileName, fullPath);
+			files.emplace_back();
+			files.back().modName = data.cFileName;
+			files.back().path = fullPath;
 
 		} while (FindNextFile(hFind, &data));
 		FindClose(hFind);
 	}
 }
 
-void SettingStore::LoadUserSettings() {
+void SettingStore::LoadUserSettings(std::vector<IniFile>& files) {
 	char* modSettingsDirectory = "Data\\MCM\\Settings\\*.ini";
 
 	HANDLE hFind;
 	WIN32_FIND_DATA data;
-	std::vector<WIN32_FIND_DATA> modSettingFiles;
+	UInt32 numFiles = 0;
 
 	hFind = FindFirstFile(modSettingsDirectory, &data);
 	if (hFind != INVALID_HANDLE_VALUE) {
 		do {
-			modSettingFiles.push_back(data);
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+
+			// Extract mod name
+			std::string modName(data.cFileName);
+			modName = modName.substr(0, modName.find_last_of('.'));
+
+			files.emplace_back();
+			files.back().modName = modName;
+			files.back().path = std::string("Data\\MCM\\Settings\\") + data.cFileName;
+			numFiles++;
 		} while (FindNextFile(hFind, &data));
 		FindClose(hFind);
 	}
 
-	_MESSAGE("Number of mod setting files: %d", modSettingFiles.size());
+	_MESSAGE("Number of mod setting files: %d", numFiles);
+}
 
-	for (int i = 0; i < modSettingFiles.size(); i++) {
-		std::string iniLocation = "./Data/MCM/Settings/";
-		iniLocation += modSettingFiles[i].cFileName;
+void SettingStore::LoadINIFiles(std::vector<IniFile>& files) {
+	// Parsing only touches the file itself, so spread it over a few threads.
+	// Registration stays on this thread and runs in file order.
+	std::atomic<UInt32> nextFile(0);
+
+	auto worker = [&files, &nextFile]() {
+		UInt32 i;
+		while ((i = nextFile++) < files.size()) {
+			if (MapINI(files[i])) {
+				ParseINI(files[i]);
+			}
+		}
+	};
 
-		// Extract mod name
-		std::string modName(modSettingFiles[i].cFileName);
-		modName = modName.substr(0, modName.find_last_of('.'));
+	UInt32 numWorkers = std::thread::hardware_concurrency();
+	if (numWorkers > 8) numWorkers = 8;
+	if (numWorkers > files.size()) numWorkers = files.size();
 
-		ReadINI(modName, iniLocation);
+	std::vector<std::thread> workers;
+	for (UInt32 i = 1; i < numWorkers; i++) {
+		workers.emplace_back(worker);
 	}
-}
 
-bool SettingStore::ReadINI(std::string modName, std::string iniLocation) {
+	worker();
 
-	//_MESSAGE("Loading mod settings for %s.", modName.c_str());
+	for (auto& thread : workers) {
+		thread.join();
+	}
+
+	for (auto& file : files) {
+		if (file.error) {
+			_WARNING("Warning: Could not %s %s.", file.error, file.path.c_str());
+		}
 
-	// Extract all sections
-	std::vector<std::string> sections;
-	LPTSTR lpszReturnBuffer = new TCHAR[1024];
-	DWORD sizeWritten = GetPrivateProfileSectionNames(lpszReturnBuffer, 1024, iniLocation.c_str());
-	if (sizeWritten == (1024 - 2)) {
-		_WARNING("Warning: Too many sections. Settings will not be read.");
-		delete lpszReturnBuffer;
+		RegisterINI(file);
+		UnmapINI(file);
+	}
+}
+
+bool SettingStore::MapINI(IniFile& file) {
+	file.handle = CreateFile(file.path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file.handle == INVALID_HANDLE_VALUE) {
+		file.error = "open";
 		return false;
 	}
 
-	for (LPTSTR p = lpszReturnBuffer; *p; p++) {
-		std::string sectionName(p);
-		sections.push_back(sectionName);
-		p += strlen(p);
-		ASSERT(*p == 0);
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file.handle, &size) || size.HighPart) {
+		file.error = "read the size of";
+		UnmapINI(file);
+		return false;
 	}
 
-	delete lpszReturnBuffer;
+	// Empty files can't be mapped, but there is nothing to read either.
+	file.size = size.LowPart;
+	if (!file.size) return true;
 
-	//_MESSAGE("Number of sections: %d", sections.size());
+	file.mapping = CreateFileMapping(file.handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (file.mapping) {
+		file.view = (const char*)MapViewOfFile(file.mapping, FILE_MAP_READ, 0, 0, 0);
+	}
 
-	for (int j = 0; j < sections.size(); j++) {
-		// Extract all keys within section
-		int len = 1024;
-		LPTSTR lpReturnedString = new TCHAR[len];
-		DWORD sizeWritten = GetPrivateProfileSection(sections[j].c_str(), lpReturnedString, len, iniLocation.c_str());
-		while (sizeWritten == (len - 2)) {
-			// Buffer too small to contain all entries; expand buffer and try again.
-			delete lpReturnedString;
-			len <<= 1;
-			lpReturnedString = new TCHAR[len];
-			sizeWritten = GetPrivateProfileSection(sections[j].c_str(), lpReturnedString, len, iniLocation.c_str());
-			_MESSAGE("Expanded buffer to %d bytes.", len);
-		}
+	if (!file.view) {
+		file.error = "map";
+		UnmapINI(file);
+		return false;
+	}
 
-		for (LPTSTR p = lpReturnedString; *p; p++) {
-			std::string valuePair(p);
+	return true;
+}
 
-			//_MESSAGE("%s", p);
-			auto delimiter = valuePair.find_first_of('=');
-			std::string settingName = valuePair.substr(0, delimiter) + ":" + sections[j];
-			/*if (sections[j] != "Main" && sections[j] != modName) {
-			settingName += ":" + sections[j];
-			}*/
-			std::string settingValue = valuePair.substr(delimiter + 1);
-			RegisterModSetting(modName, settingName, settingValue);
+void SettingStore::UnmapINI(IniFile& file) {
+	if (file.view) UnmapViewOfFile(file.view);
+	if (file.mapping) CloseHandle(file.mapping);
+	if (file.handle != INVALID_HANDLE_VALUE) CloseHandle(file.handle);
 
-			p += strlen(p);
-			ASSERT(*p == 0);
+	file.view = nullptr;
+	file.mapping = NULL;
+	file.handle = INVALID_HANDLE_VALUE;
+	file.size = 0;
+	file.entries.clear();
+}
+
+static inline bool IsINISpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Tokenizes the whole file in one pass without copying. Follows the same rules as
+// GetPrivateProfileSection: whitespace around keys and values is trimmed, lines starting
+// with ';' are comments, and anything before the first section header is ignored.
+void SettingStore::ParseINI(IniFile& file) {
+	const char* p = file.view;
+	const char* end = file.view + file.size;
+
+	// UTF-8 BOM
+	if (file.size >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3)) p += 3;
+
+	const char* section = nullptr;
+	UInt32 sectionLength = 0;
+
+	while (p < end) {
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (!lineEnd) lineEnd = end;
+
+		const char* lineStart = p;
+		p = lineEnd + 1;
+
+		while (lineStart < lineEnd && IsINISpace(*lineStart)) lineStart++;
+		while (lineEnd > lineStart && IsINISpace(lineEnd[-1])) lineEnd--;
+
+		if (lineStart == lineEnd || *lineStart == ';') continue;
+
+		if (*lineStart == '[') {
+			const char* close = (const char*)memchr(lineStart, ']', lineEnd - lineStart);
+			if (!close) close = lineEnd;
+
+			section = lineStart + 1;
+			while (section < close && IsINISpace(*section)) section++;
+			while (close > section && IsINISpace(close[-1])) close--;
+			sectionLength = close - section;
+			continue;
 		}
 
-		delete lpReturnedString;
+		if (!section) continue;
+
+		const char* delimiter = (const char*)memchr(lineStart, '=', lineEnd - lineStart);
+		if (!delimiter) continue;
+
+		const char* keyEnd = delimiter;
+		while (keyEnd > lineStart && IsINISpace(keyEnd[-1])) keyEnd--;
+		if (keyEnd == lineStart) continue;
+
+		const char* value = delimiter + 1;
+		while (value < lineEnd && IsINISpace(*value)) value++;
+
+		IniFile::Entry entry;
+		entry.section = section;
+		entry.sectionLength = sectionLength;
+		entry.key = lineStart;
+		entry.keyLength = keyEnd - lineStart;
+		entry.value = value;
+		entry.valueLength = lineEnd - value;
+		file.entries.push_back(entry);
 	}
+}
 
-	return true;
+void SettingStore::RegisterINI(const IniFile& file) {
+
+	//_MESSAGE("Loading mod settings for %s.", file.modName.c_str());
+
+	std::string settingName;
+	std::string settingValue;
+
+	for (auto& entry : file.entries) {
+		settingName.assign(entry.key, entry.keyLength);
+		settingName += ':';
+		settingName.append(entry.section, entry.sectionLength);
+		settingValue.assign(entry.value, entry.valueLength);
+
+		RegisterModSetting(file.modName, settingName, settingValue);
+	}
+}
+
+SettingStore::SettingHandle SettingStore::FindModSetting(const char* modName, size_t modLength, const char* settingName, size_t nameLength)
+{
+	UInt64 hash = KeyIndex::Hash(modName, modLength, settingName, nameLength);
+
+	UInt32 found = m_index.Find(hash, [&](UInt32 i) {
+		const SettingEntry& entry = m_entries[i];
+		return entry.hash == hash && entry.modLength == modLength && entry.nameLength == nameLength &&
+			!memcmp(&m_names[entry.modOffset], modName, modLength) &&
+			!memcmp(&m_names[entry.modOffset + modLength], settingName, nameLength);
+	});
+
+	// entries and settings are added together, an entry's number is its setting's handle
+	return found != KeyIndex::kNotFound ? found : kInvalidHandle;
+}
+
+void SettingStore::GrowIndex()
+{
+	m_index.Reset(m_entries.size());
+
+	for (UInt32 i = 0; i < m_entries.size(); i++) {
+		m_index.Insert(m_entries[i].hash, i);
+	}
+}
+
+SettingStore::SettingHandle SettingStore::AddSetting()
+{
+	if (m_numSettings == m_settingBlocks.size() * kSettingsPerBlock) {
+		// value initialized, an unused slot has no name and destroys cleanly
+		m_settingBlocks.emplace_back(new Setting[kSettingsPerBlock]());
+	}
+
+	return m_numSettings++;
+}
+
+SettingStore::SettingHandle SettingStore::GetModSettingHandle(const char* modName, const char* settingName)
+{
+	return FindModSetting(modName, strlen(modName), settingName, strlen(settingName));
 }
 
-Setting * SettingStore::GetModSetting(std::string modName, std::string settingName)
+Setting * SettingStore::GetModSetting(SettingHandle handle)
 {
-	auto itr = m_settingStore.find(modName + ":" + settingName);
-	if (itr != m_settingStore.end()) {
-		return itr->second;
+	if (handle < m_numSettings) {
+		return SettingAt(handle);
 	}
 	return nullptr;
 }
 
-void SettingStore::RegisterModSetting(std::string modName, std::string settingName, std::string settingValue)
+Setting * SettingStore::GetModSetting(const char* modName, const char* settingName)
+{
+	if (!modName || !settingName) return nullptr;
+
+	return GetModSetting(GetModSettingHandle(modName, settingName));
+}
+
+void SettingStore::RegisterModSetting(const std::string& modName, const std::string& settingName, const std::string& settingValue)
 {
-	Setting* ms = new Setting;
+	SettingHandle handle = FindModSetting(modName.data(), modName.size(), settingName.data(), settingName.size());
+	bool isNew = (handle == kInvalidHandle);
 
-	char* nameCopy = new char[settingName.size()+1];
-	std::copy(settingName.begin(), settingName.end(), nameCopy);
-	nameCopy[settingName.size()] = '\0';
-	ms->name = nameCopy;
+	if (isNew) {
+		handle = AddSetting();
+	}
+
+	Setting* ms = SettingAt(handle);
+
+	if (isNew) {
+		char* nameCopy = new char[settingName.size()+1];
+		std::copy(settingName.begin(), settingName.end(), nameCopy);
+		nameCopy[settingName.size()] = '\0';
+		ms->name = nameCopy;
+		ms->data.u32 = 0;
+	}
 	
 	switch (ms->GetType()) {
 		case Setting::kType_Bool:
@@ -262,6 +451,7 @@ void SettingStore::RegisterModSetting(std::string modName, std::string settingNa
 			break;
 
 		case Setting::kType_String: {
+			if (!isNew && ms->data.s) delete ms->data.s;
 			ms->data.s = new char[settingValue.size() + 1];
 			std::copy(settingValue.begin(), settingValue.end(), ms->data.s);
 			ms->data.s[settingValue.size()] = '\0';
@@ -270,47 +460,332 @@ void SettingStore::RegisterModSetting(std::string modName, std::string settingNa
 
 		default:
 			_WARNING("WARNING: ModSetting %s from mod %s has an unknown type and cannot be registered.", settingName.c_str(), modName.c_str());
-			delete ms;
+			if (isNew) {
+				// hand the slot back, the next setting reuses it
+				delete ms->name;
+				ms->name = nullptr;
+				m_numSettings--;
+			}
 			return;
 	}
 
-	m_settingStore[modName + ":" + settingName] = ms;
+	if (isNew) {
+		SettingEntry entry;
+		entry.hash = KeyIndex::Hash(modName.data(), modName.size(), settingName.data(), settingName.size());
+		entry.modOffset = m_names.size();
+		entry.modLength = modName.size();
+		entry.nameLength = settingName.size();
+
+		m_names += modName;
+		m_names += settingName;
+
+		m_entries.push_back(entry);
+
+		if (m_index.NeedsResize(m_entries.size())) {
+			GrowIndex();
+		} else {
+			m_index.Insert(entry.hash, m_entries.size() - 1);
+		}
+	}
 }
 
-void SettingStore::CommitModSetting(std::string modName, Setting* modSetting)
+//----------------------
+// Persistence
+//----------------------
+
+// A batch is written once its settings have been left alone for kFlushDelay,
+// or kFlushMaxDelay after the first change if they keep changing (slider drags).
+static const ULONGLONG kFlushDelay = 500;
+static const ULONGLONG kFlushMaxDelay = 3000;
+
+struct SettingStore::IniUpdate
 {
-	std::string modSettingName(modSetting->name);
-	auto delimiter = modSettingName.find_first_of(':');
-	if (delimiter != std::string::npos) {
-		std::string settingName = modSettingName.substr(0, delimiter);
-		std::string sectionName = modSettingName.substr(delimiter+1);
-		std::string value;
-
-		switch (modSetting->GetType()) {
-		case Setting::kType_Bool:
-			value = std::to_string(modSetting->data.u8 & 1);
-			break;
-		case Setting::kType_Integer:
-			value = std::to_string(modSetting->data.s32);
-			break;
-		case Setting::kType_Float:
-			value = std::to_string(modSetting->data.f32);
-			break;
-		case Setting::kType_String:
-			value = modSetting->data.s;
-			break;
-		default:
-			_WARNING("WARNING: ModSetting %s from mod %s has an unknown type and cannot be saved.", settingName.c_str(), modName.c_str());
-			return;
+	std::string	section;
+	std::string	key;
+	std::string	value;
+	bool		written;
+};
+
+// Caller holds m_commitLock.
+void SettingStore::CommitModSetting(const char* modName, Setting* modSetting)
+{
+	ULONGLONG now = GetTickCount64();
+
+	if (m_dirtyMods.empty()) {
+		m_firstCommit = now;
+	}
+	m_lastCommit = now;
+	m_numCommits++;
+
+	std::vector<Setting*>& settings = m_dirtyMods[modName];
+	if (std::find(settings.begin(), settings.end(), modSetting) == settings.end()) {
+		settings.push_back(modSetting);
+	}
+
+	if (!m_commitEvent) {
+		m_commitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_flushThread = m_commitEvent ? CreateThread(NULL, 0, FlushThreadProc, this, 0, NULL) : NULL;
+		if (!m_flushThread) {
+			_WARNING("Warning: Could not start the settings writer, settings will be saved when the menu closes.");
+		}
+	}
+
+	if (m_flushThread) {
+		SetEvent(m_commitEvent);
+	}
+}
+
+DWORD WINAPI SettingStore::FlushThreadProc(void* param)
+{
+	((SettingStore*)param)->FlushThread();
+	return 0;
+}
+
+void SettingStore::FlushThread()
+{
+	for (;;) {
+		WaitForSingleObject(m_commitEvent, INFINITE);
+
+		// Wait for the settings to settle. An explicit flush may take the batch in the meantime.
+		for (;;) {
+			ULONGLONG due;
+			{
+				IScopedCriticalSection lock(&m_commitLock);
+				if (m_dirtyMods.empty()) break;
+
+				due = (std::min)(m_lastCommit + kFlushDelay, m_firstCommit + kFlushMaxDelay);
+			}
+
+			ULONGLONG now = GetTickCount64();
+			if (now >= due) {
+				FlushModSettings();
+				break;
+			}
+
+			WaitForSingleObject(m_commitEvent, (DWORD)(due - now));
+		}
+	}
+}
+
+void SettingStore::FlushModSettings()
+{
+	// Held across the writes, so a later snapshot of a file can't be overwritten by an earlier one.
+	IScopedCriticalSection flushLock(&m_flushLock);
+
+	std::map<std::string, std::vector<IniUpdate>> pending;
+	UInt32 numCommits;
+
+	{
+		IScopedCriticalSection lock(&m_commitLock);
+		if (m_dirtyMods.empty()) return;
+
+		for (auto& mod : m_dirtyMods) {
+			std::vector<IniUpdate>& updates = pending[mod.first];
+
+			for (Setting* modSetting : mod.second) {
+				const char* delimiter = strchr(modSetting->name, ':');
+				if (!delimiter) {
+					_WARNING("Error: Section could not be resolved.");
+					continue;
+				}
+
+				IniUpdate update;
+				update.key.assign(modSetting->name, delimiter - modSetting->name);
+				update.section = delimiter + 1;
+				update.written = false;
+
+				switch (modSetting->GetType()) {
+				case Setting::kType_Bool:
+					update.value = std::to_string(modSetting->data.u8 & 1);
+					break;
+				case Setting::kType_Integer:
+					update.value = std::to_string(modSetting->data.s32);
+					break;
+				case Setting::kType_Float:
+					update.value = std::to_string(modSetting->data.f32);
+					break;
+				case Setting::kType_String:
+					update.value = modSetting->data.s;
+					break;
+				default:
+					_WARNING("WARNING: ModSetting %s from mod %s has an unknown type and cannot be saved.", update.key.c_str(), mod.first.c_str());
+					continue;
+				}
+
+				updates.push_back(update);
+			}
+		}
+
+		m_dirtyMods.clear();
+		numCommits = m_numCommits;
+	}
+
+	if (GetFileAttributes("Data\\MCM\\Settings") == INVALID_FILE_ATTRIBUTES)
+		CreateDirectory("Data\\MCM\\Settings", NULL);
+
+	for (auto& mod : pending) {
+		if (!mod.second.empty() && WriteModSettings(mod.first, mod.second)) {
+			m_numFilesWritten++;
+		}
+	}
+
+	_MESSAGE("Saved mod settings for %d mods (%d commits coalesced in to %d file writes so far).", (UInt32)pending.size(), numCommits, m_numFilesWritten);
+}
+
+static inline bool IsINISection(const std::string& section, const char* name, UInt32 length) {
+	return section.size() == length && !_strnicmp(section.data(), name, length);
+}
+
+// Rewrites the existing file with the new values in place, the same way WritePrivateProfileString
+// would: matching keys (case insensitive) keep their position, new keys go after the last key of
+// their section, and new sections are appended. Comments and unknown keys are left alone.
+void SettingStore::MergeINI(const char* p, const char* end, std::vector<IniUpdate>& updates, std::string& out)
+{
+	const char* section = nullptr;
+	UInt32 sectionLength = 0;
+	size_t insertPos = std::string::npos;
+
+	auto endSection = [&]() {
+		if (insertPos == std::string::npos) return;
+
+		std::string lines;
+		for (auto& update : updates) {
+			if (!update.written && IsINISection(update.section, section, sectionLength)) {
+				lines += update.key + "=" + update.value + "\r\n";
+				update.written = true;
+			}
+		}
+		out.insert(insertPos, lines);
+	};
+
+	if (end - p >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3)) {
+		out.append(p, 3);
+		p += 3;
+	}
+
+	while (p < end) {
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		const char* next = lineEnd ? lineEnd + 1 : end;
+		if (!lineEnd) lineEnd = end;
+
+		const char* raw = p;
+		const char* lineStart = p;
+		p = next;
+
+		// the last line may not have a newline, new lines could be appended after it
+		const char* newline = lineEnd;
+		if (newline > lineStart && newline[-1] == '\r') newline--;
+		std::string lineBreak(newline, next);
+		if (lineBreak.empty()) lineBreak = "\r\n";
+
+		while (lineStart < lineEnd && IsINISpace(*lineStart)) lineStart++;
+		while (lineEnd > lineStart && IsINISpace(lineEnd[-1])) lineEnd--;
+
+		if (lineStart == lineEnd || *lineStart == ';') {
+			out.append(raw, newline);
+			out += lineBreak;
+			continue;
+		}
+
+		if (*lineStart == '[') {
+			endSection();
+
+			const char* close = (const char*)memchr(lineStart, ']', lineEnd - lineStart);
+			if (!close) close = lineEnd;
+
+			section = lineStart + 1;
+			while (section < close && IsINISpace(*section)) section++;
+			while (close > section && IsINISpace(close[-1])) close--;
+			sectionLength = close - section;
+
+			out.append(raw, newline);
+			out += lineBreak;
+			insertPos = out.size();
+			continue;
+		}
+
+		const char* delimiter = (const char*)memchr(lineStart, '=', lineEnd - lineStart);
+		const char* keyEnd = delimiter ? delimiter : lineStart;
+		while (keyEnd > lineStart && IsINISpace(keyEnd[-1])) keyEnd--;
+
+		IniUpdate* match = nullptr;
+		if (section && keyEnd > lineStart) {
+			for (auto& update : updates) {
+				if (IsINISection(update.section, section, sectionLength) && update.key.size() == keyEnd - lineStart &&
+					!_strnicmp(update.key.data(), lineStart, keyEnd - lineStart)) {
+					match = &update;
+					break;
+				}
+			}
+		}
+
+		if (match) {
+			// duplicates are all updated, the last one wins on load
+			out.append(raw, keyEnd);
+			out += "=" + match->value;
+			match->written = true;
+		} else {
+			out.append(raw, newline);
+		}
+		out += lineBreak;
+
+		if (section) insertPos = out.size();
+	}
+
+	endSection();
+
+	for (size_t i = 0; i < updates.size(); i++) {
+		if (updates[i].written) continue;
+
+		out += "[" + updates[i].section + "]\r\n";
+		for (size_t j = i; j < updates.size(); j++) {
+			if (!updates[j].written && updates[j].section == updates[i].section) {
+				out += updates[j].key + "=" + updates[j].value + "\r\n";
+				updates[j].written = true;
+			}
 		}
+	}
+}
+
+// Writes the whole file once to a temp file, then moves it over the old one.
+bool SettingStore::WriteModSettings(const std::string& modName, std::vector<IniUpdate>& updates)
+{
+	std::string path = "Data\\MCM\\Settings\\" + modName + ".ini";
+	std::string tempPath = path + ".tmp";
+	std::string text;
 
-		std::string iniPath = "./Data/MCM/Settings/" + modName + ".ini";
-		if (GetFileAttributes("Data\\MCM\\Settings") == INVALID_FILE_ATTRIBUTES)
-			CreateDirectory("Data\\MCM\\Settings", NULL);
-		WritePrivateProfileString(sectionName.c_str(), settingName.c_str(), value.c_str(), iniPath.c_str());
+	IniFile file;
+	file.path = path;
+
+	if (GetFileAttributes(path.c_str()) != INVALID_FILE_ATTRIBUTES && MapINI(file)) {
+		MergeINI(file.view, file.view + file.size, updates, text);
+		UnmapINI(file);
 	} else {
-		_WARNING("Error: Section could not be resolved.");
+		if (file.error) {
+			_WARNING("Warning: Could not %s %s.", file.error, path.c_str());
+		}
+
+		MergeINI(nullptr, nullptr, updates, text);
 	}
 
-	
+	HANDLE handle = CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) {
+		_WARNING("Warning: Could not create %s.", tempPath.c_str());
+		return false;
+	}
+
+	DWORD bytesWritten = 0;
+	bool result = WriteFile(handle, text.data(), text.size(), &bytesWritten, NULL) && bytesWritten == text.size();
+	if (result) result = FlushFileBuffers(handle) != 0;
+
+	CloseHandle(handle);
+
+	if (result) result = MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+
+	if (!result) {
+		_WARNING("Warning: Could not write %s.", path.c_str());
+		DeleteFile(tempPath.c_str());
+	}
+
+	return result;
 }
@@ -1,9 +1,15 @@
 #pragma once
 
-#include <unordered_map>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "common/ICriticalSection.h"
 #include "f4se/GameSettings.h"
 
+#include "KeyIndex.h"
+
 //struct ModSetting {
 //	char* settingName;
 //	union {
@@ -18,39 +24,96 @@
 class SettingStore
 {
 public:
+	// resolved once, stays valid for the lifetime of the store
+	typedef UInt32 SettingHandle;
+	enum { kInvalidHandle = 0xFFFFFFFF };
+
 	static SettingStore& GetInstance() {
 		static SettingStore instance;
 		return instance;
 	}
 	void ReadSettings();
 
-	SInt32 GetModSettingInt(std::string modName, std::string settingName);
-	void SetModSettingInt(std::string modName, std::string settingName, SInt32 newValue);
+	SInt32 GetModSettingInt(const char* modName, const char* settingName);
+	void SetModSettingInt(const char* modName, const char* settingName, SInt32 newValue);
 	
-	bool GetModSettingBool(std::string modName, std::string settingName);
-	void SetModSettingBool(std::string modName, std::string settingName, bool newValue);
+	bool GetModSettingBool(const char* modName, const char* settingName);
+	void SetModSettingBool(const char* modName, const char* settingName, bool newValue);
+
+	float GetModSettingFloat(const char* modName, const char* settingName);
+	void SetModSettingFloat(const char* modName, const char* settingName, float newValue);
+
+	char* GetModSettingString(const char* modName, const char* settingName);
+	void SetModSettingString(const char* modName, const char* settingName, const char* newValue);
 
-	float GetModSettingFloat(std::string modName, std::string settingName);
-	void SetModSettingFloat(std::string modName, std::string settingName, float newValue);
+	// Handle API for hot callers: look the setting up once and read it directly afterwards.
+	SettingHandle GetModSettingHandle(const char* modName, const char* settingName);
+	Setting* GetModSetting(SettingHandle handle);
 
-	char* GetModSettingString(std::string modName, std::string settingName);
-	void SetModSettingString(std::string modName, std::string settingName, const char* newValue);
+	// Changed settings are written out by a background thread once they stop changing.
+	// Writes every pending settings file now, on the calling thread.
+	void FlushModSettings();
+
+	UInt32 GetNumCommits() const { return m_numCommits; }
+	UInt32 GetNumFilesWritten() const { return m_numFilesWritten; }
 
 private:
+	struct SettingEntry {
+		UInt64	hash;
+		UInt32	modOffset;		// into m_names, setting name follows the mod name
+		UInt32	modLength;
+		UInt32	nameLength;
+	};
+
+	enum { kSettingsPerBlock = 256 };
+
 	SettingStore();
-	std::unordered_map<std::string, Setting*> m_settingStore;
 
-	bool ReadINI(std::string modName, std::string iniLocation);
-	void LoadDefaults();
-	void LoadUserSettings();
+	std::vector<std::unique_ptr<Setting[]>>	m_settingBlocks;	// settings arena, fixed size blocks so a setting never moves
+	UInt32						m_numSettings = 0;
+	std::vector<SettingEntry>	m_entries;		// parallel to the settings
+	KeyIndex					m_index;		// of m_entries
+	std::string					m_names;
 
-	Setting* GetModSetting(std::string modName, std::string settingName);
-	void RegisterModSetting(std::string modName, std::string settingName, std::string settingValue);
-	void CommitModSetting(std::string modName, Setting* modSetting);
+	// pending writes, per mod
+	std::map<std::string, std::vector<Setting*>>	m_dirtyMods;	// guarded by m_commitLock
+	ICriticalSection			m_commitLock;		// also held while a setter changes a value
+	ICriticalSection			m_flushLock;		// one writer at a time, so files are written in commit order
+	HANDLE						m_commitEvent = NULL;
+	HANDLE						m_flushThread = NULL;
+	ULONGLONG					m_firstCommit = 0;	// of the pending batch
+	ULONGLONG					m_lastCommit = 0;
+	UInt32						m_numCommits = 0;
+	UInt32						m_numFilesWritten = 0;
+
+	struct IniFile;
+	struct IniUpdate;
+
+	void LoadDefaults(std::vector<IniFile>& files);
+	void LoadUserSettings(std::vector<IniFile>& files);
+	void LoadINIFiles(std::vector<IniFile>& files);
+	void RegisterINI(const IniFile& file);
+
+	static bool MapINI(IniFile& file);
+	static void UnmapINI(IniFile& file);
+	static void ParseINI(IniFile& file);
+
+	SettingHandle FindModSetting(const char* modName, size_t modLength, const char* settingName, size_t nameLength);
+	void GrowIndex();
+
+	Setting* SettingAt(SettingHandle handle) { return &m_settingBlocks[handle / kSettingsPerBlock][handle % kSettingsPerBlock]; }
+	SettingHandle AddSetting();
+
+	Setting* GetModSetting(const char* modName, const char* settingName);
+	void RegisterModSetting(const std::string& modName, const std::string& settingName, const std::string& settingValue);
+	void CommitModSetting(const char* modName, Setting* modSetting);
+	static DWORD WINAPI FlushThreadProc(void* param);
+	void FlushThread();
+	bool WriteModSettings(const std::string& modName, std::vector<IniUpdate>& updates);
+	static void MergeINI(const char* p, const char* end, std::vector<IniUpdate>& updates, std::string& out);
 
 public:
 	// Get rid of unwanted constructors
 	SettingStore(SettingStore const&)	= delete;
 	void operator=(SettingStore const&) = delete;
 };
-
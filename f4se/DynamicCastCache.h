@@ -0,0 +1,112 @@
+#pragma once
+
+#include "common/ITypes.h"
+
+#include <atomic>
+
+// Memoized results of a runtime dynamic cast, keyed on the object's vtable and the two types. An object's vtable pointer
+// identifies both its most derived class and which of its subobjects the pointer addresses, so the result of a cast is
+// always the same adjustment to the pointer, or always a failure. Each distinct cast goes through the real one once.
+//
+// Lock free: a slot is claimed with a CAS and published with a release store, and is never reused after that. Casts
+// that find their probe window full or still being written fall back to the real cast, they are only slower.
+class DynamicCastCache
+{
+public:
+	typedef void * (* CastFn)(void * obj, const void * fromType, const void * toType);
+
+	enum
+	{
+		kNumSlots	= 2048,	// power of two, distinct casts in a session are in the hundreds
+		kMaxProbes	= 16
+	};
+
+	DynamicCastCache()
+	{
+		for(UInt32 i = 0; i < kNumSlots; i++)
+			m_slots[i].state.store(kState_Empty, std::memory_order_relaxed);
+	}
+
+	void * Cast(void * obj, const void * fromType, const void * toType, CastFn cast)
+	{
+		if(!obj)
+			return NULL;
+
+		const void	* vtbl = *(const void **)obj;
+		UInt32		start = Hash(vtbl, fromType, toType);
+
+		for(UInt32 i = 0; i < kMaxProbes; i++)
+		{
+			Slot	& slot = m_slots[(start + i) & (kNumSlots - 1)];
+			UInt32	state = slot.state.load(std::memory_order_acquire);
+
+			if(state == kState_Empty)
+				return Insert(slot, obj, vtbl, fromType, toType, cast);
+
+			if(state == kState_Ready && slot.vtbl == vtbl && slot.fromType == fromType && slot.toType == toType)
+				return slot.adjustment == kFailed ? NULL : (char *)obj + slot.adjustment;
+		}
+
+		return cast(obj, fromType, toType);
+	}
+
+	UInt32 NumEntries(void) const
+	{
+		UInt32	count = 0;
+
+		for(UInt32 i = 0; i < kNumSlots; i++)
+			if(m_slots[i].state.load(std::memory_order_acquire) == kState_Ready)
+				count++;
+
+		return count;
+	}
+
+private:
+	enum
+	{
+		kState_Empty = 0,
+		kState_Writing,
+		kState_Ready
+	};
+
+	static const SInt64	kFailed = INT64_MIN;
+
+	struct Slot
+	{
+		std::atomic <UInt32>	state;
+		const void				* vtbl;
+		const void				* fromType;
+		const void				* toType;
+		SInt64					adjustment;	// kFailed if the cast returns NULL
+	};
+
+	static UInt32 Hash(const void * vtbl, const void * fromType, const void * toType)
+	{
+		UInt64	h = (UInt64)vtbl * 0x9E3779B97F4A7C15ull;
+		h ^= (UInt64)fromType * 0xC2B2AE3D27D4EB4Full;
+		h ^= (UInt64)toType * 0x165667B19E3779F9ull;
+
+		return (UInt32)(h >> 40);
+	}
+
+	void * Insert(Slot & slot, void * obj, const void * vtbl, const void * fromType, const void * toType, CastFn cast)
+	{
+		void	* result = cast(obj, fromType, toType);
+
+		// whoever loses the race to claim the slot just returns its own result
+		UInt32	expected = kState_Empty;
+		if(slot.state.compare_exchange_strong(expected, kState_Writing, std::memory_order_acquire))
+		{
+			slot.vtbl = vtbl;
+			slot.fromType = fromType;
+			slot.toType = toType;
+			slot.adjustment = result ? (char *)result - (char *)obj : kFailed;
+
+			slot.state.store(kState_Ready, std::memory_order_release);
+		}
+
+		return result;
+	}
+
+	Slot	m_slots[kNumSlots];
+};
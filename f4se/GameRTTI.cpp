@@ -1,4 +1,5 @@
 #include "GameRTTI.h"
+#include "DynamicCastCache.h"
 #include "f4se_common/Relocation.h"
 
 typedef void * (* _Runtime_DynamicCast_Internal)(void * srcObj, UInt32 arg1, const void * fromType, const void * toType, UInt32 arg4);
@@ -6,7 +7,7 @@ typedef void * (* _Runtime_DynamicCast_Internal)(void * srcObj, UInt32 arg1, con
 // 11BCFFABF53E33EAC4BAE470FD237D36B63F868A+ED
 RelocAddr <_Runtime_DynamicCast_Internal> Runtime_DynamicCast_Internal(0x02991602);	// __RTDynamicCast
 
-void * Runtime_DynamicCast(void * srcObj, const void * fromType, const void * toType)
+static void * Runtime_DynamicCast_Uncached(void * srcObj, const void * fromType, const void * toType)
 {
 	uintptr_t fromTypeAddr = uintptr_t(fromType) + RelocationManager::s_baseAddr;
 	uintptr_t toTypeAddr = uintptr_t(toType) + RelocationManager::s_baseAddr;
@@ -14,4 +15,12 @@ void * Runtime_DynamicCast(void * srcObj, const void * fromType, const void * to
 	return Runtime_DynamicCast_Internal(srcObj, 0, (void *)fromTypeAddr, (void *)toTypeAddr, 0);
 }
 
+// __RTDynamicCast walks the class hierarchy descriptors on every call, the cache makes repeats a hash probe
+static DynamicCastCache	s_castCache;
+
+void * Runtime_DynamicCast(void * srcObj, const void * fromType, const void * toType)
+{
+	return s_castCache.Cast(srcObj, fromType, toType, Runtime_DynamicCast_Uncached);
+}
+
 #include "GameRTTI.inl"
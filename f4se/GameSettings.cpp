@@ -1,6 +1,9 @@
 #include "f4se/GameSettings.h"
 #include "f4se/GameTypes.h"
 
+#include <unordered_map>
+#include <vector>
+
 // 5B1FD95B3A1729A1781BED06D47E1A47EB6D89F2+91
 RelocPtr <INISettingCollection *> g_iniSettings(0x05F33A30);
 // 239A2F4B85F2D36A7E4E77D681108A197210AE0B+1C3
@@ -100,7 +103,12 @@ bool Setting::SetString(const char * value)
 
 Setting * GetINISetting(const char * name)
 {
-	Setting	* setting = (*g_iniSettings)->Get(name);
+	// most names are in one of the indexes, the lists are only walked when neither has it
+	Setting	* setting = (*g_iniSettings)->GetIndexed(name);
+	if(!setting)
+		setting = (*g_iniPrefSettings)->GetIndexed(name);
+	if(!setting)
+		setting = (*g_iniSettings)->Get(name);
 	if(!setting)
 		setting = (*g_iniPrefSettings)->Get(name);
 
@@ -116,22 +124,195 @@ Setting * GetGameSetting(const char * name)
 	return setting;
 }
 
-Setting * SettingCollectionList::Get(const char * name)
+namespace
 {
-	Node * node = data;
-	do
+	// name -> setting for one SettingCollectionList, the game's list itself can't be given members
+	// only a hint, a hit is checked against its node before it's returned and a miss is checked against the list
+	class SettingIndex
 	{
-		Setting * setting = node->data;
-		if(setting) {
-			BSAutoFixedString searchName(name);
-			BSAutoFixedString settingName(setting->name);
-			if(searchName == settingName) {
-				return setting;
+	public:
+		SettingIndex() : m_head(nullptr), m_tail(nullptr) { }
+
+		// the game adds settings at the ends of the list, which moves the head or gives the tail a next node
+		bool IsCurrent(const SettingCollectionList::Node * head) const
+		{
+			return m_tail && head == m_head && !m_tail->next;
+		}
+
+		void Build(const SettingCollectionList::Node * head)
+		{
+			UInt32	numSettings = 0;
+			for(const SettingCollectionList::Node * node = head; node; node = node->next)
+				numSettings++;
+
+			// load factor at or below 1/2
+			UInt32	size = 16;
+			while(size < numSettings * 2)
+				size *= 2;
+
+			m_slots.assign(size, Slot());
+			m_head = head;
+			m_tail = nullptr;
+
+			for(const SettingCollectionList::Node * node = head; node; node = node->next)
+			{
+				m_tail = node;
+
+				Setting	* setting = node->data;
+				if(!setting || !setting->name)
+					continue;
+
+				UInt32	hash = Hash(setting->name);
+				UInt32	slot = hash & (size - 1);
+
+				// the first of two settings with one name is the one the list walk finds
+				bool	duplicate = false;
+				while(m_slots[slot].setting)
+				{
+					if(m_slots[slot].hash == hash && !_stricmp(m_slots[slot].setting->name, setting->name))
+					{
+						duplicate = true;
+						break;
+					}
+
+					slot = (slot + 1) & (size - 1);
+				}
+
+				if(!duplicate)
+				{
+					m_slots[slot].hash = hash;
+					m_slots[slot].node = node;
+					m_slots[slot].setting = setting;
+				}
 			}
 		}
 
-		node = node->next;
-	} while(node);
+		Setting * Find(const char * name) const
+		{
+			if(m_slots.empty())
+				return nullptr;
+
+			UInt32	hash = Hash(name);
+			UInt32	mask = m_slots.size() - 1;
+
+			// a node given a different setting since the build is passed over, the list walk finds what replaced it
+			// SetString can give a setting a new name buffer, so names are read from the settings each time
+			for(UInt32 slot = hash & mask; m_slots[slot].setting; slot = (slot + 1) & mask)
+			{
+				const Slot	& entry = m_slots[slot];
+				if(entry.hash == hash && entry.node->data == entry.setting && !_stricmp(entry.setting->name, name))
+					return entry.setting;
+			}
+
+			return nullptr;
+		}
+
+		// what Get did before there was an index
+		static Setting * Walk(const SettingCollectionList::Node * head, const char * name)
+		{
+			for(const SettingCollectionList::Node * node = head; node; node = node->next)
+			{
+				Setting	* setting = node->data;
+				if(setting && setting->name && !_stricmp(setting->name, name))
+					return setting;
+			}
 
-	return nullptr;
+			return nullptr;
+		}
+
+	private:
+		struct Slot
+		{
+			Slot() : hash(0), node(nullptr), setting(nullptr) { }
+
+			UInt32								hash;
+			const SettingCollectionList::Node	* node;
+			Setting								* setting;	// node->data when the index was built
+		};
+
+		// FNV-1a over the lowercased name
+		static UInt32 Hash(const char * name)
+		{
+			UInt32	hash = 2166136261u;
+
+			for(; *name; name++)
+			{
+				hash ^= (UInt8)tolower((UInt8)*name);
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+
+		std::vector <Slot>						m_slots;	// open addressing, linear probing, power of two size
+		const SettingCollectionList::Node		* m_head;
+		const SettingCollectionList::Node		* m_tail;
+	};
+
+	// lookups share it, building an index takes it alone
+	SRWLOCK	s_settingIndexLock = SRWLOCK_INIT;
+	std::unordered_map <const SettingCollectionList *, SettingIndex>	s_settingIndexes;
+}
+
+Setting * SettingCollectionList::GetIndexed(const char * name)
+{
+	if(!name)
+		return nullptr;
+
+	Setting	* setting = nullptr;
+	bool	current = false;
+
+	AcquireSRWLockShared(&s_settingIndexLock);
+
+	auto	iter = s_settingIndexes.find(this);
+	if(iter != s_settingIndexes.end() && iter->second.IsCurrent(data))
+	{
+		setting = iter->second.Find(name);
+		current = true;
+	}
+
+	ReleaseSRWLockShared(&s_settingIndexLock);
+
+	if(setting || current)
+		return setting;
+
+	AcquireSRWLockExclusive(&s_settingIndexLock);
+
+	SettingIndex	& index = s_settingIndexes[this];
+	if(!index.IsCurrent(data))
+		index.Build(data);
+
+	setting = index.Find(name);
+
+	ReleaseSRWLockExclusive(&s_settingIndexLock);
+
+	return setting;
+}
+
+Setting * SettingCollectionList::Get(const char * name)
+{
+	if(!name)
+		return nullptr;
+
+	Setting	* setting = GetIndexed(name);
+	if(setting)
+		return setting;
+
+	// the index may be missing a setting added somewhere it can't see, if the walk finds one the index is rebuilt
+	setting = SettingIndex::Walk(data, name);
+	if(setting)
+	{
+		AcquireSRWLockExclusive(&s_settingIndexLock);
+		s_settingIndexes[this].Build(data);
+		ReleaseSRWLockExclusive(&s_settingIndexLock);
+	}
+
+	return setting;
+}
+
+void SettingCollectionList::InvalidateIndex(void)
+{
+	AcquireSRWLockExclusive(&s_settingIndexLock);
+	s_settingIndexes.erase(this);
+	ReleaseSRWLockExclusive(&s_settingIndexLock);
 }
@@ -108,7 +108,15 @@ public:
 	void	* unk118;	// 118
 	Node	* data;		// 120
 
+	// case insensitive, through a name index built on first use
+	// the index is rebuilt when nodes are added at either end, or when a miss finds the name by walking the list
 	Setting * Get(const char * name);
+
+	// Get without the walk, a miss may be a setting the index hasn't seen yet
+	Setting * GetIndexed(const char * name);
+
+	// the index keeps pointers to the list's nodes, call before a node is unlinked and freed
+	void InvalidateIndex(void);
 };
 
 // 128
@@ -4,12 +4,15 @@
 #include "f4se_common/BranchTrampoline.h"
 #include "f4se_common/Relocation.h"
 
-#include "f4se/PapyrusEvents.h"
+#include "f4se/PapyrusEventDispatch.h"
 #include "f4se/GameCamera.h"
+#include "f4se/Hooks_Threads.h"
+
+static PapyrusEventDispatcher<NullParameters, SInt32, SInt32> s_cameraStateEvent(&g_cameraEventRegs, "OnPlayerCameraState");
 
 void Hooks_Camera_Init()
 {
-
+	s_cameraStateEvent.InitCoalescing(TaskInterface::AddTaskFunction);
 }
 
 typedef void (* _SetCameraState)(TESCamera * camera, TESCameraState * newState);
@@ -23,12 +26,7 @@ void SetCameraState_Hook(TESCamera * camera, TESCameraState * newCameraState)
 		SInt32 oldState = (*g_playerCamera)->GetCameraStateId(camera->cameraState);
 		SInt32 newState = (*g_playerCamera)->GetCameraStateId(newCameraState);
 
-		g_cameraEventRegs.ForEach(
-			[&oldState, &newState](const EventRegistration<NullParameters> & reg)
-		{
-			SendPapyrusEvent2<SInt32, SInt32>(reg.handle, reg.scriptName, "OnPlayerCameraState", oldState, newState);
-		}
-		);
+		s_cameraStateEvent.Send(oldState, newState);
 	}
 
 	SetCameraState_Original(camera, newCameraState);
@@ -4,6 +4,7 @@
 
 #include "f4se/PapyrusVM.h"
 #include "f4se/PapyrusEvents.h"
+#include "f4se/Hooks_Threads.h"
 
 #include "f4se/PapyrusF4SE.h"
 #include "f4se/PapyrusForm.h"
@@ -170,6 +171,7 @@ void RegisterPapyrusFunctions_Hook(VirtualMachine ** vmPtr)
 	// Armor
 	papyrusArmor::RegisterFuncs(vm);
 
+	F4SEFurnitureEventSink::InitCoalescing(TaskInterface::AddTaskFunction);
 	GetEventDispatcher<TESFurnitureEvent>()->AddEventSink(&g_furnitureEventSink);
 
 	// Plugins
@@ -35,6 +35,7 @@ void SaveGame_Hook(BGSSaveLoadGame * saveLoadMgr, const char * saveName, UInt8 u
 	Serialization::SetSaveName(saveName);
 	PluginManager::Dispatch_Message(0, F4SEMessagingInterface::kMessage_PreSaveGame, (void*)saveName, strlen(saveName), NULL);
 	SaveGame_Original(saveLoadMgr, saveName, unk1);
+	Serialization::HandlePostSaveGame();
 	PluginManager::Dispatch_Message(0, F4SEMessagingInterface::kMessage_PostSaveGame, (void*)saveName, strlen(saveName), NULL);
 	Serialization::SetSaveName(NULL);
 }
@@ -1,17 +1,13 @@
 #include "f4se/Hooks_Threads.h"
-#include "common/ICriticalSection.h"
 #include "f4se/GameThreads.h"
+#include "f4se/TaskQueue.h"
 #include "f4se_common/Relocation.h"
 #include "f4se_common/BranchTrampoline.h"
+#include "f4se_common/Utilities.h"
 #include "xbyak/xbyak.h"
 
-#include <queue>
-
-ICriticalSection		s_taskQueueLock;
-std::queue<ITaskDelegate*>	s_tasks;
-
-ICriticalSection		s_uiQueueLock;
-std::queue<ITaskDelegate*>	s_uiQueue;
+TaskQueue	s_tasks;
+TaskQueue	s_uiQueue;
 
 typedef bool (* _MessageQueueProcessTask)(void * messageQueue, float timeout, UInt32 unk1);
 RelocAddr <_MessageQueueProcessTask> MessageQueueProcessTask(0x00DA87C0);
@@ -25,51 +21,62 @@ bool MessageQueueProcessTask_Hook(void * messageQueue, float timeout, UInt32 unk
 {
 	bool result = MessageQueueProcessTask_Original(messageQueue, timeout, unk1);
 
-	s_taskQueueLock.Enter();
-	while (!s_tasks.empty())
-	{
-		ITaskDelegate * cmd = s_tasks.front();
-		s_tasks.pop();
-		cmd->Run();
-		delete cmd;
-	}
-	s_taskQueueLock.Leave();
+	s_tasks.Run();
 
 	return result;
 }
 
 void TaskInterface::AddTask(ITaskDelegate * task)
 {
-	s_taskQueueLock.Enter();
-	s_tasks.push(task);
-	s_taskQueueLock.Leave();
+	s_tasks.Push(task);
 }
 
 void ProcessEventQueue_Hook(void * unk1)
 {
-	s_uiQueueLock.Enter();
-	while (!s_uiQueue.empty())
-	{
-		ITaskDelegate * cmd = s_uiQueue.front();
-		s_uiQueue.pop();
-		cmd->Run();
-		delete cmd;
-	}
-	s_uiQueueLock.Leave();
+	s_uiQueue.Run();
 
 	ProcessEventQueue_Internal(unk1);
 }
 
 void TaskInterface::AddUITask(ITaskDelegate * task)
 {
-	s_uiQueueLock.Enter();
-	s_uiQueue.push(task);
-	s_uiQueueLock.Leave();
+	s_uiQueue.Push(task);
+}
+
+void TaskInterface::AddTaskFunction(TaskFunction * task)
+{
+	if(task)
+		s_tasks.Push(std::move(*task));
+}
+
+void TaskInterface::AddUITaskFunction(TaskFunction * task)
+{
+	if(task)
+		s_uiQueue.Push(std::move(*task));
+}
+
+void TaskInterface::GetStats(TaskQueue::Stats * tasks, TaskQueue::Stats * uiTasks)
+{
+	if(tasks)
+		s_tasks.GetStats(tasks);
+	if(uiTasks)
+		s_uiQueue.GetStats(uiTasks);
 }
 
 void Hooks_Threads_Init(void)
 {
-	
+	// no budget unless the ini sets one, every queued task runs on the next pump as it always has
+	// with a budget, tasks left over run on the pump after
+	UInt32	maxTasks = 0;
+	UInt32	maxMicroseconds = 0;
+
+	GetConfigOption_UInt32("Threads", "uMaxTasksPerFrame", &maxTasks);
+	GetConfigOption_UInt32("Threads", "uTaskBudgetMicroseconds", &maxMicroseconds);
+
+	s_tasks.SetBudget(maxTasks, maxMicroseconds);
+	s_uiQueue.SetBudget(maxTasks, maxMicroseconds);
+
+	_MESSAGE("task budget: %d tasks, %d us per frame (0 = unlimited)", maxTasks, maxMicroseconds);
 }
 
 void Hooks_Threads_Commit(void)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "f4se/TaskQueue.h"
+
 class ITaskDelegate;
 
 void Hooks_Threads_Init(void);
@@ -9,4 +11,9 @@ namespace TaskInterface
 {
 	void AddTask(ITaskDelegate * task);
 	void AddUITask(ITaskDelegate * task);
+	void AddTaskFunction(TaskFunction * task);
+	void AddUITaskFunction(TaskFunction * task);
+
+	// queue depth and latency counters, either pointer may be null
+	void GetStats(TaskQueue::Stats * tasks, TaskQueue::Stats * uiTasks);
 }
@@ -195,31 +195,31 @@ void Core_LoadCallback(const F4SESerializationInterface * intfc)
 			// Key input events
 		case 'KEYR':
 			_MESSAGE("Loading key input event registrations...");
-			g_inputKeyEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+			g_inputKeyEventRegs.Load(intfc, version);
 			break;
 
 			// Control input events
 		case 'CTLR':
 			_MESSAGE("Loading control input event registrations...");
-			g_inputControlEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+			g_inputControlEventRegs.Load(intfc, version);
 			break;
 
 			// External events
 		case 'EXEV':
 			_MESSAGE("Loading external event registrations...");
-			g_externalEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+			g_externalEventRegs.Load(intfc, version);
 			break;
 
 			// Camera events
 		case 'CAMR':
 			_MESSAGE("Loading camera event registrations...");
-			g_cameraEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+			g_cameraEventRegs.Load(intfc, version);
 			break;
 
 			// Furniture events
 		case 'FRNR':
 			_MESSAGE("Loading furniture event registrations...");
-			g_furnitureEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+			g_furnitureEventRegs.Load(intfc, version);
 			break;
 
 			// SKSEPersistentObjectStorage
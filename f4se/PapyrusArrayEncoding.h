@@ -0,0 +1,217 @@
+#pragma once
+
+#include "common/ITypes.h"
+
+#include <string.h>
+#include <vector>
+
+// Packed payloads for Papyrus arrays of primitives, written by WriteVMData as one block instead of one record write
+// per element. Each encoder appends count elements to out, each decoder reads count elements starting at *offset and
+// fails rather than read past srcLength.
+//
+//	int			zigzag varint of each value's difference from the previous one
+//	identifier	the same over 64 bit handles
+//	float		the raw floats
+//	bool		one bit per element, low bit first
+//
+// get(i) returns element i, set(i, value) stores it, so the elements can stay where the VM keeps them.
+
+namespace PapyrusArrayEncoding
+{
+	enum
+	{
+		kMaxVarIntLength =	10,
+	};
+
+	inline void EncodeVarInt(UInt64 value, std::vector <UInt8> & out)
+	{
+		while(value >= 0x80)
+		{
+			out.push_back((UInt8)(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back((UInt8)value);
+	}
+
+	inline bool DecodeVarInt(const UInt8 * src, UInt32 srcLength, UInt32 * offset, UInt64 * valueOut)
+	{
+		// most values are a byte or two, away from the end the bounds check can wait
+		if(srcLength - *offset >= kMaxVarIntLength)
+		{
+			const UInt8	* p = src + *offset;
+			UInt64		value = *p & 0x7F;
+
+			if(*p < 0x80)
+			{
+				*offset += 1;
+				*valueOut = value;
+				return true;
+			}
+
+			for(UInt32 i = 1; i < kMaxVarIntLength; i++)
+			{
+				value |= (UInt64)(p[i] & 0x7F) << (i * 7);
+
+				if(p[i] < 0x80)
+				{
+					*offset += i + 1;
+					*valueOut = value;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		UInt64	value = 0;
+
+		for(UInt32 shift = 0; shift < kMaxVarIntLength * 7; shift += 7)
+		{
+			if(*offset >= srcLength)
+				return false;
+
+			UInt8	byte = src[(*offset)++];
+
+			value |= (UInt64)(byte & 0x7F) << shift;
+
+			if(!(byte & 0x80))
+			{
+				*valueOut = value;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// differences wrap, so any sequence round trips whatever the jumps between values
+	template <typename T, typename Get>
+	void EncodeDeltas(UInt32 count, Get get, std::vector <UInt8> & out)
+	{
+		const UInt32	kSignShift = sizeof(T) * 8 - 1;
+
+		T	prev = 0;
+
+		for(UInt32 i = 0; i < count; i++)
+		{
+			T	value = get(i);
+			T	delta = value - prev;
+
+			EncodeVarInt((T)(delta << 1) ^ (T)(0 - (delta >> kSignShift)), out);
+
+			prev = value;
+		}
+	}
+
+	template <typename T, typename Set>
+	bool DecodeDeltas(const UInt8 * src, UInt32 srcLength, UInt32 * offset, UInt32 count, Set set)
+	{
+		T	prev = 0;
+
+		for(UInt32 i = 0; i < count; i++)
+		{
+			UInt64	zigzag;
+
+			if(!DecodeVarInt(src, srcLength, offset, &zigzag) || (zigzag != (T)zigzag))
+				return false;
+
+			T	delta = ((T)zigzag >> 1) ^ (T)(0 - ((T)zigzag & 1));
+
+			prev += delta;
+			set(i, prev);
+		}
+
+		return true;
+	}
+
+	template <typename Get>
+	void EncodeInts(UInt32 count, Get get, std::vector <UInt8> & out)
+	{
+		EncodeDeltas<UInt32>(count, [&get](UInt32 i) { return (UInt32)get(i); }, out);
+	}
+
+	template <typename Set>
+	bool DecodeInts(const UInt8 * src, UInt32 srcLength, UInt32 * offset, UInt32 count, Set set)
+	{
+		return DecodeDeltas<UInt32>(src, srcLength, offset, count, [&set](UInt32 i, UInt32 value) { set(i, (SInt32)value); });
+	}
+
+	template <typename Get>
+	void EncodeHandles(UInt32 count, Get get, std::vector <UInt8> & out)
+	{
+		EncodeDeltas<UInt64>(count, get, out);
+	}
+
+	template <typename Set>
+	bool DecodeHandles(const UInt8 * src, UInt32 srcLength, UInt32 * offset, UInt32 count, Set set)
+	{
+		return DecodeDeltas<UInt64>(src, srcLength, offset, count, set);
+	}
+
+	template <typename Get>
+	void EncodeFloats(UInt32 count, Get get, std::vector <UInt8> & out)
+	{
+		UInt64	base = out.size();
+
+		out.resize(base + (UInt64)count * sizeof(float));
+
+		UInt8	* dst = out.data() + base;
+
+		for(UInt32 i = 0; i < count; i++)
+		{
+			float	value = get(i);
+			memcpy(dst + i * sizeof(float), &value, sizeof(float));
+		}
+	}
+
+	template <typename Set>
+	bool DecodeFloats(const UInt8 * src, UInt32 srcLength, UInt32 * offset, UInt32 count, Set set)
+	{
+		if((UInt64)count * sizeof(float) > srcLength - *offset)
+			return false;
+
+		const UInt8	* data = src + *offset;
+
+		for(UInt32 i = 0; i < count; i++)
+		{
+			float	value;
+			memcpy(&value, data + i * sizeof(float), sizeof(float));
+			set(i, value);
+		}
+
+		*offset += count * sizeof(float);
+
+		return true;
+	}
+
+	template <typename Get>
+	void EncodeBools(UInt32 count, Get get, std::vector <UInt8> & out)
+	{
+		UInt64	base = out.size();
+
+		out.resize(base + count / 8 + ((count & 7) != 0), 0);
+
+		for(UInt32 i = 0; i < count; i++)
+			if(get(i))
+				out[base + i / 8] |= 1 << (i & 7);
+	}
+
+	template <typename Set>
+	bool DecodeBools(const UInt8 * src, UInt32 srcLength, UInt32 * offset, UInt32 count, Set set)
+	{
+		UInt32	length = count / 8 + ((count & 7) != 0);
+
+		if(length > srcLength - *offset)
+			return false;
+
+		const UInt8	* data = src + *offset;
+
+		for(UInt32 i = 0; i < count; i++)
+			set(i, ((data[i / 8] >> (i & 7)) & 1) != 0);
+
+		*offset += length;
+
+		return true;
+	}
+}
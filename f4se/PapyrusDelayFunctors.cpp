@@ -1,8 +1,6 @@
 #include "f4se/PapyrusDelayFunctors.h"
 #include "f4se/PapyrusObjects.h"
 
-#include <algorithm>
-
 #include "f4se/GameAPI.h"
 #include "f4se/PapyrusVM.h"
 #include "f4se/Serialization.h"
@@ -152,14 +150,19 @@ bool F4SEDelayFunctorQueue::Load(const F4SESerializationInterface* intfc, UInt32
 /// F4SEDelayFunctorWaitList
 ///
 
-F4SEDelayFunctorWaitList::F4SEDelayFunctorWaitList() :
-	lastTickTime_( GetPerfCounter() )
+static SInt64 GetPerfCountsPerMS()
 {
 	LARGE_INTEGER freq;
 	QueryPerformanceFrequency(&freq); 
-	freq.QuadPart /= 1000;
 
-	msToCountMult_ = freq.QuadPart;
+	return freq.QuadPart / 1000;
+}
+
+// wheel slots are 1ms
+F4SEDelayFunctorWaitList::F4SEDelayFunctorWaitList() :
+	msToCountMult_( GetPerfCountsPerMS() ),
+	waitData_( msToCountMult_, GetPerfCounter() )
+{
 }
 
 F4SEDelayFunctorWaitList::~F4SEDelayFunctorWaitList()
@@ -171,7 +174,7 @@ void F4SEDelayFunctorWaitList::Add(SInt32 delayMS, IF4SEDelayFunctor* func)
 {// inLock_
 	IScopedCriticalSection scopedLock( &inLock_ );
 
-	WaitEntryT t( msToCountMult_ * delayMS, func );
+	WaitEntryT t( GetPerfCounter() + msToCountMult_ * delayMS, func );
 	inData_.push_back(t);
 }// ~inLock_
 
@@ -182,36 +185,14 @@ void F4SEDelayFunctorWaitList::Update()
 	{// inLock_
 		IScopedCriticalSection scopedLock( &inLock_ );
 
-		waitData_.insert(waitData_.end(), inData_.begin(), inData_.end());
+		for (WaitDataT::iterator it = inData_.begin(); it != inData_.end(); ++it)
+			waitData_.Insert(it->first, it->second);
+
 		inData_.clear();
 	}// ~inLock
 
-	SInt64 curTime = GetPerfCounter();
-	SInt64 dt      = curTime - lastTickTime_;
-
-	lastTickTime_ = curTime;
-
-	if (dt <= 0)
-		return;
-
-	// Decrement wait times by time delta
-	for (WaitDataT::iterator it = waitData_.begin(); it != waitData_.end(); ++it)
-		if (it->first > 0)
-			it->first -= dt;
-
-	struct IsStillWaiting_
-	{
-		bool operator()(const WaitEntryT& e) { return e.first > 0; }
-	};
-	IsStillWaiting_ pred;
-
-	// Swap all ready entries to end of the vector#1, add them to vector#2, and truncate #1
-	WaitDataT::iterator r = std::partition(waitData_.begin(), waitData_.end(), pred);
-
-	for (WaitDataT::iterator it = r; it != waitData_.end(); ++it)
-		readyData_.push_back(it->second );
-
-	waitData_.resize(std::distance(waitData_.begin(), r));
+	// Only touches the entries that are due
+	waitData_.Advance(GetPerfCounter(), readyData_);
 }
 
 IF4SEDelayFunctor* F4SEDelayFunctorWaitList::PopReady()
@@ -242,18 +223,16 @@ void F4SEDelayFunctorWaitList::ClearAndRelease()
 
 	inData_.clear();
 
-	for (WaitDataT::iterator it = waitData_.begin(); it != waitData_.end(); ++it)
+	waitData_.ForEach([](SInt64 deadline, IF4SEDelayFunctor* func)
 	{
-		const IF4SEObjectFactory* factory = F4SEObjectRegistryInstance().GetFactoryByName(it->second->ClassName());
+		const IF4SEObjectFactory* factory = F4SEObjectRegistryInstance().GetFactoryByName(func->ClassName());
 		if (factory == NULL)
 		{
-			continue;
+			return;
 		}
 
-		factory->Free(it->second);
-	}
-
-	waitData_.clear();
+		factory->Free(func);
+	});
 
 	for (ReadyDataT::iterator it = readyData_.begin(); it != readyData_.end(); ++it)
 	{
@@ -268,13 +247,16 @@ void F4SEDelayFunctorWaitList::ClearAndRelease()
 	readyData_.clear();
 
 	// Avoid interval spanning two sessions
-	lastTickTime_= GetPerfCounter();
+	waitData_.Reset(GetPerfCounter());
 }
 
 bool F4SEDelayFunctorWaitList::Save(const F4SESerializationInterface* intfc)
 {
 	using namespace Serialization;
 
+	// Delays are saved relative to now
+	SInt64 curTime = GetPerfCounter();
+
 	// inData_
 	UInt32 inDataSize = inData_.size();
 	if (! WriteData(intfc,&inDataSize))
@@ -282,7 +264,7 @@ bool F4SEDelayFunctorWaitList::Save(const F4SESerializationInterface* intfc)
 
 	for (UInt32 i=0; i<inDataSize; i++)
 	{
-		SInt64				delay	= inData_[i].first;
+		SInt64				delay	= inData_[i].first - curTime;
 		IF4SEDelayFunctor*	functor = inData_[i].second;
 	
 		if (! WriteF4SEObject(intfc, functor))
@@ -293,21 +275,24 @@ bool F4SEDelayFunctorWaitList::Save(const F4SESerializationInterface* intfc)
 	}
 
 	// waitData_
-	UInt32 waitDataSize = waitData_.size();
+	UInt32 waitDataSize = waitData_.Size();
 	if (! WriteData(intfc,&waitDataSize))
 		return false;
 
-	for (UInt32 i=0; i<waitDataSize; i++)
+	bool ok = true;
+	waitData_.ForEach([&](SInt64 deadline, IF4SEDelayFunctor* functor)
 	{
-		SInt64				delay	= waitData_[i].first;
-		IF4SEDelayFunctor*	functor = waitData_[i].second;
-	
-		if (! WriteF4SEObject(intfc, functor))
-			return false;
+		SInt64 delay = deadline - curTime;
 
-		if (! WriteData(intfc, &delay))
-			return false;
-	}
+		if (ok && ! WriteF4SEObject(intfc, functor))
+			ok = false;
+
+		if (ok && ! WriteData(intfc, &delay))
+			ok = false;
+	});
+
+	if (! ok)
+		return false;
 
 	// readyData_
 	UInt32 readyDataSize = readyData_.size();
@@ -361,7 +346,7 @@ bool F4SEDelayFunctorWaitList::Load(const F4SESerializationInterface* intfc, UIn
 		if (! ReadData(intfc, &delay))
 			return false;
 		
-		WaitEntryT t( delay, functor );
+		WaitEntryT t( GetPerfCounter() + delay, functor );
 		inData_.push_back(t);
 	}
 
@@ -370,8 +355,6 @@ bool F4SEDelayFunctorWaitList::Load(const F4SESerializationInterface* intfc, UIn
 	if (! ReadData(intfc,&waitDataSize))
 		return false;
 
-	waitData_.reserve(waitDataSize);
-
 	for (UInt32 i=0; i<waitDataSize; i++)
 	{
 		IF4SEObject* obj = NULL;
@@ -397,8 +380,7 @@ bool F4SEDelayFunctorWaitList::Load(const F4SESerializationInterface* intfc, UIn
 		if (! ReadData(intfc, &delay))
 			return false;
 		
-		WaitEntryT t( delay, functor );
-		waitData_.push_back(t);
+		waitData_.Insert(GetPerfCounter() + delay, functor);
 	}
 
 	// readyData_
@@ -4,6 +4,7 @@
 
 #include "f4se/GameTypes.h"
 #include "f4se/PapyrusObjects.h"
+#include "f4se/TimerWheel.h"
 
 #include <deque>
 #include <new>
@@ -92,7 +93,7 @@ private:
 class F4SEDelayFunctorWaitList
 {
 private:
-	typedef std::pair<SInt64,IF4SEDelayFunctor*>	WaitEntryT;
+	typedef std::pair<SInt64,IF4SEDelayFunctor*>	WaitEntryT;		// deadline in GetPerfCounter ticks
 	typedef std::vector<WaitEntryT>					WaitDataT;
 	typedef std::vector<IF4SEDelayFunctor*>			ReadyDataT;
 
@@ -111,18 +112,18 @@ public:
 
 	void ClearAndRelease();
 
+	// records remaining delays in ticks, as before the wheel
 	enum { kSaveVersion = 1 };
 
 	bool Save(const F4SESerializationInterface* intfc);
 	bool Load(const F4SESerializationInterface* intfc, UInt32 version);
 
 private:
-	SInt64				lastTickTime_;
 	SInt64				msToCountMult_;
 
 	ICriticalSection	inLock_;
 	WaitDataT			inData_;
-	WaitDataT			waitData_;
+	TimerWheel			waitData_;
 	ReadyDataT			readyData_;
 };
 
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "common/ICriticalSection.h"
+
+#include "f4se/PapyrusEvents.h"
+#include "f4se/TaskFunction.h"
+#include "f4se_common/Utilities.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Sends a native event to every script in a RegistrationSetHolder.
+// The arguments are packed in to one VM array once per event, and that array is shared by every receiver.
+// SendPapyrusEventN used to pack them again for every registration.
+//
+// Coalescing is per event type and off unless [PapyrusEvents] uCoalesce<eventName>=1 is set in the F4SE ini.
+// When it's on, events are queued and sent from the next task pump, and an event with the same arguments as
+// one still queued is dropped. Only turn it on for events where receivers don't count repeats, and whose
+// arguments are still valid a frame later.
+
+struct PapyrusEventStats
+{
+	UInt64	numEvents;		// Send calls
+	UInt64	numCoalesced;	// dropped as a repeat of a queued event
+	UInt64	numCalls;		// receivers called
+};
+
+// the counters, and the list of dispatchers GetStats looks them up in
+class PapyrusEventDispatcherBase
+{
+public:
+	void GetStats(PapyrusEventStats * stats) const
+	{
+		stats->numEvents = m_numEvents.load(std::memory_order_relaxed);
+		stats->numCoalesced = m_numCoalesced.load(std::memory_order_relaxed);
+		stats->numCalls = m_numCalls.load(std::memory_order_relaxed);
+	}
+
+	// the dispatcher sending eventName in this module, nullptr if there isn't one
+	static const PapyrusEventDispatcherBase * Find(const char * eventName)
+	{
+		for (const PapyrusEventDispatcherBase * dispatcher = First(); dispatcher; dispatcher = dispatcher->m_next)
+		{
+			if (!_stricmp(dispatcher->m_eventName, eventName))
+				return dispatcher;
+		}
+
+		return nullptr;
+	}
+
+protected:
+	// dispatchers are statics, constructed before anything can call Find
+	explicit PapyrusEventDispatcherBase(const char * eventName)
+		:m_eventName(eventName)
+		,m_numEvents(0)
+		,m_numCoalesced(0)
+		,m_numCalls(0)
+		,m_next(First())
+	{
+		First() = this;
+	}
+
+	const char							* m_eventName;
+
+	std::atomic<UInt64>					m_numEvents;
+	std::atomic<UInt64>					m_numCoalesced;
+	std::atomic<UInt64>					m_numCalls;
+
+private:
+	PapyrusEventDispatcherBase(const PapyrusEventDispatcherBase &);
+	PapyrusEventDispatcherBase & operator=(const PapyrusEventDispatcherBase &);
+
+	static const PapyrusEventDispatcherBase *& First(void)
+	{
+		static const PapyrusEventDispatcherBase * first = nullptr;
+		return first;
+	}
+
+	const PapyrusEventDispatcherBase	* m_next;
+};
+
+namespace PapyrusEventDispatch
+{
+	// an event's dispatch counters, false if no dispatcher in this module sends it
+	inline bool GetStats(const char * eventName, PapyrusEventStats * stats)
+	{
+		const PapyrusEventDispatcherBase * dispatcher = PapyrusEventDispatcherBase::Find(eventName);
+		if (!dispatcher)
+			return false;
+
+		dispatcher->GetStats(stats);
+		return true;
+	}
+}
+
+template <typename D, typename... Args>
+class PapyrusEventDispatcher : public PapyrusEventDispatcherBase
+{
+public:
+	typedef bool (* Filter)(const D & params, const Args & ... args);
+	typedef UInt32 (* FilterKeys)(UInt64 * keys, const Args & ... args);	// writes the event's filter keys, returns how many
+	typedef void (* ScheduleFn)(TaskFunction * task);	// TaskInterface::AddTaskFunction, or F4SETaskInterface's in a plugin
+
+	PapyrusEventDispatcher(RegistrationSetHolder<D> * regs, const char * eventName, Filter filter = nullptr)
+		:PapyrusEventDispatcherBase(eventName)
+		,m_regs(regs)
+		,m_indexedRegs(nullptr)
+		,m_filter(filter)
+		,m_filterKeys(nullptr)
+		,m_schedule(nullptr)
+		,m_flushScheduled(false)
+	{
+	}
+
+	// only visits the registrations indexed under one of the event's keys, or with no filter
+	PapyrusEventDispatcher(IndexedRegistrationSetHolder<D> * regs, const char * eventName, FilterKeys filterKeys)
+		:PapyrusEventDispatcherBase(eventName)
+		,m_regs(regs)
+		,m_indexedRegs(regs)
+		,m_filter(nullptr)
+		,m_filterKeys(filterKeys)
+		,m_schedule(nullptr)
+		,m_flushScheduled(false)
+	{
+	}
+
+	// reads the ini setting, events are sent straight away until this turns coalescing on
+	void InitCoalescing(ScheduleFn schedule)
+	{
+		UInt32 coalesce = 0;
+		GetConfigOption_UInt32("PapyrusEvents", ("uCoalesce" + std::string(m_eventName)).c_str(), &coalesce);
+
+		if (coalesce && schedule)
+		{
+			m_schedule = schedule;
+			_MESSAGE("coalescing %s", m_eventName);
+		}
+	}
+
+	void Send(Args ... args)
+	{
+		m_numEvents.fetch_add(1, std::memory_order_relaxed);
+
+		if (!m_schedule)
+		{
+			Dispatch(args...);
+			return;
+		}
+
+		EventT event(args...);
+		bool schedule = false;
+
+		{
+			IScopedCriticalSection lock(&m_lock);
+
+			if (std::find(m_pending.begin(), m_pending.end(), event) != m_pending.end())
+			{
+				m_numCoalesced.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			m_pending.push_back(event);
+
+			if (!m_flushScheduled)
+				schedule = m_flushScheduled = true;
+		}
+
+		if (schedule)
+		{
+			TaskFunction task([this]() { Flush(); });
+			m_schedule(&task);
+		}
+	}
+
+private:
+	typedef std::tuple<Args...>	EventT;
+
+	template <typename T>
+	static void PushArgument(VMArray<VMVariable> & arguments, T & arg)
+	{
+		VMVariable var;
+		var.Set<T>(&arg);
+		arguments.Push(&var);
+	}
+
+	static void Pack(VMValue * packed, VirtualMachine * vm, Args & ... args)
+	{
+		VMArray<VMVariable> arguments;
+
+		int expand[] = { 0, (PushArgument<Args>(arguments, args), 0)... };
+		(void)expand;
+
+		PackValue(packed, &arguments, vm);
+	}
+
+	void Dispatch(Args & ... args)
+	{
+		VirtualMachine * vm = (*g_gameVM)->m_virtualMachine;
+
+		// built for the first receiver and shared by the rest
+		BSFixedString eventName;
+		VMValue packed;
+		bool isPacked = false;
+
+		auto send = [&](const EventRegistration<D> & reg)
+		{
+			if (m_filter && !m_filter(reg.params, args...))
+				return;
+
+			VMValue receiver;
+			if (!GetIdentifier(&receiver, reg.handle, &reg.scriptName, vm) || !receiver.IsIdentifier() || !receiver.data.id)
+				return;
+
+			if (!isPacked)
+			{
+				eventName = BSFixedString(m_eventName);
+				Pack(&packed, vm, args...);
+				isPacked = true;
+			}
+
+			CallFunctionNoWait_Internal(vm, 0, receiver.data.id, &eventName, &packed);
+			m_numCalls.fetch_add(1, std::memory_order_relaxed);
+		};
+
+		if (m_indexedRegs)
+		{
+			UInt64 keys[SubscriptionIndex<EventRegistration<D>>::kMaxEventKeys];
+			UInt32 numKeys = m_filterKeys(keys, args...);
+
+			m_indexedRegs->ForEachMatching(keys, numKeys, send);
+		}
+		else
+		{
+			m_regs->ForEach(send);
+		}
+	}
+
+	template <size_t... I>
+	void DispatchEvent(EventT & event, std::index_sequence<I...>)
+	{
+		Dispatch(std::get<I>(event)...);
+	}
+
+	// task pump
+	void Flush(void)
+	{
+		{
+			IScopedCriticalSection lock(&m_lock);
+
+			m_flushing.swap(m_pending);
+			m_flushScheduled = false;
+		}
+
+		for (auto & event : m_flushing)
+			DispatchEvent(event, std::index_sequence_for<Args...>());
+
+		m_flushing.clear();
+	}
+
+	RegistrationSetHolder<D>			* m_regs;
+	IndexedRegistrationSetHolder<D>		* m_indexedRegs;
+	Filter								m_filter;
+	FilterKeys							m_filterKeys;
+	ScheduleFn							m_schedule;
+
+	ICriticalSection					m_lock;
+	std::vector<EventT>					m_pending;
+	std::vector<EventT>					m_flushing;		// task pump only
+	bool								m_flushScheduled;
+};
@@ -1,4 +1,5 @@
 #include "f4se/PapyrusEvents.h"
+#include "f4se/PapyrusEventDispatch.h"
 #include "f4se/PapyrusUtilities.h"
 
 #include "f4se/GameReferences.h"
@@ -11,19 +12,28 @@ RegistrationMapHolder<UInt32>									g_inputKeyEventRegs;
 RegistrationMapHolder<BSFixedString>							g_inputControlEventRegs;
 RegistrationMapHolder<BSFixedString, ExternalEventParameters>	g_externalEventRegs;
 RegistrationSetHolder<NullParameters>							g_cameraEventRegs;
-RegistrationSetHolder<FormParameters>							g_furnitureEventRegs;
+IndexedRegistrationSetHolder<FormParameters>					g_furnitureEventRegs;
 
 F4SEFurnitureEventSink g_furnitureEventSink;
 
+// registrations with no filter, or a filter on the actor or the furniture
+static UInt32 FurnitureEventKeys(UInt64 * keys, Actor * const & actor, TESObjectREFR * const & furniture, const bool & isGettingUp)
+{
+	keys[0] = FormParameters::FilterKey(actor);
+	keys[1] = FormParameters::FilterKey(furniture);
+	return 2;
+}
+
+static PapyrusEventDispatcher<FormParameters, Actor*, TESObjectREFR*, bool> s_furnitureEvent(&g_furnitureEventRegs, "OnFurnitureEvent", FurnitureEventKeys);
+
+void F4SEFurnitureEventSink::InitCoalescing(void (* schedule)(TaskFunction * task))
+{
+	s_furnitureEvent.InitCoalescing(schedule);
+}
+
 EventResult	F4SEFurnitureEventSink::ReceiveEvent(TESFurnitureEvent * evn, void * dispatcher)
 {
-	g_furnitureEventRegs.ForEach(
-		[&evn](const EventRegistration<FormParameters> & reg)
-	{
-		if(reg.params.NoFilter() || reg.params.HasFilter(evn->actor) || reg.params.HasFilter(evn->furniture))
-			SendPapyrusEvent3<Actor*, TESObjectREFR*, bool>(reg.handle, reg.scriptName, "OnFurnitureEvent", evn->actor, evn->furniture, evn->isGettingUp);
-	}
-	);
+	s_furnitureEvent.Send(evn->actor, evn->furniture, evn->isGettingUp);
 #if 0
 	UInt64 handle = PapyrusVM::GetHandleFromObject(evn->furniture, TESObjectREFR::kTypeID);
 	// Do not use, function signature is not correct
@@ -5,9 +5,12 @@
 #include "f4se/PapyrusArgs.h"
 
 #include "f4se/PluginAPI.h"
+#include "f4se/RegistrationIndex.h"
+#include "f4se/SubscriptionIndex.h"
 #include "f4se/Serialization.h"
 
 #include <map>
+#include <memory>
 #include <set>
 
 // This is the callback function to ScriptObject.SendCustomEvent, the high-level parameters were more convenient
@@ -63,9 +66,16 @@ enum InternalEventVersion
 {
 	kVersion1,
 	kVersion2,
-	kCurrentVersion = kVersion2
+	kVersion3,	// strings through the co-save string table
+	kCurrentVersion = kVersion3
 };
 
+// the string table needs serialization interface version 4, older runtimes get the version 2 layout
+inline UInt32 GetSaveVersion(const F4SESerializationInterface * intfc, UInt32 version)
+{
+	return (version >= InternalEventVersion::kVersion3 && intfc->version < 4) ? InternalEventVersion::kVersion2 : version;
+}
+
 template <typename D>
 class EventRegistration
 {
@@ -90,8 +100,13 @@ public:
 	{
 		if (! intfc->WriteRecordData(&handle, sizeof(handle)))
 			return false;
-		if (!Serialization::WriteData(intfc, &scriptName))
-			return false;
+		if(version >= InternalEventVersion::kVersion3) {
+			if (!Serialization::WriteDataRef(intfc, &scriptName))
+				return false;
+		} else {
+			if (!Serialization::WriteData(intfc, &scriptName))
+				return false;
+		}
 		if (! params.Save(intfc, version))
 			return false;
 		return true;
@@ -101,7 +116,10 @@ public:
 	{
 		if (! intfc->ReadRecordData(&handle, sizeof(handle)))
 			return false;
-		if(version >= InternalEventVersion::kVersion2) {
+		if(version >= InternalEventVersion::kVersion3) {
+			if (!Serialization::ReadDataRef(intfc, &scriptName))
+				return false;
+		} else if(version >= InternalEventVersion::kVersion2) {
 			if (!Serialization::ReadData(intfc, &scriptName))
 				return false;
 		} else {
@@ -198,6 +216,19 @@ public:
 		return forms.size() == 0;
 	}
 
+	// IndexedRegistrationSetHolder keys, the same formIDs HasFilter looks for
+	template <typename F>
+	void ForEachFilterKey(F & functor) const
+	{
+		for(auto & form : forms)
+			functor(form);
+	}
+
+	static UInt64 FilterKey(TESForm * form)
+	{
+		return form ? form->formID : 0;
+	}
+
 	void Dump(void)
 	{
 		_MESSAGE("> formId:\t%08X", forms.size());
@@ -211,11 +242,17 @@ public:
 
 	bool Save(const F4SESerializationInterface * intfc, UInt32 version) const
 	{
+		if (version >= InternalEventVersion::kVersion3)
+			return Serialization::WriteDataRef<BSFixedString>(intfc, &callbackName);
+
 		return Serialization::WriteData<BSFixedString>(intfc, &callbackName);
 	}
 
 	bool Load(const F4SESerializationInterface * intfc, UInt32 version)
 	{
+		if (version >= InternalEventVersion::kVersion3)
+			return Serialization::ReadDataRef<BSFixedString>(intfc, &callbackName);
+
 		return Serialization::ReadData<BSFixedString>(intfc, &callbackName);
 	}
 
@@ -225,11 +262,12 @@ public:
 	}
 };
 
+// ForEach reads a snapshot and doesn't take the lock, so a key event never waits on Register/Unregister
 template <typename K, typename D = NullParameters>
-class RegistrationMapHolder : public SafeDataHolder<std::map<K,std::set<EventRegistration<D>>>>
+class RegistrationMapHolder : public SafeDataHolder<RegistrationIndex<K,EventRegistration<D>>>
 {
-	typedef std::set<EventRegistration<D>>	RegSet;
-	typedef std::map<K,RegSet>				RegMap;
+	typedef RegistrationIndex<K,EventRegistration<D>>	RegIndex;
+	typedef typename RegIndex::RegList					RegList;
 
 public:
 
@@ -246,8 +284,11 @@ public:
 
 		Lock();
 
-		if (m_data[key].insert(reg).second)
+		if (m_data.Insert(key, reg))
+		{
 			policy->AddRef(handle);
+			m_data.Publish();
+		}
 
 		Release();
 	}
@@ -263,8 +304,11 @@ public:
 
 		Lock();
 
-		if (m_data[key].erase(reg))
+		if (m_data.Erase(key, reg))
+		{
 			policy->Release(handle);
+			m_data.Publish();
+		}
 
 		Release();
 	}
@@ -280,9 +324,12 @@ public:
 
 		Lock();
 
-		for (RegMap::iterator iter = m_data.begin(); iter != m_data.end(); ++iter)
-			if (iter->second.erase(reg))
-				policy->Release(handle);
+		UInt32 numErased = m_data.EraseAll(reg);
+		for (UInt32 i = 0; i < numErased; i++)
+			policy->Release(handle);
+
+		if (numErased)
+			m_data.Publish();
 
 		Release();
 	}
@@ -290,52 +337,46 @@ public:
 	template <typename F>
 	void ForEach(K & key, F & functor)
 	{
-		Lock();
-
-		RegMap::iterator handles = m_data.find(key);
-
-		if (handles != m_data.end())
-			for (RegSet::iterator iter = handles->second.begin(); iter != handles->second.end(); ++iter)
-				functor(*iter);
-
-		Release();
+		m_data.ForEach(key, functor);
 	}
 
 	void Clear(void)
 	{
 		Lock();
-		m_data.clear();
+		m_data.Clear();
+		m_data.Publish();
 		Release();
 	}
 
 	bool Save(const F4SESerializationInterface * intfc, UInt32 type, UInt32 version)
 	{
+		version = GetSaveVersion(intfc, version);
+
 		intfc->OpenRecord(type, version);
 
-		Lock();
+		typename RegIndex::Snapshot table = m_data.GetSnapshot();
 
-		for (RegMap::iterator iter = m_data.begin(); iter != m_data.end(); ++iter)
+		auto saveKey = [&](const K & key, const RegList & regs)
 		{
-			UInt32 numRegs = iter->second.size();
-
-			if (!numRegs)
-				continue;
+			UInt32 numRegs = regs.size();
 
 			intfc->OpenRecord('REGS', version);
 
 			// Key
-			Serialization::WriteData(intfc, &iter->first);
+			if (version >= InternalEventVersion::kVersion3)
+				Serialization::WriteDataRef(intfc, &key);
+			else
+				Serialization::WriteData(intfc, &key);
 			// Reg count
 			intfc->WriteRecordData(&numRegs, sizeof(numRegs));
 			// Regs
-			for (RegSet::iterator elems = iter->second.begin(); elems != iter->second.end(); ++elems)
+			for (typename RegList::const_iterator elems = regs.begin(); elems != regs.end(); ++elems)
 				elems->Save(intfc, version);
-		}
+		};
+		table->ForEach(saveKey);
 
 		intfc->OpenRecord('REGE', version);
 
-		Release();
-
 		return true;
 	}
 
@@ -351,7 +392,8 @@ public:
 				{
 					K curKey;
 					// Key
-					if (! Serialization::ReadData(intfc, &curKey))
+					bool keyRead = (curVersion >= InternalEventVersion::kVersion3) ? Serialization::ReadDataRef(intfc, &curKey) : Serialization::ReadData(intfc, &curKey);
+					if (! keyRead)
 					{
 						_MESSAGE("Error loading reg key");
 						return false;
@@ -392,7 +434,7 @@ public:
 
 							Lock();
 
-							if (m_data[curKey].insert(reg).second)
+							if (m_data.Insert(curKey, reg))
 								policy->AddRef(reg.handle);
 
 							Release();
@@ -405,6 +447,11 @@ public:
 						}
 					}
 
+					// One snapshot per key
+					Lock();
+					m_data.Publish();
+					Release();
+
 					break;
 				}
 			case 'REGE':
@@ -487,6 +534,8 @@ public:
 
 	bool Save(const F4SESerializationInterface * intfc, UInt32 type, UInt32 version)
 	{
+		version = GetSaveVersion(intfc, version);
+
 		intfc->OpenRecord(type, version);
 
 		Lock();
@@ -559,16 +608,101 @@ public:
 	}
 };
 
+// RegistrationSetHolder that also indexes its registrations by D::ForEachFilterKey, so an event only visits the
+// registrations that can pass its filter (see SubscriptionIndex.h). Editing params in place between Lock and Release
+// is fine, Release drops the index and the next dispatch rebuilds it.
+template <typename D>
+class IndexedRegistrationSetHolder : public RegistrationSetHolder<D>
+{
+	typedef RegistrationSetHolder<D>					Base;
+	typedef SubscriptionIndex<EventRegistration<D>>		Index;
+
+public:
+	void Release(void)
+	{
+		Invalidate();
+		Base::Release();
+	}
+
+	void Register(UInt64 handle, BSFixedString scriptName, D * params = NULL)
+	{
+		Base::Register(handle, scriptName, params);
+		Invalidate();
+	}
+
+	void Unregister(UInt64 handle, BSFixedString scriptName)
+	{
+		Base::Unregister(handle, scriptName);
+		Invalidate();
+	}
+
+	void Clear(void)
+	{
+		Base::Clear();
+		Invalidate();
+	}
+
+	bool Load(const F4SESerializationInterface* intfc, UInt32 version)
+	{
+		bool result = Base::Load(intfc, version);
+		Invalidate();
+		return result;
+	}
+
+	// f(reg) for registrations with no filter or a filter on any of keys, without holding the lock
+	template <typename F>
+	void ForEachMatching(const UInt64 * keys, UInt32 numKeys, F & functor)
+	{
+		std::shared_ptr<const Index> index = GetIndex();
+		index->ForEachMatching(keys, numKeys, functor);
+	}
+
+private:
+	void Invalidate(void)
+	{
+		std::atomic_store(&m_index, std::shared_ptr<const Index>());
+	}
+
+	std::shared_ptr<const Index> GetIndex(void)
+	{
+		std::shared_ptr<const Index> index = std::atomic_load(&m_index);
+		if (index)
+			return index;
+
+		Base::Lock();
+
+		index = std::atomic_load(&m_index);
+		if (!index)
+		{
+			auto built = std::make_shared<Index>();
+			for (auto & reg : this->m_data)
+				built->Add(reg, [&reg](auto functor) { reg.params.ForEachFilterKey(functor); });
+
+			index = built;
+			std::atomic_store(&m_index, index);
+		}
+
+		Base::Release();
+
+		return index;
+	}
+
+	std::shared_ptr<const Index>	m_index;	// null until the first dispatch after an edit
+};
+
 extern RegistrationMapHolder<UInt32>									g_inputKeyEventRegs;
 extern RegistrationMapHolder<BSFixedString>								g_inputControlEventRegs;
 extern RegistrationMapHolder<BSFixedString, ExternalEventParameters>	g_externalEventRegs;
 extern RegistrationSetHolder<NullParameters>							g_cameraEventRegs;
-extern RegistrationSetHolder<FormParameters>							g_furnitureEventRegs;
+extern IndexedRegistrationSetHolder<FormParameters>						g_furnitureEventRegs;
 
 class F4SEFurnitureEventSink : public BSTEventSink<TESFurnitureEvent>
 {
 public:
 	virtual	EventResult	ReceiveEvent(TESFurnitureEvent * evn, void * dispatcher) override;
+
+	// see PapyrusEventDispatch.h
+	static void InitCoalescing(void (* schedule)(TaskFunction * task));
 };
 
 extern F4SEFurnitureEventSink g_furnitureEventSink;
@@ -1,13 +1,141 @@
 #include "f4se/PapyrusSerialization.h"
+#include "f4se/PapyrusArrayEncoding.h"
 
 #include "f4se/PapyrusArgs.h"
 
 namespace Serialization
 {
-	bool WriteVMData(const F4SESerializationInterface* intfc, const VMValue * val)
+	enum
+	{
+		// or'd in to the type of an array written in one block, see PapyrusArrayEncoding
+		// older data has one value per element and still loads
+		kTypeFlag_Packed = 0x80,
+	};
+
+	// packed array payloads are built and, for interfaces without ReadRecordDataSpan, read back through here
+	thread_local std::vector <UInt8>	s_packBuffer;
+
+	static bool WriteString(const F4SESerializationInterface* intfc, const BSFixedString * str, bool stringRefs)
+	{
+		return stringRefs ? WriteDataRef(intfc, str) : WriteData(intfc, str);
+	}
+
+	static bool ReadString(const F4SESerializationInterface* intfc, BSFixedString * str, bool stringRefs)
+	{
+		return stringRefs ? ReadDataRef(intfc, str) : ReadData(intfc, str);
+	}
+
+	static bool IsPackedType(UInt8 typeId)
+	{
+		switch(typeId)
+		{
+		case VMValue::kType_IdentifierArray:
+		case VMValue::kType_IntArray:
+		case VMValue::kType_FloatArray:
+		case VMValue::kType_BoolArray:
+		case VMValue::kType_StructArray:
+			return true;
+		}
+
+		return false;
+	}
+
+	// the payload in s_packBuffer, behind its length
+	static bool WritePackBuffer(const F4SESerializationInterface* intfc)
+	{
+		UInt32 payloadLength = s_packBuffer.size();
+
+		if(!WriteData(intfc, &payloadLength))
+			return false;
+
+		return !payloadLength || intfc->WriteRecordData(s_packBuffer.data(), payloadLength);
+	}
+
+	// straight out of the record where the interface allows it, one copy otherwise
+	static bool ReadPackBuffer(const F4SESerializationInterface* intfc, const UInt8 ** payload, UInt32 * payloadLength)
+	{
+		if(!ReadData(intfc, payloadLength))
+			return false;
+
+		if(intfc->version >= 2)
+		{
+			UInt32 lengthOut = 0;
+			*payload = (const UInt8 *)intfc->ReadRecordDataSpan(*payloadLength, &lengthOut);
+			return lengthOut == *payloadLength;
+		}
+
+		s_packBuffer.resize(*payloadLength);
+		*payload = s_packBuffer.data();
+
+		return !*payloadLength || intfc->ReadRecordData(s_packBuffer.data(), *payloadLength) == *payloadLength;
+	}
+
+	static bool WritePackedArray(const F4SESerializationInterface* intfc, UInt8 typeId, const VMValue::ArrayData * arr)
+	{
+		UInt32 length = arr ? arr->arr.count : 0;
+		const VMValue * entries = arr ? arr->arr.entries : nullptr;
+
+		if(!WriteData(intfc, &length))
+			return false;
+
+		s_packBuffer.clear();
+
+		switch(typeId)
+		{
+		case VMValue::kType_IntArray:
+			PapyrusArrayEncoding::EncodeInts(length, [entries](UInt32 i) { return entries[i].data.i; }, s_packBuffer);
+			break;
+		case VMValue::kType_FloatArray:
+			PapyrusArrayEncoding::EncodeFloats(length, [entries](UInt32 i) { return entries[i].data.f; }, s_packBuffer);
+			break;
+		case VMValue::kType_BoolArray:
+			PapyrusArrayEncoding::EncodeBools(length, [entries](UInt32 i) { return entries[i].data.b; }, s_packBuffer);
+			break;
+		}
+
+		return WritePackBuffer(intfc);
+	}
+
+	static bool ReadPackedArray(const F4SESerializationInterface* intfc, UInt8 typeId, VMValue * val, VirtualMachine * vm)
+	{
+		UInt32 length = 0;
+		if(!ReadData(intfc, &length))
+			return false;
+
+		const UInt8 * payload = nullptr;
+		UInt32 payloadLength = 0;
+		if(!ReadPackBuffer(intfc, &payload, &payloadLength))
+			return false;
+
+		VMValue::ArrayData * data = nullptr;
+		vm->CreateArray(val, length, &data);
+
+		val->type.value = typeId;
+
+		if(!data)
+			return false;
+
+		VMValue * entries = data->arr.entries;
+		UInt32 offset = 0;
+
+		switch(typeId)
+		{
+		case VMValue::kType_IntArray:
+			return PapyrusArrayEncoding::DecodeInts(payload, payloadLength, &offset, length, [entries](UInt32 i, SInt32 value) { entries[i].SetInt(value); });
+		case VMValue::kType_FloatArray:
+			return PapyrusArrayEncoding::DecodeFloats(payload, payloadLength, &offset, length, [entries](UInt32 i, float value) { entries[i].SetFloat(value); });
+		case VMValue::kType_BoolArray:
+			return PapyrusArrayEncoding::DecodeBools(payload, payloadLength, &offset, length, [entries](UInt32 i, bool value) { entries[i].SetBool(value); });
+		}
+
+		return false;
+	}
+
+	bool WriteVMData(const F4SESerializationInterface* intfc, const VMValue * val, bool stringRefs)
 	{
 		UInt8 typeId = val->GetTypeEnum();
-		if(!WriteData(intfc, &typeId))
+		UInt8 typeTag = IsPackedType(typeId) ? (typeId | kTypeFlag_Packed) : typeId;
+		if(!WriteData(intfc, &typeTag))
 			return false;
 
 		switch(typeId)
@@ -25,7 +153,7 @@ namespace Serialization
 						typeName = typeObject->m_typeName;
 				}
 
-				if(!WriteData(intfc, &typeName))
+				if(!WriteString(intfc, &typeName, stringRefs))
 					return false;
 				if(!WriteData(intfc, &handle))
 					return false;
@@ -33,7 +161,7 @@ namespace Serialization
 			break;
 		case VMValue::kType_String:
 			{
-				if(!WriteData(intfc, val->data.GetStr()))
+				if(!WriteString(intfc, val->data.GetStr(), stringRefs))
 					return false;
 			}
 			break;
@@ -57,7 +185,7 @@ namespace Serialization
 			break;
 		case VMValue::kType_Variable:
 			{
-				if(!WriteVMData(intfc, val->data.var))
+				if(!WriteVMData(intfc, val->data.var, stringRefs))
 					return false;
 			}
 			break;
@@ -68,16 +196,16 @@ namespace Serialization
 				VMStructTypeInfo * typeObject = strct->m_type;
 				UInt32 members = typeObject->m_members.Size();
 
-				if(!WriteData(intfc, &typeObject->m_typeName))
+				if(!WriteString(intfc, &typeObject->m_typeName, stringRefs))
 					return false;
 
 				if(!WriteData(intfc, &members))
 					return false;
 
-				typeObject->m_members.ForEach([&intfc, &entries](VMStructTypeInfo::MemberItem * item)
+				typeObject->m_members.ForEach([&intfc, &entries, stringRefs](VMStructTypeInfo::MemberItem * item)
 				{
-					WriteData(intfc, &item->name);				// Write Key
-					WriteVMData(intfc, &entries[item->index]);	// Write Value
+					WriteString(intfc, &item->name, stringRefs);			// Write Key
+					WriteVMData(intfc, &entries[item->index], stringRefs);	// Write Value
 					return true;
 				});
 			}
@@ -99,32 +227,24 @@ namespace Serialization
 					typeName = typeObject->m_typeName;
 				}
 
-				if(!WriteData(intfc, &typeObject->m_typeName))
+				if(!WriteString(intfc, &typeName, stringRefs))
 					return false;
 
-				if(arr)
-				{
-					for(UInt32 i = 0; i < length; i++)
-					{
-						VMValue entry;
-						arr->arr.GetNthItem(i, entry);
+				const VMValue * entries = arr ? arr->arr.entries : nullptr;
 
-						UInt64 handle = 0;
-						VMIdentifier * id = entry.data.id;
-						if(id) {
-							handle = id->GetHandle();
-						}
+				s_packBuffer.clear();
 
-						if(!WriteData(intfc, &handle))
-							return false;
-					}
-				}
+				PapyrusArrayEncoding::EncodeHandles(length, [entries](UInt32 i)
+				{
+					VMIdentifier * id = entries[i].data.id;
+					return id ? id->GetHandle() : 0;
+				}, s_packBuffer);
+
+				if(!WritePackBuffer(intfc))
+					return false;
 			}
 			break;
 		case VMValue::kType_StringArray:
-		case VMValue::kType_IntArray:
-		case VMValue::kType_FloatArray:
-		case VMValue::kType_BoolArray:
 			{
 				UInt32 length = 0;
 				VMValue::ArrayData * arr = val->data.arr;
@@ -135,34 +255,21 @@ namespace Serialization
 				if(!WriteData(intfc, &length))
 					return false;
 
-				if(arr)
+				for(UInt32 i = 0; i < length; i++)
 				{
-					for(UInt32 i = 0; i < length; i++)
-					{
-						VMValue entry;
-						arr->arr.GetNthItem(i, entry);
-						switch(typeId) {
-						case VMValue::kType_StringArray:
-							if(!WriteData(intfc, entry.data.GetStr()))
-								return false;
-							break;
-						case VMValue::kType_IntArray:
-							if(!WriteData(intfc, &entry.data.i))
-								return false;
-							break;
-						case VMValue::kType_FloatArray:
-							if(!WriteData(intfc, &entry.data.f))
-								return false;
-							break;
-						case VMValue::kType_BoolArray:
-							if(!WriteData(intfc, &entry.data.b))
-								return false;
-							break;
-						}
-					}
+					if(!WriteString(intfc, arr->arr.entries[i].data.GetStr(), stringRefs))
+						return false;
 				}
 			}
 			break;
+		case VMValue::kType_IntArray:
+		case VMValue::kType_FloatArray:
+		case VMValue::kType_BoolArray:
+			{
+				if(!WritePackedArray(intfc, typeId, val->data.arr))
+					return false;
+			}
+			break;
 		case VMValue::kType_VariableArray:
 			{
 				UInt32 length = 0;
@@ -181,7 +288,7 @@ namespace Serialization
 						VMValue entry;
 						arr->arr.GetNthItem(i, entry);
 
-						if(!WriteVMData(intfc, &entry))
+						if(!WriteVMData(intfc, &entry, stringRefs))
 							return false;
 					}
 				}
@@ -206,37 +313,46 @@ namespace Serialization
 				if(!WriteData(intfc, &length))
 					return false;
 
-				if(!WriteData(intfc, &typeName))
+				if(!WriteString(intfc, &typeName, stringRefs))
 					return false;
 
 				UInt32 members = typeObject ? typeObject->m_members.Size() : 0;
 				if(!WriteData(intfc, &members))
 					return false;
 
-				for(UInt32 i = 0; i < length; i++)
+				if(!typeObject)
+					break;
+
+				// member names once for the whole array, then each element's values in the same order
+				bool result = true;
+
+				typeObject->m_members.ForEach([&intfc, &result, stringRefs](VMStructTypeInfo::MemberItem * item)
 				{
-					VMValue entry;
-					arr->arr.GetNthItem(i, entry);
+					result = WriteString(intfc, &item->name, stringRefs);
+					return result;
+				});
 
-					VMValue::StructData * strct = entry.data.strct;
+				for(UInt32 i = 0; result && i < length; i++)
+				{
+					VMValue::StructData * strct = arr->arr.entries[i].data.strct;
 					VMValue * entries = strct->GetStruct();
-					if(typeObject)
+
+					typeObject->m_members.ForEach([&intfc, &entries, &result, stringRefs](VMStructTypeInfo::MemberItem * item)
 					{
-						typeObject->m_members.ForEach([&intfc, &entries](VMStructTypeInfo::MemberItem * item)
-						{
-							WriteData(intfc, &item->name);				// Write Key
-							WriteVMData(intfc, &entries[item->index]);	// Write Value
-							return true;
-						});
-					}
+						result = WriteVMData(intfc, &entries[item->index], stringRefs);
+						return result;
+					});
 				}
+
+				if(!result)
+					return false;
 			}
 			break;
 		}
 		return true;
 	}
 
-	bool ReadVMData(const F4SESerializationInterface* intfc, VMValue * val)
+	bool ReadVMData(const F4SESerializationInterface* intfc, VMValue * val, bool stringRefs)
 	{
 		VirtualMachine * vm = (*g_gameVM)->m_virtualMachine;
 
@@ -244,12 +360,15 @@ namespace Serialization
 		if(!ReadData(intfc, &typeId))
 			return false;
 
+		bool packed = (typeId & kTypeFlag_Packed) != 0;
+		typeId &= ~kTypeFlag_Packed;
+
 		switch(typeId)
 		{
 		case VMValue::kType_Identifier:
 			{
 				BSFixedString typeName;
-				if(!ReadData(intfc, &typeName))
+				if(!ReadString(intfc, &typeName, stringRefs))
 					return false;
 
 				UInt64 handle = 0;
@@ -264,7 +383,7 @@ namespace Serialization
 		case VMValue::kType_String:
 			{
 				BSFixedString str;
-				if(!ReadData(intfc, &str))
+				if(!ReadString(intfc, &str, stringRefs))
 					return false;
 				val->SetString(str);
 			}
@@ -280,7 +399,7 @@ namespace Serialization
 		case VMValue::kType_Float:
 			{
 				float f = 0.0f;
-				if(!WriteData(intfc, &f))
+				if(!ReadData(intfc, &f))
 					return false;
 				val->SetFloat(f);
 			}
@@ -288,7 +407,7 @@ namespace Serialization
 		case VMValue::kType_Bool:
 			{
 				bool b = false;
-				if(!WriteData(intfc, &b))
+				if(!ReadData(intfc, &b))
 					return false;
 				val->SetBool(b);
 			}
@@ -296,7 +415,7 @@ namespace Serialization
 		case VMValue::kType_Variable:
 			{
 				VMValue * value = new VMValue;
-				if(!ReadVMData(intfc, value)) {
+				if(!ReadVMData(intfc, value, stringRefs)) {
 					delete value;
 					return false;
 				}
@@ -306,7 +425,7 @@ namespace Serialization
 		case VMValue::kType_Struct:
 			{
 				BSFixedString structName;
-				if(!ReadData(intfc, &structName))
+				if(!ReadString(intfc, &structName, stringRefs))
 					return false;
 
 				UInt32 members;
@@ -336,11 +455,11 @@ namespace Serialization
 				for(UInt32 i = 0; i < members; i++)
 				{
 					BSFixedString member;
-					if(!ReadData(intfc, &member))	// Read Key
+					if(!ReadString(intfc, &member, stringRefs))	// Read Key
 						return false;
 
 					VMValue data;
-					if(!ReadVMData(intfc, &data))	// Read Value
+					if(!ReadVMData(intfc, &data, stringRefs))	// Read Value
 						return false;
 
 					if(strct)
@@ -361,7 +480,7 @@ namespace Serialization
 					return false;
 
 				BSFixedString typeName;
-				if(!ReadData(intfc, &typeName))
+				if(!ReadString(intfc, &typeName, stringRefs))
 					return false;
 
 				VMValue::ArrayData * data = nullptr;
@@ -372,14 +491,35 @@ namespace Serialization
 					if(typeInfo)
 						typeInfo->Release();
 
-				for(UInt32 i = 0; i < length; i++)
+				if(packed)
 				{
-					UInt64 handle = 0;
-					if(!ReadData(intfc, &handle))
+					const UInt8 * payload = nullptr;
+					UInt32 payloadLength = 0;
+					if(!ReadPackBuffer(intfc, &payload, &payloadLength))
+						return false;
+
+					UInt32 offset = 0;
+					bool decoded = PapyrusArrayEncoding::DecodeHandles(payload, payloadLength, &offset, length, [&](UInt32 i, UInt64 handle)
+					{
+						if(intfc->ResolveHandle(handle, &handle) && data) {
+							GetIdentifier(&data->arr.entries[i], handle, typeInfo, vm);
+						}
+					});
+
+					if(!decoded)
 						return false;
+				}
+				else
+				{
+					for(UInt32 i = 0; i < length; i++)
+					{
+						UInt64 handle = 0;
+						if(!ReadData(intfc, &handle))
+							return false;
 
-					if(intfc->ResolveHandle(handle, &handle) && data) {
-						GetIdentifier(&data->arr.entries[i], handle, typeInfo, (*g_gameVM)->m_virtualMachine);
+						if(intfc->ResolveHandle(handle, &handle) && data) {
+							GetIdentifier(&data->arr.entries[i], handle, typeInfo, vm);
+						}
 					}
 				}
 
@@ -392,6 +532,13 @@ namespace Serialization
 		case VMValue::kType_FloatArray:
 		case VMValue::kType_BoolArray:
 			{
+				if(packed)
+				{
+					if(!ReadPackedArray(intfc, typeId, val, vm))
+						return false;
+					break;
+				}
+
 				UInt32 length = 0;
 				if(!ReadData(intfc, &length))
 					return false;
@@ -407,17 +554,17 @@ namespace Serialization
 					case VMValue::kType_StringArray:
 						{
 							BSFixedString str;
-							if(!ReadData(intfc, &str))
+							if(!ReadString(intfc, &str, stringRefs))
 								return false;
 							data->arr.entries[i].SetString(str);
 						}
 						break;
 					case VMValue::kType_IntArray:
 						{
-							SInt32 i = 0;
-							if(!ReadData(intfc, &i))
+							SInt32 value = 0;
+							if(!ReadData(intfc, &value))
 								return false;
-							data->arr.entries[i].SetInt(i);
+							data->arr.entries[i].SetInt(value);
 						}
 						break;
 					case VMValue::kType_FloatArray:
@@ -443,7 +590,7 @@ namespace Serialization
 		case VMValue::kType_VariableArray:
 			{
 				UInt32 length = 0;
-				if(!WriteData(intfc, &length))
+				if(!ReadData(intfc, &length))
 					return false;
 
 				VMValue::ArrayData * data = nullptr;
@@ -453,7 +600,7 @@ namespace Serialization
 
 				for(UInt32 i = 0; i < length; i++)
 				{
-					if(!ReadVMData(intfc, &data->arr.entries[i]))
+					if(!ReadVMData(intfc, &data->arr.entries[i], stringRefs))
 						return false;
 				}
 			}
@@ -465,7 +612,7 @@ namespace Serialization
 					return false;
 
 				BSFixedString structName;
-				if(!ReadData(intfc, &structName))
+				if(!ReadString(intfc, &structName, stringRefs))
 					return false;
 
 				UInt32 members = 0;
@@ -485,6 +632,21 @@ namespace Serialization
 				if(typeObject)
 					vm->CreateArray(val, length, &data);
 
+				// packed arrays name the members once, look each up once, -1 for members the type no longer has
+				std::vector<SInt32> memberIndices;
+				if(packed)
+				{
+					for(UInt32 j = 0; j < members; j++)
+					{
+						BSFixedString member;
+						if(!ReadString(intfc, &member, stringRefs))
+							return false;
+
+						auto memberItem = typeObject ? typeObject->m_members.Find(&member) : nullptr;
+						memberIndices.push_back(memberItem ? (SInt32)memberItem->index : -1);
+					}
+				}
+
 				for(UInt32 i = 0; i < length; i++)
 				{
 					VMValue::StructData * strct = nullptr;
@@ -493,19 +655,30 @@ namespace Serialization
 
 					for(UInt32 j = 0; j < members; j++)
 					{
-						BSFixedString member;
-						if(!ReadData(intfc, &member))	// Read Key
-							return false;
+						SInt32 memberIndex = -1;
+
+						if(packed)
+						{
+							memberIndex = memberIndices[j];
+						}
+						else
+						{
+							BSFixedString member;
+							if(!ReadString(intfc, &member, stringRefs))	// Read Key
+								return false;
+
+							auto memberItem = strct ? typeObject->m_members.Find(&member) : nullptr;
+							if(memberItem)
+								memberIndex = memberItem->index;
+						}
 
 						VMValue data;
-						if(!ReadVMData(intfc, &data))	// Read Value
+						if(!ReadVMData(intfc, &data, stringRefs))	// Read Value
 							return false;
 
 						// Set the member data if we both had the type and created the struct
-						if(strct) {
-							auto memberItem = typeObject->m_members.Find(&member);
-							if(memberItem)
-								strct->GetStruct()[memberItem->index] = data;
+						if(strct && memberIndex >= 0) {
+							strct->GetStruct()[memberIndex] = data;
 						}
 					}
 
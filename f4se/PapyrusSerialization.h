@@ -8,6 +8,7 @@ class VMVariable;
 
 namespace Serialization
 {
-	bool WriteVMData(const F4SESerializationInterface* intfc, const VMValue * val);
-	bool ReadVMData(const F4SESerializationInterface* intfc, VMValue * val);
+	// stringRefs writes type names, member names and strings through the co-save string table, read back the same way
+	bool WriteVMData(const F4SESerializationInterface* intfc, const VMValue * val, bool stringRefs = false);
+	bool ReadVMData(const F4SESerializationInterface* intfc, VMValue * val, bool stringRefs = false);
 };
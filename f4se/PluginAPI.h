@@ -5,6 +5,7 @@ typedef UInt32	PluginHandle;	// treat this as an opaque type
 class GFxMovieView;
 class GFxValue;
 class ITaskDelegate;
+class TaskFunction;
 class F4SEDelayFunctorManager;
 class F4SEObjectRegistry;
 class F4SEPersistentObjectStorage;
@@ -144,7 +145,10 @@ struct F4SESerializationInterface
 {
 	enum
 	{
-		kInterfaceVersion = 1,
+		kInterfaceVersion = 4,
+
+		// record type of the string table F4SE appends to a plugin's data, see WriteStringRef
+		kStringTableType = 'F4ST',
 	};
 	
 	typedef void (* EventCallback)(const F4SESerializationInterface * intfc);
@@ -167,6 +171,34 @@ struct F4SESerializationInterface
 	UInt32	(* ReadRecordData)(void * buf, UInt32 length);
 	bool	(* ResolveHandle)(UInt64 handle, UInt64 * handleOut);
 	bool	(* ResolveFormId)(UInt32 formId, UInt32 * formIdOut);
+
+	// version 2
+
+	// consumes up to length bytes of the current record without copying them
+	// the returned pointer is only valid until your load callback returns
+	const void *	(* ReadRecordDataSpan)(UInt32 length, UInt32 * lengthOut);
+
+	// opens the first record of the given type in your plugin's data, regardless of the current position
+	// GetNextRecordInfo continues with the record following it
+	// when either fails no record is open, ReadRecordData returns 0 until one is
+	bool	(* FindRecord)(UInt32 type, UInt32 * version, UInt32 * length);
+
+	// version 3
+
+	// same as SetLoadCallback, but the callback may be run on a worker thread concurrently with other plugins
+	// only use this if your callback touches nothing but the serialization interface and your own state
+	// the record functions above read from a per-thread cursor, all load callbacks finish before the game continues
+	void	(* SetThreadSafeLoadCallback)(PluginHandle plugin, EventCallback callback);
+
+	// version 4
+
+	// writes a reference to str in to the current record, each distinct string is stored once per plugin per co-save
+	// the strings go out after your save callback returns as a record of type kStringTableType, which loading hides
+	bool	(* WriteStringRef)(const char * str);
+
+	// reads a reference written by WriteStringRef, NULL if it doesn't resolve
+	// the returned string is only valid until your load callback returns
+	const char *	(* ReadStringRef)(UInt32 * lengthOut);
 };
 
 class VirtualMachine;
@@ -190,12 +222,21 @@ struct F4SETaskInterface
 {
 	enum
 	{
-		kInterfaceVersion = 2
+		kInterfaceVersion = 3
 	};
 	UInt32	interfaceVersion;
 
+	// tasks run in the order they were added, all of them on the next pump of their queue
+	// a budget set in f4sevr.ini ([Threads] uMaxTasksPerFrame, uTaskBudgetMicroseconds) can leave some for later pumps
 	void	(* AddTask)(ITaskDelegate * task);
 	void	(* AddUITask)(ITaskDelegate * task);
+
+	// version 3
+	// the function is moved in to a pooled queue slot and task is left empty
+	// a null task or an empty TaskFunction is ignored
+	// functions that fit in TaskFunction::kInlineSize queue without allocating (see f4se/TaskFunction.h)
+	void	(* AddTaskFunction)(TaskFunction * task);
+	void	(* AddUITaskFunction)(TaskFunction * task);
 };
 
 struct F4SEObjectInterface
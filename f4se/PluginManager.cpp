@@ -72,7 +72,15 @@ static const F4SESerializationInterface	g_F4SESerializationInterface =
 	Serialization::GetNextRecordInfo,
 	Serialization::ReadRecordData,
 	Serialization::ResolveHandle,
-	Serialization::ResolveFormId
+	Serialization::ResolveFormId,
+
+	Serialization::ReadRecordDataSpan,
+	Serialization::FindRecord,
+
+	Serialization::SetThreadSafeLoadCallback,
+
+	Serialization::WriteStringRef,
+	Serialization::ReadStringRef
 };
 
 #include "Hooks_Threads.h"
@@ -82,7 +90,9 @@ static const F4SETaskInterface	g_F4SETaskInterface =
 	F4SETaskInterface::kInterfaceVersion,
 
 	TaskInterface::AddTask,
-	TaskInterface::AddUITask
+	TaskInterface::AddUITask,
+	TaskInterface::AddTaskFunction,
+	TaskInterface::AddUITaskFunction
 };
 
 #include "f4se/PapyrusDelayFunctors.h"
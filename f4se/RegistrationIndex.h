@@ -0,0 +1,266 @@
+#pragma once
+
+#include "f4se/GameTypes.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Keyed event registrations for RegistrationMapHolder.
+// Each key's registrations are a sorted vector in an open-addressed (linear probing) table. Writers edit their own
+// copy of the table and Publish it as an immutable snapshot; dispatch reads the latest snapshot without the writer lock,
+// and a snapshot stays valid for as long as a reader holds it. Key lists are shared between snapshots and copied on write.
+// A handle -> keys index lets RemoveAll visit only the keys a handle is registered for.
+// R needs a UInt64 handle and operator<. Everything except ForEach and GetSnapshot is writer side and needs external locking.
+
+inline UInt32 RegistrationKeyHash(UInt32 key)
+{
+	key ^= key >> 16;
+	key *= 0x7FEB352D;
+	key ^= key >> 15;
+	key *= 0x846CA68B;
+	key ^= key >> 16;
+	return key;
+}
+
+// the string cache interns, equal strings share an entry
+inline UInt32 RegistrationKeyHash(const BSFixedString & key)
+{
+	UInt64 entry = (UInt64)key.data;
+	return RegistrationKeyHash((UInt32)(entry ^ (entry >> 32)));
+}
+
+template <typename K, typename R>
+class RegistrationIndex
+{
+public:
+	typedef std::vector<R>	RegList;
+
+	class Table
+	{
+	public:
+		Table() : m_numKeys(0) { }
+
+		const RegList * Find(const K & key) const
+		{
+			if (m_slots.empty())
+				return NULL;
+
+			UInt32 mask = m_slots.size() - 1;
+			for (UInt32 i = RegistrationKeyHash(key) & mask; m_slots[i].regs; i = (i + 1) & mask)
+				if (m_slots[i].key == key)
+					return m_slots[i].regs.get();
+
+			return NULL;
+		}
+
+		// f(key, regs) for every key, in table order
+		template <typename F>
+		void ForEach(F & functor) const
+		{
+			for (auto & slot : m_slots)
+				if (slot.regs)
+					functor(slot.key, *slot.regs);
+		}
+
+		UInt32 NumKeys(void) const { return m_numKeys; }
+
+	private:
+		friend class RegistrationIndex;
+
+		struct Slot
+		{
+			K							key;
+			std::shared_ptr<RegList>	regs;	// null for an empty slot, never empty otherwise
+		};
+
+		UInt32 FindSlot(const K & key) const
+		{
+			UInt32 mask = m_slots.size() - 1;
+			UInt32 i = RegistrationKeyHash(key) & mask;
+
+			while (m_slots[i].regs && !(m_slots[i].key == key))
+				i = (i + 1) & mask;
+
+			return i;
+		}
+
+		void Grow(void)
+		{
+			std::vector<Slot> old;
+			old.swap(m_slots);
+			m_slots.resize(old.empty() ? 16 : old.size() * 2);
+
+			for (auto & slot : old)
+				if (slot.regs)
+					m_slots[FindSlot(slot.key)] = std::move(slot);
+		}
+
+		// backward shift, so lookups never need tombstones
+		void RemoveSlot(UInt32 hole)
+		{
+			UInt32 mask = m_slots.size() - 1;
+
+			m_slots[hole].regs.reset();
+			m_numKeys--;
+
+			for (UInt32 i = (hole + 1) & mask; m_slots[i].regs; i = (i + 1) & mask)
+			{
+				UInt32 home = RegistrationKeyHash(m_slots[i].key) & mask;
+
+				// can the entry at i move back to the hole without passing its home slot
+				if (((i - home) & mask) >= ((i - hole) & mask))
+				{
+					m_slots[hole] = std::move(m_slots[i]);
+					m_slots[i].regs.reset();
+					hole = i;
+				}
+			}
+		}
+
+		std::vector<Slot>	m_slots;	// power of two, at most half full
+		UInt32				m_numKeys;
+	};
+
+	typedef std::shared_ptr<const Table>	Snapshot;
+
+	RegistrationIndex() : m_snapshot(std::make_shared<const Table>()) { }
+
+	// returns false if the registration was already there
+	bool Insert(const K & key, const R & reg)
+	{
+		if ((m_table.m_numKeys + 1) * 2 > m_table.m_slots.size())
+			m_table.Grow();
+
+		UInt32 i = m_table.FindSlot(key);
+		auto & slot = m_table.m_slots[i];
+
+		if (!slot.regs)
+		{
+			slot.key = key;
+			slot.regs = std::make_shared<RegList>(1, reg);
+			m_table.m_numKeys++;
+		}
+		else
+		{
+			typename RegList::const_iterator pos = std::lower_bound(slot.regs->begin(), slot.regs->end(), reg);
+			if (pos != slot.regs->end() && !(reg < *pos))
+				return false;
+
+			auto regs = std::make_shared<RegList>();
+			regs->reserve(slot.regs->size() + 1);
+			regs->insert(regs->end(), slot.regs->cbegin(), pos);
+			regs->push_back(reg);
+			regs->insert(regs->end(), pos, slot.regs->cend());
+			slot.regs = std::move(regs);
+		}
+
+		std::vector<K> & keys = m_handleKeys[reg.handle];
+		if (std::find(keys.begin(), keys.end(), key) == keys.end())
+			keys.push_back(key);
+
+		return true;
+	}
+
+	// returns false if the registration wasn't there
+	bool Erase(const K & key, const R & reg)
+	{
+		if (m_table.m_slots.empty())
+			return false;
+
+		UInt32 i = m_table.FindSlot(key);
+		auto & slot = m_table.m_slots[i];
+		if (!slot.regs)
+			return false;
+
+		typename RegList::const_iterator pos = std::lower_bound(slot.regs->begin(), slot.regs->end(), reg);
+		if (pos == slot.regs->end() || reg < *pos)
+			return false;
+
+		bool handleLeft = false;
+
+		if (slot.regs->size() == 1)
+		{
+			m_table.RemoveSlot(i);
+		}
+		else
+		{
+			auto regs = std::make_shared<RegList>();
+			regs->reserve(slot.regs->size() - 1);
+			regs->insert(regs->end(), slot.regs->cbegin(), pos);
+			regs->insert(regs->end(), pos + 1, slot.regs->cend());
+
+			for (auto & other : *regs)
+				if (other.handle == reg.handle)
+					handleLeft = true;
+
+			slot.regs = std::move(regs);
+		}
+
+		if (!handleLeft)
+		{
+			auto keys = m_handleKeys.find(reg.handle);
+			if (keys != m_handleKeys.end())
+			{
+				keys->second.erase(std::find(keys->second.begin(), keys->second.end(), key));
+				if (keys->second.empty())
+					m_handleKeys.erase(keys);
+			}
+		}
+
+		return true;
+	}
+
+	// erases reg from every key the handle is registered for, returns how many were erased
+	UInt32 EraseAll(const R & reg)
+	{
+		auto keys = m_handleKeys.find(reg.handle);
+		if (keys == m_handleKeys.end())
+			return 0;
+
+		// Erase edits the index entry
+		std::vector<K> handleKeys = keys->second;
+
+		UInt32 numErased = 0;
+		for (auto & key : handleKeys)
+			if (Erase(key, reg))
+				numErased++;
+
+		return numErased;
+	}
+
+	void Clear(void)
+	{
+		m_table = Table();
+		m_handleKeys.clear();
+	}
+
+	// makes the writer's edits visible to readers
+	void Publish(void)
+	{
+		std::atomic_store(&m_snapshot, Snapshot(std::make_shared<const Table>(m_table)));
+	}
+
+	// any thread, without the writer lock
+	Snapshot GetSnapshot(void) const
+	{
+		return std::atomic_load(&m_snapshot);
+	}
+
+	template <typename F>
+	void ForEach(const K & key, F & functor) const
+	{
+		Snapshot table = GetSnapshot();
+
+		const RegList * regs = table->Find(key);
+		if (regs)
+			for (auto & reg : *regs)
+				functor(reg);
+	}
+
+private:
+	Table								m_table;		// writer's copy
+	Snapshot							m_snapshot;		// readers'
+	std::map<UInt64, std::vector<K>>	m_handleKeys;
+};
@@ -1,16 +1,21 @@
 #include "f4se/Serialization.h"
 #include "common/IFileStream.h"
+#include "common/ICriticalSection.h"
 #include "f4se/PluginManager.h"
 #include "f4se/GameAPI.h"
 #include "f4se_common/f4se_version.h"
+#include "f4se_common/Utilities.h"
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <shlobj.h>
-#include <io.h>
 #include "f4se/GameData.h"
 #include "f4se/InternalSerialization.h"
 #include "f4se/GameSettings.h"
 #include "f4se/ScaleformCallbacks.h"
 #include "f4se/ScaleformValue.h"
+#include "f4se/SerializationCompression.h"
 
 namespace Serialization
 {
@@ -23,13 +28,26 @@ namespace Serialization
 	//		PluginHeader	plugin[header.numPlugins]
 	//			ChunkHeader		chunk[plugin.numChunks]
 	//				UInt8			data[chunk.length]
+	//
+	//	format version 2 replaces PluginHeader with CompressedPluginHeader, the
+	//	ChunkHeader/data block following it is LZ4 block-compressed
+	//
+	//	plugins that use WriteStringRef get one more chunk after their own:
+	//	ChunkHeader		type = kStringTableType, version = kStringTableVersion
+	//		varint			numStrings
+	//			varint			length
+	//			char			str[length + 1]		terminated, loading hands out pointers in to it
+	//	references in the plugin's records are varint indices in to it
 
 	struct Header
 	{
 		enum
 		{
 			kSignature =		MACRO_SWAP32('F4SE'),	// endian-swapping so the order matches
-			kVersion =			1,
+			kVersion =			2,
+
+			kVersion_Uncompressed =	1,
+			kVersion_Compressed =	2,
 
 			kVersion_Invalid =	0
 		};
@@ -48,6 +66,14 @@ namespace Serialization
 		UInt32	length;		// length of following data including ChunkHeader
 	};
 
+	struct CompressedPluginHeader
+	{
+		UInt32	signature;
+		UInt32	numChunks;
+		UInt32	length;		// length of the stored block
+		UInt32	rawLength;	// length of the block after decompression, block is stored uncompressed if equal to length
+	};
+
 	struct ChunkHeader
 	{
 		UInt32	type;
@@ -55,10 +81,146 @@ namespace Serialization
 		UInt32	length;
 	};
 
+	enum
+	{
+		kStringTableVersion =	1,
+
+		kMaxVarIntLength =		5,
+	};
+
+	// LEB128, seven bits a byte low first
+	static UInt32 EncodeVarInt(UInt32 value, UInt8 * buf)
+	{
+		UInt32	length = 0;
+
+		while(value >= 0x80)
+		{
+			buf[length++] = (UInt8)(value | 0x80);
+			value >>= 7;
+		}
+
+		buf[length++] = (UInt8)value;
+
+		return length;
+	}
+
+	static bool DecodeVarInt(const UInt8 * data, UInt32 length, UInt32 * offset, UInt32 * valueOut)
+	{
+		UInt32	value = 0;
+
+		for(UInt32 shift = 0; shift < kMaxVarIntLength * 7; shift += 7)
+		{
+			if(*offset >= length)
+				return false;
+
+			UInt8	byte = data[(*offset)++];
+
+			value |= (UInt32)(byte & 0x7F) << shift;
+
+			if(!(byte & 0x80))
+			{
+				*valueOut = value;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// the strings the plugin currently saving has referenced, already laid out the way the table record stores them
+	class SaveStringTable
+	{
+	public:
+		void Clear(void)
+		{
+			m_data.clear();
+			m_entries.clear();
+
+			std::fill(m_slots.begin(), m_slots.end(), 0);
+		}
+
+		// index of the string, added if it's new
+		UInt32 Add(const char * str, UInt32 length)
+		{
+			if((m_entries.size() + 1) * 2 > m_slots.size())
+				Grow();
+
+			UInt32	hash = Hash(str, length);
+			UInt32	mask = m_slots.size() - 1;
+
+			for(UInt32 i = hash & mask; ; i = (i + 1) & mask)
+			{
+				UInt32	slot = m_slots[i];
+
+				if(!slot)
+				{
+					UInt8	buf[kMaxVarIntLength];
+					m_data.insert(m_data.end(), buf, buf + EncodeVarInt(length, buf));
+
+					Entry	entry = { hash, (UInt32)m_data.size(), length };
+
+					m_data.insert(m_data.end(), (const UInt8 *)str, (const UInt8 *)str + length);
+					m_data.push_back(0);
+
+					m_entries.push_back(entry);
+					m_slots[i] = m_entries.size();
+
+					return m_entries.size() - 1;
+				}
+
+				const Entry	& entry = m_entries[slot - 1];
+
+				if(entry.hash == hash && entry.length == length && !memcmp(&m_data[entry.offset], str, length))
+					return slot - 1;
+			}
+		}
+
+		UInt32	GetNumStrings(void) const				{ return m_entries.size(); }
+		const std::vector <UInt8> &	GetData(void) const	{ return m_data; }
+
+	private:
+		struct Entry
+		{
+			UInt32	hash;
+			UInt32	offset;	// of the string in m_data
+			UInt32	length;
+		};
+
+		static UInt32 Hash(const char * str, UInt32 length)
+		{
+			UInt32	hash = 2166136261u;
+
+			for(UInt32 i = 0; i < length; i++)
+				hash = (hash ^ (UInt8)str[i]) * 16777619u;
+
+			return hash;
+		}
+
+		void Grow(void)
+		{
+			UInt32	numSlots = m_slots.empty() ? 256 : m_slots.size() * 2;
+			UInt32	mask = numSlots - 1;
+
+			m_slots.assign(numSlots, 0);
+
+			for(UInt32 i = 0; i < m_entries.size(); i++)
+			{
+				UInt32	j = m_entries[i].hash & mask;
+				while(m_slots[j])
+					j = (j + 1) & mask;
+
+				m_slots[j] = i + 1;
+			}
+		}
+
+		std::vector <UInt8>		m_data;
+		std::vector <Entry>		m_entries;
+		std::vector <UInt32>	m_slots;	// entry index + 1, 0 if empty
+	};
+
 	// locals
 
 	std::string		s_savePath;
-	IFileStream		s_currentFile;
 
 	typedef std::vector <PluginCallbacks>	PluginCallbackList;
 	PluginCallbackList	s_pluginCallbacks;
@@ -67,15 +229,119 @@ namespace Serialization
 
 	Header			s_fileHeader = { 0 };
 
-	UInt64			s_pluginHeaderOffset = 0;
 	PluginHeader	s_pluginHeader = { 0 };
 
 	bool			s_chunkOpen = false;
 	UInt64			s_chunkHeaderOffset = 0;
 	ChunkHeader		s_chunkHeader = { 0 };
 
+	// the whole co-save is staged here during save and written out in one pass
+	std::vector <UInt8>	s_saveBuffer;
+
+	// uncompressed chunks for the plugin currently saving, s_chunkHeaderOffset is relative to this
+	std::vector <UInt8>	s_pluginBuffer;
+
+	SaveStringTable	s_saveStrings;
+
+	bool			s_compressSave = true;
+
+	// finished co-saves are handed off to a background thread that writes them out
+	// the save hook waits for it once the game has finished its own save
+	bool			s_asyncSave = true;
+	HANDLE			s_flushThread = NULL;	// guarded by s_flushLock
+	ICriticalSection	s_flushLock;
+	std::string		s_flushPath;
+	std::vector <UInt8>	s_flushBuffer;
+
+	// how the last write went, the flush thread doesn't log so the waiting thread reports it
+	enum
+	{
+		kWrite_OK = 0,
+		kWrite_CreateFailed,
+		kWrite_WriteFailed,
+	};
+
+	UInt32			s_flushStatus = kWrite_OK;
+	DWORD			s_flushError = 0;
+
+	enum
+	{
+		kSaveBuffer_InitialSize =	1024 * 1024,
+		kSaveBuffer_WriteBlock =	4 * 1024 * 1024,
+	};
+
+	// during load the whole co-save is mapped and indexed once, plugins then read straight out of the view
+
+	struct ChunkIndexEntry
+	{
+		UInt32	type;
+		UInt32	version;
+		UInt32	length;
+		const UInt8	* data;
+	};
+
+	struct PluginIndexEntry
+	{
+		UInt32	uid;
+		UInt32	firstChunk;	// index in to s_chunkIndex
+		UInt32	numChunks;
+		UInt32	firstString;	// index in to s_stringIndex
+		UInt32	numStrings;
+	};
+
+	struct StringIndexEntry
+	{
+		const char	* str;	// terminated, in the mapped file or s_loadBuffer
+		UInt32		length;
+	};
+
+	struct LoadCursor
+	{
+		const PluginIndexEntry	* plugin;
+		UInt32					nextChunk;	// relative to plugin->firstChunk
+
+		bool					chunkOpen;
+		const UInt8				* data;		// unread part of the open chunk
+		UInt32					remain;
+	};
+
+	HANDLE			s_loadFile = INVALID_HANDLE_VALUE;
+	HANDLE			s_loadMapping = NULL;
+	const UInt8		* s_loadBase = NULL;
+	UInt64			s_loadLength = 0;
+
+	// decompressed plugin blocks for format version 2
+	std::vector <UInt8>	s_loadBuffer;
+
+	typedef std::vector <PluginIndexEntry>	PluginIndex;
+	typedef std::vector <ChunkIndexEntry>	ChunkIndex;
+	PluginIndex		s_pluginIndex;
+	ChunkIndex		s_chunkIndex;
+	std::vector <StringIndexEntry>	s_stringIndex;
+
+	// each thread running a load callback has its own cursor
+	thread_local LoadCursor	s_loadCursor = { 0 };
+
+	enum
+	{
+		kMaxLoadWorkers =	8,
+	};
+
 	// utilities
 
+	void Init(void)
+	{
+		UInt32	compressSave = 1;
+		if(GetConfigOption_UInt32("Serialization", "bCompressCoSave", &compressSave))
+			s_compressSave = compressSave != 0;
+
+		UInt32	asyncSave = 1;
+		if(GetConfigOption_UInt32("Serialization", "bAsyncCoSave", &asyncSave))
+			s_asyncSave = asyncSave != 0;
+
+		_MESSAGE("co-save compression %s, background write %s", s_compressSave ? "enabled" : "disabled", s_asyncSave ? "enabled" : "disabled");
+	}
+
 	// make full path from save name
 	std::string MakeSavePath(std::string name, const char * extension)
 	{
@@ -139,7 +405,18 @@ namespace Serialization
 
 	void SetLoadCallback(PluginHandle plugin, F4SESerializationInterface::EventCallback callback)
 	{
-		GetPluginInfo(plugin)->load = callback;
+		PluginCallbacks	* info = GetPluginInfo(plugin);
+
+		info->load = callback;
+		info->threadSafeLoad = false;
+	}
+
+	void SetThreadSafeLoadCallback(PluginHandle plugin, F4SESerializationInterface::EventCallback callback)
+	{
+		PluginCallbacks	* info = GetPluginInfo(plugin);
+
+		info->load = callback;
+		info->threadSafeLoad = true;
 	}
 
 	void SetFormDeleteCallback(PluginHandle plugin, F4SESerializationInterface::FormDeleteCallback callback)
@@ -170,23 +447,190 @@ namespace Serialization
 		return WriteRecordData(buf, length);
 	}
 
-	// flush a chunk header to the file if one is currently open
+	// reserve space at the end of a staging buffer, returns the offset of the reserved block
+	static UInt64 ReserveSaveBuffer(std::vector <UInt8> & buffer, UInt64 length)
+	{
+		UInt64	offset = buffer.size();
+
+		buffer.resize(offset + length);
+
+		return offset;
+	}
+
+	// patch a header already reserved in a staging buffer
+	static void PatchSaveBuffer(std::vector <UInt8> & buffer, UInt64 offset, const void * buf, UInt64 length)
+	{
+		ASSERT(offset + length <= buffer.size());
+
+		memcpy(&buffer[offset], buf, length);
+	}
+
+	// move the finished plugin's chunks in to the save buffer, compressing them if enabled
+	static void FlushPluginBlock(void)
+	{
+		UInt32	rawLength = s_pluginBuffer.size();
+
+		if(s_compressSave)
+		{
+			CompressedPluginHeader	header;
+
+			header.signature = s_pluginHeader.signature;
+			header.numChunks = s_pluginHeader.numChunks;
+			header.rawLength = rawLength;
+
+			UInt64	headerOffset = ReserveSaveBuffer(s_saveBuffer, sizeof(header));
+			UInt64	dataOffset = ReserveSaveBuffer(s_saveBuffer, SerializationCompression::CompressBound(rawLength));
+
+			header.length = SerializationCompression::Compress(s_pluginBuffer.data(), rawLength, &s_saveBuffer[dataOffset]);
+
+			// store incompressible data as-is
+			if(header.length >= rawLength)
+			{
+				memcpy(&s_saveBuffer[dataOffset], s_pluginBuffer.data(), rawLength);
+				header.length = rawLength;
+			}
+
+			s_saveBuffer.resize(dataOffset + header.length);
+
+			PatchSaveBuffer(s_saveBuffer, headerOffset, &header, sizeof(header));
+		}
+		else
+		{
+			ASSERT(s_pluginHeader.length == rawLength);
+
+			const UInt8	* header = (const UInt8 *)&s_pluginHeader;
+
+			s_saveBuffer.insert(s_saveBuffer.end(), header, header + sizeof(s_pluginHeader));
+			s_saveBuffer.insert(s_saveBuffer.end(), s_pluginBuffer.begin(), s_pluginBuffer.end());
+		}
+	}
+
+	// write a staged co-save to a temp file in large sequential blocks, then move it over the real one
+	// a crash part way through leaves the previous co-save intact
+	// runs on the flush thread, so it returns a kWrite_ status and the error code instead of logging
+	static UInt32 WriteCoSaveFile(const std::string & path, const std::vector <UInt8> & buffer, DWORD * errorOut)
+	{
+		std::string	tempPath = path + ".tmp";
+
+		*errorOut = 0;
+
+		HANDLE	file = CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if(file == INVALID_HANDLE_VALUE)
+		{
+			*errorOut = GetLastError();
+			return kWrite_CreateFailed;
+		}
+
+		bool		result = true;
+		const UInt8	* data = buffer.data();
+		UInt64		remain = buffer.size();
+
+		while(remain && result)
+		{
+			DWORD	blockSize = (remain > kSaveBuffer_WriteBlock) ? kSaveBuffer_WriteBlock : (DWORD)remain;
+			DWORD	bytesWritten = 0;
+
+			result = WriteFile(file, data, blockSize, &bytesWritten, NULL) && (bytesWritten == blockSize);
+
+			data += blockSize;
+			remain -= blockSize;
+		}
+
+		if(result)
+			result = FlushFileBuffers(file) != 0;
+
+		CloseHandle(file);
+
+		if(result)
+			result = MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+
+		if(!result)
+		{
+			*errorOut = GetLastError();
+			DeleteFile(tempPath.c_str());
+
+			return kWrite_WriteFailed;
+		}
+
+		return kWrite_OK;
+	}
+
+	static void LogWriteStatus(UInt32 status, const std::string & path, DWORD error)
+	{
+		switch(status)
+		{
+			case kWrite_CreateFailed:
+				_ERROR("WriteCoSaveFile: couldn't create save file (%s.tmp) (%d)", path.c_str(), error);
+				break;
+
+			case kWrite_WriteFailed:
+				_ERROR("WriteCoSaveFile: couldn't write save file (%s) (%d)", path.c_str(), error);
+				break;
+		}
+	}
+
+	static DWORD WINAPI FlushThreadProc(void * param)
+	{
+		s_flushStatus = WriteCoSaveFile(s_flushPath, s_flushBuffer, &s_flushError);
+
+		return 0;
+	}
+
+	// completion barrier for the background co-save write, reports how it went
+	static void WaitForPendingFlush(void)
+	{
+		IScopedCriticalSection	lock(&s_flushLock);
+
+		if(s_flushThread)
+		{
+			WaitForSingleObject(s_flushThread, INFINITE);
+			CloseHandle(s_flushThread);
+
+			s_flushThread = NULL;
+
+			LogWriteStatus(s_flushStatus, s_flushPath, s_flushError);
+		}
+	}
+
+	static void FlushSaveBuffer(void)
+	{
+		if(s_asyncSave)
+		{
+			// the flush thread owns s_flushBuffer until it finishes, the old allocation comes back for the next save
+			s_flushPath = s_savePath;
+			s_flushBuffer.swap(s_saveBuffer);
+
+			IScopedCriticalSection	lock(&s_flushLock);
+
+			s_flushThread = CreateThread(NULL, 0, FlushThreadProc, NULL, 0, NULL);
+			if(s_flushThread)
+				return;
+
+			_WARNING("FlushSaveBuffer: couldn't start background write (%d)", GetLastError());
+
+			s_flushBuffer.swap(s_saveBuffer);
+		}
+
+		DWORD	error;
+		UInt32	status = WriteCoSaveFile(s_savePath, s_saveBuffer, &error);
+
+		LogWriteStatus(status, s_savePath, error);
+	}
+
+	// fill in the chunk header in the save buffer if one is currently open
 	static void FlushWriteChunk(void)
 	{
 		if(!s_chunkOpen)
 			return;
 
-		UInt64	curOffset = s_currentFile.GetOffset();
+		UInt64	curOffset = s_pluginBuffer.size();
 		UInt64	chunkSize = curOffset - s_chunkHeaderOffset - sizeof(s_chunkHeader);
 
 		ASSERT(chunkSize < 0x80000000);	// stupidity check
 
 		s_chunkHeader.length = (UInt32)chunkSize;
 
-		s_currentFile.SetOffset(s_chunkHeaderOffset);
-		s_currentFile.WriteBuf(&s_chunkHeader, sizeof(s_chunkHeader));
-
-		s_currentFile.SetOffset(curOffset);
+		PatchSaveBuffer(s_pluginBuffer, s_chunkHeaderOffset, &s_chunkHeader, sizeof(s_chunkHeader));
 
 		s_pluginHeader.length += chunkSize + sizeof(s_chunkHeader);
 
@@ -195,18 +639,9 @@ namespace Serialization
 
 	bool OpenRecord(UInt32 type, UInt32 version)
 	{
-		if(!s_pluginHeader.numChunks)
-		{
-			ASSERT(!s_chunkOpen);
-
-			s_pluginHeaderOffset = s_currentFile.GetOffset();
-			s_currentFile.Skip(sizeof(s_pluginHeader));
-		}
-
 		FlushWriteChunk();
 
-		s_chunkHeaderOffset = s_currentFile.GetOffset();
-		s_currentFile.Skip(sizeof(s_chunkHeader));
+		s_chunkHeaderOffset = ReserveSaveBuffer(s_pluginBuffer, sizeof(s_chunkHeader));
 
 		s_pluginHeader.numChunks++;
 
@@ -221,57 +656,157 @@ namespace Serialization
 
 	bool WriteRecordData(const void * buf, UInt32 length)
 	{
-		s_currentFile.WriteBuf(buf, length);
+		const UInt8	* data = (const UInt8 *)buf;
+
+		s_pluginBuffer.insert(s_pluginBuffer.end(), data, data + length);
 
 		return true;
 	}
 
-	static void FlushReadRecord(void)
+	// append the strings referenced by the plugin's records as its last chunk
+	static void WriteStringTable(void)
 	{
-		if(s_chunkOpen)
-		{
-			if(s_chunkHeader.length)
-			{
-				// _WARNING("plugin didn't finish reading chunk");
-				s_currentFile.Skip(s_chunkHeader.length);
-			}
+		UInt8	buf[kMaxVarIntLength];
 
-			s_chunkOpen = false;
-		}
+		OpenRecord(F4SESerializationInterface::kStringTableType, kStringTableVersion);
+
+		WriteRecordData(buf, EncodeVarInt(s_saveStrings.GetNumStrings(), buf));
+		WriteRecordData(s_saveStrings.GetData().data(), s_saveStrings.GetData().size());
+
+		FlushWriteChunk();
 	}
 
-	bool GetNextRecordInfo(UInt32 * type, UInt32 * version, UInt32 * length)
+	static void SetLoadCursor(const PluginIndexEntry * plugin)
+	{
+		s_loadCursor.plugin = plugin;
+		s_loadCursor.nextChunk = 0;
+		s_loadCursor.chunkOpen = false;
+		s_loadCursor.data = NULL;
+		s_loadCursor.remain = 0;
+	}
+
+	// a failed lookup leaves nothing to read, not the rest of the previous chunk
+	static void CloseLoadChunk(void)
 	{
-		FlushReadRecord();
+		s_loadCursor.chunkOpen = false;
+		s_loadCursor.data = NULL;
+		s_loadCursor.remain = 0;
+	}
 
-		if(!s_pluginHeader.numChunks)
-			return false;
+	static void OpenLoadChunk(UInt32 chunkIdx, UInt32 * type, UInt32 * version, UInt32 * length)
+	{
+		const ChunkIndexEntry	* chunk = &s_chunkIndex[s_loadCursor.plugin->firstChunk + chunkIdx];
 
-		s_pluginHeader.numChunks--;
+		s_loadCursor.nextChunk = chunkIdx + 1;
+		s_loadCursor.chunkOpen = true;
+		s_loadCursor.data = chunk->data;
+		s_loadCursor.remain = chunk->length;
 
-		s_currentFile.ReadBuf(&s_chunkHeader, sizeof(s_chunkHeader));
+		*type =		chunk->type;
+		*version =	chunk->version;
+		*length =	chunk->length;
+	}
 
-		*type =		s_chunkHeader.type;
-		*version =	s_chunkHeader.version;
-		*length =	s_chunkHeader.length;
+	bool GetNextRecordInfo(UInt32 * type, UInt32 * version, UInt32 * length)
+	{
+		// any unread data in the previous chunk is simply dropped
+		CloseLoadChunk();
 
-		s_chunkOpen = true;
+		if(!s_loadCursor.plugin || (s_loadCursor.nextChunk >= s_loadCursor.plugin->numChunks))
+			return false;
+
+		OpenLoadChunk(s_loadCursor.nextChunk, type, version, length);
 
 		return true;
 	}
 
 	UInt32 ReadRecordData(void * buf, UInt32 length)
 	{
-		ASSERT(s_chunkOpen);
+		UInt32			lengthOut = 0;
+		const void		* data = ReadRecordDataSpan(length, &lengthOut);
 
-		if(length > s_chunkHeader.length)
-			length = s_chunkHeader.length;
+		if(lengthOut)
+			memcpy(buf, data, lengthOut);
 
-		s_currentFile.ReadBuf(buf, length);
+		return lengthOut;
+	}
 
-		s_chunkHeader.length -= length;
+	const void * ReadRecordDataSpan(UInt32 length, UInt32 * lengthOut)
+	{
+		if(!s_loadCursor.chunkOpen)
+			length = 0;
+		else if(length > s_loadCursor.remain)
+			length = s_loadCursor.remain;
 
-		return length;
+		const void	* result = s_loadCursor.data;
+
+		s_loadCursor.data += length;
+		s_loadCursor.remain -= length;
+
+		if(lengthOut)
+			*lengthOut = length;
+
+		return result;
+	}
+
+	bool WriteStringRef(const char * str)
+	{
+		if(!str)
+			str = "";
+
+		UInt8	buf[kMaxVarIntLength];
+		UInt32	index = s_saveStrings.Add(str, strlen(str));
+
+		return WriteRecordData(buf, EncodeVarInt(index, buf));
+	}
+
+	const char * ReadStringRef(UInt32 * lengthOut)
+	{
+		if(lengthOut)
+			*lengthOut = 0;
+
+		UInt32	offset = 0;
+		UInt32	index;
+
+		if(!s_loadCursor.chunkOpen || !s_loadCursor.plugin || !DecodeVarInt(s_loadCursor.data, s_loadCursor.remain, &offset, &index))
+			return NULL;
+
+		s_loadCursor.data += offset;
+		s_loadCursor.remain -= offset;
+
+		if(index >= s_loadCursor.plugin->numStrings)
+			return NULL;
+
+		const StringIndexEntry	& entry = s_stringIndex[s_loadCursor.plugin->firstString + index];
+
+		if(lengthOut)
+			*lengthOut = entry.length;
+
+		return entry.str;
+	}
+
+	bool FindRecord(UInt32 type, UInt32 * version, UInt32 * length)
+	{
+		CloseLoadChunk();
+
+		if(!s_loadCursor.plugin || !s_loadCursor.plugin->numChunks)
+			return false;
+
+		const ChunkIndexEntry	* chunks = &s_chunkIndex[s_loadCursor.plugin->firstChunk];
+
+		for(UInt32 i = 0; i < s_loadCursor.plugin->numChunks; i++)
+		{
+			if(chunks[i].type == type)
+			{
+				UInt32	typeOut;
+
+				OpenLoadChunk(i, &typeOut, version, length);
+
+				return true;
+			}
+		}
+
+		return false;
 	}
 
 	bool ResolveFormId(UInt32 formId, UInt32 * formIdOut)
@@ -334,6 +869,333 @@ namespace Serialization
 		return true;
 	}
 
+	static void UnmapLoadFile(void)
+	{
+		if(s_loadBase)
+		{
+			UnmapViewOfFile(s_loadBase);
+			s_loadBase = NULL;
+		}
+
+		if(s_loadMapping)
+		{
+			CloseHandle(s_loadMapping);
+			s_loadMapping = NULL;
+		}
+
+		if(s_loadFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(s_loadFile);
+			s_loadFile = INVALID_HANDLE_VALUE;
+		}
+
+		s_loadLength = 0;
+	}
+
+	// map the co-save in to memory for the duration of the load
+	static bool MapLoadFile(const char * path)
+	{
+		s_loadFile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if(s_loadFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER	fileSize;
+
+		if(GetFileSizeEx(s_loadFile, &fileSize) && fileSize.QuadPart)
+		{
+			s_loadLength = fileSize.QuadPart;
+
+			s_loadMapping = CreateFileMapping(s_loadFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if(s_loadMapping)
+			{
+				s_loadBase = (const UInt8 *)MapViewOfFile(s_loadMapping, FILE_MAP_READ, 0, 0, 0);
+				if(s_loadBase)
+					return true;
+
+				_ERROR("HandleLoadGame: couldn't map co-save (%d)", GetLastError());
+			}
+			else
+			{
+				_ERROR("HandleLoadGame: couldn't create co-save mapping (%d)", GetLastError());
+			}
+		}
+
+		UnmapLoadFile();
+
+		return false;
+	}
+
+	// pull the strings out of a plugin's string table record
+	static void IndexPluginStrings(PluginIndexEntry * plugin, const UInt8 * data, UInt32 length)
+	{
+		UInt32	offset = 0;
+		UInt32	numStrings = 0;
+
+		plugin->firstString = s_stringIndex.size();
+
+		if(DecodeVarInt(data, length, &offset, &numStrings))
+		{
+			for(UInt32 i = 0; i < numStrings; i++)
+			{
+				UInt32	strLength;
+
+				if(!DecodeVarInt(data, length, &offset, &strLength) || (strLength >= length - offset) || data[offset + strLength])
+				{
+					_WARNING("HandleLoadGame: string table for %08X is malformed (%d of %d strings)", plugin->uid, i, numStrings);
+					break;
+				}
+
+				StringIndexEntry	entry = { (const char *)data + offset, strLength };
+				s_stringIndex.push_back(entry);
+
+				offset += strLength + 1;
+			}
+		}
+
+		plugin->numStrings = s_stringIndex.size() - plugin->firstString;
+	}
+
+	// index the chunks in one plugin's (uncompressed) block
+	static void IndexPluginChunks(UInt32 uid, UInt32 numChunks, const UInt8 * data, UInt64 length)
+	{
+		PluginIndexEntry	pluginEntry;
+
+		pluginEntry.uid = uid;
+		pluginEntry.firstChunk = s_chunkIndex.size();
+		pluginEntry.numChunks = 0;
+		pluginEntry.firstString = s_stringIndex.size();
+		pluginEntry.numStrings = 0;
+
+		UInt64	offset = 0;
+
+		for(UInt32 i = 0; (i < numChunks) && (length - offset >= sizeof(ChunkHeader)); i++)
+		{
+			ChunkHeader	chunkHeader;
+
+			memcpy(&chunkHeader, data + offset, sizeof(chunkHeader));
+			offset += sizeof(chunkHeader);
+
+			if(chunkHeader.length > length - offset)
+			{
+				_WARNING("HandleLoadGame: chunk %08X for %08X is truncated", chunkHeader.type, uid);
+				chunkHeader.length = (UInt32)(length - offset);
+			}
+
+			ChunkIndexEntry	chunkEntry;
+
+			chunkEntry.type = chunkHeader.type;
+			chunkEntry.version = chunkHeader.version;
+			chunkEntry.length = chunkHeader.length;
+			chunkEntry.data = data + offset;
+
+			s_chunkIndex.push_back(chunkEntry);
+			pluginEntry.numChunks++;
+
+			offset += chunkHeader.length;
+		}
+
+		// the string table is always last, and is ours rather than the plugin's
+		if(pluginEntry.numChunks)
+		{
+			const ChunkIndexEntry	& lastChunk = s_chunkIndex.back();
+
+			if((lastChunk.type == F4SESerializationInterface::kStringTableType) && (lastChunk.version == kStringTableVersion))
+			{
+				IndexPluginStrings(&pluginEntry, lastChunk.data, lastChunk.length);
+
+				s_chunkIndex.pop_back();
+				pluginEntry.numChunks--;
+			}
+		}
+
+		s_pluginIndex.push_back(pluginEntry);
+	}
+
+	// format version 1, chunks are indexed directly in the mapped file
+	static void BuildUncompressedIndex(void)
+	{
+		UInt64	offset = sizeof(Header);
+
+		while(s_loadLength - offset >= sizeof(PluginHeader))
+		{
+			PluginHeader	pluginHeader;
+
+			memcpy(&pluginHeader, s_loadBase + offset, sizeof(pluginHeader));
+			offset += sizeof(pluginHeader);
+
+			UInt64	length = pluginHeader.length;
+			if(length > s_loadLength - offset)
+			{
+				_WARNING("HandleLoadGame: data for %08X is truncated (%016I64X bytes missing)", pluginHeader.signature, length - (s_loadLength - offset));
+				length = s_loadLength - offset;
+			}
+
+			IndexPluginChunks(pluginHeader.signature, pluginHeader.numChunks, s_loadBase + offset, length);
+
+			offset += length;
+		}
+	}
+
+	// format version 2, plugin blocks are decompressed in to s_loadBuffer and indexed there
+	static void BuildCompressedIndex(void)
+	{
+		struct PluginBlock
+		{
+			CompressedPluginHeader	header;
+			const UInt8				* data;
+		};
+
+		std::vector <PluginBlock>	blocks;
+		UInt64						totalRawLength = 0;
+
+		// collect the blocks first so the output buffer can be sized once
+		UInt64	offset = sizeof(Header);
+
+		while(s_loadLength - offset >= sizeof(CompressedPluginHeader))
+		{
+			PluginBlock	block;
+
+			memcpy(&block.header, s_loadBase + offset, sizeof(block.header));
+			offset += sizeof(block.header);
+
+			block.data = s_loadBase + offset;
+
+			if(block.header.length > s_loadLength - offset)
+			{
+				_WARNING("HandleLoadGame: data for %08X is truncated (%016I64X bytes missing)", block.header.signature, block.header.length - (s_loadLength - offset));
+				break;
+			}
+
+			offset += block.header.length;
+
+			if(block.header.length != block.header.rawLength)
+			{
+				// a corrupt length would otherwise size the buffer, the plugin is loaded without records
+				if(block.header.rawLength > SerializationCompression::DecompressBound(block.header.length))
+				{
+					_WARNING("HandleLoadGame: data for %08X can't decompress to %08X bytes from %08X", block.header.signature, block.header.rawLength, block.header.length);
+					block.data = NULL;
+				}
+				else
+				{
+					totalRawLength += block.header.rawLength;
+				}
+			}
+
+			blocks.push_back(block);
+		}
+
+		s_loadBuffer.resize(totalRawLength);
+
+		UInt8	* out = s_loadBuffer.data();
+
+		for(std::vector <PluginBlock>::iterator iter = blocks.begin(); iter != blocks.end(); ++iter)
+		{
+			const CompressedPluginHeader	& header = iter->header;
+
+			if(!iter->data)
+			{
+				IndexPluginChunks(header.signature, 0, NULL, 0);
+			}
+			else if(header.length == header.rawLength)
+			{
+				// stored uncompressed
+				IndexPluginChunks(header.signature, header.numChunks, iter->data, header.length);
+			}
+			else if(SerializationCompression::Decompress(iter->data, header.length, out, header.rawLength))
+			{
+				IndexPluginChunks(header.signature, header.numChunks, out, header.rawLength);
+
+				out += header.rawLength;
+			}
+			else
+			{
+				_ERROR("HandleLoadGame: couldn't decompress data for %08X", header.signature);
+
+				// plugin still gets its load callback, just without records
+				IndexPluginChunks(header.signature, 0, NULL, 0);
+			}
+		}
+	}
+
+	// validate the header and walk the plugin/chunk headers once to build the record index
+	static bool BuildLoadIndex(void)
+	{
+		s_pluginIndex.clear();
+		s_chunkIndex.clear();
+		s_stringIndex.clear();
+
+		Header	header;
+
+		if(s_loadLength < sizeof(header))
+		{
+			_ERROR("HandleLoadGame: file too small (%016I64X)", s_loadLength);
+			return false;
+		}
+
+		memcpy(&header, s_loadBase, sizeof(header));
+
+		if(header.signature != Header::kSignature)
+		{
+			_ERROR("HandleLoadGame: invalid file signature (found %08X expected %08X)", header.signature, Header::kSignature);
+			return false;
+		}
+
+		if(header.formatVersion <= Header::kVersion_Invalid)
+		{
+			_ERROR("HandleLoadGame: version invalid (%08X)", header.formatVersion);
+			return false;
+		}
+
+		if(header.formatVersion > Header::kVersion)
+		{
+			_ERROR("HandleLoadGame: version too new (found %08X current %08X)", header.formatVersion, Header::kVersion);
+			return false;
+		}
+
+		s_pluginIndex.reserve(header.numPlugins);
+
+		if(header.formatVersion == Header::kVersion_Uncompressed)
+			BuildUncompressedIndex();
+		else
+			BuildCompressedIndex();
+
+		return true;
+	}
+
+	struct PendingLoad
+	{
+		PluginCallbacks			* info;
+		const PluginIndexEntry	* data;
+		bool					failed;		// the callback threw, logged by the loading thread after the workers finish
+	};
+
+	typedef std::vector <PendingLoad>	PendingLoadList;
+
+	// run one plugin's load callback against its own cursor, may be called from a worker thread
+	// nothing here logs, the log isn't safe to write from the workers
+	static void RunLoadCallback(PendingLoad * load)
+	{
+		try
+		{
+			SetLoadCursor(load->data);
+			load->info->load(&g_F4SESerializationInterface);
+		}
+		catch( ... )
+		{
+			load->failed = true;
+		}
+
+		SetLoadCursor(NULL);
+	}
+
+	static void LogFailedLoads(const PendingLoadList & loads)
+	{
+		for(PendingLoadList::const_iterator iter = loads.begin(); iter != loads.end(); ++iter)
+			if(iter->failed)
+				_ERROR("HandleLoadGame: exception occurred loading %08X", iter->data->uid);
+	}
+
 	// internal event handlers
 	void HandleRevertGlobalData(void)
 	{
@@ -345,24 +1207,24 @@ namespace Serialization
 	void HandleSaveGlobalData(void)
 	{
 		_MESSAGE("creating co-save");
-		if(_access(s_savePath.c_str(), 0) == 0)
-			DeleteFile(s_savePath.c_str());
-		if(!s_currentFile.Create(s_savePath.c_str()))
-		{
-			_ERROR("HandleSaveGlobalData: couldn't create save file (%s)", s_savePath.c_str());
-			return;
-		}
+
+		// the previous write may still be using the buffers
+		WaitForPendingFlush();
 
 		try
 		{
 			// init header
 			s_fileHeader.signature =		Header::kSignature;
-			s_fileHeader.formatVersion =	Header::kVersion;
+			s_fileHeader.formatVersion =	s_compressSave ? Header::kVersion_Compressed : Header::kVersion_Uncompressed;
 			s_fileHeader.f4seVersion =		PACKED_F4SE_VERSION;
 			s_fileHeader.runtimeVersion =	RUNTIME_VERSION;
 			s_fileHeader.numPlugins =		0;
 
-			s_currentFile.Skip(sizeof(s_fileHeader));
+			// keep the allocation from the previous save around, only the contents are reset
+			s_saveBuffer.clear();
+			s_saveBuffer.reserve(kSaveBuffer_InitialSize);
+
+			ReserveSaveBuffer(s_saveBuffer, sizeof(s_fileHeader));
 
 			// iterate through plugins
 			for(UInt32 i = 0; i < s_pluginCallbacks.size(); i++)
@@ -378,6 +1240,9 @@ namespace Serialization
 					s_pluginHeader.numChunks = 0;
 					s_pluginHeader.length = 0;
 
+					s_pluginBuffer.clear();
+					s_saveStrings.Clear();
+
 					s_chunkOpen = false;
 
 					// call the plugin
@@ -387,90 +1252,66 @@ namespace Serialization
 					}
 					catch( ... )
 					{
-						_ERROR("HandleSaveGlobalData: exception occurred saving %08X at %016I64X data may be corrupt.", s_pluginHeader.signature, s_currentFile.GetOffset());
+						_ERROR("HandleSaveGlobalData: exception occurred saving %08X at %016I64X data may be corrupt.", s_pluginHeader.signature, (UInt64)s_pluginBuffer.size());
 					}
 
 					// flush the remaining chunk data
 					FlushWriteChunk();
 
+					if(s_saveStrings.GetNumStrings())
+						WriteStringTable();
+
 					if(s_pluginHeader.numChunks)
 					{
-						UInt64	curOffset = s_currentFile.GetOffset();
-
-						s_currentFile.SetOffset(s_pluginHeaderOffset);
-						s_currentFile.WriteBuf(&s_pluginHeader, sizeof(s_pluginHeader));
-
-						s_currentFile.SetOffset(curOffset);
+						FlushPluginBlock();
 
 						s_fileHeader.numPlugins++;
 					}
 				}
 			}
 
-			// write header
-			s_currentFile.SetOffset(0);
-			s_currentFile.WriteBuf(&s_fileHeader, sizeof(s_fileHeader));
+			// fill in the header and write everything out
+			PatchSaveBuffer(s_saveBuffer, 0, &s_fileHeader, sizeof(s_fileHeader));
+
+			FlushSaveBuffer();
 		}
 		catch(...)
 		{
 			_ERROR("HandleSaveGame: exception during save");
 		}
-
-		s_currentFile.Close();
 	}
 
 	void HandleLoadGlobalData(void)
 	{
 		_MESSAGE("loading co-save");
 
-		if(!s_currentFile.Open(s_savePath.c_str()))
+		WaitForPendingFlush();
+
+		if(!MapLoadFile(s_savePath.c_str()))
 		{
 			return;
 		}
 
 		try
 		{
-			Header	header;
-
-			s_currentFile.ReadBuf(&header, sizeof(header));
-
-			if(header.signature != Header::kSignature)
-			{
-				_ERROR("HandleLoadGame: invalid file signature (found %08X expected %08X)", header.signature, Header::kSignature);
-				goto done;
-			}
-
-			if(header.formatVersion <= Header::kVersion_Invalid)
-			{
-				_ERROR("HandleLoadGame: version invalid (%08X)", header.formatVersion);
-				goto done;
-			}
-
-			if(header.formatVersion > Header::kVersion)
-			{
-				_ERROR("HandleLoadGame: version too new (found %08X current %08X)", header.formatVersion, Header::kVersion);
-				goto done;
-			}
-
-			// reset flags
-			for(PluginCallbackList::iterator iter = s_pluginCallbacks.begin(); iter != s_pluginCallbacks.end(); ++iter)
-				iter->hadData = false;
-			
-			// iterate through plugin data chunks
-			while(s_currentFile.GetRemain() >= sizeof(PluginHeader))
+			if(BuildLoadIndex())
 			{
-				s_currentFile.ReadBuf(&s_pluginHeader, sizeof(s_pluginHeader));
+				// reset flags
+				for(PluginCallbackList::iterator iter = s_pluginCallbacks.begin(); iter != s_pluginCallbacks.end(); ++iter)
+					iter->hadData = false;
 
-				UInt64	pluginChunkStart = s_currentFile.GetOffset();
+				// match plugin data to loaded plugins
+				PendingLoadList	serialLoads;
+				PendingLoadList	parallelLoads;
 
-				UInt32	pluginIdx = kPluginHandle_Invalid;
+				for(PluginIndex::iterator pluginIter = s_pluginIndex.begin(); pluginIter != s_pluginIndex.end(); ++pluginIter)
+				{
+					UInt32	pluginIdx = kPluginHandle_Invalid;
 
-				for(PluginCallbackList::iterator iter = s_pluginCallbacks.begin(); iter != s_pluginCallbacks.end(); ++iter)
-					if(iter->hadUID && (iter->uid == s_pluginHeader.signature))
-						pluginIdx = iter - s_pluginCallbacks.begin();
+					for(PluginCallbackList::iterator iter = s_pluginCallbacks.begin(); iter != s_pluginCallbacks.end(); ++iter)
+						if(iter->hadUID && (iter->uid == pluginIter->uid))
+							pluginIdx = iter - s_pluginCallbacks.begin();
 
-				try
-				{
 					if(pluginIdx != kPluginHandle_Invalid)
 					{
 						PluginCallbacks	* info = &s_pluginCallbacks[pluginIdx];
@@ -479,33 +1320,64 @@ namespace Serialization
 
 						if(info->load)
 						{
-							s_chunkOpen = false;
-							info->load(&g_F4SESerializationInterface);
+							PendingLoad	load = { info, &(*pluginIter), false };
+
+							if(info->threadSafeLoad)
+								parallelLoads.push_back(load);
+							else
+								serialLoads.push_back(load);
 						}
 					}
 					else
 					{
-						_WARNING("HandleLoadGame: plugin with signature %08X not loaded", s_pluginHeader.signature);
+						_WARNING("HandleLoadGame: plugin with signature %08X not loaded", pluginIter->uid);
 					}
 				}
-				catch( ... )
-				{
-					_ERROR("HandleLoadGame: exception occurred loading %08X", s_pluginHeader.signature);
-				}
 
-				// if plugin failed to read all its data or threw exception, jump to the next chunk
-				UInt64	expectedOffset = pluginChunkStart + s_pluginHeader.length;
-				if(s_currentFile.GetOffset() != expectedOffset)
+				// thread-safe plugins are decoded on the worker pool while the rest run here in file order
+				std::vector <std::thread>	workers;
+				std::atomic <UInt32>		nextParallelLoad(0);
+
+				if(!parallelLoads.empty())
 				{
-					_WARNING("HandleLoadGame: plugin did not read all of its data (at %016I64X expected %016I64X)", s_currentFile.GetOffset(), expectedOffset);
-					s_currentFile.SetOffset(expectedOffset);
+					UInt32	numWorkers = std::thread::hardware_concurrency();
+					if(numWorkers > 1)
+						numWorkers--;
+					if(numWorkers > kMaxLoadWorkers)
+						numWorkers = kMaxLoadWorkers;
+					if(numWorkers > parallelLoads.size())
+						numWorkers = parallelLoads.size();
+					if(!numWorkers)
+						numWorkers = 1;
+
+					for(UInt32 i = 0; i < numWorkers; i++)
+					{
+						workers.emplace_back([&parallelLoads, &nextParallelLoad]()
+						{
+							UInt32	loadIdx;
+
+							while((loadIdx = nextParallelLoad++) < parallelLoads.size())
+								RunLoadCallback(&parallelLoads[loadIdx]);
+						});
+					}
 				}
-			}
 
-			// call load on plugins that had no data
-			for(PluginCallbackList::iterator iter = s_pluginCallbacks.begin(); iter != s_pluginCallbacks.end(); ++iter) {
-				if(!iter->hadData && iter->load) {
-					iter->load(&g_F4SESerializationInterface);
+				for(PendingLoadList::iterator iter = serialLoads.begin(); iter != serialLoads.end(); ++iter)
+					RunLoadCallback(&(*iter));
+
+				for(std::vector <std::thread>::iterator iter = workers.begin(); iter != workers.end(); ++iter)
+					iter->join();
+
+				LogFailedLoads(serialLoads);
+				LogFailedLoads(parallelLoads);
+
+				_MESSAGE("loaded co-save data for %d plugins (%d in parallel)", (UInt32)(serialLoads.size() + parallelLoads.size()), (UInt32)parallelLoads.size());
+
+				// call load on plugins that had no data
+				for(PluginCallbackList::iterator iter = s_pluginCallbacks.begin(); iter != s_pluginCallbacks.end(); ++iter) {
+					if(!iter->hadData && iter->load) {
+						iter->load(&g_F4SESerializationInterface);
+					}
 				}
 			}
 		}
@@ -516,8 +1388,18 @@ namespace Serialization
 			// ### this could be handled better, individually catch around each plugin so one plugin can't mess things up for everyone else
 		}
 
-	done:
-		s_currentFile.Close();
+		SetLoadCursor(NULL);
+
+		UnmapLoadFile();
+
+		s_loadBuffer.clear();
+		s_loadBuffer.shrink_to_fit();
+	}
+
+	void HandlePostSaveGame(void)
+	{
+		// the write overlapped the rest of the game's save, the co-save is on disk once the save is
+		WaitForPendingFlush();
 	}
 
 	void HandleDeleteSave(std::string saveName)
@@ -527,6 +1409,8 @@ namespace Serialization
 		savePath += ".fos";
 		coSavePath += ".f4se";
 
+		WaitForPendingFlush();
+
 		// Old save file really gone?
 		IFileStream	saveFile;
 		if (!saveFile.Open(savePath.c_str()))
@@ -553,6 +1437,9 @@ namespace Serialization
 		return WriteData<const char>(intfc, str->c_str());
 	}
 
+	// strings are read through here to terminate them, it keeps its allocation between calls
+	thread_local std::vector <char>	s_readStringBuffer;
+
 	template <>
 	bool ReadData<BSFixedString>(const F4SESerializationInterface * intfc, BSFixedString * str)
 	{
@@ -565,17 +1452,15 @@ namespace Serialization
 		if (len > SHRT_MAX)
 			return false;
 
-		char * buf = new char[len + 1];
-		buf[0] = 0;
+		s_readStringBuffer.resize(len + 1);
 
-		if (! intfc->ReadRecordData(buf, len)) {
-			delete [] buf;
+		char * buf = s_readStringBuffer.data();
+
+		if (! intfc->ReadRecordData(buf, len))
 			return false;
-		}
 		buf[len] = 0;
 
 		*str = BSFixedString(buf);
-		delete [] buf;
 		return true;
 	}
 
@@ -605,17 +1490,15 @@ namespace Serialization
 		if (len > SHRT_MAX)
 			return false;
 
-		char * buf = new char[len + 1];
-		buf[0] = 0;
+		s_readStringBuffer.resize(len + 1);
 
-		if (! intfc->ReadRecordData(buf, len)) {
-			delete [] buf;
+		char * buf = s_readStringBuffer.data();
+
+		if (! intfc->ReadRecordData(buf, len))
 			return false;
-		}
 		buf[len] = 0;
 
 		*str = std::string(buf);
-		delete [] buf;
 		return true;
 	}
 
@@ -633,4 +1516,21 @@ namespace Serialization
 			return false;
 		return true;
 	}
+
+	template <>
+	bool WriteDataRef<BSFixedString>(const F4SESerializationInterface * intfc, const BSFixedString * str)
+	{
+		return intfc->WriteStringRef(str->c_str());
+	}
+
+	template <>
+	bool ReadDataRef<BSFixedString>(const F4SESerializationInterface * intfc, BSFixedString * str)
+	{
+		const char * data = intfc->ReadStringRef(NULL);
+		if (! data)
+			return false;
+
+		*str = BSFixedString(data);
+		return true;
+	}
 }
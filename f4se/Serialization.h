@@ -18,7 +18,8 @@ namespace Serialization
 			,formDelete(NULL)
 			,uid(0)
 			,hadData(false)
-			,hadUID(false) { }
+			,hadUID(false)
+			,threadSafeLoad(false) { }
 
 		F4SESerializationInterface::EventCallback	revert;
 		F4SESerializationInterface::EventCallback	save;
@@ -29,13 +30,17 @@ namespace Serialization
 
 		bool	hadData;
 		bool	hadUID;
+		bool	threadSafeLoad;	// load callback may run on a worker thread
 	};
 
+	void	Init(void);
+
 	// plugin API
 	void	SetUniqueID(PluginHandle plugin, UInt32 uid);
 	void	SetRevertCallback(PluginHandle plugin, F4SESerializationInterface::EventCallback callback);
 	void	SetSaveCallback(PluginHandle plugin, F4SESerializationInterface::EventCallback callback);
 	void	SetLoadCallback(PluginHandle plugin, F4SESerializationInterface::EventCallback callback);
+	void	SetThreadSafeLoadCallback(PluginHandle plugin, F4SESerializationInterface::EventCallback callback);
 	void	SetFormDeleteCallback(PluginHandle plugin, F4SESerializationInterface::FormDeleteCallback callback);
 
 	void	SetSaveName(const char * name);
@@ -45,6 +50,11 @@ namespace Serialization
 
 	bool	GetNextRecordInfo(UInt32 * type, UInt32 * version, UInt32 * length);
 	UInt32	ReadRecordData(void * buf, UInt32 length);
+	const void *	ReadRecordDataSpan(UInt32 length, UInt32 * lengthOut);
+	bool	FindRecord(UInt32 type, UInt32 * version, UInt32 * length);
+
+	bool	WriteStringRef(const char * str);
+	const char *	ReadStringRef(UInt32 * lengthOut);
 
 	bool	ResolveFormId(UInt32 formId, UInt32 * formIdOut);
 	bool	ResolveHandle(UInt64 handle, UInt64 * handleOut);
@@ -53,6 +63,7 @@ namespace Serialization
 	void	HandleRevertGlobalData(void);
 	void	HandleSaveGlobalData(void);
 	void	HandleLoadGlobalData(void);
+	void	HandlePostSaveGame(void);
 
 	void	HandleDeleteSave(std::string saveName);
 	void	HandleDeletedForm(UInt64 handle);
@@ -79,6 +90,23 @@ namespace Serialization
 	// Note: Read would have to allocate somehow. You have to do that manually.
 	template <> bool WriteData<const char>(const F4SESerializationInterface * intfc, const char* data);
 
+	// WriteData/ReadData, except strings are written as references in to the plugin's string table
+	// a record written with these has to be read back with them, version your records accordingly
+	template <typename T>
+	bool WriteDataRef(const F4SESerializationInterface * intfc, const T * data)
+	{
+		return WriteData(intfc, data);
+	}
+
+	template <typename T>
+	bool ReadDataRef(const F4SESerializationInterface * intfc, T * data)
+	{
+		return ReadData(intfc, data);
+	}
+
+	template <> bool WriteDataRef<BSFixedString>(const F4SESerializationInterface * intfc, const BSFixedString * data);
+	template <> bool ReadDataRef<BSFixedString>(const F4SESerializationInterface * intfc, BSFixedString * data);
+
 	template <typename T>
 	bool SaveClassHelper(const F4SESerializationInterface* intfc, UInt32 type, T& instance)
 	{
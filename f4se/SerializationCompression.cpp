@@ -0,0 +1,225 @@
+#include "f4se/SerializationCompression.h"
+
+namespace SerializationCompression
+{
+	enum
+	{
+		kMinMatch =			4,
+		kLastLiterals =		5,		// the last 5 bytes of a block are always literals
+		kMatchFindLimit =	12,		// the last match must start at least 12 bytes before the end
+		kMaxOffset =		0xFFFF,
+
+		kHashLog =			12,
+		kHashSize =			1 << kHashLog,
+
+		kRunMask =			0x0F,
+		kSkipStrength =		6,
+	};
+
+	static inline UInt32 Read32(const UInt8 * p)
+	{
+		UInt32	result;
+
+		memcpy(&result, p, sizeof(result));
+
+		return result;
+	}
+
+	static inline UInt32 Hash(UInt32 sequence)
+	{
+		return (sequence * 2654435761U) >> (32 - kHashLog);
+	}
+
+	// writes the 255-byte continuation run for a length that didn't fit in the token
+	static inline UInt8 * WriteLength(UInt8 * op, UInt32 length)
+	{
+		for(; length >= 255; length -= 255)
+			*op++ = 255;
+
+		*op++ = (UInt8)length;
+
+		return op;
+	}
+
+	static inline UInt8 * WriteSequence(UInt8 * op, const UInt8 * literals, UInt32 literalLength, UInt32 offset, UInt32 matchLength, bool hasMatch)
+	{
+		UInt8	* token = op++;
+
+		*token = (literalLength >= kRunMask) ? (kRunMask << 4) : (literalLength << 4);
+		if(literalLength >= kRunMask)
+			op = WriteLength(op, literalLength - kRunMask);
+
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		if(hasMatch)
+		{
+			*op++ = offset & 0xFF;
+			*op++ = offset >> 8;
+
+			*token |= (matchLength >= kRunMask) ? kRunMask : matchLength;
+			if(matchLength >= kRunMask)
+				op = WriteLength(op, matchLength - kRunMask);
+		}
+
+		return op;
+	}
+
+	UInt32 CompressBound(UInt32 srcLength)
+	{
+		return srcLength + (srcLength / 255) + 16;
+	}
+
+	UInt64 DecompressBound(UInt32 srcLength)
+	{
+		return (UInt64)srcLength * 255 + 16;
+	}
+
+	UInt32 Compress(const void * src, UInt32 srcLength, void * dst)
+	{
+		const UInt8	* base = (const UInt8 *)src;
+		const UInt8	* ip = base;
+		const UInt8	* anchor = base;
+		const UInt8	* iend = base + srcLength;
+		UInt8		* op = (UInt8 *)dst;
+
+		if(srcLength > kMatchFindLimit)
+		{
+			const UInt8	* mflimit = iend - kMatchFindLimit;
+			const UInt8	* matchlimit = iend - kLastLiterals;
+
+			UInt32	hashTable[kHashSize];
+			memset(hashTable, 0, sizeof(hashTable));
+
+			ip++;
+
+			while(ip < mflimit)
+			{
+				UInt32			sequence = Read32(ip);
+				UInt32			h = Hash(sequence);
+				const UInt8		* ref = base + hashTable[h];
+
+				hashTable[h] = ip - base;
+
+				if((ref >= ip) || ((UInt32)(ip - ref) > kMaxOffset) || (Read32(ref) != sequence))
+				{
+					// step faster through data that isn't matching
+					ip += 1 + ((ip - anchor) >> kSkipStrength);
+					continue;
+				}
+
+				// extend backwards in to the pending literals
+				while((ip > anchor) && (ref > base) && (ip[-1] == ref[-1]))
+				{
+					ip--;
+					ref--;
+				}
+
+				// extend forwards
+				const UInt8	* matchEnd = ip + kMinMatch;
+				const UInt8	* refEnd = ref + kMinMatch;
+
+				while((matchEnd < matchlimit) && (*matchEnd == *refEnd))
+				{
+					matchEnd++;
+					refEnd++;
+				}
+
+				op = WriteSequence(op, anchor, ip - anchor, ip - ref, (matchEnd - ip) - kMinMatch, true);
+
+				ip = matchEnd;
+				anchor = ip;
+
+				if(ip < mflimit)
+					hashTable[Hash(Read32(ip - 2))] = (ip - 2) - base;
+			}
+		}
+
+		// trailing literals
+		op = WriteSequence(op, anchor, iend - anchor, 0, 0, false);
+
+		return op - (UInt8 *)dst;
+	}
+
+	// reads a 255-byte continuation run, returns false if it runs off the end of the input
+	static inline bool ReadLength(const UInt8 ** ip, const UInt8 * iend, UInt32 * length)
+	{
+		UInt8	data;
+
+		do
+		{
+			if(*ip >= iend)
+				return false;
+
+			data = *(*ip)++;
+			*length += data;
+		}
+		while(data == 255);
+
+		return true;
+	}
+
+	bool Decompress(const void * src, UInt32 srcLength, void * dst, UInt32 dstLength)
+	{
+		const UInt8	* ip = (const UInt8 *)src;
+		const UInt8	* iend = ip + srcLength;
+		UInt8		* op = (UInt8 *)dst;
+		UInt8		* oend = op + dstLength;
+
+		while(ip < iend)
+		{
+			UInt8	token = *ip++;
+
+			// literals
+			UInt32	literalLength = token >> 4;
+			if((literalLength == kRunMask) && !ReadLength(&ip, iend, &literalLength))
+				return false;
+
+			if((literalLength > (UInt32)(iend - ip)) || (literalLength > (UInt32)(oend - op)))
+				return false;
+
+			memcpy(op, ip, literalLength);
+			op += literalLength;
+			ip += literalLength;
+
+			// the last sequence has no match
+			if(ip >= iend)
+				break;
+
+			// match
+			if(iend - ip < 2)
+				return false;
+
+			UInt32	offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+
+			if(!offset || (offset > (UInt32)(op - (UInt8 *)dst)))
+				return false;
+
+			UInt32	matchLength = token & kRunMask;
+			if((matchLength == kRunMask) && !ReadLength(&ip, iend, &matchLength))
+				return false;
+
+			matchLength += kMinMatch;
+
+			if(matchLength > (UInt32)(oend - op))
+				return false;
+
+			const UInt8	* match = op - offset;
+
+			if(offset >= matchLength)
+			{
+				memcpy(op, match, matchLength);
+				op += matchLength;
+			}
+			else
+			{
+				// overlapping copy, repeats the last offset bytes
+				for(UInt32 i = 0; i < matchLength; i++)
+					*op++ = *match++;
+			}
+		}
+
+		return op == oend;
+	}
+}
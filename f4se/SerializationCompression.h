@@ -0,0 +1,19 @@
+#pragma once
+
+// LZ4 block format codec used for co-save plugin blocks
+// only the raw block format is implemented, there is no frame header or checksum
+
+namespace SerializationCompression
+{
+	// worst-case compressed size for srcLength bytes of input
+	UInt32	CompressBound(UInt32 srcLength);
+
+	// most that srcLength bytes of compressed input can decode to, a match gains at most 255 bytes per input byte
+	UInt64	DecompressBound(UInt32 srcLength);
+
+	// returns the compressed length, dst must hold at least CompressBound(srcLength) bytes
+	UInt32	Compress(const void * src, UInt32 srcLength, void * dst);
+
+	// returns true if src decoded to exactly dstLength bytes
+	bool	Decompress(const void * src, UInt32 srcLength, void * dst, UInt32 dstLength);
+}
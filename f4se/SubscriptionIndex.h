@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common/ITypes.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Event registrations bucketed by the filter keys they subscribe to (formIDs, or pairs of them packed in to a UInt64),
+// plus a bucket for registrations with no filter. Dispatch visits the unfiltered bucket and the buckets of the event's
+// keys, so listeners filtered on other forms cost nothing. Built in one go by IndexedRegistrationSetHolder, read only after.
+
+template <typename R>
+class SubscriptionIndex
+{
+public:
+	enum
+	{
+		kMaxEventKeys = 8
+	};
+
+	// forEachKey(f) calls f(key) for each of reg's filter keys, a registration with none goes in the unfiltered bucket
+	template <typename KeysFn>
+	void Add(const R & reg, KeysFn forEachKey)
+	{
+		UInt32	index = m_regs.size();
+		bool	filtered = false;
+
+		m_regs.push_back(reg);
+
+		forEachKey([&](UInt64 key)
+		{
+			std::vector<UInt32> & bucket = m_buckets[key];
+			if (bucket.empty() || bucket.back() != index)
+				bucket.push_back(index);
+
+			filtered = true;
+		});
+
+		if (!filtered)
+			m_unfiltered.push_back(index);
+	}
+
+	// f(reg) once for each registration that is unfiltered or subscribed to any of keys, in the order they were added
+	template <typename F>
+	void ForEachMatching(const UInt64 * keys, UInt32 numKeys, F & functor) const
+	{
+		const std::vector<UInt32>	* lists[kMaxEventKeys + 1];
+		UInt32						numLists = 0;
+
+		if (!m_unfiltered.empty())
+			lists[numLists++] = &m_unfiltered;
+
+		for (UInt32 i = 0; i < numKeys && i < kMaxEventKeys; i++)
+		{
+			bool repeated = false;
+			for (UInt32 j = 0; j < i; j++)
+				if (keys[j] == keys[i])
+					repeated = true;
+
+			if (repeated)
+				continue;
+
+			auto bucket = m_buckets.find(keys[i]);
+			if (bucket != m_buckets.end())
+				lists[numLists++] = &bucket->second;
+		}
+
+		if (numLists == 1)
+		{
+			for (UInt32 index : *lists[0])
+				functor(m_regs[index]);
+			return;
+		}
+
+		// each list is ascending, merge them so a registration subscribed to several of the keys is only visited once
+		UInt32	pos[kMaxEventKeys + 1] = { 0 };
+
+		for (;;)
+		{
+			UInt32 next = 0xFFFFFFFF;
+			for (UInt32 i = 0; i < numLists; i++)
+				if (pos[i] < lists[i]->size() && (*lists[i])[pos[i]] < next)
+					next = (*lists[i])[pos[i]];
+
+			if (next == 0xFFFFFFFF)
+				break;
+
+			for (UInt32 i = 0; i < numLists; i++)
+				if (pos[i] < lists[i]->size() && (*lists[i])[pos[i]] == next)
+					pos[i]++;
+
+			functor(m_regs[next]);
+		}
+	}
+
+	UInt32 NumRegistrations(void) const	{ return m_regs.size(); }
+	UInt32 NumUnfiltered(void) const	{ return m_unfiltered.size(); }
+	UInt32 NumKeys(void) const			{ return m_buckets.size(); }
+
+private:
+	std::vector<R>										m_regs;
+	std::vector<UInt32>									m_unfiltered;
+	std::unordered_map<UInt64, std::vector<UInt32>>		m_buckets;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// move-only callable for F4SETaskInterface::AddTaskFunction
+// callables up to kInlineSize bytes are stored in place and the task queue moves them in to a pooled slot,
+// larger ones are allocated here and freed again by the module that created them
+class TaskFunction
+{
+public:
+	enum
+	{
+		kInlineSize =	48,
+		kInlineAlign =	16
+	};
+
+	struct Ops
+	{
+		void	(* invoke)(void * storage);
+		void	(* relocate)(void * dst, void * src);	// move constructs in dst and destroys src
+		void	(* destroy)(void * storage);
+		bool	isInline;
+	};
+
+	TaskFunction() : m_ops(nullptr) { }
+
+	template <typename F, typename = typename std::enable_if <!std::is_same <typename std::decay <F>::type, TaskFunction>::value>::type>
+	TaskFunction(F && func)
+	{
+		typedef typename std::decay <F>::type	Func;
+
+		Construct <Func>(std::forward <F>(func), std::integral_constant <bool, FitsInline <Func>::value>());
+	}
+
+	TaskFunction(TaskFunction && rhs) : m_ops(rhs.m_ops)
+	{
+		if(m_ops)
+		{
+			m_ops->relocate(&m_storage, &rhs.m_storage);
+			rhs.m_ops = nullptr;
+		}
+	}
+
+	TaskFunction & operator=(TaskFunction && rhs)
+	{
+		if(this != &rhs)
+		{
+			Reset();
+
+			m_ops = rhs.m_ops;
+			if(m_ops)
+			{
+				m_ops->relocate(&m_storage, &rhs.m_storage);
+				rhs.m_ops = nullptr;
+			}
+		}
+
+		return *this;
+	}
+
+	TaskFunction(const TaskFunction &) = delete;
+	TaskFunction & operator=(const TaskFunction &) = delete;
+
+	~TaskFunction()	{ Reset(); }
+
+	void	operator()()	{ m_ops->invoke(&m_storage); }
+
+	explicit operator bool() const	{ return m_ops != nullptr; }
+
+	bool	IsInline(void) const	{ return m_ops && m_ops->isInline; }
+
+	void	Reset(void)
+	{
+		if(m_ops)
+		{
+			m_ops->destroy(&m_storage);
+			m_ops = nullptr;
+		}
+	}
+
+private:
+	template <typename Func>
+	struct FitsInline
+	{
+		enum { value = sizeof(Func) <= kInlineSize && alignof(Func) <= kInlineAlign && std::is_nothrow_move_constructible <Func>::value };
+	};
+
+	template <typename Func>
+	struct InlineOps
+	{
+		static void Invoke(void * storage)				{ (*(Func *)storage)(); }
+		static void Relocate(void * dst, void * src)	{ new (dst) Func(std::move(*(Func *)src)); ((Func *)src)->~Func(); }
+		static void Destroy(void * storage)				{ ((Func *)storage)->~Func(); }
+
+		static const Ops * Get(void)
+		{
+			static const Ops	ops = { Invoke, Relocate, Destroy, true };
+			return &ops;
+		}
+	};
+
+	template <typename Func>
+	struct HeapOps
+	{
+		static void Invoke(void * storage)				{ (**(Func **)storage)(); }
+		static void Relocate(void * dst, void * src)	{ *(Func **)dst = *(Func **)src; }
+		static void Destroy(void * storage)				{ delete *(Func **)storage; }
+
+		static const Ops * Get(void)
+		{
+			static const Ops	ops = { Invoke, Relocate, Destroy, false };
+			return &ops;
+		}
+	};
+
+	template <typename Func, typename F>
+	void Construct(F && func, std::true_type)
+	{
+		new (&m_storage) Func(std::forward <F>(func));
+		m_ops = InlineOps <Func>::Get();
+	}
+
+	template <typename Func, typename F>
+	void Construct(F && func, std::false_type)
+	{
+		*(Func **)&m_storage = new Func(std::forward <F>(func));
+		m_ops = HeapOps <Func>::Get();
+	}
+
+	const Ops	* m_ops;
+	typename std::aligned_storage <kInlineSize, kInlineAlign>::type	m_storage;
+};
@@ -0,0 +1,239 @@
+#include "f4se/TaskQueue.h"
+#include "f4se/GameThreads.h"
+
+// node pool
+// released nodes go on a shared stack, a thread that runs out takes the whole stack in to its own cache with
+// one exchange, so nothing is ever popped from a shared list (no ABA) and acquiring is lock-free
+// nodes are only allocated a slab at a time, once the pool has grown to the peak queue depth pushing stops allocating
+
+enum
+{
+	kSlabSize =	256
+};
+
+std::atomic <TaskQueue::Node *>		TaskQueue::s_freeNodes(nullptr);
+thread_local TaskQueue::NodeCache	TaskQueue::s_nodeCache;
+
+static std::atomic <UInt32>		s_numSlabs(0);
+static std::atomic <UInt64>		s_numAcquired(0);
+static std::atomic <UInt64>		s_numHeapTasks(0);
+
+static UInt64 GetPerfCounter(void)
+{
+	LARGE_INTEGER	counter;
+	QueryPerformanceCounter(&counter);
+
+	return counter.QuadPart;
+}
+
+TaskQueue::TaskQueue()
+	:m_pushed(nullptr)
+	,m_running(false)
+	,m_pending(nullptr)
+	,m_pendingTail(&m_pending)
+	,m_maxTasks(0)
+	,m_maxTicks(0)
+	,m_numQueued(0)
+	,m_numRun(0)
+	,m_maxDepth(0)
+	,m_numDeferred(0)
+	,m_totalLatency(0)
+	,m_maxLatency(0)
+{
+	LARGE_INTEGER	frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	m_ticksPerMicrosecond = frequency.QuadPart / 1000000;
+	if(!m_ticksPerMicrosecond)
+		m_ticksPerMicrosecond = 1;
+}
+
+void TaskQueue::SetBudget(UInt32 maxTasks, UInt32 maxMicroseconds)
+{
+	m_maxTasks = maxTasks;
+	m_maxTicks = maxMicroseconds * m_ticksPerMicrosecond;
+}
+
+void TaskQueue::Push(ITaskDelegate * task)
+{
+	if(!task)
+		return;
+
+	Node	* node = AcquireNode();
+	node->task = TaskFunction([task]()
+	{
+		task->Run();
+		delete task;
+	});
+
+	PushNode(node);
+}
+
+void TaskQueue::Push(TaskFunction && task)
+{
+	// the pump would call through its null ops
+	if(!task)
+		return;
+
+	if(!task.IsInline())
+		s_numHeapTasks.fetch_add(1, std::memory_order_relaxed);
+
+	Node	* node = AcquireNode();
+	node->task = std::move(task);
+
+	PushNode(node);
+}
+
+void TaskQueue::PushNode(Node * node)
+{
+	node->queuedTime = GetPerfCounter();
+
+	// counted before it can be run, so depth never goes negative
+	m_numQueued.fetch_add(1, std::memory_order_relaxed);
+
+	Node	* head = m_pushed.load(std::memory_order_relaxed);
+	do
+	{
+		node->next = head;
+	}
+	while(!m_pushed.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+	UInt64	numRun = m_numRun.load(std::memory_order_relaxed);
+	UInt32	depth = m_numQueued.load(std::memory_order_relaxed) - numRun;
+	UInt32	maxDepth = m_maxDepth.load(std::memory_order_relaxed);
+
+	while(depth > maxDepth && !m_maxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+		;
+}
+
+// move everything pushed so far to the end of the pending list, in push order
+void TaskQueue::TakePushed(void)
+{
+	Node	* node = m_pushed.exchange(nullptr, std::memory_order_acquire);
+	if(!node)
+		return;
+
+	Node	* last = node;
+	Node	* reversed = nullptr;
+
+	while(node)
+	{
+		Node	* next = node->next;
+		node->next = reversed;
+		reversed = node;
+		node = next;
+	}
+
+	*m_pendingTail = reversed;
+	m_pendingTail = &last->next;
+}
+
+void TaskQueue::Run(void)
+{
+	if(m_running.exchange(true, std::memory_order_acquire))
+		return;
+
+	TakePushed();
+
+	UInt64	start = GetPerfCounter();
+	UInt32	numRun = 0;
+
+	while(m_pending)
+	{
+		UInt64	now = GetPerfCounter();
+
+		if(numRun && ((m_maxTasks && numRun >= m_maxTasks) || (m_maxTicks && now - start >= m_maxTicks)))
+		{
+			m_numDeferred.fetch_add(1, std::memory_order_relaxed);
+			break;
+		}
+
+		Node	* node = m_pending;
+		m_pending = node->next;
+		if(!m_pending)
+			m_pendingTail = &m_pending;
+
+		UInt64	latency = (now - node->queuedTime) / m_ticksPerMicrosecond;
+		m_totalLatency.fetch_add(latency, std::memory_order_relaxed);
+		if(latency > m_maxLatency.load(std::memory_order_relaxed))
+			m_maxLatency.store(latency, std::memory_order_relaxed);
+
+		node->task();
+		node->task.Reset();
+
+		ReleaseNodes(node, node);
+
+		m_numRun.fetch_add(1, std::memory_order_relaxed);
+		numRun++;
+	}
+
+	m_running.store(false, std::memory_order_release);
+}
+
+void TaskQueue::GetStats(Stats * stats) const
+{
+	stats->numRun = m_numRun.load(std::memory_order_relaxed);
+	stats->numQueued = m_numQueued.load(std::memory_order_relaxed);
+	stats->depth = stats->numQueued - stats->numRun;
+	stats->maxDepth = m_maxDepth.load(std::memory_order_relaxed);
+	stats->numDeferred = m_numDeferred.load(std::memory_order_relaxed);
+	stats->totalLatency = m_totalLatency.load(std::memory_order_relaxed);
+	stats->maxLatency = m_maxLatency.load(std::memory_order_relaxed);
+}
+
+TaskQueue::Node * TaskQueue::AcquireNode(void)
+{
+	s_numAcquired.fetch_add(1, std::memory_order_relaxed);
+
+	if(!s_nodeCache.head)
+		s_nodeCache.head = s_freeNodes.exchange(nullptr, std::memory_order_acquire);
+
+	if(!s_nodeCache.head)
+	{
+		Node	* slab = new Node[kSlabSize];
+		s_numSlabs.fetch_add(1, std::memory_order_relaxed);
+
+		for(UInt32 i = 1; i < kSlabSize - 1; i++)
+			slab[i].next = &slab[i + 1];
+		slab[kSlabSize - 1].next = nullptr;
+
+		s_nodeCache.head = &slab[1];
+
+		return &slab[0];
+	}
+
+	Node	* node = s_nodeCache.head;
+	s_nodeCache.head = node->next;
+
+	return node;
+}
+
+void TaskQueue::ReleaseNodes(Node * first, Node * last)
+{
+	Node	* head = s_freeNodes.load(std::memory_order_relaxed);
+	do
+	{
+		last->next = head;
+	}
+	while(!s_freeNodes.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+}
+
+TaskQueue::NodeCache::~NodeCache()
+{
+	if(!head)
+		return;
+
+	Node	* last = head;
+	while(last->next)
+		last = last->next;
+
+	ReleaseNodes(head, last);
+}
+
+void TaskQueue::GetPoolStats(PoolStats * stats)
+{
+	stats->numSlabs = s_numSlabs.load(std::memory_order_relaxed);
+	stats->numNodes = stats->numSlabs * kSlabSize;
+	stats->numAcquired = s_numAcquired.load(std::memory_order_relaxed);
+	stats->numHeapTasks = s_numHeapTasks.load(std::memory_order_relaxed);
+}
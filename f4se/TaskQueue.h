@@ -0,0 +1,93 @@
+#pragma once
+
+#include "f4se/TaskFunction.h"
+
+#include <atomic>
+
+class ITaskDelegate;
+
+// multi-producer, single-consumer task queue for the pump hooks in Hooks_Threads
+// producers push with one CAS and never wait, the pump takes everything queued with one exchange
+// the pump runs tasks in order until its budget is spent, whatever is left waits for the next pump
+// queue nodes come from a slab pool shared by every queue and are recycled once their task has run
+class TaskQueue
+{
+public:
+	struct Stats
+	{
+		UInt64	numQueued;
+		UInt64	numRun;
+		UInt32	depth;			// queued and not run yet
+		UInt32	maxDepth;
+		UInt32	numDeferred;	// pumps that ran out of budget with tasks left over
+		UInt64	totalLatency;	// microseconds from Push to Run, summed over numRun
+		UInt64	maxLatency;
+	};
+
+	struct PoolStats
+	{
+		UInt32	numSlabs;		// heap allocations made by the pool
+		UInt32	numNodes;		// nodes in those slabs
+		UInt64	numAcquired;
+		UInt64	numHeapTasks;	// TaskFunctions too large to be stored inline
+	};
+
+	TaskQueue();
+
+	// 0 means no limit, at least one task runs per pump either way
+	void	SetBudget(UInt32 maxTasks, UInt32 maxMicroseconds);
+
+	// any thread, a null or empty task isn't queued
+	void	Push(ITaskDelegate * task);		// run then deleted
+	void	Push(TaskFunction && task);		// moved in to the node, task is left empty
+
+	// consumer, a nested or concurrent call returns without running anything
+	void	Run(void);
+
+	void	GetStats(Stats * stats) const;
+
+	static void	GetPoolStats(PoolStats * stats);
+
+private:
+	struct Node
+	{
+		Node			* next;
+		UInt64			queuedTime;		// QueryPerformanceCounter
+		TaskFunction	task;
+	};
+
+	// thread's private run of free nodes, handed back to the pool when the thread exits
+	struct NodeCache
+	{
+		Node	* head = nullptr;
+
+		~NodeCache();
+	};
+
+	static Node *	AcquireNode(void);
+	static void		ReleaseNodes(Node * first, Node * last);
+
+	static std::atomic <Node *>	s_freeNodes;
+	static thread_local NodeCache	s_nodeCache;
+
+	void	PushNode(Node * node);
+	void	TakePushed(void);
+
+	std::atomic <Node *>	m_pushed;		// newest first
+	std::atomic <bool>		m_running;
+
+	// consumer only
+	Node		* m_pending;				// oldest first
+	Node		** m_pendingTail;
+
+	UInt32		m_maxTasks;
+	UInt64		m_maxTicks;
+	UInt64		m_ticksPerMicrosecond;
+
+	std::atomic <UInt64>	m_numQueued;
+	std::atomic <UInt64>	m_numRun;
+	std::atomic <UInt32>	m_maxDepth;
+	std::atomic <UInt32>	m_numDeferred;
+	std::atomic <UInt64>	m_totalLatency;
+	std::atomic <UInt64>	m_maxLatency;
+};
@@ -0,0 +1,200 @@
+#include "f4se/TimerWheel.h"
+
+#include <intrin.h>
+
+// level n slots are 256^n base slots wide, an entry goes in the lowest level its distance fits in
+// and is moved down a level (cascaded) when the level below wraps around to reach its slot
+
+TimerWheel::TimerWheel(SInt64 ticksPerSlot, SInt64 now)
+	:m_ticksPerSlot(ticksPerSlot > 0 ? ticksPerSlot : 1)
+{
+	Reset(now);
+}
+
+void TimerWheel::Reset(SInt64 now)
+{
+	m_base = now;
+	m_now = 0;
+
+	m_entries.clear();
+	m_freeEntries = kNone;
+	m_numEntries = 0;
+	m_numScheduled = 0;
+
+	m_due = kNone;
+	memset(m_slots, 0xFF, sizeof(m_slots));
+	memset(m_occupied, 0, sizeof(m_occupied));
+}
+
+// rounded up, so the slot is never reached before the deadline
+UInt64 TimerWheel::SlotOf(SInt64 deadline) const
+{
+	if(deadline <= m_base)
+		return 0;
+
+	return (deadline - m_base + m_ticksPerSlot - 1) / m_ticksPerSlot;
+}
+
+void TimerWheel::Insert(SInt64 deadline, IF4SEDelayFunctor * func)
+{
+	UInt32	index;
+
+	if(m_freeEntries != kNone)
+	{
+		index = m_freeEntries;
+		m_freeEntries = m_entries[index].next;
+	}
+	else
+	{
+		index = m_entries.size();
+		m_entries.emplace_back();
+	}
+
+	Entry	& entry = m_entries[index];
+	entry.deadline = deadline;
+	entry.func = func;
+
+	m_numEntries++;
+
+	Place(index);
+}
+
+void TimerWheel::Place(UInt32 index)
+{
+	Entry	& entry = m_entries[index];
+	UInt64	slot = SlotOf(entry.deadline);
+
+	if(slot <= m_now)
+	{
+		entry.next = m_due;
+		m_due = index;
+		return;
+	}
+
+	UInt64	delta = slot - m_now;
+	UInt32	level = 0;
+
+	while(level < kNumLevels - 1 && delta >= (1ULL << (kSlotBits * (level + 1))))
+		level++;
+
+	// further out than the top level reaches, park it in the last slot the top level gets to
+	// before wrapping and let the cascade place it again from there
+	if(delta >> (kSlotBits * kNumLevels))
+		slot = m_now + ((UInt64)kSlotMask << (kSlotBits * level));
+
+	UInt32	i = (slot >> (kSlotBits * level)) & kSlotMask;
+
+	entry.next = m_slots[level][i];
+	m_slots[level][i] = index;
+	m_occupied[level][i / 64] |= 1ULL << (i % 64);
+
+	m_numScheduled++;
+}
+
+UInt32 TimerWheel::TakeSlot(UInt32 level, UInt32 slot)
+{
+	UInt32	list = m_slots[level][slot];
+	if(list == kNone)
+		return kNone;
+
+	m_slots[level][slot] = kNone;
+	m_occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+
+	for(UInt32 index = list; index != kNone; index = m_entries[index].next)
+		m_numScheduled--;
+
+	return list;
+}
+
+// m_now has just wrapped level 0, bring the next slot of each level that wrapped down
+void TimerWheel::Cascade(void)
+{
+	for(UInt32 level = 1; level < kNumLevels; level++)
+	{
+		UInt32	slot = (m_now >> (kSlotBits * level)) & kSlotMask;
+		UInt32	index = TakeSlot(level, slot);
+
+		while(index != kNone)
+		{
+			UInt32	next = m_entries[index].next;
+			Place(index);
+			index = next;
+		}
+
+		if(slot)
+			break;
+	}
+}
+
+// first occupied level 0 slot at or after from, kNumSlots if there are none before the wrap
+UInt32 TimerWheel::NextOccupied(UInt32 from) const
+{
+	for(UInt32 word = from / 64; word < kWordsPerLevel; word++)
+	{
+		UInt64	bits = m_occupied[0][word];
+		if(word == from / 64)
+			bits &= ~0ULL << (from % 64);
+
+		unsigned long	bit;
+		if(_BitScanForward64(&bit, bits))
+			return word * 64 + bit;
+	}
+
+	return kNumSlots;
+}
+
+void TimerWheel::Expire(UInt32 list, std::vector <IF4SEDelayFunctor *> & expired)
+{
+	while(list != kNone)
+	{
+		Entry	& entry = m_entries[list];
+		UInt32	next = entry.next;
+
+		expired.push_back(entry.func);
+
+		entry.func = nullptr;
+		entry.next = m_freeEntries;
+		m_freeEntries = list;
+		m_numEntries--;
+
+		list = next;
+	}
+}
+
+void TimerWheel::Advance(SInt64 now, std::vector <IF4SEDelayFunctor *> & expired)
+{
+	Expire(m_due, expired);
+	m_due = kNone;
+
+	UInt64	target = now > m_base ? (now - m_base) / m_ticksPerSlot : 0;
+
+	while(m_now < target)
+	{
+		if(!m_numScheduled)
+		{
+			m_now = target;
+			break;
+		}
+
+		// step straight to the next occupied slot, stopping at the wrap for the cascade
+		UInt64	rotation = m_now & ~(UInt64)kSlotMask;
+		UInt32	current = m_now & kSlotMask;
+		UInt64	next = current == kSlotMask ? rotation + kNumSlots : rotation + NextOccupied(current + 1);
+
+		if(next > target)
+			next = target;
+
+		m_now = next;
+
+		if(!(m_now & kSlotMask))
+		{
+			Cascade();
+
+			// cascaded entries due right now
+			Expire(m_due, expired);
+			m_due = kNone;
+		}
+
+		Expire(TakeSlot(0, m_now & kSlotMask), expired);
+	}
+}
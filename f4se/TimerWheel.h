@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+
+class IF4SEDelayFunctor;
+
+// hierarchical timing wheel for F4SEDelayFunctorWaitList
+// entries are keyed on absolute deadlines in GetPerfCounter ticks and rounded up to whole slots,
+// so an entry never comes out early and at most one slot late
+// insert is O(1), Advance costs the entries that expire plus a cascade every 256 slots,
+// nothing is touched for entries that aren't due
+// not thread safe, the wait list buffers Add calls from other threads
+class TimerWheel
+{
+public:
+	TimerWheel(SInt64 ticksPerSlot, SInt64 now);
+
+	// drops every entry without freeing the functors, time starts again at now
+	void	Reset(SInt64 now);
+
+	void	Insert(SInt64 deadline, IF4SEDelayFunctor * func);
+
+	// appends everything due by now to expired, earliest slot first
+	void	Advance(SInt64 now, std::vector <IF4SEDelayFunctor *> & expired);
+
+	UInt32	Size(void) const	{ return m_numEntries; }
+
+	// f(deadline, func) for every entry, in no particular order
+	template <typename F>
+	void	ForEach(F f) const
+	{
+		ForEachIn(m_due, f);
+
+		for(UInt32 level = 0; level < kNumLevels; level++)
+			for(UInt32 slot = 0; slot < kNumSlots; slot++)
+				ForEachIn(m_slots[level][slot], f);
+	}
+
+private:
+	enum
+	{
+		kNumLevels =	4,
+		kSlotBits =		8,
+		kNumSlots =		1 << kSlotBits,
+		kSlotMask =		kNumSlots - 1,
+		kWordsPerLevel = kNumSlots / 64,
+
+		kNone =			0xFFFFFFFF
+	};
+
+	struct Entry
+	{
+		SInt64				deadline;
+		IF4SEDelayFunctor	* func;
+		UInt32				next;
+	};
+
+	template <typename F>
+	void	ForEachIn(UInt32 index, F & f) const
+	{
+		for(; index != kNone; index = m_entries[index].next)
+			f(m_entries[index].deadline, m_entries[index].func);
+	}
+
+	UInt64	SlotOf(SInt64 deadline) const;
+	void	Place(UInt32 index);
+	UInt32	TakeSlot(UInt32 level, UInt32 slot);
+	void	Cascade(void);
+	UInt32	NextOccupied(UInt32 from) const;
+	void	Expire(UInt32 list, std::vector <IF4SEDelayFunctor *> & expired);
+
+	SInt64	m_ticksPerSlot;
+	SInt64	m_base;				// tick time of slot 0
+	UInt64	m_now;				// slots since m_base
+
+	std::vector <Entry>	m_entries;
+	UInt32	m_freeEntries;
+	UInt32	m_numEntries;
+	UInt32	m_numScheduled;		// in m_slots, the rest are in m_due
+
+	UInt32	m_due;				// inserted with a deadline that has already passed
+	UInt32	m_slots[kNumLevels][kNumSlots];
+	UInt64	m_occupied[kNumLevels][kWordsPerLevel];
+};
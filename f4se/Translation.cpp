@@ -1,6 +1,7 @@
 #include "Translation.h"
 
 #include "common/IFileStream.h"
+#include "common/IBufferedReadStream.h"
 #include <shlobj.h>
 #include <string>
 #include "f4se/GameStreams.h"
@@ -90,10 +91,13 @@ namespace Translation
 		IFileStream modlistFile;
 		if(modlistFile.Open(modlistPath.c_str()))
 		{
-			while(!modlistFile.HitEOF())
+			// a line at a time from a block read, not a ReadFile per byte
+			IBufferedReadStream	modlist(&modlistFile, 4096);
+
+			while(!modlist.HitEOF())
 			{
 				char buf[512];
-				modlistFile.ReadString(buf, 512, '\n', '\r');
+				modlist.ReadLine(buf, 512);
 
 				// skip comments
 				if(buf[0] == '#' || buf[0] != '*')
@@ -18,6 +18,7 @@
 #include "Hooks_Camera.h"
 #include "PluginManager.h"
 #include "InternalSerialization.h"
+#include "Serialization.h"
 
 IDebugLog gLog;
 void * g_moduleHandle = nullptr;
@@ -41,6 +42,14 @@ void F4SE_Initialize(void)
 
 	gLog.OpenRelative(CSIDL_MYDOCUMENTS, "\\My Games\\Fallout4VR\\F4SE\\f4sevr.log");
 
+	// format and write the log on a background thread, off the game's threads
+	UInt32	asyncLog = 1;
+	GetConfigOption_UInt32("Logging", "bAsyncLog", &asyncLog);
+	gLog.SetAsync(asyncLog != 0);
+
+	// iLogLevel and iLogLevel_<module>
+	gLog.ReadModuleLevels(GetConfigPath().c_str(), "Logging");
+
 #ifndef _DEBUG
 	__try {
 #endif
@@ -97,6 +106,7 @@ void F4SE_Initialize(void)
 		Hooks_Threads_Commit();
 		Hooks_Camera_Commit();
 
+		Serialization::Init();
 		Init_CoreSerialization_Callbacks();
 
 		FlushInstructionCache(GetCurrentProcess(), NULL, 0);
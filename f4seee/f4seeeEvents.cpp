@@ -1,5 +1,6 @@
 #include "f4seeeEvents.h"
 #include "f4se/PapyrusUtilities.h"
+#include "f4se/PapyrusEventDispatch.h"
 
 #include "f4se/GameReferences.h"
 
@@ -40,21 +41,26 @@ void CellAttachDetachEvent_Dispatcher_Init()
 
 // 024 BasicEventHandler@GameScript@@
 
-RegistrationSetHolder<FormsPairParameters>							g_f4seeeTESActivateEventRegs;
+IndexedRegistrationSetHolder<FormsPairParameters>					g_f4seeeTESActivateEventRegs;
 
 f4seeeTESActivateEventSink g_f4seeeTESActivateEventSink;
 
+// registrations with no filter, or a filter on the pair, on either form alone, or on (none, none)
+static UInt32 FormsPairKeys(UInt64 * keys, Actor * const & actor, TESObjectREFR * const & ref)
+{
+	keys[0] = FormsPairParameters::FilterKey(actor, ref);
+	keys[1] = FormsPairParameters::FilterKey(nullptr, ref);
+	keys[2] = FormsPairParameters::FilterKey(actor, nullptr);
+	keys[3] = FormsPairParameters::FilterKey(nullptr, nullptr);
+	return 4;
+}
+
+static PapyrusEventDispatcher<FormsPairParameters, Actor*, TESObjectREFR*> s_TESActivateEvent(&g_f4seeeTESActivateEventRegs, "OnTESActivateEvent", FormsPairKeys);
+
 EventResult	f4seeeTESActivateEventSink::ReceiveEvent(TESActivateEvent * evn, void * dispatcher)
 {
 	_DMESSAGE("f4seee TESActivateEvent recieved: %s activated by %s", evn->activator->baseForm->GetFullName(), evn->actor->baseForm->GetFullName());
-	g_f4seeeTESActivateEventRegs.ForEach(
-		[&evn](const EventRegistration<FormsPairParameters> & reg)
-	{
-		if (reg.params.NoFilter() || reg.params.HasFilter(evn->actor, evn->activator) || reg.params.HasFilter(nullptr, evn->activator) || reg.params.HasFilter(evn->actor, nullptr) || reg.params.HasFilter(nullptr, nullptr))
-			SendPapyrusEvent2<Actor*, TESObjectREFR*>(reg.handle, reg.scriptName, "OnTESActivateEvent", evn->actor, evn->activator);
-
-	}
-	);
+	s_TESActivateEvent.Send(evn->actor, evn->activator);
 
 	return kEvent_Continue;
 }
@@ -71,21 +77,16 @@ void TESActivateEvent_Dispatcher_Init()
 
 // 025 BasicEventHandler@GameScript@@
 
-RegistrationSetHolder<FormsPairParameters>							g_f4seeeTESExitFurnitureEventRegs;
+IndexedRegistrationSetHolder<FormsPairParameters>					g_f4seeeTESExitFurnitureEventRegs;
 
 f4seeeTESExitFurnitureEventSink g_f4seeeTESExitFurnitureEventSink;
 
+static PapyrusEventDispatcher<FormsPairParameters, Actor*, TESObjectREFR*> s_TESExitFurnitureEvent(&g_f4seeeTESExitFurnitureEventRegs, "OnTESExitFurnitureEvent", FormsPairKeys);
+
 EventResult	f4seeeTESExitFurnitureEventSink::ReceiveEvent(TESExitFurnitureEvent * evn, void * dispatcher)
 {
 	_DMESSAGE("f4seee TESExitFurnitureEvent recieved");
-	g_f4seeeTESExitFurnitureEventRegs.ForEach(
-		[&evn](const EventRegistration<FormsPairParameters> & reg)
-	{
-		if (reg.params.NoFilter() || reg.params.HasFilter(evn->actor, evn->furniture) || reg.params.HasFilter(nullptr, evn->furniture) || reg.params.HasFilter(evn->actor, nullptr) || reg.params.HasFilter(nullptr, nullptr))
-			SendPapyrusEvent2<Actor*, TESObjectREFR*>(reg.handle, reg.scriptName, "OnTESExitFurnitureEvent", evn->actor, evn->furniture);
-
-	}
-	);
+	s_TESExitFurnitureEvent.Send(evn->actor, evn->furniture);
 
 	return kEvent_Continue;
 }
@@ -347,15 +348,12 @@ RegistrationSetHolder<NullParameters>							g_f4seeeLevelIncrease__EventRegs;
 
 f4seeeLevelIncrease__EventSink g_f4seeeLevelIncrease__EventSink;
 
+static PapyrusEventDispatcher<NullParameters, UInt32, float, UInt32> s_LevelIncrease__Event(&g_f4seeeLevelIncrease__EventRegs, "OnLevelIncrease__Event");
+
 EventResult	f4seeeLevelIncrease__EventSink::ReceiveEvent(LevelIncrease::Event * evn, void * dispatcher)
 {
 	_DMESSAGE("f4seee LevelIncrease__Event recieved");
-	g_f4seeeLevelIncrease__EventRegs.ForEach(
-		[&evn](const EventRegistration<NullParameters> & reg)
-	{
-			SendPapyrusEvent3<UInt32, float, UInt32>(reg.handle, reg.scriptName, "OnLevelIncrease__Event", evn->gainedLevel, evn->gainedExp, evn->fromLevel);
-	}
-	);
+	s_LevelIncrease__Event.Send(evn->gainedLevel, evn->gainedExp, evn->fromLevel);
 
 	return kEvent_Continue;
 }
@@ -692,4 +690,11 @@ void InitEvents()
 	TESEquipEvent_Dispatcher_Init();						// inv4
 
 
+}
+
+void InitEventCoalescing(void (* schedule)(TaskFunction * task))
+{
+	s_TESActivateEvent.InitCoalescing(schedule);			// 024
+	s_TESExitFurnitureEvent.InitCoalescing(schedule);		// 025
+	s_LevelIncrease__Event.InitCoalescing(schedule);		// x01
 }
\ No newline at end of file
@@ -215,6 +215,19 @@ public:
 		return pairs.size() == 0;
 	}
 
+	// IndexedRegistrationSetHolder keys, one per pair
+	template <typename F>
+	void ForEachFilterKey(F & functor) const
+	{
+		for (auto & pair : pairs)
+			functor(((UInt64)pair.first << 32) | pair.second);
+	}
+
+	static UInt64 FilterKey(TESForm * form1, TESForm * form2)
+	{
+		return ((UInt64)(form1 ? form1->formID : 0) << 32) | (form2 ? form2->formID : 0);
+	}
+
 	void Dump(void)
 	{
 		_MESSAGE("> formId:\t%08X", pairs.size());
@@ -287,7 +300,7 @@ void TESActivateEvent_Dispatcher_Init();
 
 DECLARE_EVENT_DISPATCHER_EX(TESActivateEvent, TESActivateEvent_Dispatcher_address);
 
-extern RegistrationSetHolder<FormsPairParameters>							g_f4seeeTESActivateEventRegs;
+extern IndexedRegistrationSetHolder<FormsPairParameters>					g_f4seeeTESActivateEventRegs;
 
 class f4seeeTESActivateEventSink : public BSTEventSink<TESActivateEvent>
 {
@@ -311,7 +324,7 @@ void TESExitFurnitureEvent_Dispatcher_Init();
 
 DECLARE_EVENT_DISPATCHER_EX(TESExitFurnitureEvent, TESExitFurnitureEvent_Dispatcher_address);
 
-extern RegistrationSetHolder<FormsPairParameters>							g_f4seeeTESExitFurnitureEventRegs;
+extern IndexedRegistrationSetHolder<FormsPairParameters>					g_f4seeeTESExitFurnitureEventRegs;
 
 class f4seeeTESExitFurnitureEventSink : public BSTEventSink<TESExitFurnitureEvent>
 {
@@ -1030,4 +1043,7 @@ struct PipboyValueChangedEvent
 
 };
 
-void InitEvents();
\ No newline at end of file
+void InitEvents();
+
+// schedule is F4SETaskInterface::AddTaskFunction, or null to always send straight away
+void InitEventCoalescing(void (* schedule)(TaskFunction * task));
\ No newline at end of file
@@ -27,23 +27,23 @@ namespace f4eeeSerialization
 			{
 			case 'E024':
 				_DMESSAGE("Loading g_f4seeeTESActivateEventRegs.");
-				g_f4seeeTESActivateEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+				g_f4seeeTESActivateEventRegs.Load(intfc, version);
 				break;
 			case 'E025':
 				_DMESSAGE("Loading g_f4seeeTESExitFurnitureEventRegs.");
-				g_f4seeeTESExitFurnitureEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+				g_f4seeeTESExitFurnitureEventRegs.Load(intfc, version);
 				break;
 			case 'E026':
 				_DMESSAGE("Loading g_f4seeeTESActiveEffectApplyRemoveEventRegs.");
-				g_f4seeeTESActiveEffectApplyRemoveEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+				g_f4seeeTESActiveEffectApplyRemoveEventRegs.Load(intfc, version);
 				break;
 			case 'E027':
 				_DMESSAGE("Loading g_f4seeeTESActorLocationChangeEventRegs.");
-				g_f4seeeTESActorLocationChangeEventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+				g_f4seeeTESActorLocationChangeEventRegs.Load(intfc, version);
 				break;
 			case 'Exx1':
 				_DMESSAGE("Loading g_f4seeeLevelIncrease__EventRegs.");
-				g_f4seeeLevelIncrease__EventRegs.Load(intfc, InternalEventVersion::kCurrentVersion);
+				g_f4seeeLevelIncrease__EventRegs.Load(intfc, version);
 				break;
 			}
 		}
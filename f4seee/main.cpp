@@ -16,6 +16,7 @@ F4SEScaleformInterface		*g_scaleform = NULL;
 F4SEPapyrusInterface		*g_papyrus = NULL;
 F4SEMessagingInterface		*g_messaging = NULL;
 F4SESerializationInterface	*g_serialization = NULL;
+F4SETaskInterface			*g_task = NULL;
 
 PluginHandle			    g_pluginHandle = kPluginHandle_Invalid;
 
@@ -160,6 +161,12 @@ extern "C"
 			return false;
 		}
 
+		// Get the task interface, only used to coalesce events
+		g_task = (F4SETaskInterface *)f4se->QueryInterface(kInterface_Task);
+		if (!g_task) {
+			_MESSAGE("couldn't get task interface");
+		}
+
 		return true;
 	}
 
@@ -174,6 +181,7 @@ extern "C"
 		g_serialization->SetLoadCallback(g_pluginHandle, f4eeeSerialization::LoadCallback);
 		g_serialization->SetSaveCallback(g_pluginHandle, f4eeeSerialization::SaveCallback);
 		InitEvents();
+		InitEventCoalescing(g_task && g_task->interfaceVersion >= 3 ? g_task->AddTaskFunction : NULL);
 		RVAManager::UpdateAddresses(f4se->runtimeVersion);
 		return true;
 	}
@@ -1,11 +1,502 @@
 #include "Pattern.h"
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <emmintrin.h>
+#include <immintrin.h>
 #include <intrin.h>
+#include <shlobj.h>
 
 static std::multimap<uint64_t, uintptr_t> g_hints;
 
+// pattern length by hash, so cached hints can be bounds checked before anything is compared at them
+static std::unordered_map<uint64_t, uint32_t> g_hintSizes;
+
+// patterns a completed scan found nothing for, so they aren't scanned for again
+static std::unordered_set<uint64_t> g_misses;
+
+// hints are persisted in the F4SE log folder so later launches can skip scanning
+static bool g_hintCacheLoaded = false;
+static bool g_hintCacheDirty = false;
+
+namespace {
+
+	const uint32_t kHintCacheSignature = 0x4E435353;	// 'SSCN'
+	const uint32_t kHintCacheVersion = 3;
+
+	struct HintCacheHeader {
+		uint32_t	signature;
+		uint32_t	version;
+		uint64_t	executableHash;
+		uint32_t	numEntries;
+		uint32_t	pad;
+	};
+
+	struct HintCacheEntry {
+		uint64_t	hash;
+		uint64_t	rva;
+		uint32_t	size;		// pattern length, the hint is only used for a pattern of this length and rva + size is within the code section
+		uint32_t	pad;
+	};
+
+	// scans are done in cache-sized blocks, every anchor byte is searched for in a block before moving on
+	const size_t kScanBlockSize = 64 * 1024;
+
+	struct CompiledPattern {
+		std::string				bytes;
+		std::string				mask;		// 0xFF for bytes that must match, 0x00 for wildcards
+		size_t					size;
+
+		size_t					anchorOffset;
+		uint8_t					anchorValue;
+		bool					hasAnchor;
+
+		uint64_t				hash;
+		int						maxCount;
+		std::vector<uintptr_t>	matches;
+	};
+
+	Utility::executable_meta & GetExecutable() {
+
+		static Utility::executable_meta executable;
+
+		executable.EnsureInit();
+
+		return executable;
+	}
+
+	bool HasAVX2() {
+
+		static int result = -1;
+
+		if ( result < 0 ) {
+
+			int cpuid[4];
+			__cpuid( cpuid, 0 );
+
+			result = 0;
+
+			if ( cpuid[0] >= 7 ) {
+
+				__cpuidex( cpuid, 1, 0 );
+
+				bool osxsave = ( cpuid[2] & ( 1 << 27 ) ) != 0;
+				bool avx = ( cpuid[2] & ( 1 << 28 ) ) != 0;
+
+				// the OS must also save the upper halves of the ymm registers
+				if ( osxsave && avx && ( _xgetbv( 0 ) & 6 ) == 6 ) {
+
+					__cpuidex( cpuid, 7, 0 );
+
+					result = ( cpuid[1] & ( 1 << 5 ) ) != 0;
+				}
+			}
+		}
+
+		return result != 0;
+	}
+
+	// rough byte frequencies of the code section, sampled, used to pick the rarest byte of each pattern as its anchor
+	const uint32_t * GetByteFrequencies() {
+
+		static uint32_t frequencies[256] = { 0 };
+		static bool init = false;
+
+		if ( !init ) {
+
+			Utility::executable_meta & executable = GetExecutable();
+
+			for ( uintptr_t i = executable.begin(); i < executable.end(); i += 61 ) {
+				frequencies[*reinterpret_cast<const uint8_t*>( i )]++;
+			}
+
+			init = true;
+		}
+
+		return frequencies;
+	}
+
+	// takes the canonical data/mask from TransformPattern
+	void CompilePattern( const std::string & bytes, const std::string & mask, uint64_t hash, int maxCount, CompiledPattern & out ) {
+
+		out.bytes = bytes;
+		out.size = mask.size();
+		out.mask.resize( out.size );
+		out.hash = hash;
+		out.maxCount = maxCount;
+		out.hasAnchor = false;
+		out.anchorOffset = 0;
+		out.anchorValue = 0;
+
+		const uint32_t * frequencies = GetByteFrequencies();
+
+		for ( size_t i = 0; i < out.size; i++ ) {
+
+			bool fixed = mask[i] != '?';
+
+			out.mask[i] = fixed ? '\xFF' : '\x00';
+
+			if ( fixed ) {
+
+				uint8_t value = static_cast<uint8_t>( out.bytes[i] );
+
+				if ( !out.hasAnchor || frequencies[value] < frequencies[out.anchorValue] ) {
+
+					out.hasAnchor = true;
+					out.anchorOffset = i;
+					out.anchorValue = value;
+				}
+			}
+		}
+	}
+
+	bool MatchesAt( const CompiledPattern & pattern, const uint8_t * ptr ) {
+
+		const uint8_t * bytes = reinterpret_cast<const uint8_t*>( pattern.bytes.data() );
+		const uint8_t * mask = reinterpret_cast<const uint8_t*>( pattern.mask.data() );
+
+		size_t i = 0;
+
+		for ( ; i + 16 <= pattern.size; i += 16 ) {
+
+			__m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( ptr + i ) );
+			__m128i comparand = _mm_loadu_si128( reinterpret_cast<const __m128i*>( bytes + i ) );
+			__m128i byteMask = _mm_loadu_si128( reinterpret_cast<const __m128i*>( mask + i ) );
+
+			__m128i difference = _mm_and_si128( _mm_xor_si128( value, comparand ), byteMask );
+
+			if ( _mm_movemask_epi8( _mm_cmpeq_epi8( difference, _mm_setzero_si128() ) ) != 0xFFFF ) {
+				return false;
+			}
+		}
+
+		for ( ; i < pattern.size; i++ ) {
+
+			if ( ( ptr[i] ^ bytes[i] ) & mask[i] ) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template<typename Fn>
+	void FindByteSSE2( const uint8_t * ptr, const uint8_t * end, uint8_t value, Fn & fn ) {
+
+		__m128i needle = _mm_set1_epi8( static_cast<char>( value ) );
+
+		for ( ; ptr + 16 <= end; ptr += 16 ) {
+
+			unsigned int found = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( ptr ) ), needle ) );
+
+			while ( found ) {
+
+				unsigned long bit;
+				_BitScanForward( &bit, found );
+
+				fn( ptr + bit );
+
+				found &= found - 1;
+			}
+		}
+
+		for ( ; ptr < end; ptr++ ) {
+
+			if ( *ptr == value ) {
+				fn( ptr );
+			}
+		}
+	}
+
+	template<typename Fn>
+	void FindByteAVX2( const uint8_t * ptr, const uint8_t * end, uint8_t value, Fn & fn ) {
+
+		__m256i needle = _mm256_set1_epi8( static_cast<char>( value ) );
+
+		for ( ; ptr + 32 <= end; ptr += 32 ) {
+
+			unsigned int found = _mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( ptr ) ), needle ) );
+
+			while ( found ) {
+
+				unsigned long bit;
+				_BitScanForward( &bit, found );
+
+				fn( ptr + bit );
+
+				found &= found - 1;
+			}
+		}
+
+		_mm256_zeroupper();
+
+		FindByteSSE2( ptr, end, value, fn );
+	}
+
+	// find all patterns in one pass over [begin, end], matches come out in ascending address order
+	void ScanPatterns( std::vector<CompiledPattern*> & patterns, uintptr_t begin, uintptr_t end ) {
+
+		typedef std::vector<CompiledPattern*> PatternList;
+
+		// bucket patterns by their anchor byte
+		std::map<uint8_t, PatternList> anchors;
+		size_t remaining = 0;
+
+		for ( auto pattern : patterns ) {
+
+			if ( pattern->maxCount <= 0 ) {
+				continue;
+			}
+
+			if ( !pattern->hasAnchor ) {
+
+				// nothing but wildcards, matches everywhere
+				for ( uintptr_t i = begin; i <= end && pattern->matches.size() < (size_t)pattern->maxCount; i++ ) {
+					pattern->matches.push_back( i );
+				}
+
+				continue;
+			}
+
+			anchors[pattern->anchorValue].push_back( pattern );
+			remaining++;
+		}
+
+		bool avx2 = HasAVX2();
+
+		for ( uintptr_t blockBegin = begin; blockBegin <= end && remaining; blockBegin += kScanBlockSize ) {
+
+			uintptr_t blockEnd = std::min<uintptr_t>( blockBegin + kScanBlockSize, end + 1 );
+
+			for ( auto & anchor : anchors ) {
+
+				PatternList & list = anchor.second;
+
+				if ( list.empty() ) {
+					continue;
+				}
+
+				auto consider = [&]( const uint8_t * found ) {
+
+					for ( auto pattern : list ) {
+
+						uintptr_t start = reinterpret_cast<uintptr_t>( found ) - pattern->anchorOffset;
+
+						if ( start < begin || start > end || pattern->matches.size() >= (size_t)pattern->maxCount ) {
+							continue;
+						}
+
+						if ( MatchesAt( *pattern, reinterpret_cast<const uint8_t*>( start ) ) ) {
+							pattern->matches.push_back( start );
+						}
+					}
+				};
+
+				const uint8_t * ptr = reinterpret_cast<const uint8_t*>( blockBegin );
+				const uint8_t * ptrEnd = reinterpret_cast<const uint8_t*>( blockEnd );
+
+				if ( avx2 ) {
+					FindByteAVX2( ptr, ptrEnd, anchor.first, consider );
+				} else {
+					FindByteSSE2( ptr, ptrEnd, anchor.first, consider );
+				}
+
+				// drop patterns that have all the matches they want
+				auto done = std::remove_if( list.begin(), list.end(), []( CompiledPattern * pattern ) {
+					return pattern->matches.size() >= (size_t)pattern->maxCount;
+				} );
+
+				remaining -= list.end() - done;
+				list.erase( done, list.end() );
+			}
+		}
+	}
+
+	uint64_t GetExecutableHash() {
+
+		// the PE headers carry the link timestamp, checksum and section layout, which is enough to tell builds apart
+		const uint8_t * base = reinterpret_cast<const uint8_t*>( GetModuleHandle( NULL ) );
+		const IMAGE_DOS_HEADER * dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>( base );
+		const IMAGE_NT_HEADERS64 * ntHeader = reinterpret_cast<const IMAGE_NT_HEADERS64*>( base + dosHeader->e_lfanew );
+
+		return fnv_1()( std::string( reinterpret_cast<const char*>( base ), ntHeader->OptionalHeader.SizeOfHeaders ) );
+	}
+
+	const std::string & GetHintCachePath() {
+
+		static std::string path;
+
+		if ( path.empty() ) {
+
+			// My Games\Fallout4VR\F4SE\<module name>.sscan, alongside the logs, plugin folders may not be writable
+			HMODULE module = NULL;
+			char modulePath[MAX_PATH];
+			char documentsPath[MAX_PATH];
+
+			if ( GetModuleHandleEx( GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCSTR>( &g_hints ), &module ) &&
+				GetModuleFileName( module, modulePath, sizeof( modulePath ) ) &&
+				SUCCEEDED( SHGetFolderPath( NULL, CSIDL_MYDOCUMENTS | CSIDL_FLAG_CREATE, NULL, SHGFP_TYPE_CURRENT, documentsPath ) ) ) {
+
+				std::string name = modulePath;
+
+				size_t separator = name.find_last_of( "\\/" );
+				if ( separator != std::string::npos ) {
+					name.erase( 0, separator + 1 );
+				}
+
+				size_t extension = name.find_last_of( '.' );
+				if ( extension != std::string::npos ) {
+					name.erase( extension );
+				}
+
+				std::string folder = documentsPath;
+
+				for ( auto subFolder : { "\\My Games", "\\Fallout4VR", "\\F4SE" } ) {
+					folder += subFolder;
+					CreateDirectory( folder.c_str(), NULL );
+				}
+
+				path = folder + "\\" + name + ".sscan";
+			}
+		}
+
+		return path;
+	}
+
+	// a hint is only tried for a pattern of the length it was found for, hashes of different patterns can collide
+	bool HintSizeMatches( uint64_t hash, size_t size ) {
+
+		auto hintSize = g_hintSizes.find( hash );
+
+		return hintSize == g_hintSizes.end() || hintSize->second == size;
+	}
+
+	void LoadHintCache() {
+
+		if ( g_hintCacheLoaded ) {
+			return;
+		}
+
+		g_hintCacheLoaded = true;
+
+		const std::string & path = GetHintCachePath();
+		if ( path.empty() ) {
+			return;
+		}
+
+		FILE * file = nullptr;
+		if ( fopen_s( &file, path.c_str(), "rb" ) != 0 || !file ) {
+			return;
+		}
+
+		HintCacheHeader header;
+
+		if ( fread( &header, sizeof( header ), 1, file ) == 1 &&
+			header.signature == kHintCacheSignature &&
+			header.version == kHintCacheVersion &&
+			header.executableHash == GetExecutableHash() ) {
+
+			Utility::executable_meta & executable = GetExecutable();
+			uintptr_t base = reinterpret_cast<uintptr_t>( GetModuleHandle( NULL ) );
+			uint64_t codeSize = executable.end() - base;
+
+			std::vector<HintCacheEntry> entries( header.numEntries );
+
+			if ( !entries.empty() && fread( entries.data(), sizeof( HintCacheEntry ), entries.size(), file ) == entries.size() ) {
+
+				// hints are still verified against the pattern before they're used, a damaged file mustn't point that outside the code section
+				for ( auto & entry : entries ) {
+
+					if ( entry.rva > codeSize || entry.size > codeSize - entry.rva ) {
+						continue;
+					}
+
+					g_hints.insert( std::make_pair( entry.hash, base + static_cast<uintptr_t>( entry.rva ) ) );
+					g_hintSizes[entry.hash] = entry.size;
+				}
+			}
+		}
+
+		fclose( file );
+	}
+
+	void SaveHintCache() {
+
+		if ( !g_hintCacheDirty ) {
+			return;
+		}
+
+		g_hintCacheDirty = false;
+
+		const std::string & path = GetHintCachePath();
+		if ( path.empty() ) {
+			return;
+		}
+
+		Utility::executable_meta & executable = GetExecutable();
+		uintptr_t base = reinterpret_cast<uintptr_t>( GetModuleHandle( NULL ) );
+
+		std::vector<HintCacheEntry> entries;
+		entries.reserve( g_hints.size() );
+
+		for ( auto & hint : g_hints ) {
+
+			// hints added by hand without a scan have no length to check against, they aren't saved
+			auto size = g_hintSizes.find( hint.first );
+			if ( size == g_hintSizes.end() ) {
+				continue;
+			}
+
+			uint32_t length = size->second;
+
+			if ( hint.second >= executable.begin() && hint.second <= executable.end() && length <= executable.end() - hint.second ) {
+
+				HintCacheEntry entry = { hint.first, hint.second - base, length, 0 };
+				entries.push_back( entry );
+			}
+		}
+
+		HintCacheHeader header = { kHintCacheSignature, kHintCacheVersion, GetExecutableHash(), static_cast<uint32_t>( entries.size() ), 0 };
+
+		std::string tempPath = path + ".tmp";
+
+		FILE * file = nullptr;
+		if ( fopen_s( &file, tempPath.c_str(), "wb" ) != 0 || !file ) {
+			return;
+		}
+
+		bool written = fwrite( &header, sizeof( header ), 1, file ) == 1 &&
+			( entries.empty() || fwrite( entries.data(), sizeof( HintCacheEntry ), entries.size(), file ) == entries.size() );
+
+		fclose( file );
+
+		if ( !written || !MoveFileEx( tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING ) ) {
+			DeleteFile( tempPath.c_str() );
+		}
+	}
+
+	void AddScanResults( const CompiledPattern & pattern ) {
+
+		// hints left by a different pattern with the same hash go
+		if ( !HintSizeMatches( pattern.hash, pattern.size ) ) {
+			g_hints.erase( pattern.hash );
+			g_hintCacheDirty = true;
+		}
+
+		for ( auto address : pattern.matches ) {
+			Utility::pattern::hint( pattern.hash, address );
+		}
+
+		g_hintSizes[pattern.hash] = static_cast<uint32_t>( pattern.size );
+
+		if ( pattern.matches.empty() ) {
+			g_misses.insert( pattern.hash );
+		}
+	}
+}
+
 void Utility::executable_meta::EnsureInit() {
 
 	if ( m_begin ) {
@@ -73,10 +564,12 @@ void Utility::pattern::Initialize( const char* pattern, size_t length ) {
 
 	m_size = m_mask.size();
 
-	// if there's hints, try those first
+	LoadHintCache();
+
+	// if there's hints for a pattern this long, try those first
 	auto range = g_hints.equal_range( m_hash );
 
-	if ( range.first != range.second ) {
+	if ( range.first != range.second && HintSizeMatches( m_hash, m_size ) ) {
 
 		std::for_each( range.first, range.second, [&]( const std::pair<uint64_t, uintptr_t> & hint ) {
 			ConsiderMatch( hint.second );
@@ -88,6 +581,11 @@ void Utility::pattern::Initialize( const char* pattern, size_t length ) {
 			return;
 		}
 	}
+
+	// an earlier scan already came up empty
+	if ( g_misses.count( m_hash ) ) {
+		m_matched = true;
+	}
 }
 
 bool Utility::pattern::ConsiderMatch( uintptr_t offset ) {
@@ -119,94 +617,92 @@ void Utility::pattern::EnsureMatches( int maxCount ) {
 		return;
 	}
 
-	// Scan the executable for code
-	static executable_meta executable;
+	executable_meta & executable = GetExecutable();
+
+	CompiledPattern compiled;
+	CompilePattern( m_bytes, m_mask, m_hash, maxCount, compiled );
+
+	std::vector<CompiledPattern*> patterns( 1, &compiled );
 
-	executable.EnsureInit();
+	ScanPatterns( patterns, executable.begin(), executable.end() );
 
-	// Check if SSE 4.2 is supported
-	int cpuid[4];
-	__cpuid( cpuid, 0 );
+	for ( auto address : compiled.matches ) {
+		m_matches.push_back( pattern_match( reinterpret_cast<void*>( address ) ) );
+	}
+
+	AddScanResults( compiled );
 
-	bool sse42 = false;
+	m_matched = true;
+}
 
-	if ( m_mask.size() <= 16 ) {
+void Utility::pattern::hint( uint64_t hash, uintptr_t address ) {
 
-		if ( cpuid[0] >= 1 ) {
+	auto range = g_hints.equal_range( hash );
 
-			__cpuidex( cpuid, 1, 0 );
+	for ( auto it = range.first; it != range.second; it++ ) {
 
-			sse42 = ( cpuid[2] & ( 1 << 20 ) ) == 1;
+		if ( it->second == address ) {
+			return;
 		}
 	}
 
-	auto matchSuccess = [&]( uintptr_t address ) {
+	g_hints.insert( std::make_pair( hash, address ) );
 
-		g_hints.insert( std::make_pair( m_hash, address ) );
+	g_hintCacheDirty = true;
+}
 
-		return ( m_matches.size() == maxCount );
-	};
+void Utility::pattern::prefetch( const std::vector<const char*> & patterns, int maxCount ) {
 
-	LARGE_INTEGER ticks;
-	QueryPerformanceCounter( &ticks );
+	LoadHintCache();
 
-	uint64_t startTicksOld = ticks.QuadPart;
+	std::vector<CompiledPattern> compiled;
+	std::unordered_set<uint64_t> seen;
 
-	if ( !sse42 ) {
+	compiled.reserve( patterns.size() );
 
-		for ( uintptr_t i = executable.begin(); i <= executable.end(); i++ ) {
+	for ( auto sig : patterns ) {
 
-			if ( ConsiderMatch( i ) ) {
+		std::string baseString( sig );
+		uint64_t hash = fnv_1()( baseString );
 
-				if ( matchSuccess( i ) ) {
-					break;
-				}
-			}
+		// skip duplicates and anything already resolved
+		if ( !seen.insert( hash ).second || g_misses.count( hash ) ) {
+			continue;
 		}
-	} else {
 
-		__declspec( align( 16 ) ) char desiredMask[16] = { 0 };
+		std::string bytes;
+		std::string mask;
 
-		for ( int i = 0; i < m_mask.size(); i++ ) {
-			desiredMask[i / 8] |= ( ( m_mask[i] == '?' ) ? 0 : 1 ) << ( i % 8 );
+		TransformPattern( baseString, bytes, mask );
+
+		if ( g_hints.count( hash ) && HintSizeMatches( hash, mask.size() ) ) {
+			continue;
 		}
 
-		__m128i mask = _mm_load_si128( reinterpret_cast<const __m128i*>( desiredMask ) );
-		__m128i comparand = _mm_loadu_si128( reinterpret_cast<const __m128i*>( m_bytes.c_str() ) );
+		compiled.push_back( CompiledPattern() );
+		CompilePattern( bytes, mask, hash, maxCount, compiled.back() );
+	}
 
-		for ( uintptr_t i = executable.begin(); i <= executable.end(); i++ ) {
+	if ( compiled.empty() ) {
+		return;
+	}
 
-			__m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( i ) );
-			__m128i result = _mm_cmpestrm( value, 16, comparand, (int)m_bytes.size(), _SIDD_CMP_EQUAL_EACH );
+	std::vector<CompiledPattern*> pointers;
 
-			// As the result can match more bits than the mask contains
-			__m128i matches = _mm_and_si128( mask, result );
-			__m128i equivalence = _mm_xor_si128( mask, matches );
+	for ( auto & pattern : compiled ) {
+		pointers.push_back( &pattern );
+	}
 
-			if ( _mm_test_all_zeros( equivalence, equivalence ) ) {
+	executable_meta & executable = GetExecutable();
 
-				m_matches.push_back( pattern_match( (void*)i ) );
+	ScanPatterns( pointers, executable.begin(), executable.end() );
 
-				if ( matchSuccess( i ) ) {
-					break;
-				}
-			}
-		}
+	for ( auto & pattern : compiled ) {
+		AddScanResults( pattern );
 	}
-
-	m_matched = true;
 }
 
-void Utility::pattern::hint( uint64_t hash, uintptr_t address ) {
-
-	auto range = g_hints.equal_range( hash );
-
-	for ( auto it = range.first; it != range.second; it++ ) {
-
-		if ( it->second == address ) {
-			return;
-		}
-	}
+void Utility::pattern::save_hints() {
 
-	g_hints.insert( std::make_pair( hash, address ) );
+	SaveHintCache();
 }
@@ -145,6 +145,13 @@ namespace Utility {
 	public:
 		// define a hint
 		static void hint( uint64_t hash, uintptr_t address );
+
+		// resolve a set of patterns in a single pass over the executable
+		// results are stored as hints, so constructing the same patterns afterwards doesn't scan again
+		static void prefetch( const std::vector<const char*> & patterns, int maxCount = INT_MAX );
+
+		// write hints found since the last save to the cache file, once after a batch of lookups rather than per pattern
+		static void save_hints();
 	};
 }
 
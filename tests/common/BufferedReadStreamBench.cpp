@@ -0,0 +1,295 @@
+#include "common/IFileStream.h"
+#include "common/IBufferStream.h"
+#include "common/IBufferedReadStream.h"
+#include "support/TestSupport.h"
+
+#include <random>
+#include <vector>
+
+// A plugins.txt style text file read a line at a time the way Translation::ImportTranslationFiles reads it, through
+// IFileStream::ReadString as it always has and through an IBufferedReadStream wrapped around the same file. Reports
+// the time and throughput of each.
+//
+//	- every line, its length and the offset after it come out the same, whatever the block size
+//	- \n, \r\n, a lone \r, a NUL, lines longer than the buffer and a last line with no ending all split the same
+//	- mixed reads, peeks, skips and seeks return what the unbuffered stream does
+
+namespace
+{
+	UInt32	s_fileSize = 10 * 1024 * 1024;
+	UInt32	s_checkSize = 256 * 1024;
+
+	enum
+	{
+		kLineBufSize =	512,	// what ImportTranslationFiles reads with
+	};
+
+	std::string MakeText(UInt32 size, UInt32 seed)
+	{
+		std::mt19937	rng(seed);
+		std::string		text;
+
+		text.reserve(size + 1024);
+		text += "# This file is used by the game to keep track of your downloaded content.\r\n";
+
+		const char	* endings[] = { "\r\n", "\r\n", "\r\n", "\n", "\n", "\r" };
+
+		while(text.size() < size)
+		{
+			UInt32	kind = rng() % 100;
+
+			if(kind < 2)
+				text += std::string(kLineBufSize + rng() % 1000, 'L');	// longer than the line buffer
+			else if(kind < 3)
+				text += std::string("before") + '\0' + "after";
+			else if(kind < 5)
+				;	// empty line
+			else
+				text += (kind & 1 ? "*" : "") + std::string("Plugin") + std::to_string(rng() % 100000) + (kind & 2 ? ".esp" : ".esm");
+
+			text += endings[rng() % 6];
+		}
+
+		text += "*Last.esp";	// no line ending
+
+		return text;
+	}
+
+	struct Line
+	{
+		std::string	text;
+		UInt32		length;
+		SInt64		offset;
+
+		bool operator==(const Line & rhs) const	{ return text == rhs.text && length == rhs.length && offset == rhs.offset; }
+	};
+
+	template <typename Stream>
+	std::vector <Line> ReadLines(Stream & stream, char altTerminator, char altTerminator2)
+	{
+		std::vector <Line>	lines;
+
+		while(!stream.HitEOF())
+		{
+			char	buf[kLineBufSize];
+			Line	line;
+
+			line.length = stream.ReadString(buf, sizeof(buf), altTerminator, altTerminator2);
+			line.text = buf;
+			line.offset = stream.GetOffset();
+
+			lines.push_back(line);
+		}
+
+		return lines;
+	}
+
+	void CheckLines(const std::string & path)
+	{
+		UInt32	blockSizes[] = { 1, 7, 511, 512, 4096, IBufferedReadStream::kDefaultBlockSize };
+
+		// line endings, NUL terminated strings, and a single terminator that isn't a line ending
+		char	terminators[][2] = { { '\n', '\r' }, { 0, 0 }, { ',', 0 }, { '\r', 0 } };
+
+		for(auto & term : terminators)
+		{
+			IFileStream	file;
+			CHECK(file.Open(path.c_str()));
+
+			std::vector <Line>	expected = ReadLines(file, term[0], term[1]);
+
+			for(UInt32 blockSize : blockSizes)
+			{
+				CHECK(file.Open(path.c_str()));
+
+				IBufferedReadStream	stream(&file, blockSize);
+
+				CHECK(ReadLines(stream, term[0], term[1]) == expected);
+			}
+		}
+
+		// ReadLine is ReadString with the line endings
+		IFileStream	file(path.c_str());
+		std::vector <Line>	expected = ReadLines(file, '\n', '\r');
+
+		CHECK(file.Open(path.c_str()));
+
+		IBufferedReadStream	stream(&file, 4096);
+		UInt32				i = 0;
+
+		for(; !stream.HitEOF() && i < expected.size(); i++)
+		{
+			char	buf[kLineBufSize];
+
+			if(stream.ReadLine(buf, sizeof(buf)) != expected[i].length || expected[i].text != buf)
+				break;
+		}
+
+		CHECK(i == expected.size() && stream.HitEOF());
+	}
+
+	// the same random reads through a plain memory stream and a buffered one in front of another
+	void CheckMixedReads(const std::string & text)
+	{
+		std::string		copy = text;
+		IBufferStream	plain((void *)text.data(), text.size());
+		IBufferStream	inner((void *)copy.data(), copy.size());
+
+		inner.Skip(3);
+		plain.Skip(3);
+
+		IBufferedReadStream	stream(&inner, 100);
+		std::mt19937		rng(7);
+		bool				same = stream.GetOffset() == 3;
+
+		for(UInt32 i = 0; same && i < 20000; i++)
+		{
+			UInt32	op = rng() % 7;
+
+			if(plain.GetRemain() < 300)
+			{
+				SInt64	offset = rng() % (text.size() - 300);
+
+				plain.SetOffset(offset);
+				stream.SetOffset(offset);
+			}
+
+			switch(op)
+			{
+				case 0:	same &= plain.Read8() == stream.Read8();		break;
+				case 1:	same &= plain.Read32() == stream.Read32();		break;
+				case 2:	same &= plain.Peek8() == stream.Peek8();		break;
+				case 3:	same &= plain.Peek64() == stream.Peek64();		break;
+
+				case 4:
+					{
+						UInt32	length = rng() % 250;
+						char	a[256], b[256];
+
+						plain.ReadBuf(a, length);
+						stream.ReadBuf(b, length);
+
+						same &= !memcmp(a, b, length);
+					}
+					break;
+
+				case 5:
+					{
+						SInt64	bytes = (SInt64)(rng() % 200) - 100;
+						if(plain.GetOffset() + bytes < 0)
+							bytes = 0;
+
+						plain.Skip(bytes);
+						stream.Skip(bytes);
+					}
+					break;
+
+				case 6:
+					{
+						char	a[kLineBufSize], b[kLineBufSize];
+
+						same &= plain.ReadString(a, 64, '\n', '\r') == stream.ReadString(b, 64, '\n', '\r');
+						same &= !strcmp(a, b);
+					}
+					break;
+			}
+
+			same &= plain.GetOffset() == stream.GetOffset();
+		}
+
+		CHECK(same);
+
+		// a read longer than a block goes straight to the wrapped stream
+		std::string	big(1000, 0);
+
+		plain.SetOffset(10);
+		stream.SetOffset(10);
+
+		plain.ReadBuf(&big[0], 1000);
+		CHECK(stream.Read8() == (UInt8)text[10]);
+
+		std::string	bigBuffered(1000, 0);
+		stream.SetOffset(10);
+		stream.ReadBuf(&bigBuffered[0], 1000);
+
+		CHECK(big == bigBuffered);
+		CHECK(stream.GetOffset() == 1010 && stream.Read8() == (UInt8)text[1010]);
+	}
+
+	struct Result
+	{
+		double	time;
+		UInt32	numLines;
+		UInt32	numPlugins;
+	};
+
+	template <typename Stream>
+	Result TimeLines(Stream & stream)
+	{
+		Result	result = { 0, 0, 0 };
+
+		result.time = Test::Time([&]()
+		{
+			while(!stream.HitEOF())
+			{
+				char	buf[kLineBufSize];
+				stream.ReadString(buf, sizeof(buf), '\n', '\r');
+
+				result.numLines++;
+				result.numPlugins += buf[0] == '*';
+			}
+		});
+
+		return result;
+	}
+
+	void RunBench(const std::string & path)
+	{
+		IFileStream	file;
+
+		CHECK(file.Open(path.c_str()));
+		Result	old = TimeLines(file);
+
+		CHECK(file.Open(path.c_str()));
+		IBufferedReadStream	small(&file, 4096);
+		Result	buffered4k = TimeLines(small);
+
+		CHECK(file.Open(path.c_str()));
+		IBufferedReadStream	large(&file);
+		Result	buffered = TimeLines(large);
+
+		CHECK(buffered.numLines == old.numLines && buffered.numPlugins == old.numPlugins);
+		CHECK(buffered4k.numLines == old.numLines && buffered4k.numPlugins == old.numPlugins);
+
+		double	mb = file.GetLength() / (1024.0 * 1024.0);
+
+		printf("buffered read stream: %.1f MB text file, %u lines\n", mb, old.numLines);
+		printf("  IFileStream::ReadString (old)   %9.1f ms  %8.1f MB/s\n", old.time, mb * 1000 / old.time);
+		printf("  buffered, 4 KB blocks           %9.1f ms  %8.1f MB/s\n", buffered4k.time, mb * 1000 / buffered4k.time);
+		printf("  buffered, 64 KB blocks          %9.1f ms  %8.1f MB/s\n", buffered.time, mb * 1000 / buffered.time);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_fileSize = 1024 * 1024;
+		s_checkSize = 32 * 1024;
+	}
+
+	std::string	root = Test::MakeTempDir("buffered_read");
+	std::string	checkPath = root + "/check.txt";
+	std::string	benchPath = root + "/plugins.txt";
+
+	std::string	checkText = MakeText(s_checkSize, 1);
+
+	Test::WriteTextFile(checkPath, checkText);
+	Test::WriteTextFile(benchPath, MakeText(s_fileSize, 2));
+
+	CheckLines(checkPath);
+	CheckMixedReads(checkText);
+	RunBench(benchPath);
+
+	return Test::Finish("BufferedReadStreamBench");
+}
@@ -0,0 +1,325 @@
+#include "support/TestSupport.h"
+#include "support/AllocCounter.h"
+
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// _MESSAGE calls the way the hot paths make them, written synchronously by the calling thread as IDebugLog always
+// did and queued for the writer thread with SetAsync. Reports the time the calling thread spends per message.
+//
+//	- the log file reads the same either way, formats, sources, indents and blocks included
+//	- each thread's messages come out in order, every message is either written or counted as dropped
+//	- a fatal error is in the file by the time the call returns
+//	- a %s with a precision reads no further than the precision, a four character code needn't be terminated
+//	- queueing a message allocates nothing once the thread has its ring
+
+namespace
+{
+	UInt32	s_numMessages = 200000;
+	UInt32	s_numThreadMessages = 20000;
+
+	enum
+	{
+		kNumThreads =	4,
+	};
+
+	std::string	s_root;
+
+	std::string LogPath(const char * name)
+	{
+		return s_root + "/" + name + ".log";
+	}
+
+	std::vector <std::string> SplitLines(const std::string & text)
+	{
+		std::vector <std::string>	lines;
+		size_t						start = 0;
+
+		while(start < text.size())
+		{
+			size_t	end = text.find('\n', start);
+			if(end == std::string::npos)
+				end = text.size();
+
+			lines.push_back(text.substr(start, end - start));
+			start = end + 1;
+		}
+
+		return lines;
+	}
+
+	void LogNNL(const char * fmt, ...)
+	{
+		va_list	args;
+
+		va_start(args, fmt);
+		gLog.LogNNL(IDebugLog::kLevel_Message, fmt, args);
+		va_end(args);
+	}
+
+	// one of everything the writer has to reproduce
+	void WriteScript(void)
+	{
+		std::string	longString(9000, 'y');
+
+		_MESSAGE("plain text");
+		_MESSAGE("ints %d %i %u %x %X %o %c", -5, 7, 4000000000u, 0xBEEF, 0xBEEF, 8, 'q');
+		_MESSAGE("sizes %hhd %hd %ld %lld %zu %jd", 300, 70000, -9L, -1234567890123LL, (size_t)77, (intmax_t)-8);
+		_MESSAGE("floats %f %.3e %g %a %10.2f", 1.5, 12345.678, 0.0001, 2.0, 3.14159f);
+		_MESSAGE("strings [%s] [%-10s] [%10s] [%.3s] [%s]", "abc", "left", "right", "truncated", (const char *)NULL);
+		_MESSAGE("stars [%*d] [%-*d] [%.*f] [%*.*s]", 6, 42, 6, 42, 2, 2.71828, 8, 3, "abcdef");
+		_MESSAGE("pointer %p percent %% done", (void *)0x1234);
+		_MESSAGE("wide [%ls] long double [%Lf]", L"wide", (long double)1.25);
+		_MESSAGE("long %s end", longString.c_str());
+
+		gLog.Message("with a source", "Source");
+		gLog.Indent();
+		_MESSAGE("indented");
+		gLog.OpenBlock();
+		_MESSAGE("in a block");
+		gLog.CloseBlock();
+		gLog.Outdent();
+
+		// ClearSource leaves the prefix as it was
+		gLog.ClearSource();
+		gLog.SetSource("Test");
+
+		gLog.FormattedMessage("formatted %d", 12);
+		LogNNL("no newline %d, ", 1);
+		LogNNL("then more");
+		_MESSAGE("");
+		_DMESSAGE("debug %s", "message");
+	}
+
+	void CheckSameOutput(void)
+	{
+		std::string	syncPath = LogPath("sync");
+		std::string	asyncPath = LogPath("async");
+
+		IDebugLog::Open(syncPath.c_str());
+		WriteScript();
+		IDebugLog::Flush();
+
+		IDebugLog::SetAsync(true);
+		IDebugLog::Open(asyncPath.c_str());
+		WriteScript();
+		IDebugLog::SetAsync(false);
+
+		std::string	syncLog = Test::ReadTextFile(syncPath);
+		std::string	asyncLog = Test::ReadTextFile(asyncPath);
+
+		CHECK(!syncLog.empty());
+		CHECK(syncLog == asyncLog);
+		CHECK(syncLog.find("[    42] [42    ]") != std::string::npos);
+	}
+
+	void CheckThreads(void)
+	{
+		std::string	path = LogPath("threads");
+
+		IDebugLog::SetAsync(true);
+		IDebugLog::Open(path.c_str());
+
+		UInt64	droppedBefore = IDebugLog::GetNumDropped();
+
+		std::vector <std::thread>	threads;
+
+		for(UInt32 t = 0; t < kNumThreads; t++)
+		{
+			threads.emplace_back([t]()
+			{
+				for(UInt32 i = 0; i < s_numThreadMessages; i++)
+					_MESSAGE("thread %u line %u", t, i);
+			});
+		}
+
+		for(auto & thread : threads)
+			thread.join();
+
+		// a new thread picks up a ring an old one left behind, emptied first so the message can't be dropped
+		IDebugLog::Flush();
+		std::thread([]() { _MESSAGE("thread %u line %u", kNumThreads, 0); }).join();
+
+		IDebugLog::Flush();
+
+		UInt64	numDropped = IDebugLog::GetNumDropped() - droppedBefore;
+
+		IDebugLog::SetAsync(false);
+
+		std::vector <std::string>	lines = SplitLines(Test::ReadTextFile(path));
+
+		SInt64	last[kNumThreads + 1];
+		for(auto & l : last)
+			l = -1;
+
+		bool	ordered = true;
+		UInt64	numWritten = 0;
+		UInt64	numReported = 0;
+
+		for(auto & line : lines)
+		{
+			UInt32				t, i;
+			unsigned long long	dropped;
+
+			if(sscanf(line.c_str(), "[Test    ]\tthread %u line %u", &t, &i) == 2)
+			{
+				ordered &= t <= kNumThreads && (SInt64)i > last[t];
+				last[t] = i;
+				numWritten++;
+			}
+			else if(sscanf(line.c_str(), "[Test    ]\t(%llu log messages dropped", &dropped) == 1)
+			{
+				numReported += dropped;
+			}
+		}
+
+		CHECK(ordered);
+		CHECK(last[kNumThreads] == 0);
+		CHECK(numWritten + numDropped == (UInt64)kNumThreads * s_numThreadMessages + 1);
+		CHECK(numReported == numDropped);
+	}
+
+	void CheckFatal(void)
+	{
+		std::string	path = LogPath("fatal");
+
+		IDebugLog::SetAsync(true);
+		IDebugLog::Open(path.c_str());
+		IDebugLog::SetPrintLevel((IDebugLog::LogLevel)-1);
+
+		_MESSAGE("before");
+		_FATALERROR("fatal %d", 1);
+
+		CHECK(Test::ReadTextFile(path) == "[Test    ]\tbefore\n[Test    ]\tfatal 1\n");
+
+		IDebugLog::SetPrintLevel(IDebugLog::kLevel_Warning);
+		IDebugLog::SetAsync(false);
+	}
+
+	// the co-save error paths log "%.4s", &type with the type in a UInt32, put one against an unreadable page
+	void CheckUnterminated(void)
+	{
+		std::string	path = LogPath("unterminated");
+		size_t		pageSize = sysconf(_SC_PAGESIZE);
+
+		UInt8	* pages = (UInt8 *)mmap(NULL, pageSize * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		CHECK(pages != MAP_FAILED);
+		CHECK(!mprotect(pages + pageSize, pageSize, PROT_NONE));
+
+		UInt32	* type = (UInt32 *)(pages + pageSize - sizeof(UInt32));
+		memcpy(type, "PLGN", 4);
+
+		IDebugLog::SetAsync(true);
+		IDebugLog::Open(path.c_str());
+
+		_MESSAGE("type %.4s", type);
+		_MESSAGE("star %.*s", 4, type);
+		_MESSAGE("short %.2s", type);
+		_MESSAGE("empty [%.0s]", type);
+
+		IDebugLog::SetAsync(false);
+
+		CHECK(Test::ReadTextFile(path) ==
+			"[Test    ]\ttype PLGN\n"
+			"[Test    ]\tstar PLGN\n"
+			"[Test    ]\tshort PL\n"
+			"[Test    ]\tempty []\n");
+
+		munmap(pages, pageSize * 2);
+	}
+
+	void CheckAllocations(void)
+	{
+		IDebugLog::SetAsync(true);
+		IDebugLog::Open(LogPath("allocs").c_str());
+
+		_MESSAGE("first message gets the ring");
+
+		UInt64	before = Test::GetNumAllocs();
+
+		for(UInt32 i = 0; i < 1000; i++)
+			_MESSAGE("message %u %s %f", i, "text", i * 0.5);
+
+		CHECK(Test::GetNumAllocs() == before);
+
+		IDebugLog::SetAsync(false);
+	}
+
+	double TimeMessages(UInt32 numMessages)
+	{
+		return Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < numMessages; i++)
+				_MESSAGE("ScaleformMCM::NavigateList: index %d of %d, entry %s, flags %08X", i & 31, 32, "Option", i);
+		});
+	}
+
+	void RunBench(void)
+	{
+		// the default, flushed after every line
+		IDebugLog::Open(LogPath("bench_sync").c_str());
+		double	sync = TimeMessages(s_numMessages);
+
+		IDebugLog::SetAutoFlush(false);
+		IDebugLog::Open(LogPath("bench_buffered").c_str());
+		double	buffered = TimeMessages(s_numMessages);
+		IDebugLog::SetAutoFlush(true);
+
+		IDebugLog::SetAsync(true);
+		IDebugLog::Open(LogPath("bench_async").c_str());
+
+		UInt64	droppedBefore = IDebugLog::GetNumDropped();
+		double	async = TimeMessages(s_numMessages);
+		double	flush = Test::Time([]() { IDebugLog::Flush(); });
+		UInt64	dropped = IDebugLog::GetNumDropped() - droppedBefore;
+
+		// the hot paths log a burst per event and then go quiet, give the writer the gaps it would get
+		droppedBefore = dropped + droppedBefore;
+
+		UInt32	burst = 200;
+		double	paced = 0;
+
+		for(UInt32 i = 0; i < s_numMessages; i += burst)
+		{
+			paced += TimeMessages(burst);
+			Sleep(1);
+		}
+
+		IDebugLog::Flush();
+		UInt64	pacedDropped = IDebugLog::GetNumDropped() - droppedBefore;
+
+		IDebugLog::SetAsync(false);
+
+		printf("debug log: %u messages from one thread, time spent in the calling thread\n", s_numMessages);
+		printf("  synchronous, autoflush (old)    %8.1f ms  %7.0f ns/message\n", sync, sync * 1e6 / s_numMessages);
+		printf("  synchronous, buffered           %8.1f ms  %7.0f ns/message\n", buffered, buffered * 1e6 / s_numMessages);
+		printf("  async, back to back             %8.1f ms  %7.0f ns/message  (%llu dropped, flush %.1f ms)\n", async, async * 1e6 / s_numMessages, (unsigned long long)dropped, flush);
+		printf("  async, bursts of %u             %8.1f ms  %7.0f ns/message  (%llu dropped)\n", burst, paced, paced * 1e6 / s_numMessages, (unsigned long long)pacedDropped);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numMessages = 20000;
+		s_numThreadMessages = 2000;
+	}
+
+	s_root = Test::MakeTempDir("debug_log");
+
+	// every line gets this prefix, the source can't be unset
+	gLog.SetSource("Test");
+
+	CheckSameOutput();
+	CheckThreads();
+	CheckFatal();
+	CheckUnterminated();
+	CheckAllocations();
+	RunBench();
+
+	return Test::Finish("DebugLogBench");
+}
@@ -0,0 +1,271 @@
+#include "support/TestSupport.h"
+
+// Log calls at each level through the default module, through a module declared in LogLevelBenchModule.cpp and
+// through an inline variadic function the way _MESSAGE and _DMESSAGE were before they checked a level mask. Each
+// call's argument goes through Evaluate, standing in for the GetPerkPoints() a call site passes. Reports the time
+// per call, filtered and written.
+//
+//	- the default module follows the global log level
+//	- a module's own level overrides the global one in either direction and caps the print level
+//	- a filtered call never evaluates its arguments, a compiled out one never does anything
+//	- ReadModuleLevels picks the levels up from an ini file, names matched without case
+
+namespace LogLevelBench
+{
+	UInt32	s_numEvaluated = 0;
+
+	__attribute__((noinline)) int Evaluate(int value)
+	{
+		s_numEvaluated++;
+		return value;
+	}
+
+	const IDebugLog::Module & GetModule(void);
+	void ModuleCalls(IDebugLog::LogLevel level, UInt32 count);
+}
+
+using namespace LogLevelBench;
+
+namespace
+{
+	UInt32	s_numFiltered = 20000000;
+	UInt32	s_numWritten = 200000;
+
+	std::string	s_root;
+	std::string	s_logPath;
+
+	// the old _MESSAGE and _DMESSAGE
+	inline void OldMessage(const char * fmt, ...)
+	{
+		va_list args;
+
+		va_start(args, fmt);
+		gLog.Log(IDebugLog::kLevel_Message, fmt, args);
+		va_end(args);
+	}
+
+	inline void OldDebugMessage(const char * fmt, ...)
+	{
+		va_list args;
+
+		va_start(args, fmt);
+		gLog.Log(IDebugLog::kLevel_DebugMessage, fmt, args);
+		va_end(args);
+	}
+
+	void DefaultCalls(IDebugLog::LogLevel level, UInt32 count)
+	{
+		switch(level)
+		{
+			case IDebugLog::kLevel_Message:
+				for(UInt32 i = 0; i < count; i++)
+					_MESSAGE("default message %d", Evaluate(i));
+				break;
+
+			case IDebugLog::kLevel_DebugMessage:
+				for(UInt32 i = 0; i < count; i++)
+					_DMESSAGE("default debug %d", Evaluate(i));
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	void OldCalls(IDebugLog::LogLevel level, UInt32 count)
+	{
+		if(level == IDebugLog::kLevel_Message)
+		{
+			for(UInt32 i = 0; i < count; i++)
+				OldMessage("default message %d", Evaluate(i));
+		}
+		else
+		{
+			for(UInt32 i = 0; i < count; i++)
+				OldDebugMessage("default debug %d", Evaluate(i));
+		}
+	}
+
+	void StartLog(void)
+	{
+		IDebugLog::Open(s_logPath.c_str());
+		s_numEvaluated = 0;
+	}
+
+	// lines in the log containing text
+	UInt32 CountLines(const char * text)
+	{
+		std::string	log = Test::ReadTextFile(s_logPath);
+		UInt32		count = 0;
+
+		for(size_t pos = log.find(text); pos != std::string::npos; pos = log.find(text, pos + 1))
+			count++;
+
+		return count;
+	}
+
+	void ResetLevels(void)
+	{
+		IDebugLog::SetLogLevel(IDebugLog::kLevel_Message);
+		IDebugLog::SetModuleLevel("Bench", (IDebugLog::LogLevel)-1);
+	}
+
+	void CheckDefaultModule(void)
+	{
+		ResetLevels();
+		StartLog();
+
+		DefaultCalls(IDebugLog::kLevel_Message, 2);
+		DefaultCalls(IDebugLog::kLevel_DebugMessage, 3);
+
+		CHECK(CountLines("default message") == 2);
+		CHECK(CountLines("default debug") == 0);
+		CHECK(s_numEvaluated == 2);
+
+		IDebugLog::SetLogLevel(IDebugLog::kLevel_DebugMessage);
+		StartLog();
+
+		DefaultCalls(IDebugLog::kLevel_DebugMessage, 3);
+
+		CHECK(CountLines("default debug") == 3);
+		CHECK(s_numEvaluated == 3);
+
+		// an undeclared module follows the global level too
+		CHECK(GetModule().IsEnabled(IDebugLog::kLevel_DebugMessage));
+		CHECK(IDebugLog::defaultModule.IsEnabled(IDebugLog::kLevel_DebugMessage));
+	}
+
+	void CheckModuleLevel(void)
+	{
+		// quieter than the global level
+		ResetLevels();
+		IDebugLog::SetModuleLevel("Bench", IDebugLog::kLevel_Warning);
+		StartLog();
+
+		ModuleCalls(IDebugLog::kLevel_Message, 4);
+		ModuleCalls(IDebugLog::kLevel_Warning, 1);
+		DefaultCalls(IDebugLog::kLevel_Message, 1);
+
+		CHECK(CountLines("module message") == 0);
+		CHECK(CountLines("module warning") == 1);
+		CHECK(CountLines("default message") == 1);
+		CHECK(s_numEvaluated == 2);
+
+		// the console doesn't get what the module filters
+		IDebugLog::SetPrintLevel(IDebugLog::kLevel_DebugMessage);
+		CHECK(!GetModule().IsEnabled(IDebugLog::kLevel_Message));
+		CHECK(IDebugLog::defaultModule.IsEnabled(IDebugLog::kLevel_DebugMessage));
+		IDebugLog::SetPrintLevel((IDebugLog::LogLevel)-1);
+
+		// louder than the global level
+		IDebugLog::SetLogLevel(IDebugLog::kLevel_Warning);
+		IDebugLog::SetModuleLevel("Bench", IDebugLog::kLevel_Message);
+		StartLog();
+
+		ModuleCalls(IDebugLog::kLevel_Message, 4);
+		DefaultCalls(IDebugLog::kLevel_Message, 1);
+
+		CHECK(CountLines("module message") == 4);
+		CHECK(CountLines("default message") == 0);
+		CHECK(s_numEvaluated == 4);
+
+		// past IDEBUGLOG_MAX_LEVEL whatever the level says
+		IDebugLog::SetModuleLevel("Bench", IDebugLog::kLevel_DebugMessage);
+		StartLog();
+
+		ModuleCalls(IDebugLog::kLevel_DebugMessage, 4);
+
+		CHECK(GetModule().IsEnabled(IDebugLog::kLevel_DebugMessage));
+		CHECK(CountLines("module debug") == 0);
+		CHECK(s_numEvaluated == 0);
+	}
+
+	void CheckReadLevels(void)
+	{
+		std::string	iniPath = s_root + "/f4sevr.ini";
+
+		ResetLevels();
+
+		Test::WriteTextFile(iniPath, "[Logging]\niLogLevel=2\niLogLevel_bench=3\n[Other]\niLogLevel_Bench=0\n");
+		IDebugLog::ReadModuleLevels(iniPath.c_str(), "Logging");
+
+		CHECK(!IDebugLog::defaultModule.IsEnabled(IDebugLog::kLevel_Message));
+		CHECK(IDebugLog::defaultModule.IsEnabled(IDebugLog::kLevel_Warning));
+		CHECK(GetModule().IsEnabled(IDebugLog::kLevel_Message));
+		CHECK(!GetModule().IsEnabled(IDebugLog::kLevel_VerboseMessage));
+
+		// missing and out of range keys leave the levels alone
+		Test::WriteTextFile(iniPath, "[Logging]\niLogLevel_Bench=9\n");
+		IDebugLog::ReadModuleLevels(iniPath.c_str(), "Logging");
+
+		CHECK(!IDebugLog::defaultModule.IsEnabled(IDebugLog::kLevel_Message));
+		CHECK(GetModule().IsEnabled(IDebugLog::kLevel_Message));
+		CHECK(!GetModule().IsEnabled(IDebugLog::kLevel_VerboseMessage));
+	}
+
+	template <typename F>
+	double TimeCalls(UInt32 count, F func)
+	{
+		StartLog();
+
+		return Test::Time([&]() { func(count); }) * 1e6 / count;
+	}
+
+	void RunBench(void)
+	{
+		ResetLevels();
+		IDebugLog::SetAutoFlush(false);
+
+		double	oldFiltered = TimeCalls(s_numFiltered, [](UInt32 n) { OldCalls(IDebugLog::kLevel_DebugMessage, n); });
+		CHECK(s_numEvaluated == s_numFiltered);
+
+		double	defaultFiltered = TimeCalls(s_numFiltered, [](UInt32 n) { DefaultCalls(IDebugLog::kLevel_DebugMessage, n); });
+		CHECK(s_numEvaluated == 0);
+
+		IDebugLog::SetModuleLevel("Bench", IDebugLog::kLevel_Warning);
+		double	moduleFiltered = TimeCalls(s_numFiltered, [](UInt32 n) { ModuleCalls(IDebugLog::kLevel_Message, n); });
+		CHECK(s_numEvaluated == 0);
+
+		double	compiledOut = TimeCalls(s_numFiltered, [](UInt32 n) { ModuleCalls(IDebugLog::kLevel_DebugMessage, n); });
+		CHECK(s_numEvaluated == 0);
+
+		double	oldWritten = TimeCalls(s_numWritten, [](UInt32 n) { OldCalls(IDebugLog::kLevel_Message, n); });
+		double	defaultWritten = TimeCalls(s_numWritten, [](UInt32 n) { DefaultCalls(IDebugLog::kLevel_Message, n); });
+		CHECK(s_numEvaluated == s_numWritten);
+
+		IDebugLog::SetAutoFlush(true);
+		ResetLevels();
+
+		printf("log levels: time per call, global level Message, written calls go to a buffered file\n");
+		printf("  filtered, old inline function        %7.2f ns\n", oldFiltered);
+		printf("  filtered, default module             %7.2f ns\n", defaultFiltered);
+		printf("  filtered, module level               %7.2f ns\n", moduleFiltered);
+		printf("  compiled out                         %7.2f ns\n", compiledOut);
+		printf("  written, old inline function         %7.2f ns\n", oldWritten);
+		printf("  written, default module              %7.2f ns\n", defaultWritten);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numFiltered = 1000000;
+		s_numWritten = 20000;
+	}
+
+	s_root = Test::MakeTempDir("log_level");
+	s_logPath = s_root + "/levels.log";
+
+	// the module checks count lines in the file, keep the console out of it
+	IDebugLog::SetPrintLevel((IDebugLog::LogLevel)-1);
+
+	CheckDefaultModule();
+	CheckModuleLevel();
+	CheckReadLevels();
+	RunBench();
+
+	IDebugLog::SetPrintLevel(IDebugLog::kLevel_Warning);
+
+	return Test::Finish("LogLevelBench");
+}
@@ -0,0 +1,40 @@
+#include "support/TestSupport.h"
+
+// The half of LogLevelBench that declares a module, built with IDEBUGLOG_MAX_LEVEL 3 so _VMESSAGE and _DMESSAGE are
+// compiled out here and nowhere else.
+
+IDEBUGLOG_MODULE("Bench");
+
+namespace LogLevelBench
+{
+	int Evaluate(int value);
+
+	const IDebugLog::Module & GetModule(void)
+	{
+		return s_logModule;
+	}
+
+	void ModuleCalls(IDebugLog::LogLevel level, UInt32 count)
+	{
+		switch(level)
+		{
+			case IDebugLog::kLevel_Warning:
+				for(UInt32 i = 0; i < count; i++)
+					_WARNING("module warning %d", Evaluate(i));
+				break;
+
+			case IDebugLog::kLevel_Message:
+				for(UInt32 i = 0; i < count; i++)
+					_MESSAGE("module message %d", Evaluate(i));
+				break;
+
+			case IDebugLog::kLevel_DebugMessage:
+				for(UInt32 i = 0; i < count; i++)
+					_DMESSAGE("module debug %d", Evaluate(i));
+				break;
+
+			default:
+				break;
+		}
+	}
+}
@@ -0,0 +1,216 @@
+#include "SettingStore.h"
+#include "f4mcm/SettingsCorpus.h"
+
+#include <map>
+
+// Loads a generated corpus of a few thousand MCM ini files with SettingStore::ReadSettings and with
+// the old GetPrivateProfileSectionNames/GetPrivateProfileSection reader, checks that every setting
+// ends up with the same value, and runs the tokenizer's edge cases through a hand written file. A file that
+// can't be opened is logged once the parse workers are done.
+
+namespace
+{
+	UInt32	s_numMods = 3000;
+	UInt32	s_numKeys = 40;
+
+	// the pre-tokenizer reader as the baseline, registration just records the value
+
+	namespace Legacy
+	{
+		std::map<std::string, std::string>	s_values;
+		UInt32								s_numFiles = 0;
+
+		std::string Trim(const std::string & str)
+		{
+			size_t	begin = str.find_first_not_of(" \t");
+			size_t	end = str.find_last_not_of(" \t");
+
+			return begin == std::string::npos ? std::string() : str.substr(begin, end - begin + 1);
+		}
+
+		// the api trims around '=' itself, the shim doesn't, so the key and value are trimmed here
+		void RegisterModSetting(std::string modName, std::string settingName, std::string settingValue)
+		{
+			size_t	delimiter = settingName.find(':');
+
+			s_values[modName + ":" + Trim(settingName.substr(0, delimiter)) + settingName.substr(delimiter)] = Trim(settingValue);
+		}
+
+		bool ReadINI(std::string modName, std::string iniLocation) {
+
+			s_numFiles++;
+
+			// Extract all sections
+			std::vector<std::string> sections;
+			LPTSTR lpszReturnBuffer = new TCHAR[1024];
+			DWORD sizeWritten = GetPrivateProfileSectionNames(lpszReturnBuffer, 1024, iniLocation.c_str());
+			if (sizeWritten == (1024 - 2)) {
+				_WARNING("Warning: Too many sections. Settings will not be read.");
+				delete [] lpszReturnBuffer;
+				return false;
+			}
+
+			for (LPTSTR p = lpszReturnBuffer; *p; p++) {
+				std::string sectionName(p);
+				sections.push_back(sectionName);
+				p += strlen(p);
+			}
+
+			delete [] lpszReturnBuffer;
+
+			for (int j = 0; j < sections.size(); j++) {
+				// Extract all keys within section
+				int len = 1024;
+				LPTSTR lpReturnedString = new TCHAR[len];
+				DWORD sizeWritten = GetPrivateProfileSection(sections[j].c_str(), lpReturnedString, len, iniLocation.c_str());
+				while (sizeWritten == (len - 2)) {
+					// Buffer too small to contain all entries; expand buffer and try again.
+					delete [] lpReturnedString;
+					len <<= 1;
+					lpReturnedString = new TCHAR[len];
+					sizeWritten = GetPrivateProfileSection(sections[j].c_str(), lpReturnedString, len, iniLocation.c_str());
+				}
+
+				for (LPTSTR p = lpReturnedString; *p; p++) {
+					std::string valuePair(p);
+
+					auto delimiter = valuePair.find_first_of('=');
+					std::string settingName = valuePair.substr(0, delimiter) + ":" + sections[j];
+					std::string settingValue = valuePair.substr(delimiter + 1);
+					RegisterModSetting(modName, settingName, settingValue);
+
+					p += strlen(p);
+				}
+
+				delete [] lpReturnedString;
+			}
+
+			return true;
+		}
+
+		// LoadDefaults then LoadUserSettings, minus the directory walk
+		void ReadSettings(UInt32 numMods)
+		{
+			for (UInt32 mod = 0; mod < numMods; mod++) {
+				char modName[16];
+				SettingsCorpus::GetModName(mod, modName, sizeof(modName));
+				ReadINI(modName, std::string("Data\\MCM\\Config\\") + modName + "\\settings.ini");
+			}
+
+			for (UInt32 mod = 0; mod < numMods; mod++) {
+				char modName[16];
+				SettingsCorpus::GetModName(mod, modName, sizeof(modName));
+
+				std::string path = std::string("Data\\MCM\\Settings\\") + modName + ".ini";
+				if (GetFileAttributes(path.c_str()) != INVALID_FILE_ATTRIBUTES)
+					ReadINI(modName, path);
+			}
+		}
+	}
+
+	// checks a setting against the text value the old reader ended up with
+	void CheckValue(SettingStore & store, const std::string & mod, const std::string & setting, const std::string & value)
+	{
+		switch(setting[0])
+		{
+			case 'i':	CHECK(store.GetModSettingInt(mod.c_str(), setting.c_str()) == std::stoi(value)); break;
+			case 'f':	CHECK(store.GetModSettingFloat(mod.c_str(), setting.c_str()) == std::stof(value)); break;
+			case 'b':	CHECK(store.GetModSettingBool(mod.c_str(), setting.c_str()) == (value != "0")); break;
+			case 's':
+			{
+				const char	* str = store.GetModSettingString(mod.c_str(), setting.c_str());
+				CHECK(str && value == str);
+				break;
+			}
+		}
+	}
+
+	const char	kEdgeCases[] =
+		"\xEF\xBB\xBF; a bom, then a comment\r\n"
+		"iOrphan=1\r\n"								// before any section, ignored
+		"[ Main ]\r\n"
+		"iPadded   =   42   \r\n"
+		"\t\r\n"
+		"bNoValue=\r\n"
+		"sEmpty=\r\n"
+		"no delimiter on this line\r\n"
+		"=no key\r\n"
+		"fTabs\t=\t1.5\t\r\n"
+		"  ; indented comment\r\n"
+		"sInner = a = b \r\n"
+		"[Other]\n"
+		"iDup=1\n"
+		"iDup=2\n"
+		"[Unclosed\n"
+		"iUnclosed=3\n"
+		"sLast=no newline at the end";
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numMods = 100;
+		s_numKeys = 20;
+	}
+
+	std::string	root = Test::MakeTempDir("iniparse");
+
+	std::vector <SettingsCorpus::Key>	keys = SettingsCorpus::Write(root, s_numMods, s_numKeys, 5);
+	SettingsCorpus::EnterRoot(root);
+
+	CHECK(!system("mkdir -p Data/MCM/Config/EdgeCases"));
+	Test::WriteTextFile("Data/MCM/Config/EdgeCases/settings.ini", kEdgeCases);
+
+	// an empty file is fine and holds nothing
+	CHECK(!system("mkdir -p Data/MCM/Config/Empty && : > Data/MCM/Config/Empty/settings.ini"));
+
+	// listed, but there's nothing to open
+	CHECK(!system("ln -sf Missing.ini Data/MCM/Settings/Broken.ini"));
+
+	std::string	logPath = root + "/iniparse.log";
+	IDebugLog::Open(logPath.c_str());
+
+	printf("ini parse: %u mods, %u settings\n", s_numMods, (UInt32)keys.size());
+
+	double	legacyTime = Test::Time([&]()
+	{
+		Legacy::ReadSettings(s_numMods);
+	});
+
+	printf("%-34s %9.2f ms %6u files\n", "GetPrivateProfileSection (old)", legacyTime, Legacy::s_numFiles);
+
+	SettingStore	& store = SettingStore::GetInstance();
+
+	double	storeTime = Test::Time([&]()
+	{
+		store.ReadSettings();
+	});
+
+	printf("%-34s %9.2f ms\n", "mapped single pass", storeTime);
+
+	// same values as the old reader for every setting in the corpus
+	CHECK(Legacy::s_values.size() == keys.size());
+
+	for(auto & value : Legacy::s_values)
+	{
+		size_t	delimiter = value.first.find(':');
+
+		CheckValue(store, value.first.substr(0, delimiter), value.first.substr(delimiter + 1), value.second);
+	}
+
+	// tokenizer rules
+	CHECK(store.GetModSettingHandle("EdgeCases", "iOrphan:") == SettingStore::kInvalidHandle);
+	CHECK(store.GetModSettingInt("EdgeCases", "iPadded:Main") == 42);
+	CHECK(store.GetModSettingBool("EdgeCases", "bNoValue:Main"));
+	CHECK(!strcmp(store.GetModSettingString("EdgeCases", "sEmpty:Main"), ""));
+	CHECK(store.GetModSettingFloat("EdgeCases", "fTabs:Main") == 1.5f);
+	CHECK(!strcmp(store.GetModSettingString("EdgeCases", "sInner:Main"), "a = b"));
+	CHECK(store.GetModSettingInt("EdgeCases", "iDup:Other") == 2);
+	CHECK(store.GetModSettingInt("EdgeCases", "iUnclosed:Unclosed") == 3);
+	CHECK(!strcmp(store.GetModSettingString("EdgeCases", "sLast:Unclosed"), "no newline at the end"));
+
+	CHECK(Test::ReadTextFile(logPath).find("Could not open Data\\MCM\\Settings\\Broken.ini") != std::string::npos);
+
+	return Test::Finish("IniParseBench");
+}
@@ -0,0 +1,274 @@
+#include "KeybindStore.h"
+#include "json/json.h"
+#include "support/TestSupport.h"
+
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Keybind definitions from a generated Data\MCM\Config, through KeybindStore built cold, built again from its
+// cache, and through the per mod parse of keybinds.json that KeybindManager::GetKeybindData did on first use.
+//
+//	- every definition is found, whatever the case of the mod name and keybind ID, with its action and params
+//	- a build from the cache finds exactly what a cold build found and parses nothing
+//	- a file that changed size or write time is parsed again, a removed one drops out, the rest come from the cache
+//	- a truncated cache and a malformed keybinds.json are survived, a later definition of a keybind wins
+//	- what the parse workers have to report is logged by the thread building the store
+
+namespace
+{
+	UInt32	s_numMods = 300;
+	UInt32	s_numKeybinds = 12;
+
+	const char	* kActionTypes[] = { "CallFunction", "CallGlobalFunction", "RunConsoleCommand", "SendEvent" };
+
+	std::string ModName(UInt32 mod)
+	{
+		char	buf[32];
+		snprintf(buf, sizeof(buf), "Mod%04u", mod);
+		return buf;
+	}
+
+	std::string KeybindID(UInt32 index)
+	{
+		return "hotkey_" + std::to_string(index);
+	}
+
+	std::string MakeKeybindsJSON(UInt32 mod, UInt32 numKeybinds, const char * descSuffix = "")
+	{
+		Json::Value	json;
+		json["modName"] = ModName(mod);
+
+		for (UInt32 i = 0; i < numKeybinds; i++)
+		{
+			Json::Value	keybind, action;
+			keybind["id"] = KeybindID(i);
+			keybind["desc"] = "Keybind " + std::to_string(i) + descSuffix;
+
+			action["type"] = kActionTypes[i % 4];
+			action["form"] = ModName(mod) + ".esp|" + std::to_string(0x800 + i);
+			action["function"] = "OnHotkey" + std::to_string(i);
+			action["script"] = "HotkeyScript";
+			action["command"] = "player.additem f " + std::to_string(i);
+
+			action["params"][0] = (int)(mod * 100 + i);
+			action["params"][1] = (i & 1) != 0;
+			action["params"][2] = 0.5 + i;
+			action["params"][3] = "param " + std::to_string(i);
+
+			keybind["action"] = action;
+			json["keybinds"][i] = keybind;
+		}
+
+		return Json::StyledWriter().write(json);
+	}
+
+	std::string ModDir(const std::string & configDir, UInt32 mod)
+	{
+		return configDir + ModName(mod);
+	}
+
+	void WriteMod(const std::string & configDir, UInt32 mod, const std::string & text)
+	{
+		mkdir(ModDir(configDir, mod).c_str(), 0755);
+		Test::WriteTextFile(ModDir(configDir, mod) + "/keybinds.json", text);
+	}
+
+	// moves the write time without changing the contents
+	void Touch(const std::string & path, UInt32 seconds)
+	{
+		struct timeval	times[2] = { { seconds, 0 }, { seconds, 0 } };
+		CHECK(!utimes(path.c_str(), times));
+	}
+
+	std::string Upper(std::string str)
+	{
+		for (auto & c : str)
+			c = toupper(c);
+		return str;
+	}
+
+	bool Matches(const KeybindDefinition * definition, UInt32 mod, UInt32 i)
+	{
+		if (!definition || definition->params.size() != 4)
+			return false;
+
+		const auto	& params = definition->params;
+
+		return definition->modName == ModName(mod) && definition->keybindID == KeybindID(i) &&
+			definition->actionType == kActionTypes[i % 4] && definition->function == "OnHotkey" + std::to_string(i) &&
+			definition->form == ModName(mod) + ".esp|" + std::to_string(0x800 + i) &&
+			params[0].type == KeybindDefinition::Param::kType_Int && params[0].iValue == (SInt32)(mod * 100 + i) &&
+			params[1].type == KeybindDefinition::Param::kType_Bool && params[1].bValue == ((i & 1) != 0) &&
+			params[2].type == KeybindDefinition::Param::kType_Float && params[2].fValue == 0.5f + i &&
+			params[3].type == KeybindDefinition::Param::kType_String && params[3].sValue == "param " + std::to_string(i);
+	}
+
+	bool FindsAll(const KeybindStore & store, UInt32 numMods)
+	{
+		bool	found = true;
+
+		for (UInt32 mod = 0; mod < numMods; mod++)
+		{
+			for (UInt32 i = 0; i < s_numKeybinds; i++)
+			{
+				found &= Matches(store.Find(ModName(mod).c_str(), KeybindID(i).c_str()), mod, i);
+				found &= store.Find(Upper(ModName(mod)).c_str(), Upper(KeybindID(i)).c_str()) == store.Find(ModName(mod).c_str(), KeybindID(i).c_str());
+			}
+		}
+
+		return found;
+	}
+
+	void CheckBuilds(const std::string & root)
+	{
+		std::string	configDir = root + "/Config/";
+		std::string	cachePath = root + "/Keybinds.cache";
+
+		CHECK(!system(("mkdir -p '" + configDir + "'").c_str()));
+
+		const UInt32	numMods = 20;
+		for (UInt32 mod = 0; mod < numMods; mod++)
+			WriteMod(configDir, mod, MakeKeybindsJSON(mod, s_numKeybinds));
+
+		// a mod folder without keybinds is skipped
+		CHECK(!system(("mkdir -p '" + configDir + "NoKeybinds'").c_str()));
+
+		KeybindStore	cold;
+		cold.Build(configDir.c_str(), cachePath.c_str());
+
+		CHECK(cold.GetNumFilesParsed() == numMods);
+		CHECK(cold.GetNumFilesCached() == 0);
+		CHECK(cold.GetNumDefinitions() == numMods * s_numKeybinds);
+		CHECK(FindsAll(cold, numMods));
+		CHECK(cold.Find(ModName(0).c_str(), "missing") == nullptr);
+		CHECK(cold.Find("NoSuchMod", KeybindID(0).c_str()) == nullptr);
+
+		KeybindStore	cached;
+		cached.Build(configDir.c_str(), cachePath.c_str());
+
+		CHECK(cached.GetNumFilesParsed() == 0);
+		CHECK(cached.GetNumFilesCached() == numMods);
+		CHECK(cached.GetNumDefinitions() == numMods * s_numKeybinds);
+		CHECK(FindsAll(cached, numMods));
+
+		// one file grows, one keeps its size with a new write time, one goes away
+		WriteMod(configDir, 3, MakeKeybindsJSON(3, s_numKeybinds, " (updated)"));
+		Touch(ModDir(configDir, 4) + "/keybinds.json", 1000000000);
+		CHECK(!system(("rm -rf '" + ModDir(configDir, numMods - 1) + "'").c_str()));
+
+		KeybindStore	changed;
+		changed.Build(configDir.c_str(), cachePath.c_str());
+
+		CHECK(changed.GetNumFilesParsed() == 2);
+		CHECK(changed.GetNumFilesCached() == numMods - 3);
+		CHECK(changed.GetNumDefinitions() == (numMods - 1) * s_numKeybinds);
+		CHECK(FindsAll(changed, numMods - 1));
+		CHECK(changed.Find(ModName(3).c_str(), KeybindID(1).c_str())->keybindDesc == "Keybind 1 (updated)");
+		CHECK(changed.Find(ModName(numMods - 1).c_str(), KeybindID(0).c_str()) == nullptr);
+
+		// and the cache written then is current
+		KeybindStore	again;
+		again.Build(configDir.c_str(), cachePath.c_str());
+
+		CHECK(again.GetNumFilesParsed() == 0);
+		CHECK(FindsAll(again, numMods - 1));
+
+		// a truncated cache is rebuilt from the files
+		CHECK(!truncate(cachePath.c_str(), 100));
+
+		KeybindStore	truncated;
+		truncated.Build(configDir.c_str(), cachePath.c_str());
+
+		CHECK(truncated.GetNumFilesParsed() == numMods - 1);
+		CHECK(FindsAll(truncated, numMods - 1));
+
+		// a malformed file defines nothing, and a mod that redefines another's keybind wins by folder order
+		WriteMod(configDir, 5, "{ \"modName\": \"Mod0005\", \"keybinds\": [ { \"id\": ");
+
+		Json::Value		json;
+		Json::Reader().parse(MakeKeybindsJSON(0, 1, " (override)"), json);
+		Test::WriteTextFile(configDir + "NoKeybinds/keybinds.json", Json::StyledWriter().write(json));
+
+		// a param of a type that can't be registered is dropped and logged
+		Json::Reader().parse(MakeKeybindsJSON(7, 1), json);
+		json["keybinds"][0]["action"]["params"][0] = Json::Value();
+		WriteMod(configDir, 7, Json::StyledWriter().write(json));
+
+		std::string	logPath = root + "/keybinds.log";
+		IDebugLog::Open(logPath.c_str());
+
+		KeybindStore	mixed;
+		mixed.Build(configDir.c_str(), cachePath.c_str());
+
+		CHECK(Test::ReadTextFile(logPath).find("Cannot register unknown parameter value type: 0") != std::string::npos);
+		CHECK(mixed.Find(ModName(7).c_str(), KeybindID(0).c_str()) != nullptr);
+
+		CHECK(mixed.Find(ModName(5).c_str(), KeybindID(0).c_str()) == nullptr);
+		CHECK(mixed.Find(ModName(6).c_str(), KeybindID(0).c_str()) != nullptr);
+		CHECK(mixed.Find(ModName(0).c_str(), KeybindID(0).c_str())->keybindDesc == "Keybind 0 (override)");
+		CHECK(mixed.Find(ModName(0).c_str(), KeybindID(1).c_str())->keybindDesc == "Keybind 1");
+	}
+
+	// what GetKeybindData did the first time a mod's keybind was asked for
+	UInt32 LegacyParse(const std::string & configDir, UInt32 numMods)
+	{
+		UInt32	numDefinitions = 0;
+
+		for (UInt32 mod = 0; mod < numMods; mod++)
+		{
+			std::ifstream	file(ModDir(configDir, mod) + "/keybinds.json");
+			Json::Value		json;
+			Json::Reader	reader;
+			reader.parse(file, json);
+
+			numDefinitions += json["keybinds"].size();
+		}
+
+		return numDefinitions;
+	}
+
+	void RunBench(const std::string & root)
+	{
+		std::string	configDir = root + "/Config/";
+		std::string	cachePath = root + "/Keybinds.cache";
+
+		CHECK(!system(("mkdir -p '" + configDir + "'").c_str()));
+
+		for (UInt32 mod = 0; mod < s_numMods; mod++)
+			WriteMod(configDir, mod, MakeKeybindsJSON(mod, s_numKeybinds));
+
+		UInt32	legacyDefinitions = 0;
+
+		double	legacy = Test::Time([&]() { legacyDefinitions = LegacyParse(configDir, s_numMods); });
+
+		KeybindStore	cold;
+		double	coldTime = Test::Time([&]() { cold.Build(configDir.c_str(), cachePath.c_str()); });
+
+		KeybindStore	cached;
+		double	cachedTime = Test::Time([&]() { cached.Build(configDir.c_str(), cachePath.c_str()); });
+
+		CHECK(legacyDefinitions == s_numMods * s_numKeybinds);
+		CHECK(cold.GetNumDefinitions() == legacyDefinitions);
+		CHECK(cached.GetNumFilesCached() == s_numMods);
+		CHECK(FindsAll(cached, s_numMods));
+
+		printf("keybind definitions: %u mods, %u keybinds each\n", s_numMods, s_numKeybinds);
+		printf("  parse every keybinds.json, one thread (old) %9.1f ms\n", legacy);
+		printf("  KeybindStore cold build                     %9.1f ms\n", coldTime);
+		printf("  KeybindStore build from cache               %9.1f ms\n", cachedTime);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if (Test::IsQuick(argc, argv))
+		s_numMods = 40;
+
+	CheckBuilds(Test::MakeTempDir("keybindstore_checks"));
+	RunBench(Test::MakeTempDir("keybindstore_bench"));
+
+	return Test::Finish("KeybindStoreBench");
+}
@@ -0,0 +1,241 @@
+#include "f4mcm/src/KeybindTable.h"
+#include "common/ICriticalSection.h"
+#include "f4se/GameTypes.h"
+#include "support/TestSupport.h"
+#include "support/AllocCounter.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Key presses against registered MCM keybinds, through KeybindTable snapshots and through the locked
+// std::map lookup, count then operator[], and KeybindParameters copy that MCMInput::OnButtonEvent did.
+// Reports presses per millisecond, most of them on keys with nothing bound.
+//
+//	- every keycode and modifier combination finds what a std::map of the same keybinds holds
+//	- rebinding a key replaces its action, modifiers no key press can produce are refused
+//	- the modifier mask is empty for unbound keys, so they skip reading the modifier state
+//	- a press allocates nothing
+
+namespace
+{
+	UInt32	s_numKeybinds = 300;
+	UInt32	s_numPresses = 2000000;
+
+	// keyboard, mouse and gamepad keycodes, see InputMap
+	const UInt32	kNumKeycodes = 282;
+
+	struct Keybind
+	{
+		UInt32	keycode;
+		UInt8	modifiers;
+
+		bool operator<(const Keybind & rhs) const
+		{
+			return keycode != rhs.keycode ? keycode < rhs.keycode : modifiers < rhs.modifiers;
+		}
+	};
+
+	// KeybindParameters as the old path copied it
+	struct Parameters
+	{
+		BSFixedString		keybindID;
+		BSFixedString		keybindDesc;
+		BSFixedString		modName;
+		UInt8				type;
+		UInt32				targetFormID;
+		BSFixedString		callbackName;
+		BSFixedString		scriptName;
+		std::vector<UInt32>	actionParams;
+	};
+
+	struct Action
+	{
+		UInt8			type;
+		UInt32			targetFormID;
+		BSFixedString	keybindID;
+		BSFixedString	callbackName;
+	};
+
+	typedef KeybindTable<Action>	Table;
+
+	BSFixedString Name(const char * prefix, UInt32 i)
+	{
+		return BSFixedString((std::string(prefix) + std::to_string(i)).c_str());
+	}
+
+	void MakeKeybinds(std::map<Keybind, Parameters> & keybinds, Table & table, UInt32 seed)
+	{
+		std::mt19937	rng(seed);
+
+		for (UInt32 i = 0; i < s_numKeybinds; i++)
+		{
+			Keybind		kb = { (UInt32)(rng() % kNumKeycodes), (UInt8)(rng() % 4 ? 0 : rng() % 8) };
+			Parameters	kp = { Name("id", i), Name("desc", i), Name("mod", i % 40), (UInt8)(i % 4), i, Name("callback", i), Name("script", i), { 1, 2, 3 } };
+
+			keybinds[kb] = kp;
+		}
+
+		for (auto & entry : keybinds)
+			table.Add(entry.first.keycode, entry.first.modifiers, { entry.second.type, entry.second.targetFormID, entry.second.keybindID, entry.second.callbackName });
+	}
+
+	void CheckAgainstMap(void)
+	{
+		std::map<Keybind, Parameters>	keybinds;
+		Table							table;
+
+		MakeKeybinds(keybinds, table, 3);
+
+		CHECK(table.Size() == keybinds.size());
+
+		bool	agrees = true;
+
+		for (UInt32 keycode = 0; keycode < kNumKeycodes + 10; keycode++)
+		{
+			UInt8	sets = 0;
+
+			for (UInt8 modifiers = 0; modifiers < 8; modifiers++)
+			{
+				auto			entry = keybinds.find({ keycode, modifiers });
+				const Action	* action = table.Find(keycode, modifiers);
+
+				if (entry == keybinds.end())
+				{
+					agrees &= action == nullptr;
+					continue;
+				}
+
+				sets |= 1 << modifiers;
+				agrees &= action && action->targetFormID == entry->second.targetFormID && action->keybindID == entry->second.keybindID;
+			}
+
+			agrees &= table.GetModifierSets(keycode) == sets;
+		}
+
+		CHECK(agrees);
+	}
+
+	void CheckRebind(void)
+	{
+		Table	table;
+
+		CHECK(table.Find(65, 0) == nullptr);
+		CHECK(table.GetModifierSets(65) == 0);
+
+		CHECK(table.Add(65, 1, { 0, 1, Name("first", 0), Name("callback", 0) }));
+		CHECK(table.Add(65, 1, { 0, 2, Name("second", 0), Name("callback", 0) }));
+		CHECK(table.Size() == 1);
+		CHECK(table.Find(65, 1)->targetFormID == 2);
+		CHECK(table.Find(65, 0) == nullptr);
+		CHECK(table.GetModifierSets(65) == 2);
+
+		CHECK(!table.Add(65, 8, { 0, 3, Name("bad", 0), Name("callback", 0) }));
+		CHECK(!table.Add(Table::kMaxKeycode, 0, { 0, 3, Name("bad", 0), Name("callback", 0) }));
+		CHECK(table.Size() == 1);
+
+		CHECK(table.Find(1000000, 0) == nullptr);
+	}
+
+	namespace Legacy
+	{
+		ICriticalSection				s_lock;
+		std::map<Keybind, Parameters>	s_data;
+
+		UInt32 Press(UInt32 keycode, UInt8 modifiers)
+		{
+			Keybind	kb = { keycode, modifiers };
+
+			s_lock.Enter();
+			if (s_data.count(kb) > 0)
+			{
+				Parameters	kp = s_data[kb];
+				s_lock.Leave();
+
+				return kp.targetFormID;
+			}
+			s_lock.Leave();
+
+			return 0;
+		}
+	}
+
+	void RunBench(void)
+	{
+		Table	* built = new Table;
+		MakeKeybinds(Legacy::s_data, *built, 5);
+
+		std::shared_ptr<const Table>	snapshot(built);
+
+		// mostly movement and other unbound keys, every tenth press on a bound one
+		std::vector<Keybind>	presses(4096);
+		std::mt19937			rng(11);
+		auto					bound = Legacy::s_data.begin();
+
+		for (UInt32 i = 0; i < presses.size(); i++)
+		{
+			if (i % 10)
+			{
+				presses[i] = { (UInt32)(rng() % kNumKeycodes), 0 };
+			}
+			else
+			{
+				presses[i] = bound->first;
+				if (++bound == Legacy::s_data.end())
+					bound = Legacy::s_data.begin();
+			}
+		}
+
+		UInt64	legacySum = 0;
+		UInt64	tableSum = 0;
+
+		double	legacy = Test::Time([&]()
+		{
+			for (UInt32 i = 0; i < s_numPresses; i++)
+			{
+				const Keybind	& kb = presses[i & (presses.size() - 1)];
+				legacySum += Legacy::Press(kb.keycode, kb.modifiers);
+			}
+		});
+
+		UInt64	allocsBefore = Test::GetNumAllocs();
+
+		double	indexed = Test::Time([&]()
+		{
+			for (UInt32 i = 0; i < s_numPresses; i++)
+			{
+				const Keybind	& kb = presses[i & (presses.size() - 1)];
+
+				std::shared_ptr<const Table>	table = std::atomic_load(&snapshot);
+				if (!table->GetModifierSets(kb.keycode))
+					continue;
+
+				const Action	* action = table->Find(kb.keycode, kb.modifiers);
+				if (action)
+					tableSum += action->targetFormID;
+			}
+		});
+
+		CHECK(Test::GetNumAllocs() == allocsBefore);
+		CHECK(legacySum == tableSum);
+
+		printf("key presses: %u keybinds, %u presses, 1 in 10 on a bound key\n", (UInt32)Legacy::s_data.size(), s_numPresses);
+		printf("  std::map + lock + copy (old) %9.1f ms  %8.0f presses/ms\n", legacy, s_numPresses / legacy);
+		printf("  KeybindTable snapshot        %9.1f ms  %8.0f presses/ms\n", indexed, s_numPresses / indexed);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if (Test::IsQuick(argc, argv))
+		s_numPresses = 100000;
+
+	CheckAgainstMap();
+	CheckRebind();
+
+	RunBench();
+
+	return Test::Finish("KeybindTableBench");
+}
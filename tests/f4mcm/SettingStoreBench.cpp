@@ -0,0 +1,150 @@
+#include "SettingStore.h"
+#include "f4mcm/SettingsCorpus.h"
+
+#include <random>
+#include <unordered_map>
+
+// Looks up random settings from a generated MCM setup the way Papyrus and Scaleform poll them,
+// through the old unordered_map keyed by "mod:setting" strings, through SettingStore by name, and
+// through SettingStore handles resolved once.
+
+namespace
+{
+	UInt32	s_numMods = 200;
+	UInt32	s_numKeys = 100;
+	UInt32	s_numLookups = 5000000;
+
+	// the pre-index store, kept here verbatim as the baseline
+
+	class LegacyStore
+	{
+	public:
+		void Register(std::string modName, std::string settingName, const Setting * source)
+		{
+			Setting	* ms = new Setting;
+
+			char	* nameCopy = new char[settingName.size() + 1];
+			std::copy(settingName.begin(), settingName.end(), nameCopy);
+			nameCopy[settingName.size()] = '\0';
+			ms->name = nameCopy;
+			ms->data = source->data;	// strings are shared, nothing is freed
+
+			m_settingStore[modName + ":" + settingName] = ms;
+		}
+
+		Setting * GetModSetting(std::string modName, std::string settingName)
+		{
+			auto itr = m_settingStore.find(modName + ":" + settingName);
+			if (itr != m_settingStore.end()) {
+				return itr->second;
+			}
+			return nullptr;
+		}
+
+		SInt32 GetModSettingInt(std::string modName, std::string settingName)
+		{
+			Setting* ms = GetModSetting(modName, settingName);
+			if (ms) {
+				return ms->data.s32;
+			}
+			return -1;
+		}
+
+	private:
+		std::unordered_map<std::string, Setting*>	m_settingStore;
+	};
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numMods = 20;
+		s_numKeys = 40;
+		s_numLookups = 100000;
+	}
+
+	std::string	root = Test::MakeTempDir("settingstore");
+
+	std::vector <SettingsCorpus::Key>	keys = SettingsCorpus::Write(root, s_numMods, s_numKeys, 4);
+	SettingsCorpus::EnterRoot(root);
+
+	SettingStore	& store = SettingStore::GetInstance();
+	store.ReadSettings();
+
+	// every key reads back with the user value where there is one
+	LegacyStore	legacy;
+
+	for(UInt32 i = 0; i < keys.size(); i++)
+	{
+		const SettingsCorpus::Key	& key = keys[i];
+
+		UInt32	mod = atoi(key.mod.c_str() + 3);
+		UInt32	index = atoi(key.setting.c_str() + 8);
+		bool	user = SettingsCorpus::IsUser(mod, index, 4);
+
+		switch(key.type)
+		{
+			case 'i':	CHECK(store.GetModSettingInt(key.mod.c_str(), key.setting.c_str()) == SettingsCorpus::GetInt(key.seed, user)); break;
+			case 'f':	CHECK(store.GetModSettingFloat(key.mod.c_str(), key.setting.c_str()) == SettingsCorpus::GetFloat(key.seed, user)); break;
+			case 'b':	CHECK(store.GetModSettingBool(key.mod.c_str(), key.setting.c_str()) == SettingsCorpus::GetBool(key.seed, user)); break;
+			case 's':	CHECK(SettingsCorpus::GetString(key.seed, user) == store.GetModSettingString(key.mod.c_str(), key.setting.c_str())); break;
+		}
+
+		SettingStore::SettingHandle	handle = store.GetModSettingHandle(key.mod.c_str(), key.setting.c_str());
+		CHECK(handle != SettingStore::kInvalidHandle);
+
+		legacy.Register(key.mod, key.setting, store.GetModSetting(handle));
+	}
+
+	CHECK(store.GetModSettingHandle("Mod0000", "iMissing:Main") == SettingStore::kInvalidHandle);
+	CHECK(store.GetModSettingHandle("NoSuchMod", keys[0].setting.c_str()) == SettingStore::kInvalidHandle);
+
+	// the same random sequence of integer settings for every variant
+	std::vector <UInt32>	order(s_numLookups);
+	std::vector <UInt32>	intKeys;
+	std::mt19937			rng(42);
+
+	for(UInt32 i = 0; i < keys.size(); i++)
+		if(keys[i].type == 'i')
+			intKeys.push_back(i);
+
+	for(UInt32 i = 0; i < s_numLookups; i++)
+		order[i] = intKeys[rng() % intKeys.size()];
+
+	printf("settingstore: %u settings in %u mods, %u lookups\n", (UInt32)keys.size(), s_numMods, s_numLookups);
+
+	SInt64	legacySum = 0;
+	double	legacyTime = Test::Time([&]()
+	{
+		for(UInt32 i : order)
+			legacySum += legacy.GetModSettingInt(keys[i].mod, keys[i].setting);
+	});
+
+	SInt64	nameSum = 0;
+	double	nameTime = Test::Time([&]()
+	{
+		for(UInt32 i : order)
+			nameSum += store.GetModSettingInt(keys[i].mod.c_str(), keys[i].setting.c_str());
+	});
+
+	std::vector <SettingStore::SettingHandle>	handles(keys.size());
+	for(UInt32 i = 0; i < keys.size(); i++)
+		handles[i] = store.GetModSettingHandle(keys[i].mod.c_str(), keys[i].setting.c_str());
+
+	SInt64	handleSum = 0;
+	double	handleTime = Test::Time([&]()
+	{
+		for(UInt32 i : order)
+			handleSum += store.GetModSetting(handles[i])->data.s32;
+	});
+
+	printf("%-34s %9.2f ms %8.1f ns/lookup\n", "unordered_map<string> (old)", legacyTime, legacyTime * 1e6 / s_numLookups);
+	printf("%-34s %9.2f ms %8.1f ns/lookup\n", "SettingStore by name", nameTime, nameTime * 1e6 / s_numLookups);
+	printf("%-34s %9.2f ms %8.1f ns/lookup\n", "SettingStore by handle", handleTime, handleTime * 1e6 / s_numLookups);
+
+	CHECK(legacySum == nameSum);
+	CHECK(legacySum == handleSum);
+
+	return Test::Finish("SettingStoreBench");
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "support/TestSupport.h"
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Generated MCM configs under <root>/Data/MCM, laid out the way ReadSettings finds them:
+// Config\<mod>\settings.ini holds the defaults, Settings\<mod>.ini the user's overrides.
+// Values are a function of the mod, section and key so the tests can check any of them.
+
+namespace SettingsCorpus
+{
+	struct Key
+	{
+		std::string	mod;
+		std::string	setting;	// name:section like SettingStore keys them
+		char		type;		// first letter of the name, i f b or s
+		UInt32		seed;
+	};
+
+	inline const char * GetModName(UInt32 mod, char * buf, size_t bufLength)
+	{
+		snprintf(buf, bufLength, "Mod%04u", mod);
+		return buf;
+	}
+
+	inline SInt32		GetInt(UInt32 seed, bool user)		{ return (SInt32)(seed * 2654435761u >> 8) - (user ? 7 : 0); }
+	inline float		GetFloat(UInt32 seed, bool user)	{ return (seed % 1000) * 0.25f + (user ? 0.5f : 0); }
+	inline bool			GetBool(UInt32 seed, bool user)		{ return ((seed >> 3) & 1) != user; }
+	inline std::string	GetString(UInt32 seed, bool user)	{ return (user ? "user " : "value ") + std::to_string(seed); }
+
+	// every third key of a mod is overridden when the mod has a user file
+	inline bool	IsUser(UInt32 mod, UInt32 index, UInt32 userEvery)	{ return userEvery && !(mod % userEvery) && !(index % 3); }
+
+	inline std::string FormatValue(char type, UInt32 seed, bool user)
+	{
+		switch(type)
+		{
+			case 'i':	return std::to_string(GetInt(seed, user));
+			case 'f':	return std::to_string(GetFloat(seed, user));
+			case 'b':	return GetBool(seed, user) ? "1" : "0";
+			default:	return GetString(seed, user);
+		}
+	}
+
+	// writes numMods mods of numKeys settings each, spread over a few sections, with user files for every
+	// userEvery'th mod, and returns the keys in file order
+	inline std::vector <Key> Write(const std::string & root, UInt32 numMods, UInt32 numKeys, UInt32 userEvery)
+	{
+		static const char	kTypes[] = { 'i', 'f', 'b', 's' };
+		static const char	* kSections[] = { "Main", "Display", "Hotkeys", "Advanced" };
+
+		std::vector <Key>	keys;
+		std::string			settingsDir = root + "/Data/MCM/Settings";
+
+		CHECK(!system(("mkdir -p '" + settingsDir + "'").c_str()));
+
+		for(UInt32 mod = 0; mod < numMods; mod++)
+		{
+			char	modName[16];
+			GetModName(mod, modName, sizeof(modName));
+
+			std::string	configDir = root + "/Data/MCM/Config/" + modName;
+			CHECK(!system(("mkdir -p '" + configDir + "'").c_str()));
+
+			std::string	defaults = "; generated defaults\r\n";
+			std::string	user;
+
+			for(UInt32 section = 0; section < 4; section++)
+			{
+				std::string	header = std::string("[") + kSections[section] + "]\r\n";
+				std::string	userLines;
+
+				defaults += header;
+
+				for(UInt32 i = section; i < numKeys; i += 4)
+				{
+					Key	key;
+					key.mod = modName;
+					key.type = kTypes[i % 4];
+					key.seed = mod * 100003 + i;
+					key.setting = std::string(1, key.type) + "Setting" + std::to_string(i) + ":" + kSections[section];
+
+					std::string	name = key.setting.substr(0, key.setting.find(':'));
+
+					// a little of everything the parser has to cope with
+					defaults += (i % 7 ? name + "=" : "  " + name + " = ") + FormatValue(key.type, key.seed, false) + "\r\n";
+					if(i % 11 == 0)
+						defaults += "; comment " + std::to_string(i) + "\r\n";
+
+					if(IsUser(mod, i, userEvery))
+						userLines += name + "=" + FormatValue(key.type, key.seed, true) + "\n";
+
+					keys.push_back(key);
+				}
+
+				if(!userLines.empty())
+					user += std::string("[") + kSections[section] + "]\n" + userLines;
+			}
+
+			Test::WriteTextFile(configDir + "/settings.ini", defaults);
+
+			if(!user.empty())
+				Test::WriteTextFile(settingsDir + "/" + modName + ".ini", user);
+		}
+
+		return keys;
+	}
+
+	// ReadSettings works relative to the game directory
+	inline void EnterRoot(const std::string & root)
+	{
+		CHECK(!chdir(root.c_str()));
+	}
+}
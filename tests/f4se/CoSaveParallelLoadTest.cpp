@@ -0,0 +1,339 @@
+#include "f4se/Serialization.h"
+#include "f4se/PluginManager.h"
+#include "support/TestSupport.h"
+
+#include <atomic>
+#include <thread>
+
+// Fake plugins saving and loading through Serialization, some registered with SetLoadCallback and
+// some with SetThreadSafeLoadCallback. Checks the ordering guarantees of HandleLoadGlobalData and
+// measures the speed-up of decoding every plugin on the worker pool.
+//
+//	- serial callbacks run on the calling thread, in file order
+//	- thread-safe callbacks never run on the calling thread
+//	- every callback reads exactly its own records, the cursors are per thread
+//	- a FindRecord miss leaves no record open to read from
+//	- all callbacks have returned before HandleLoadGlobalData does
+//	- plugins without data are called after all of that, as before
+//	- a callback that throws on a worker is logged by the calling thread, the others still load
+//	- a block claiming more than its compressed data can decode to is logged and loads without records
+
+namespace
+{
+	UInt32	s_numPlugins = 32;
+	UInt32	s_recordsPerPlugin = 200;
+	UInt32	s_decodeRounds = 0;		// simulated per-record decode work for the timing runs
+
+	// plugins save in handle order, so the callback can tell which one it is standing in for
+	UInt32	s_savingPlugin = 0;
+
+	struct LoadInfo
+	{
+		std::atomic <UInt32>	calls;
+		std::atomic <bool>		finished;
+		bool					onCallingThread;
+		UInt32					sequence;
+		bool					dataValid;
+	};
+
+	LoadInfo				s_loads[256];
+	std::atomic <UInt32>	s_loadSequence(0);
+	std::atomic <UInt32>	s_running(0);
+	std::atomic <UInt32>	s_maxRunning(0);
+	std::atomic <UInt32>	s_noDataCalls(0);
+	std::thread::id			s_callingThread;
+
+	UInt32 RecordValue(UInt32 plugin, UInt32 record, UInt32 i)
+	{
+		return (plugin << 24) ^ (record * 2654435761u) ^ i;
+	}
+
+	void SaveCallback(const F4SESerializationInterface * intfc)
+	{
+		UInt32	plugin = s_savingPlugin++;
+
+		// the last plugin has no data, it still gets a load callback
+		if(plugin == s_numPlugins)
+			return;
+
+		intfc->WriteRecord('PLGN', 1, &plugin, sizeof(plugin));
+
+		for(UInt32 i = 0; i < s_recordsPerPlugin; i++)
+		{
+			intfc->OpenRecord('DATA', 1);
+
+			UInt32	length = 4 + (plugin + i) % 16;
+			for(UInt32 j = 0; j < length; j++)
+			{
+				UInt32	value = RecordValue(plugin, i, j);
+				intfc->WriteRecordData(&value, sizeof(value));
+			}
+		}
+	}
+
+	void LoadCallback(const F4SESerializationInterface * intfc)
+	{
+		UInt32	type, version, length;
+		UInt32	plugin;
+
+		if(!intfc->GetNextRecordInfo(&type, &version, &length))
+		{
+			s_noDataCalls++;
+			return;
+		}
+
+		UInt32	running = ++s_running;
+		UInt32	maxRunning = s_maxRunning;
+		while(running > maxRunning && !s_maxRunning.compare_exchange_weak(maxRunning, running)) { }
+
+		bool	valid = (type == 'PLGN') && intfc->ReadRecordData(&plugin, sizeof(plugin)) == sizeof(plugin) && plugin < s_numPlugins;
+
+		if(valid)
+		{
+			LoadInfo	& info = s_loads[plugin];
+
+			info.sequence = s_loadSequence++;
+			info.onCallingThread = std::this_thread::get_id() == s_callingThread;
+			info.calls++;
+
+			UInt32	record = 0;
+			UInt32	checksum = 0;
+
+			while(intfc->GetNextRecordInfo(&type, &version, &length))
+			{
+				UInt32	expectedLength = (4 + (plugin + record) % 16) * sizeof(UInt32);
+
+				UInt32	spanLength = 0;
+				const UInt32	* data = (const UInt32 *)intfc->ReadRecordDataSpan(length, &spanLength);
+
+				valid &= (type == 'DATA') && (length == expectedLength) && (spanLength == length);
+
+				for(UInt32 j = 0; valid && j < length / sizeof(UInt32); j++)
+				{
+					UInt32	value;
+					memcpy(&value, data + j, sizeof(value));
+
+					valid &= value == RecordValue(plugin, record, j);
+
+					for(UInt32 k = 0; k < s_decodeRounds; k++)
+						checksum = (checksum ^ value) * 16777619u;
+				}
+
+				record++;
+			}
+
+			Test::Use(checksum);
+
+			valid &= record == s_recordsPerPlugin;
+
+			// a lookup that misses leaves nothing to read, not the unread part of the record before it
+			UInt32	unread;
+
+			valid &= intfc->FindRecord('PLGN', &version, &length) && !intfc->FindRecord('NONE', &version, &length);
+			valid &= intfc->ReadRecordData(&unread, sizeof(unread)) == 0;
+
+			info.dataValid = valid;
+			info.finished = true;
+		}
+
+		s_running--;
+	}
+
+	void ResetLoads(void)
+	{
+		for(UInt32 i = 0; i < s_numPlugins; i++)
+		{
+			s_loads[i].calls = 0;
+			s_loads[i].finished = false;
+			s_loads[i].onCallingThread = false;
+			s_loads[i].sequence = 0;
+			s_loads[i].dataValid = false;
+		}
+
+		s_loadSequence = 0;
+		s_running = 0;
+		s_maxRunning = 0;
+		s_noDataCalls = 0;
+		s_callingThread = std::this_thread::get_id();
+	}
+
+	// every other plugin opts in to the worker pool
+	bool IsThreadSafe(UInt32 plugin)
+	{
+		return (plugin & 1) == 0;
+	}
+
+	void RegisterLoadCallbacks(bool mixed, bool threadSafe)
+	{
+		for(UInt32 i = 0; i <= s_numPlugins; i++)
+		{
+			if(mixed ? IsThreadSafe(i) : threadSafe)
+				Serialization::SetThreadSafeLoadCallback(i, LoadCallback);
+			else
+				Serialization::SetLoadCallback(i, LoadCallback);
+		}
+	}
+
+	void CheckOrdering(void)
+	{
+		RegisterLoadCallbacks(true, false);
+		ResetLoads();
+
+		Serialization::HandleLoadGlobalData();
+
+		UInt32	lastSerialSequence = 0;
+		bool	firstSerial = true;
+
+		for(UInt32 i = 0; i < s_numPlugins; i++)
+		{
+			const LoadInfo	& info = s_loads[i];
+
+			CHECK(info.calls == 1);
+			CHECK(info.finished);
+			CHECK(info.dataValid);
+
+			if(IsThreadSafe(i))
+			{
+				CHECK(!info.onCallingThread);
+			}
+			else
+			{
+				CHECK(info.onCallingThread);
+
+				// serial plugins keep their relative file order
+				CHECK(firstSerial || info.sequence > lastSerialSequence);
+
+				lastSerialSequence = info.sequence;
+				firstSerial = false;
+			}
+		}
+
+		// called once more by the no-data pass after everything above has finished
+		CHECK(s_noDataCalls == 1);
+		CHECK(s_loadSequence == s_numPlugins);
+
+		printf("mixed load: %u plugins, up to %u callbacks running at once\n", s_numPlugins, (UInt32)s_maxRunning);
+	}
+
+	void ThrowingLoadCallback(const F4SESerializationInterface * intfc)
+	{
+		throw 1;
+	}
+
+	void CheckFailedLoad(const std::string & logPath)
+	{
+		RegisterLoadCallbacks(false, true);
+		Serialization::SetThreadSafeLoadCallback(0, ThrowingLoadCallback);
+		ResetLoads();
+
+		IDebugLog::Open(logPath.c_str());
+		Serialization::HandleLoadGlobalData();
+
+		CHECK(Test::ReadTextFile(logPath).find("exception occurred loading 504C3030") != std::string::npos);
+
+		for(UInt32 i = 1; i < s_numPlugins; i++)
+			CHECK(s_loads[i].calls == 1 && s_loads[i].dataValid);
+	}
+
+	void CheckOversizedBlock(const std::string & savePath, const std::string & logPath)
+	{
+		std::string	original = Test::ReadTextFile(savePath);
+		std::string	corrupt = original;
+
+		UInt32	formatVersion;
+		memcpy(&formatVersion, &corrupt[4], sizeof(formatVersion));
+		CHECK(formatVersion == 2);
+
+		// the first plugin's block follows the 20 byte header, rawLength is the last field of its own header
+		UInt32	rawLength = 0xFFFFFF00;
+		memcpy(&corrupt[20 + 12], &rawLength, sizeof(rawLength));
+
+		Test::WriteTextFile(savePath, corrupt);
+
+		RegisterLoadCallbacks(false, false);
+		ResetLoads();
+
+		IDebugLog::Open(logPath.c_str());
+		Serialization::HandleLoadGlobalData();
+
+		CHECK(Test::ReadTextFile(logPath).find("data for 504C3030 can't decompress to FFFFFF00 bytes") != std::string::npos);
+		CHECK(s_loads[0].calls == 0);
+		CHECK(s_noDataCalls == 2);
+
+		for(UInt32 i = 1; i < s_numPlugins; i++)
+			CHECK(s_loads[i].calls == 1 && s_loads[i].dataValid);
+
+		Test::WriteTextFile(savePath, original);
+	}
+
+	double TimeLoad(bool threadSafe, UInt32 iterations)
+	{
+		RegisterLoadCallbacks(false, threadSafe);
+
+		double	milliseconds = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < iterations; i++)
+			{
+				ResetLoads();
+				Serialization::HandleLoadGlobalData();
+			}
+		});
+
+		for(UInt32 i = 0; i < s_numPlugins; i++)
+		{
+			CHECK(s_loads[i].calls == 1);
+			CHECK(s_loads[i].dataValid);
+		}
+
+		return milliseconds / iterations;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	UInt32	iterations = 5;
+	UInt32	decodeRounds = 64;
+
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numPlugins = 12;
+		s_recordsPerPlugin = 50;
+		iterations = 1;
+		decodeRounds = 4;
+	}
+
+	std::string	root = Test::MakeTempDir("cosave_load");
+	CHECK(!system(("mkdir -p '" + root + "/My Games/Fallout4VR/Saves'").c_str()));
+
+	TestWin32::SetFolderPath(root.c_str());
+
+	Serialization::Init();
+
+	for(UInt32 i = 0; i <= s_numPlugins; i++)
+	{
+		Serialization::SetUniqueID(i, 'PL00' + i);
+		Serialization::SetSaveCallback(i, SaveCallback);
+	}
+
+	Serialization::SetSaveName("parallel");
+
+	s_savingPlugin = 0;
+	Serialization::HandleSaveGlobalData();
+
+	CheckOrdering();
+	CheckFailedLoad(root + "/load.log");
+	CheckOversizedBlock(root + "/My Games/Fallout4VR/Saves//parallel.f4se", root + "/oversized.log");
+
+	s_decodeRounds = decodeRounds;
+
+	double	serial = TimeLoad(false, iterations);
+	double	parallel = TimeLoad(true, iterations);
+
+	printf("load %u plugins x %u records (%u hardware threads):\n", s_numPlugins, s_recordsPerPlugin, std::thread::hardware_concurrency());
+	printf("  SetLoadCallback            %9.2f ms\n", serial);
+	printf("  SetThreadSafeLoadCallback  %9.2f ms  (%.2fx)\n", parallel, serial / parallel);
+
+	Serialization::SetSaveName(NULL);
+
+	return Test::Finish("CoSaveParallelLoadTest");
+}
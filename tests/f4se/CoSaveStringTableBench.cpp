@@ -0,0 +1,278 @@
+#include "f4se/Serialization.h"
+#include "f4se/PluginManager.h"
+#include "support/TestSupport.h"
+#include "support/AllocCounter.h"
+
+#include <cstdlib>
+#include <vector>
+
+// Synthetic event registrations saved the way EventRegistration::Save writes them, a handle, a script name and a
+// callback name each, with the strings inline as InternalEventVersion 2 has them and through the co-save string
+// table as version 3 does. Reports the co-save size, compressed and not, and the save and load time of each.
+//
+//	- every registration loads back as saved in both layouts, and each plugin's references resolve in its own table
+//	- the table record is hidden from the plugin, its own records come back in order and FindRecord doesn't see it
+//	- a co-save without a table still loads, a reference past the end of the table fails the read
+//	- reading a string back allocates nothing once the string cache has it
+
+namespace
+{
+	enum
+	{
+		kNumPlugins =		2,
+		kNumScripts =		300,
+		kNumCallbacks =		40,
+
+		kVersion_Inline =	2,
+		kVersion_Table =	3,
+	};
+
+	UInt32	s_numRegs = 50000;
+
+	// short enough to stay in std::string's own buffer, the fake string cache allocates for anything longer
+	std::vector <BSFixedString>	s_scripts;
+	std::vector <BSFixedString>	s_callbacks;
+
+	std::string	s_longName;
+
+	UInt32	s_version = kVersion_Table;
+	UInt32	s_savingPlugin = 0;
+
+	UInt64 RegHandle(UInt32 plugin, UInt32 i)
+	{
+		return 0xFF00000000000000ull | ((UInt64)plugin << 32) | i;
+	}
+
+	// plugins index the names from a different start, so their tables differ
+	const BSFixedString & RegScript(UInt32 plugin, UInt32 i)	{ return s_scripts[(i * 7 + plugin * 13) % kNumScripts]; }
+	const BSFixedString & RegCallback(UInt32 plugin, UInt32 i)	{ return s_callbacks[(i + plugin * 5) % kNumCallbacks]; }
+
+	bool WriteString(const F4SESerializationInterface * intfc, const BSFixedString * str)
+	{
+		return s_version >= kVersion_Table ? Serialization::WriteDataRef(intfc, str) : Serialization::WriteData(intfc, str);
+	}
+
+	bool ReadString(const F4SESerializationInterface * intfc, UInt32 version, BSFixedString * str)
+	{
+		return version >= kVersion_Table ? Serialization::ReadDataRef(intfc, str) : Serialization::ReadData(intfc, str);
+	}
+
+	void SaveCallback(const F4SESerializationInterface * intfc)
+	{
+		UInt32	plugin = s_savingPlugin++;
+
+		// the odd ones out, an empty string and one whose length takes two varint bytes
+		BSFixedString	empty("");
+		BSFixedString	longName(s_longName.c_str());
+
+		intfc->OpenRecord('HEAD', s_version);
+		WriteString(intfc, &empty);
+		WriteString(intfc, &longName);
+
+		intfc->OpenRecord('REGS', s_version);
+		intfc->WriteRecordData(&s_numRegs, sizeof(s_numRegs));
+
+		for(UInt32 i = 0; i < s_numRegs; i++)
+		{
+			UInt64	handle = RegHandle(plugin, i);
+
+			intfc->WriteRecordData(&handle, sizeof(handle));
+			WriteString(intfc, &RegScript(plugin, i));
+			WriteString(intfc, &RegCallback(plugin, i));
+		}
+
+		// a reference no table has
+		UInt8	badRef[] = { 0xFF, 0xFF, 0x03 };
+		intfc->WriteRecord('TAIL', s_version, badRef, sizeof(badRef));
+	}
+
+	struct LoadResult
+	{
+		bool	regsValid;
+		bool	recordsValid;
+		bool	badRefFailed;
+		UInt64	numAllocs;	// while reading the registrations
+	};
+
+	LoadResult	s_results[kNumPlugins];
+	UInt32		s_loadingPlugin = 0;
+
+	void LoadCallback(const F4SESerializationInterface * intfc)
+	{
+		LoadResult	& result = s_results[s_loadingPlugin];
+		UInt32		plugin = s_loadingPlugin++;
+
+		UInt32	type, version, length;
+		UInt32	expectedTypes[] = { 'HEAD', 'REGS', 'TAIL' };
+		UInt32	numRecords = 0;
+
+		result.recordsValid = !intfc->FindRecord(F4SESerializationInterface::kStringTableType, &version, &length);
+
+		while(intfc->GetNextRecordInfo(&type, &version, &length))
+		{
+			result.recordsValid &= numRecords < 3 && type == expectedTypes[numRecords];
+			numRecords++;
+
+			switch(type)
+			{
+			case 'HEAD':
+				{
+					BSFixedString	empty, longName;
+
+					result.recordsValid &= ReadString(intfc, version, &empty) && ReadString(intfc, version, &longName);
+					result.recordsValid &= !strcmp(longName.c_str(), s_longName.c_str());
+
+					// ReadData leaves an empty string alone
+					result.recordsValid &= version < kVersion_Table ? empty.c_str() == nullptr : !strcmp(empty.c_str(), "");
+				}
+				break;
+
+			case 'REGS':
+				{
+					UInt32	numRegs = 0;
+					intfc->ReadRecordData(&numRegs, sizeof(numRegs));
+
+					bool	valid = numRegs == s_numRegs;
+					UInt64	before = Test::GetNumAllocs();
+
+					for(UInt32 i = 0; valid && i < numRegs; i++)
+					{
+						UInt64			handle = 0;
+						BSFixedString	script, callback;
+
+						valid &= intfc->ReadRecordData(&handle, sizeof(handle)) == sizeof(handle);
+						valid &= ReadString(intfc, version, &script) && ReadString(intfc, version, &callback);
+
+						valid &= handle == RegHandle(plugin, i);
+						valid &= script == RegScript(plugin, i) && callback == RegCallback(plugin, i);
+					}
+
+					result.numAllocs = Test::GetNumAllocs() - before;
+					result.regsValid = valid;
+				}
+				break;
+
+			case 'TAIL':
+				{
+					BSFixedString	str;
+
+					result.badRefFailed = version < kVersion_Table || (!ReadString(intfc, version, &str) && intfc->ReadStringRef(NULL) == NULL);
+				}
+				break;
+			}
+		}
+
+		result.recordsValid &= numRecords == 3;
+	}
+
+	void CheckLoad(void)
+	{
+		for(UInt32 i = 0; i < kNumPlugins; i++)
+			s_results[i] = LoadResult();
+
+		s_loadingPlugin = 0;
+		Serialization::HandleLoadGlobalData();
+
+		CHECK(s_loadingPlugin == kNumPlugins);
+
+		for(UInt32 i = 0; i < kNumPlugins; i++)
+		{
+			CHECK(s_results[i].regsValid);
+			CHECK(s_results[i].recordsValid);
+			CHECK(s_results[i].badRefFailed);
+			CHECK(s_results[i].numAllocs == 0);
+		}
+	}
+
+	struct Result
+	{
+		UInt64	rawSize;
+		UInt64	compressedSize;
+		double	saveTime;
+		double	loadTime;
+	};
+
+	void Configure(bool compress)
+	{
+		Test::SetConfigOption("Serialization", "bCompressCoSave", compress ? "1" : "0");
+		Serialization::Init();
+	}
+
+	double Save(void)
+	{
+		return Test::Time([&]()
+		{
+			s_savingPlugin = 0;
+			Serialization::HandleSaveGlobalData();
+		});
+	}
+
+	Result Run(const std::string & savePath, UInt32 version)
+	{
+		Result	result;
+
+		s_version = version;
+
+		Configure(true);
+		Save();
+		result.compressedSize = Test::ReadTextFile(savePath).size();
+
+		// the first load interns the strings, the checked and timed one runs after it
+		CheckLoad();
+		result.loadTime = Test::Time([&]() { CheckLoad(); });
+
+		Configure(false);
+		result.saveTime = Save();
+		result.rawSize = Test::ReadTextFile(savePath).size();
+
+		CheckLoad();
+
+		return result;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+		s_numRegs = 2000;
+
+	for(UInt32 i = 0; i < kNumScripts; i++)
+		s_scripts.push_back(BSFixedString(("Script" + std::to_string(i)).c_str()));
+	for(UInt32 i = 0; i < kNumCallbacks; i++)
+		s_callbacks.push_back(BSFixedString(("OnEvent" + std::to_string(i)).c_str()));
+
+	s_longName.assign(300, 'x');
+
+	std::string	root = Test::MakeTempDir("cosave_strings");
+	std::string	savePath = root + "/My Games/Fallout4VR/Saves//strings.f4se";
+
+	CHECK(!system(("mkdir -p '" + root + "/My Games/Fallout4VR/Saves'").c_str()));
+
+	TestWin32::SetFolderPath(root.c_str());
+
+	Test::SetConfigOption("Serialization", "bAsyncCoSave", "0");
+
+	for(UInt32 i = 0; i < kNumPlugins; i++)
+	{
+		Serialization::SetUniqueID(i, 'PL00' + i);
+		Serialization::SetSaveCallback(i, SaveCallback);
+		Serialization::SetLoadCallback(i, LoadCallback);
+	}
+
+	Serialization::SetSaveName("strings");
+
+	Result	inlined = Run(savePath, kVersion_Inline);
+	Result	table = Run(savePath, kVersion_Table);
+
+	CHECK(table.rawSize < inlined.rawSize);
+	CHECK(table.compressedSize < inlined.compressedSize);
+
+	printf("co-save string table: %u plugins x %u registrations, %u script names, %u callbacks\n", kNumPlugins, s_numRegs, kNumScripts, kNumCallbacks);
+	printf("                           uncompressed   compressed    save ms    load ms\n");
+	printf("  inline strings (old)    %10llu B %10llu B %10.2f %10.2f\n", (unsigned long long)inlined.rawSize, (unsigned long long)inlined.compressedSize, inlined.saveTime, inlined.loadTime);
+	printf("  string table            %10llu B %10llu B %10.2f %10.2f\n", (unsigned long long)table.rawSize, (unsigned long long)table.compressedSize, table.saveTime, table.loadTime);
+
+	Serialization::SetSaveName(NULL);
+
+	return Test::Finish("CoSaveStringTableBench");
+}
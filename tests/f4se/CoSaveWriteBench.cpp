@@ -0,0 +1,348 @@
+#include "f4se/Serialization.h"
+#include "f4se/PluginManager.h"
+#include "common/IFileStream.h"
+#include "f4se_common/f4se_version.h"
+#include "support/TestSupport.h"
+
+#include <vector>
+
+// Writes a synthetic co-save through Serialization::HandleSaveGlobalData and through the old
+// IFileStream writer that seeked back to patch every chunk and plugin header, and reports the time
+// and the file syscalls (write and seek calls at the Win32 boundary) of each. A failed background write has to be
+// reported once the save hook waits for it.
+
+namespace
+{
+	UInt32	s_numPlugins = 100;
+	UInt32	s_recordsPerPlugin = 500;
+
+	// one record the way plugins usually write them, a few fields at a time
+	void WriteRecords(const F4SESerializationInterface * intfc, UInt32 plugin)
+	{
+		for(UInt32 i = 0; i < s_recordsPerPlugin; i++)
+		{
+			UInt32	seed = plugin * 7919 + i;
+
+			intfc->OpenRecord('RECD', 1);
+
+			UInt32	formID = 0x01000000 | seed;
+			UInt32	numValues = 1 + seed % 6;
+
+			intfc->WriteRecordData(&formID, sizeof(formID));
+			intfc->WriteRecordData(&numValues, sizeof(numValues));
+
+			for(UInt32 j = 0; j < numValues; j++)
+			{
+				float	value = seed * 0.5f + j;
+				intfc->WriteRecordData(&value, sizeof(value));
+			}
+
+			std::string	name = "Record_" + std::to_string(seed % 97);
+			Serialization::WriteData(intfc, &name);
+		}
+	}
+
+	// plugins save in handle order, so the callback can tell which one it is standing in for
+	UInt32	s_savingPlugin = 0;
+
+	void SaveCallback(const F4SESerializationInterface * intfc)
+	{
+		WriteRecords(intfc, s_savingPlugin++);
+	}
+
+	// the pre-staging writer, kept here verbatim as the baseline
+
+	namespace Legacy
+	{
+		struct Header
+		{
+			UInt32	signature;
+			UInt32	formatVersion;
+			UInt32	f4seVersion;
+			UInt32	runtimeVersion;
+			UInt32	numPlugins;
+		};
+
+		struct PluginHeader
+		{
+			UInt32	signature;
+			UInt32	numChunks;
+			UInt32	length;
+		};
+
+		struct ChunkHeader
+		{
+			UInt32	type;
+			UInt32	version;
+			UInt32	length;
+		};
+
+		IFileStream		s_currentFile;
+		Header			s_fileHeader;
+		UInt64			s_pluginHeaderOffset;
+		PluginHeader	s_pluginHeader;
+		bool			s_chunkOpen;
+		UInt64			s_chunkHeaderOffset;
+		ChunkHeader		s_chunkHeader;
+
+		void FlushWriteChunk(void)
+		{
+			if(!s_chunkOpen)
+				return;
+
+			UInt64	curOffset = s_currentFile.GetOffset();
+			UInt64	chunkSize = curOffset - s_chunkHeaderOffset - sizeof(s_chunkHeader);
+
+			s_chunkHeader.length = (UInt32)chunkSize;
+
+			s_currentFile.SetOffset(s_chunkHeaderOffset);
+			s_currentFile.WriteBuf(&s_chunkHeader, sizeof(s_chunkHeader));
+
+			s_currentFile.SetOffset(curOffset);
+
+			s_pluginHeader.length += chunkSize + sizeof(s_chunkHeader);
+
+			s_chunkOpen = false;
+		}
+
+		bool OpenRecord(UInt32 type, UInt32 version)
+		{
+			if(!s_pluginHeader.numChunks)
+			{
+				s_pluginHeaderOffset = s_currentFile.GetOffset();
+				s_currentFile.Skip(sizeof(s_pluginHeader));
+			}
+
+			FlushWriteChunk();
+
+			s_chunkHeaderOffset = s_currentFile.GetOffset();
+			s_currentFile.Skip(sizeof(s_chunkHeader));
+
+			s_pluginHeader.numChunks++;
+
+			s_chunkHeader.type = type;
+			s_chunkHeader.version = version;
+			s_chunkHeader.length = 0;
+
+			s_chunkOpen = true;
+
+			return true;
+		}
+
+		bool WriteRecordData(const void * buf, UInt32 length)
+		{
+			s_currentFile.WriteBuf(buf, length);
+
+			return true;
+		}
+
+		bool WriteRecord(UInt32 type, UInt32 version, const void * buf, UInt32 length)
+		{
+			return OpenRecord(type, version) && WriteRecordData(buf, length);
+		}
+
+		void Save(const char * path, const F4SESerializationInterface * intfc)
+		{
+			s_currentFile.Create(path);
+
+			s_fileHeader.signature = MACRO_SWAP32('F4SE');
+			s_fileHeader.formatVersion = 1;
+			s_fileHeader.f4seVersion = PACKED_F4SE_VERSION;
+			s_fileHeader.runtimeVersion = RUNTIME_VERSION;
+			s_fileHeader.numPlugins = 0;
+
+			s_currentFile.Skip(sizeof(s_fileHeader));
+
+			s_savingPlugin = 0;
+
+			for(UInt32 i = 0; i < s_numPlugins; i++)
+			{
+				s_pluginHeader.signature = 'PL00' + i;
+				s_pluginHeader.numChunks = 0;
+				s_pluginHeader.length = 0;
+
+				s_chunkOpen = false;
+
+				SaveCallback(intfc);
+
+				FlushWriteChunk();
+
+				if(s_pluginHeader.numChunks)
+				{
+					UInt64	curOffset = s_currentFile.GetOffset();
+
+					s_currentFile.SetOffset(s_pluginHeaderOffset);
+					s_currentFile.WriteBuf(&s_pluginHeader, sizeof(s_pluginHeader));
+
+					s_currentFile.SetOffset(curOffset);
+
+					s_fileHeader.numPlugins++;
+				}
+			}
+
+			s_currentFile.SetOffset(0);
+			s_currentFile.WriteBuf(&s_fileHeader, sizeof(s_fileHeader));
+
+			s_currentFile.Close();
+		}
+	}
+
+	std::vector <UInt8> LoadFile(const std::string & path)
+	{
+		std::vector <UInt8>	result;
+
+		FILE	* src = fopen(path.c_str(), "rb");
+		if(src)
+		{
+			UInt8	buf[65536];
+			size_t	length;
+
+			while((length = fread(buf, 1, sizeof(buf), src)) > 0)
+				result.insert(result.end(), buf, buf + length);
+
+			fclose(src);
+		}
+
+		return result;
+	}
+
+	struct Result
+	{
+		double		milliseconds;
+		TestWin32::IOStats	io;
+		UInt64		fileSize;
+	};
+
+	void Report(const char * name, const Result & result, UInt32 iterations)
+	{
+		printf("%-34s %9.2f ms %10llu writes %10llu seeks %6llu flushes %10llu bytes\n", name,
+			result.milliseconds / iterations,
+			(unsigned long long)(result.io.writes / iterations),
+			(unsigned long long)(result.io.seeks / iterations),
+			(unsigned long long)(result.io.flushes / iterations),
+			(unsigned long long)result.fileSize);
+	}
+
+	// the background write is timed up to the point the game gets control back, HandlePostSaveGame then waits for it
+	Result RunStaged(const std::string & savePath, const char * compress, const char * async, UInt32 iterations)
+	{
+		Test::SetConfigOption("Serialization", "bCompressCoSave", compress);
+		Test::SetConfigOption("Serialization", "bAsyncCoSave", async);
+		Serialization::Init();
+
+		Serialization::SetSaveName("bench");
+
+		Result	result;
+
+		TestWin32::ResetIOStats();
+
+		result.milliseconds = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < iterations; i++)
+			{
+				s_savingPlugin = 0;
+				Serialization::HandleSaveGlobalData();
+			}
+		});
+
+		Serialization::HandlePostSaveGame();
+
+		result.io = TestWin32::GetIOStats();
+		result.fileSize = LoadFile(savePath).size();
+
+		Serialization::SetSaveName(NULL);
+
+		return result;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	UInt32	iterations = 5;
+
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numPlugins = 10;
+		s_recordsPerPlugin = 50;
+		iterations = 1;
+	}
+
+	std::string	root = Test::MakeTempDir("cosave_write");
+	std::string	saveDir = root + "/My Games/Fallout4VR/Saves";
+	std::string	legacyPath = root + "/legacy.f4se";
+	std::string	savePath = saveDir + "//bench.f4se";
+
+	CHECK(!system(("mkdir -p '" + saveDir + "'").c_str()));
+
+	TestWin32::SetFolderPath(root.c_str());
+
+	// uids match what the legacy writer stamps
+	for(UInt32 i = 0; i < s_numPlugins; i++)
+	{
+		Serialization::SetUniqueID(i, 'PL00' + i);
+		Serialization::SetSaveCallback(i, SaveCallback);
+	}
+
+	printf("co-save write: %u plugins x %u records, %u iterations\n", s_numPlugins, s_recordsPerPlugin, iterations);
+
+	// old path
+	F4SESerializationInterface	legacyIntfc = g_F4SESerializationInterface;
+	legacyIntfc.OpenRecord = Legacy::OpenRecord;
+	legacyIntfc.WriteRecordData = Legacy::WriteRecordData;
+	legacyIntfc.WriteRecord = Legacy::WriteRecord;
+
+	Result	legacy;
+
+	TestWin32::ResetIOStats();
+	legacy.milliseconds = Test::Time([&]()
+	{
+		for(UInt32 i = 0; i < iterations; i++)
+			Legacy::Save(legacyPath.c_str(), &legacyIntfc);
+	});
+	legacy.io = TestWin32::GetIOStats();
+	legacy.fileSize = LoadFile(legacyPath).size();
+
+	Report("seek/back-patch (old)", legacy, iterations);
+
+	// staged, the uncompressed file must match the old writer byte for byte
+	Result	staged = RunStaged(savePath, "0", "0", iterations);
+	Report("staged, uncompressed, sync", staged, iterations);
+
+	std::vector <UInt8>	legacyData = LoadFile(legacyPath);
+	std::vector <UInt8>	stagedData = LoadFile(savePath);
+
+	CHECK(!legacyData.empty());
+	CHECK(legacyData == stagedData);
+
+	CHECK(staged.io.writes < legacy.io.writes);
+	CHECK(!staged.io.seeks);
+
+	Result	compressed = RunStaged(savePath, "1", "0", iterations);
+	Report("staged, compressed, sync", compressed, iterations);
+
+	CHECK(compressed.fileSize < staged.fileSize);
+
+	std::vector <UInt8>	compressedData = LoadFile(savePath);
+
+	Result	background = RunStaged(savePath, "1", "1", iterations);
+	Report("staged, compressed, background", background, iterations);
+
+	// complete once the save hook has waited for it
+	CHECK(LoadFile(savePath) == compressedData);
+
+	// a background write that fails is reported by the thread that waits for it
+	std::string	logPath = root + "/write.log";
+
+	IDebugLog::Open(logPath.c_str());
+	Serialization::SetSaveName("missing/bench");
+
+	s_savingPlugin = 0;
+	Serialization::HandleSaveGlobalData();
+	Serialization::HandlePostSaveGame();
+
+	CHECK(Test::ReadTextFile(logPath).find("couldn't create save file") != std::string::npos);
+
+	Serialization::SetSaveName(NULL);
+
+	return Test::Finish("CoSaveWriteBench");
+}
@@ -0,0 +1,310 @@
+#include "f4se/DynamicCastCache.h"
+#include "support/TestSupport.h"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <typeinfo>
+#include <vector>
+
+// DYNAMIC_CAST over a synthetic form hierarchy with multiple inheritance, through DynamicCastCache and straight through
+// the underlying cast, here the compiler's dynamic_cast picked out of a table by the two types like __RTDynamicCast
+// finds its descriptors. Reports casts per millisecond over a mix of up, down and cross casts.
+//
+//	- every cast returns what the underlying one does, from each base of each object, successes and failures alike
+//	- the underlying cast runs once per distinct vtable and pair of types, never for a null object
+//	- threads populating one cache at once all get the right results
+//	- with more distinct casts than slots the extra ones still come back right, uncached
+
+namespace
+{
+	UInt32	s_numCasts = 10000000;
+
+	struct IFormBase		{ virtual ~IFormBase() { } UInt32 formID = 0; };
+	struct IKeywordForm		{ virtual ~IKeywordForm() { } UInt32 numKeywords = 0; };
+	struct IModelForm		{ virtual ~IModelForm() { } UInt32 model = 0; };
+
+	struct Form : IFormBase							{ UInt32 flags = 0; };
+	struct Weapon : Form, IKeywordForm, IModelForm	{ UInt32 damage = 0; };
+	struct Armor : Form, IModelForm, IKeywordForm	{ UInt32 rating = 0; };	// bases in the other order
+	struct LegendaryWeapon : Weapon					{ UInt32 effect = 0; };
+	struct Misc : Form								{ };
+
+	template <typename T>
+	const void * Type(void) { return &typeid(T); }
+
+	struct Caster
+	{
+		const void	* fromType;
+		const void	* toType;
+		void		* (* cast)(void * obj);
+	};
+
+	std::vector<Caster>		s_casters;
+	std::atomic<UInt64>		s_numUncached(0);
+
+	template <typename From, typename To>
+	void * CastTo(void * obj) { return dynamic_cast<To *>(static_cast<From *>(obj)); }
+
+	template <typename From, typename... To>
+	void AddCasters(void)
+	{
+		int unused[] = { (s_casters.push_back({ Type<From>(), Type<To>(), CastTo<From, To> }), 0)... };
+		(void)unused;
+	}
+
+	template <typename... T>
+	void AddAllCasters(void)
+	{
+		int unused[] = { (AddCasters<T, T...>(), 0)... };
+		(void)unused;
+	}
+
+	void * UncachedCast(void * obj, const void * fromType, const void * toType)
+	{
+		s_numUncached.fetch_add(1, std::memory_order_relaxed);
+
+		for (auto & caster : s_casters)
+			if (caster.fromType == fromType && caster.toType == toType)
+				return caster.cast(obj);
+
+		return NULL;
+	}
+
+	const void * s_targets[7];
+
+	// an object seen through one of its static types
+	struct Source
+	{
+		void		* ptr;
+		const void	* fromType;
+	};
+
+	struct Objects
+	{
+		Weapon			weapon;
+		Armor			armor;
+		LegendaryWeapon	legendary;
+		Misc			misc;
+
+		std::vector<Source> Sources(void)
+		{
+			return {
+				{ static_cast<Form *>(&weapon), Type<Form>() },
+				{ static_cast<IKeywordForm *>(&weapon), Type<IKeywordForm>() },
+				{ static_cast<IModelForm *>(&weapon), Type<IModelForm>() },
+				{ &weapon, Type<Weapon>() },
+				{ static_cast<Form *>(&armor), Type<Form>() },
+				{ static_cast<IKeywordForm *>(&armor), Type<IKeywordForm>() },
+				{ static_cast<IModelForm *>(&armor), Type<IModelForm>() },
+				{ &armor, Type<Armor>() },
+				{ static_cast<Form *>(&legendary), Type<Form>() },
+				{ static_cast<IKeywordForm *>(&legendary), Type<IKeywordForm>() },
+				{ static_cast<IModelForm *>(&legendary), Type<IModelForm>() },
+				{ static_cast<Weapon *>(&legendary), Type<Weapon>() },
+				{ &legendary, Type<LegendaryWeapon>() },
+				{ static_cast<Form *>(&misc), Type<Form>() },
+				{ &misc, Type<Misc>() },
+			};
+		}
+	};
+
+	void Setup(void)
+	{
+		AddAllCasters<Form, IKeywordForm, IModelForm, Weapon, Armor, LegendaryWeapon, Misc>();
+
+		const void * targets[] = { Type<Form>(), Type<IKeywordForm>(), Type<IModelForm>(), Type<Weapon>(), Type<Armor>(), Type<LegendaryWeapon>(), Type<Misc>() };
+		std::copy(targets, targets + 7, s_targets);
+	}
+
+	void CheckAgainstUncached(void)
+	{
+		std::unique_ptr<DynamicCastCache>	cache(new DynamicCastCache);
+		Objects								objects[3];
+
+		std::set<std::tuple<const void *, const void *, const void *>>	distinct;
+
+		bool	agrees = true;
+		UInt32	numFailed = 0;
+
+		UInt64	before = s_numUncached.load();
+
+		for (auto & objs : objects)
+		{
+			for (auto & source : objs.Sources())
+			{
+				for (auto toType : s_targets)
+				{
+					void	* expected = UncachedCast(source.ptr, source.fromType, toType);
+
+					agrees &= cache->Cast(source.ptr, source.fromType, toType, UncachedCast) == expected;
+					agrees &= cache->Cast(source.ptr, source.fromType, toType, UncachedCast) == expected;
+
+					distinct.insert(std::make_tuple(*(const void **)source.ptr, source.fromType, toType));
+					numFailed += !expected;
+				}
+			}
+		}
+
+		CHECK(agrees);
+		CHECK(numFailed > 0);
+		CHECK(cache->NumEntries() == distinct.size());
+
+		// one underlying cast for each check above, plus one per distinct cast
+		UInt32	numChecks = 3 * objects[0].Sources().size() * 7;
+		CHECK(s_numUncached.load() - before == numChecks + distinct.size());
+
+		// other objects of the same classes hit the same entries
+		Objects				more;
+		std::vector<void *>	expected;
+
+		for (auto & source : more.Sources())
+			for (auto toType : s_targets)
+				expected.push_back(UncachedCast(source.ptr, source.fromType, toType));
+
+		before = s_numUncached.load();
+
+		UInt32	i = 0;
+		for (auto & source : more.Sources())
+			for (auto toType : s_targets)
+				agrees &= cache->Cast(source.ptr, source.fromType, toType, UncachedCast) == expected[i++];
+
+		CHECK(agrees);
+		CHECK(s_numUncached.load() == before);
+
+		before = s_numUncached.load();
+		CHECK(cache->Cast(NULL, Type<Form>(), Type<Weapon>(), UncachedCast) == NULL);
+		CHECK(s_numUncached.load() == before);
+
+		// the cached adjustment, and the cached failure
+		IKeywordForm	* keywords = static_cast<IKeywordForm *>(&more.armor);
+		CHECK(cache->Cast(keywords, Type<IKeywordForm>(), Type<IModelForm>(), UncachedCast) == static_cast<IModelForm *>(&more.armor));
+		CHECK(cache->Cast(keywords, Type<IKeywordForm>(), Type<Weapon>(), UncachedCast) == NULL);
+		CHECK(s_numUncached.load() == before);
+	}
+
+	void CheckThreads(void)
+	{
+		std::unique_ptr<DynamicCastCache>	cache(new DynamicCastCache);
+		Objects								objects;
+		std::vector<Source>					sources = objects.Sources();
+		std::atomic<bool>					agrees(true);
+
+		auto worker = [&](UInt32 seed)
+		{
+			std::mt19937	rng(seed);
+
+			for (UInt32 i = 0; i < 20000; i++)
+			{
+				const Source	& source = sources[rng() % sources.size()];
+				const void		* toType = s_targets[rng() % 7];
+
+				if (cache->Cast(source.ptr, source.fromType, toType, UncachedCast) != UncachedCast(source.ptr, source.fromType, toType))
+					agrees = false;
+			}
+		};
+
+		std::vector<std::thread>	threads;
+		for (UInt32 i = 0; i < 4; i++)
+			threads.emplace_back(worker, i + 1);
+
+		for (auto & thread : threads)
+			thread.join();
+
+		CHECK(agrees);
+		CHECK(cache->NumEntries() <= sources.size() * 7);
+	}
+
+	// any pointer sized value will do as a type here, the cast is made up
+	void * OffsetCast(void * obj, const void * fromType, const void * toType)
+	{
+		return (uintptr_t)toType & 1 ? NULL : (char *)obj + (uintptr_t)toType;
+	}
+
+	void CheckFull(void)
+	{
+		std::unique_ptr<DynamicCastCache>	cache(new DynamicCastCache);
+		Weapon								weapon;
+
+		bool	agrees = true;
+
+		for (UInt32 pass = 0; pass < 2; pass++)
+		{
+			for (uintptr_t toType = 1; toType <= DynamicCastCache::kNumSlots * 2; toType++)
+				agrees &= cache->Cast(&weapon, Type<Weapon>(), (const void *)toType, OffsetCast) == OffsetCast(&weapon, Type<Weapon>(), (const void *)toType);
+		}
+
+		CHECK(agrees);
+		CHECK(cache->NumEntries() <= DynamicCastCache::kNumSlots);
+		CHECK(cache->NumEntries() > DynamicCastCache::kNumSlots / 2);
+	}
+
+	void RunBench(void)
+	{
+		std::unique_ptr<DynamicCastCache>	cache(new DynamicCastCache);
+		std::vector<Objects>				objects(64);
+
+		struct Cast
+		{
+			Source		source;
+			const void	* toType;
+		};
+
+		std::vector<Cast>	casts(4096);
+		std::mt19937		rng(17);
+
+		for (auto & cast : casts)
+		{
+			std::vector<Source>	sources = objects[rng() % objects.size()].Sources();
+
+			cast.source = sources[rng() % sources.size()];
+			cast.toType = s_targets[rng() % 7];
+		}
+
+		UInt64	uncachedSum = 0;
+		UInt64	cachedSum = 0;
+
+		double	uncached = Test::Time([&]()
+		{
+			for (UInt32 i = 0; i < s_numCasts; i++)
+			{
+				const Cast	& cast = casts[i & (casts.size() - 1)];
+				uncachedSum += (uintptr_t)UncachedCast(cast.source.ptr, cast.source.fromType, cast.toType);
+			}
+		});
+
+		double	cached = Test::Time([&]()
+		{
+			for (UInt32 i = 0; i < s_numCasts; i++)
+			{
+				const Cast	& cast = casts[i & (casts.size() - 1)];
+				cachedSum += (uintptr_t)cache->Cast(cast.source.ptr, cast.source.fromType, cast.toType, UncachedCast);
+			}
+		});
+
+		CHECK(uncachedSum == cachedSum);
+
+		printf("dynamic casts: %u casts over %u distinct, up, down and cross\n", s_numCasts, cache->NumEntries());
+		printf("  type table + dynamic_cast (old) %9.1f ms  %8.0f casts/ms\n", uncached, s_numCasts / uncached);
+		printf("  DynamicCastCache                %9.1f ms  %8.0f casts/ms\n", cached, s_numCasts / cached);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if (Test::IsQuick(argc, argv))
+		s_numCasts = 200000;
+
+	Setup();
+
+	CheckAgainstUncached();
+	CheckThreads();
+	CheckFull();
+
+	RunBench();
+
+	return Test::Finish("DynamicCastCacheBench");
+}
@@ -0,0 +1,414 @@
+#include "f4se/PapyrusArrayEncoding.h"
+#include "f4se/Serialization.h"
+#include "f4se/PluginManager.h"
+#include "support/TestSupport.h"
+
+#include <limits>
+#include <random>
+#include <vector>
+
+// Papyrus int, float, bool and object arrays through the packed layouts WriteVMData writes, and through the one
+// WriteRecordData/ReadRecordData call per element it made before, both over the real co-save. The elements sit in
+// 16 byte values like the VM's. Reports elements per millisecond saved and loaded, and the bytes each layout takes.
+//
+//	- random arrays of every kind round trip exactly, extremes, NaN payloads and empty arrays included
+//	- every truncation of a payload fails to decode instead of reading past it, as does a varint that never ends
+//	- random bytes decode or fail, they never run past the buffer
+//	- arrays decoded from the co-save match what was saved
+
+namespace
+{
+	UInt32	s_numArrays = 200;
+	UInt32	s_arrayLength = 10000;
+	UInt32	s_fuzzRounds = 2000;
+
+	enum
+	{
+		kKind_Int,
+		kKind_Float,
+		kKind_Bool,
+		kKind_Handle,
+
+		kNumKinds
+	};
+
+	const char	* kKindNames[] = { "int", "float", "bool", "object" };
+
+	// a VMValue's layout, the type then the value
+	struct Value
+	{
+		UInt64	type;
+		union
+		{
+			SInt32	i;
+			float	f;
+			bool	b;
+			UInt64	h;
+		};
+	};
+
+	typedef std::vector <UInt8>	Buffer;
+
+	std::mt19937	s_random(0x5041524B);
+
+	SInt32 RandomInt(void)
+	{
+		switch(s_random() % 4)
+		{
+		case 0:		return std::numeric_limits <SInt32>::min() + (s_random() % 3);
+		case 1:		return std::numeric_limits <SInt32>::max() - (s_random() % 3);
+		case 2:		return (SInt32)(s_random() % 200) - 100;
+		default:	return (SInt32)s_random();
+		}
+	}
+
+	float RandomFloat(void)
+	{
+		UInt32	bits = s_random();	// any bit pattern, NaNs and denormals included
+
+		float	result;
+		memcpy(&result, &bits, sizeof(result));
+
+		return result;
+	}
+
+	// form handles cluster, mostly the same plugin and nearby form IDs, with the odd none
+	UInt64 RandomHandle(UInt64 base)
+	{
+		switch(s_random() % 8)
+		{
+		case 0:		return 0;
+		case 1:		return ((UInt64)s_random() << 32) | s_random();
+		default:	return base + (s_random() % 4096);
+		}
+	}
+
+	std::vector <Value> MakeArray(UInt32 kind, UInt32 length)
+	{
+		std::vector <Value>	result(length);
+		UInt64				base = 0x0000FFFF01000000ull + ((s_random() % 256) << 24);
+
+		for(auto & value : result)
+		{
+			value.type = kind;
+			value.h = 0;
+
+			switch(kind)
+			{
+			case kKind_Int:		value.i = RandomInt(); break;
+			case kKind_Float:	value.f = RandomFloat(); break;
+			case kKind_Bool:	value.b = (s_random() & 1) != 0; break;
+			case kKind_Handle:	value.h = RandomHandle(base); break;
+			}
+		}
+
+		return result;
+	}
+
+	void Encode(UInt32 kind, const Value * values, UInt32 length, Buffer & out)
+	{
+		using namespace PapyrusArrayEncoding;
+
+		switch(kind)
+		{
+		case kKind_Int:		EncodeInts(length, [values](UInt32 i) { return values[i].i; }, out); break;
+		case kKind_Float:	EncodeFloats(length, [values](UInt32 i) { return values[i].f; }, out); break;
+		case kKind_Bool:	EncodeBools(length, [values](UInt32 i) { return values[i].b; }, out); break;
+		case kKind_Handle:	EncodeHandles(length, [values](UInt32 i) { return values[i].h; }, out); break;
+		}
+	}
+
+	bool Decode(UInt32 kind, const UInt8 * src, UInt32 srcLength, UInt32 * offset, Value * values, UInt32 length)
+	{
+		using namespace PapyrusArrayEncoding;
+
+		switch(kind)
+		{
+		case kKind_Int:		return DecodeInts(src, srcLength, offset, length, [values](UInt32 i, SInt32 v) { values[i].type = kKind_Int; values[i].i = v; });
+		case kKind_Float:	return DecodeFloats(src, srcLength, offset, length, [values](UInt32 i, float v) { values[i].type = kKind_Float; values[i].f = v; });
+		case kKind_Bool:	return DecodeBools(src, srcLength, offset, length, [values](UInt32 i, bool v) { values[i].type = kKind_Bool; values[i].b = v; });
+		case kKind_Handle:	return DecodeHandles(src, srcLength, offset, length, [values](UInt32 i, UInt64 v) { values[i].type = kKind_Handle; values[i].h = v; });
+		}
+
+		return false;
+	}
+
+	bool Same(UInt32 kind, const Value & a, const Value & b)
+	{
+		switch(kind)
+		{
+		case kKind_Int:		return a.i == b.i;
+		case kKind_Float:	return !memcmp(&a.f, &b.f, sizeof(float));
+		case kKind_Bool:	return a.b == b.b;
+		case kKind_Handle:	return a.h == b.h;
+		}
+
+		return false;
+	}
+
+	bool SameArrays(UInt32 kind, const std::vector <Value> & a, const std::vector <Value> & b)
+	{
+		if(a.size() != b.size())
+			return false;
+
+		for(UInt32 i = 0; i < a.size(); i++)
+			if(!Same(kind, a[i], b[i]))
+				return false;
+
+		return true;
+	}
+
+	void CheckRoundTrips(void)
+	{
+		bool	roundTrips = true;
+		bool	truncationsFail = true;
+
+		for(UInt32 round = 0; round < s_fuzzRounds; round++)
+		{
+			UInt32	kind = round % kNumKinds;
+			UInt32	length = (round % 7 == 0) ? 0 : 1 + s_random() % ((round % 5 == 0) ? 2000 : 40);
+
+			std::vector <Value>	values = MakeArray(kind, length);
+
+			// a leading byte so the offset isn't always 0
+			Buffer	payload(1, 0xEE);
+			Encode(kind, values.data(), length, payload);
+
+			std::vector <Value>	decoded(length);
+			UInt32				offset = 1;
+
+			roundTrips &= Decode(kind, payload.data(), payload.size(), &offset, decoded.data(), length);
+			roundTrips &= offset == payload.size();
+			roundTrips &= SameArrays(kind, values, decoded);
+
+			// an exact size copy for each cut, so reading past it is reading past the allocation
+			if(length && length < 64)
+			{
+				for(UInt32 cut = 1; cut < payload.size(); cut++)
+				{
+					Buffer	truncated(payload.begin(), payload.begin() + cut);
+
+					offset = 1;
+					truncationsFail &= !Decode(kind, truncated.data(), truncated.size(), &offset, decoded.data(), length);
+				}
+			}
+		}
+
+		CHECK(roundTrips);
+		CHECK(truncationsFail);
+
+		// varints that run on, and a zigzag delta too wide for an int
+		Buffer	endless(16, 0xFF);
+		Value	value;
+		UInt32	offset = 0;
+
+		CHECK(!Decode(kKind_Handle, endless.data(), endless.size(), &offset, &value, 1));
+
+		Buffer	wide;
+		PapyrusArrayEncoding::EncodeVarInt(1ull << 40, wide);
+
+		offset = 0;
+		CHECK(!Decode(kKind_Int, wide.data(), wide.size(), &offset, &value, 1));
+		offset = 0;
+		CHECK(Decode(kKind_Handle, wide.data(), wide.size(), &offset, &value, 1));
+	}
+
+	void CheckGarbage(void)
+	{
+		std::vector <Value>	decoded(64);
+		UInt32				numDecoded = 0;
+
+		for(UInt32 round = 0; round < s_fuzzRounds; round++)
+		{
+			Buffer	garbage(s_random() % 48);
+			for(auto & byte : garbage)
+				byte = (UInt8)s_random();
+
+			UInt32	offset = 0;
+			if(Decode(round % kNumKinds, garbage.data(), garbage.size(), &offset, decoded.data(), 1 + s_random() % 64))
+				numDecoded++;
+
+			CHECK(offset <= garbage.size());
+		}
+
+		Test::Use(numDecoded);
+	}
+
+	// the co-save side, one plugin writing s_numArrays arrays of one kind a record each
+
+	bool	s_packed = true;
+	UInt32	s_kind = kKind_Int;
+
+	std::vector <std::vector <Value>>	s_arrays;
+	std::vector <std::vector <Value>>	s_loaded;
+
+	UInt32 ElementSize(UInt32 kind)
+	{
+		switch(kind)
+		{
+		case kKind_Int:		return sizeof(SInt32);
+		case kKind_Float:	return sizeof(float);
+		case kKind_Bool:	return sizeof(bool);
+		default:			return sizeof(UInt64);
+		}
+	}
+
+	Buffer	s_packBuffer;
+
+	void SaveCallback(const F4SESerializationInterface * intfc)
+	{
+		UInt32	elementSize = ElementSize(s_kind);
+
+		for(auto & values : s_arrays)
+		{
+			UInt32	length = values.size();
+
+			intfc->OpenRecord('ARRY', 1);
+			intfc->WriteRecordData(&length, sizeof(length));
+
+			if(s_packed)
+			{
+				s_packBuffer.clear();
+				Encode(s_kind, values.data(), length, s_packBuffer);
+
+				UInt32	payloadLength = s_packBuffer.size();
+				intfc->WriteRecordData(&payloadLength, sizeof(payloadLength));
+				intfc->WriteRecordData(s_packBuffer.data(), payloadLength);
+			}
+			else
+			{
+				for(UInt32 i = 0; i < length; i++)
+					intfc->WriteRecordData(&values[i].i, elementSize);
+			}
+		}
+	}
+
+	void LoadCallback(const F4SESerializationInterface * intfc)
+	{
+		UInt32	type, version, recordLength;
+		UInt32	elementSize = ElementSize(s_kind);
+
+		while(intfc->GetNextRecordInfo(&type, &version, &recordLength))
+		{
+			UInt32	length = 0;
+			intfc->ReadRecordData(&length, sizeof(length));
+
+			s_loaded.emplace_back(length);
+			Value	* values = s_loaded.back().data();
+
+			if(s_packed)
+			{
+				UInt32	payloadLength = 0;
+				intfc->ReadRecordData(&payloadLength, sizeof(payloadLength));
+
+				UInt32	spanLength = 0;
+				const UInt8	* payload = (const UInt8 *)intfc->ReadRecordDataSpan(payloadLength, &spanLength);
+
+				UInt32	offset = 0;
+				if(spanLength != payloadLength || !Decode(s_kind, payload, payloadLength, &offset, values, length))
+					s_loaded.back().clear();
+			}
+			else
+			{
+				for(UInt32 i = 0; i < length; i++)
+				{
+					values[i].type = s_kind;
+					values[i].h = 0;
+					intfc->ReadRecordData(&values[i].i, elementSize);
+				}
+			}
+		}
+	}
+
+	struct Result
+	{
+		double	saveTime;
+		double	loadTime;
+		UInt64	fileSize;
+	};
+
+	Result Run(const std::string & savePath, UInt32 kind, bool packed)
+	{
+		Result	result;
+
+		s_kind = kind;
+		s_packed = packed;
+
+		result.saveTime = Test::Time([]() { Serialization::HandleSaveGlobalData(); });
+		result.fileSize = Test::ReadTextFile(savePath).size();
+
+		s_loaded.clear();
+		s_loaded.reserve(s_arrays.size());
+
+		result.loadTime = Test::Time([]() { Serialization::HandleLoadGlobalData(); });
+
+		bool	same = s_loaded.size() == s_arrays.size();
+		for(UInt32 i = 0; same && i < s_arrays.size(); i++)
+			same = SameArrays(kind, s_arrays[i], s_loaded[i]);
+
+		CHECK(same);
+
+		return result;
+	}
+
+	void RunBench(void)
+	{
+		std::string	root = Test::MakeTempDir("papyrus_arrays");
+		std::string	savePath = root + "/My Games/Fallout4VR/Saves//arrays.f4se";
+
+		CHECK(!system(("mkdir -p '" + root + "/My Games/Fallout4VR/Saves'").c_str()));
+
+		TestWin32::SetFolderPath(root.c_str());
+
+		Test::SetConfigOption("Serialization", "bCompressCoSave", "0");
+		Test::SetConfigOption("Serialization", "bAsyncCoSave", "0");
+		Serialization::Init();
+
+		Serialization::SetUniqueID(0, 'ARRY');
+		Serialization::SetSaveCallback(0, SaveCallback);
+		Serialization::SetLoadCallback(0, LoadCallback);
+		Serialization::SetSaveName("arrays");
+
+		double	numElements = (double)s_numArrays * s_arrayLength;
+
+		printf("papyrus arrays: %u arrays of %u elements per kind, uncompressed co-save\n", s_numArrays, s_arrayLength);
+		printf("                                  save elem/ms   load elem/ms        bytes\n");
+
+		for(UInt32 kind = 0; kind < kNumKinds; kind++)
+		{
+			s_arrays.clear();
+			for(UInt32 i = 0; i < s_numArrays; i++)
+				s_arrays.push_back(MakeArray(kind, s_arrayLength));
+
+			Result	perElement = Run(savePath, kind, false);
+			Result	packed = Run(savePath, kind, true);
+
+			// floats are stored as they are, behind the payload length
+			if(kind == kKind_Float)
+				CHECK(packed.fileSize == perElement.fileSize + s_numArrays * sizeof(UInt32));
+			else
+				CHECK(packed.fileSize < perElement.fileSize);
+
+			printf("  %-6s per element (old)      %12.0f   %12.0f %12llu\n", kKindNames[kind], numElements / perElement.saveTime, numElements / perElement.loadTime, (unsigned long long)perElement.fileSize);
+			printf("  %-6s packed                 %12.0f   %12.0f %12llu\n", kKindNames[kind], numElements / packed.saveTime, numElements / packed.loadTime, (unsigned long long)packed.fileSize);
+		}
+
+		Serialization::SetSaveName(NULL);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numArrays = 20;
+		s_arrayLength = 2000;
+		s_fuzzRounds = 400;
+	}
+
+	CheckRoundTrips();
+	CheckGarbage();
+	RunBench();
+
+	return Test::Finish("PapyrusArrayEncodingBench");
+}
@@ -0,0 +1,336 @@
+#include "f4se/RegistrationIndex.h"
+#include "common/ICriticalSection.h"
+#include "support/TestSupport.h"
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+// Key event dispatch against scripts registered for input keys, through RegistrationIndex and through
+// the std::map of std::sets that RegistrationMapHolder used to lock for every lookup. Reports lookups
+// per millisecond with and without a thread registering and unregistering at the same time.
+//
+//	- after random registers and unregisters each key lists exactly what a std::map<K, std::set> would
+//	- EraseAll only removes the handle and script it is given
+//	- a snapshot a reader holds doesn't change under later edits
+//	- readers see every key's list sorted while a writer publishes
+
+namespace
+{
+	UInt32	s_numKeys = 256;
+	UInt32	s_numHandles = 2000;
+	UInt32	s_numLookups = 2000000;
+
+	struct Registration
+	{
+		UInt64			handle;
+		BSFixedString	scriptName;
+		UInt32			payload;
+
+		bool operator<(const Registration & rhs) const
+		{
+			if (handle != rhs.handle)
+				return handle < rhs.handle;
+			return scriptName < rhs.scriptName;
+		}
+	};
+
+	BSFixedString ScriptName(UInt32 i)
+	{
+		static const char * names[] = { "ScriptObject", "Quest", "ObjectReference", "Actor" };
+		return BSFixedString(names[i % 4]);
+	}
+
+	template <typename K>
+	void CheckAgainstMap(K (* makeKey)(UInt32))
+	{
+		typedef std::map<K, std::set<Registration>>	RefMap;
+
+		RegistrationIndex<K, Registration>	index;
+		RefMap								reference;
+		std::mt19937						rng(77);
+
+		bool	agrees = true;
+
+		for (UInt32 i = 0; i < 20000; i++)
+		{
+			K				key = makeKey(rng() % 64);
+			Registration	reg = { rng() % 50, ScriptName(rng()), i };
+
+			switch (rng() % 8)
+			{
+			case 0:
+			case 1:
+			case 2:
+				agrees &= index.Insert(key, reg) == reference[key].insert(reg).second;
+				break;
+			case 3:
+			case 4:
+				agrees &= index.Erase(key, reg) == (reference[key].erase(reg) != 0);
+				break;
+			case 5:
+				{
+					UInt32 numErased = 0;
+					for (auto & entry : reference)
+						numErased += entry.second.erase(reg);
+
+					agrees &= index.EraseAll(reg) == numErased;
+				}
+				break;
+			default:
+				index.Publish();
+				break;
+			}
+		}
+
+		index.Publish();
+
+		auto table = index.GetSnapshot();
+		UInt32 numKeys = 0;
+
+		for (auto & entry : reference)
+		{
+			const std::vector<Registration> * regs = table->Find(entry.first);
+			if (entry.second.empty())
+			{
+				agrees &= regs == nullptr;
+				continue;
+			}
+
+			numKeys++;
+			agrees &= regs && regs->size() == entry.second.size() && std::equal(regs->begin(), regs->end(), entry.second.begin(),
+				[](const Registration & a, const Registration & b) { return !(a < b) && !(b < a) && a.payload == b.payload; });
+		}
+
+		CHECK(agrees);
+		CHECK(table->NumKeys() == numKeys);
+	}
+
+	UInt32 IntKey(UInt32 i)				{ return i * 0x10000; }		// same low bits, all in one home slot before hashing
+	BSFixedString StringKey(UInt32 i)	{ return BSFixedString(("Control" + std::to_string(i)).c_str()); }
+
+	void CheckEraseAll(void)
+	{
+		RegistrationIndex<UInt32, Registration>	index;
+
+		for (UInt32 key = 0; key < 10; key++)
+		{
+			index.Insert(key, { 1, ScriptName(0), 0 });
+			index.Insert(key, { 1, ScriptName(1), 0 });
+			index.Insert(key, { 2, ScriptName(0), 0 });
+		}
+
+		CHECK(!index.Insert(3, { 1, ScriptName(0), 0 }));
+		CHECK(index.EraseAll({ 1, ScriptName(0), 0 }) == 10);
+		CHECK(index.EraseAll({ 1, ScriptName(0), 0 }) == 0);
+		CHECK(index.EraseAll({ 1, ScriptName(1), 0 }) == 10);
+		CHECK(index.EraseAll({ 3, ScriptName(0), 0 }) == 0);
+
+		index.Publish();
+
+		auto table = index.GetSnapshot();
+		CHECK(table->NumKeys() == 10);
+		for (UInt32 key = 0; key < 10; key++)
+			CHECK(table->Find(key) && table->Find(key)->size() == 1 && table->Find(key)->front().handle == 2);
+	}
+
+	void CheckSnapshot(void)
+	{
+		RegistrationIndex<UInt32, Registration>	index;
+
+		index.Insert(1, { 5, ScriptName(0), 0 });
+		index.Publish();
+
+		auto before = index.GetSnapshot();
+
+		index.Insert(1, { 6, ScriptName(0), 0 });
+		index.Erase(1, { 5, ScriptName(0), 0 });
+		for (UInt32 key = 2; key < 100; key++)
+			index.Insert(key, { 5, ScriptName(0), 0 });
+		index.Publish();
+
+		CHECK(before->NumKeys() == 1);
+		CHECK(before->Find(1)->size() == 1 && before->Find(1)->front().handle == 5);
+		CHECK(index.GetSnapshot()->Find(1)->front().handle == 6);
+		CHECK(index.GetSnapshot()->NumKeys() == 99);
+
+		index.Clear();
+		index.Publish();
+		CHECK(index.GetSnapshot()->Find(1) == nullptr);
+		CHECK(before->Find(1)->front().handle == 5);
+	}
+
+	namespace Legacy
+	{
+		ICriticalSection								s_lock;
+		std::map<UInt32, std::set<Registration>>		s_data;
+
+		template <typename F>
+		void ForEach(UInt32 key, F & functor)
+		{
+			s_lock.Enter();
+
+			auto handles = s_data.find(key);
+			if (handles != s_data.end())
+				for (auto & reg : handles->second)
+					functor(reg);
+
+			s_lock.Leave();
+		}
+	}
+
+	// lookups on one thread, optionally with a thread churning registrations on the busy keys
+	template <typename Lookup, typename Churn>
+	double Dispatch(Lookup lookup, Churn churn, bool withWriter, UInt64 * checksum)
+	{
+		std::atomic<bool>	done(false);
+		std::thread			writer;
+
+		if (withWriter)
+			writer = std::thread([&]()
+			{
+				for (UInt32 i = 0; !done; i++)
+					churn(i);
+			});
+
+		std::mt19937	rng(5);
+		UInt64			sum = 0;
+
+		auto count = [&sum](const Registration & reg) { sum += reg.handle; };
+
+		double elapsed = Test::Time([&]()
+		{
+			for (UInt32 i = 0; i < s_numLookups; i++)
+				lookup(rng() % s_numKeys, count);
+		});
+
+		done = true;
+		if (writer.joinable())
+			writer.join();
+
+		*checksum = sum;
+
+		return elapsed;
+	}
+
+	void Churn(RegistrationIndex<UInt32, Registration> & index, ICriticalSection & writeLock, UInt32 i)
+	{
+		Registration	reg = { i % 64, ScriptName(i), 0 };
+		UInt32			key = i % 8;
+
+		writeLock.Enter();
+
+		if (i & 64)
+			index.Erase(key, reg);
+		else
+			index.Insert(key, reg);
+
+		index.Publish();
+
+		writeLock.Leave();
+	}
+
+	void CheckConcurrent(void)
+	{
+		RegistrationIndex<UInt32, Registration>	index;
+		ICriticalSection						writeLock;
+		std::atomic<bool>						done(false);
+		bool									sorted = true;
+
+		std::thread writer([&]()
+		{
+			for (UInt32 i = 0; !done; i++)
+				Churn(index, writeLock, i);
+		});
+
+		for (UInt32 i = 0; i < s_numLookups / 10; i++)
+		{
+			const Registration	* prev = nullptr;
+
+			auto check = [&](const Registration & reg)
+			{
+				if (prev && !(*prev < reg))
+					sorted = false;
+				prev = &reg;
+			};
+			index.ForEach(i % 8, check);
+		}
+
+		done = true;
+		writer.join();
+
+		CHECK(sorted);
+	}
+
+	void RunBench(void)
+	{
+		RegistrationIndex<UInt32, Registration>	index;
+		ICriticalSection						writeLock;
+		std::mt19937							rng(9);
+
+		// a few scripts on most keys, many on a handful
+		for (UInt32 handle = 0; handle < s_numHandles; handle++)
+		{
+			UInt32			key = handle < s_numHandles / 2 ? rng() % 8 : rng() % s_numKeys;
+			Registration	reg = { handle + 1000, ScriptName(handle), 0 };
+
+			index.Insert(key, reg);
+			Legacy::s_data[key].insert(reg);
+		}
+		index.Publish();
+
+		printf("key dispatch: %u handles on %u keys, %u lookups\n", s_numHandles, s_numKeys, s_numLookups);
+
+		for (bool withWriter : { false, true })
+		{
+			UInt64	legacySum, indexSum;
+
+			double legacy = Dispatch(
+				[](UInt32 key, auto & functor) { Legacy::ForEach(key, functor); },
+				[](UInt32 i)
+				{
+					Registration	reg = { i % 64, ScriptName(i), 0 };
+
+					Legacy::s_lock.Enter();
+					if (i & 64)
+						Legacy::s_data[i % 8].erase(reg);
+					else
+						Legacy::s_data[i % 8].insert(reg);
+					Legacy::s_lock.Leave();
+				},
+				withWriter, &legacySum);
+
+			double indexed = Dispatch(
+				[&](UInt32 key, auto & functor) { index.ForEach(key, functor); },
+				[&](UInt32 i) { Churn(index, writeLock, i); },
+				withWriter, &indexSum);
+
+			// the churned handles are all below 64, they're the only difference
+			if (!withWriter)
+				CHECK(legacySum == indexSum);
+
+			const char	* suffix = withWriter ? ", writer" : "";
+			printf("  std::map + lock (old)%-8s %9.1f ms  %8.0f lookups/ms\n", suffix, legacy, s_numLookups / legacy);
+			printf("  RegistrationIndex%-12s %9.1f ms  %8.0f lookups/ms\n", suffix, indexed, s_numLookups / indexed);
+		}
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if (Test::IsQuick(argc, argv))
+		s_numLookups = 100000;
+
+	CheckAgainstMap<UInt32>(IntKey);
+	CheckAgainstMap<BSFixedString>(StringKey);
+	CheckEraseAll();
+	CheckSnapshot();
+	CheckConcurrent();
+
+	RunBench();
+
+	return Test::Finish("RegistrationIndexBench");
+}
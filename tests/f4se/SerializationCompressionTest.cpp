@@ -0,0 +1,295 @@
+#include "f4se/SerializationCompression.h"
+#include "support/TestSupport.h"
+
+#include <random>
+#include <vector>
+
+// Round trips the co-save LZ4 codec over a generated corpus, feeds the decoder truncated, corrupted
+// and hand-built malformed blocks, and reports compression ratio and throughput per corpus.
+
+namespace
+{
+	typedef std::vector <UInt8>	Buffer;
+
+	enum
+	{
+		kGuardLength =	64,
+		kGuardByte =	0xCD,
+	};
+
+	std::mt19937	s_random(0x4C5A3421);
+
+	// plugin records as the co-save sees them, ids, counts, floats and short strings
+	Buffer MakeRecords(UInt32 length)
+	{
+		Buffer	result;
+
+		for(UInt32 seed = 0; result.size() < length; seed++)
+		{
+			UInt32	formID = 0x01000000 | (seed * 7919 % 0x10000);
+			UInt32	numValues = 1 + seed % 6;
+
+			result.insert(result.end(), (UInt8 *)&formID, (UInt8 *)&formID + sizeof(formID));
+			result.insert(result.end(), (UInt8 *)&numValues, (UInt8 *)&numValues + sizeof(numValues));
+
+			for(UInt32 j = 0; j < numValues; j++)
+			{
+				float	value = seed * 0.5f + j;
+				result.insert(result.end(), (UInt8 *)&value, (UInt8 *)&value + sizeof(value));
+			}
+
+			std::string	name = "Record_" + std::to_string(seed % 97);
+			UInt16		nameLength = name.size();
+
+			result.insert(result.end(), (UInt8 *)&nameLength, (UInt8 *)&nameLength + sizeof(nameLength));
+			result.insert(result.end(), name.begin(), name.end());
+		}
+
+		result.resize(length);
+
+		return result;
+	}
+
+	Buffer MakeText(UInt32 length)
+	{
+		static const char	* kWords[] =
+		{
+			"the", "settlement", "workshop", "power", "armor", "quest", "stage", "actor",
+			"inventory", "perk", "rank", "level", "keyword", "form", "reference", "cell",
+		};
+
+		Buffer	result;
+
+		while(result.size() < length)
+		{
+			const char	* word = kWords[s_random() % (sizeof(kWords) / sizeof(kWords[0]))];
+
+			result.insert(result.end(), word, word + strlen(word));
+			result.push_back((s_random() % 12) ? ' ' : '\n');
+		}
+
+		result.resize(length);
+
+		return result;
+	}
+
+	Buffer MakeRandom(UInt32 length)
+	{
+		Buffer	result(length);
+
+		for(UInt32 i = 0; i < length; i++)
+			result[i] = s_random();
+
+		return result;
+	}
+
+	// short repeats, exercises the overlapping match copy
+	Buffer MakePeriodic(UInt32 length, UInt32 period)
+	{
+		Buffer	result(length);
+
+		for(UInt32 i = 0; i < length; i++)
+			result[i] = (i % period) * 37 + 1;
+
+		return result;
+	}
+
+	Buffer Compress(const Buffer & src)
+	{
+		Buffer	result(SerializationCompression::CompressBound(src.size()));
+
+		UInt32	length = SerializationCompression::Compress(src.data(), src.size(), result.data());
+		CHECK(length <= result.size());
+
+		result.resize(length);
+
+		return result;
+	}
+
+	// decodes in to a buffer with a guard region behind it so an overrun shows up as a failure
+	bool Decompress(const UInt8 * src, UInt32 srcLength, UInt32 dstLength, Buffer * dst = NULL)
+	{
+		Buffer	output(dstLength + kGuardLength, kGuardByte);
+		Buffer	input(src, src + srcLength);
+
+		bool	result = SerializationCompression::Decompress(input.data(), input.size(), output.data(), dstLength);
+
+		for(UInt32 i = 0; i < kGuardLength; i++)
+			CHECK(output[dstLength + i] == kGuardByte);
+
+		if(dst)
+			dst->assign(output.begin(), output.begin() + dstLength);
+
+		return result;
+	}
+
+	void CheckRoundTrip(const Buffer & src)
+	{
+		Buffer	compressed = Compress(src);
+		Buffer	decompressed;
+
+		CHECK(Decompress(compressed.data(), compressed.size(), src.size(), &decompressed));
+		CHECK(decompressed == src);
+		CHECK(src.size() <= SerializationCompression::DecompressBound(compressed.size()));
+
+		// a wrong expected length is an error, not a partial decode
+		CHECK(!Decompress(compressed.data(), compressed.size(), src.size() + 1));
+		if(!src.empty())
+			CHECK(!Decompress(compressed.data(), compressed.size(), src.size() - 1));
+	}
+
+	void TestRoundTrip(void)
+	{
+		// every short length, including the ones below the match-find limit
+		for(UInt32 length = 0; length <= 96; length++)
+		{
+			CheckRoundTrip(MakeRecords(length));
+			CheckRoundTrip(MakeRandom(length));
+			CheckRoundTrip(MakePeriodic(length, 1));
+		}
+
+		for(UInt32 period = 1; period <= 20; period++)
+			CheckRoundTrip(MakePeriodic(5000, period));
+
+		// long literal and match runs need several 255 continuation bytes
+		CheckRoundTrip(MakeRandom(70000));
+		CheckRoundTrip(MakePeriodic(200000, 1));
+
+		// matches beyond the 64k window can't be referenced
+		Buffer	block = MakeRandom(1000);
+		Buffer	farRepeat = block;
+		Buffer	gap = MakeRandom(70000);
+
+		farRepeat.insert(farRepeat.end(), gap.begin(), gap.end());
+		farRepeat.insert(farRepeat.end(), block.begin(), block.end());
+
+		CheckRoundTrip(farRepeat);
+
+		for(UInt32 i = 0; i < 200; i++)
+		{
+			UInt32	length = s_random() % 20000;
+
+			switch(i % 4)
+			{
+				case 0:	CheckRoundTrip(MakeRecords(length));	break;
+				case 1:	CheckRoundTrip(MakeText(length));		break;
+				case 2:	CheckRoundTrip(MakeRandom(length));		break;
+				case 3:	CheckRoundTrip(MakePeriodic(length, 1 + s_random() % 300));	break;
+			}
+		}
+	}
+
+	void TestMalformed(void)
+	{
+		// hand-built blocks
+		const UInt8	kEmpty[] = { 0x00 };
+		CHECK(Decompress(kEmpty, 0, 0));
+		CHECK(Decompress(kEmpty, sizeof(kEmpty), 0));
+		CHECK(!Decompress(kEmpty, 0, 4));
+
+		const UInt8	kLiteralPastInput[] = { 0x50, 'a', 'b', 'c' };					// 5 literals, 3 present
+		CHECK(!Decompress(kLiteralPastInput, sizeof(kLiteralPastInput), 5));
+
+		const UInt8	kLiteralPastOutput[] = { 0x40, 'a', 'b', 'c', 'd' };
+		CHECK(!Decompress(kLiteralPastOutput, sizeof(kLiteralPastOutput), 3));
+
+		const UInt8	kTruncatedRun[] = { 0xF0, 0xFF, 0xFF };						// length run never terminates
+		CHECK(!Decompress(kTruncatedRun, sizeof(kTruncatedRun), 1000));
+
+		const UInt8	kTruncatedOffset[] = { 0x10, 'a', 0x01 };					// one offset byte
+		CHECK(!Decompress(kTruncatedOffset, sizeof(kTruncatedOffset), 10));
+
+		const UInt8	kZeroOffset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+		CHECK(!Decompress(kZeroOffset, sizeof(kZeroOffset), 5));
+
+		const UInt8	kOffsetBeforeStart[] = { 0x10, 'a', 0x02, 0x00, 0x00 };		// refers to one byte before the output
+		CHECK(!Decompress(kOffsetBeforeStart, sizeof(kOffsetBeforeStart), 5));
+
+		const UInt8	kMatchPastOutput[] = { 0x1F, 'a', 0x01, 0x00, 0xFF, 0x10 };	// 1 + 4 + 15 + 255 + 16 bytes
+		CHECK(!Decompress(kMatchPastOutput, sizeof(kMatchPastOutput), 100));
+
+		const UInt8	kValidOverlap[] = { 0x10, 'a', 0x01, 0x00, 0x10, 'b' };
+		Buffer	output;
+		CHECK(Decompress(kValidOverlap, sizeof(kValidOverlap), 6, &output));
+		CHECK(!memcmp(output.data(), "aaaaab", 6));
+
+		// every truncation of a real block fails cleanly
+		Buffer	src = MakeRecords(4000);
+		Buffer	compressed = Compress(src);
+
+		for(UInt32 length = 0; length < compressed.size(); length++)
+			CHECK(!Decompress(compressed.data(), length, src.size()));
+
+		// random corruption may decode to garbage but must never write outside the output
+		for(UInt32 i = 0; i < 20000; i++)
+		{
+			Buffer	corrupt = compressed;
+			UInt32	numFlips = 1 + s_random() % 8;
+
+			for(UInt32 j = 0; j < numFlips; j++)
+				corrupt[s_random() % corrupt.size()] ^= 1 << (s_random() % 8);
+
+			Test::Use(Decompress(corrupt.data(), corrupt.size(), src.size()));
+		}
+
+		// and so must pure noise
+		for(UInt32 i = 0; i < 20000; i++)
+		{
+			Buffer	noise = MakeRandom(1 + s_random() % 64);
+
+			Test::Use(Decompress(noise.data(), noise.size(), s_random() % 256));
+		}
+	}
+
+	void Benchmark(const char * name, const Buffer & src, UInt32 iterations)
+	{
+		Buffer	compressed(SerializationCompression::CompressBound(src.size()));
+		Buffer	decompressed(src.size());
+		UInt32	compressedLength = 0;
+
+		double	compressTime = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < iterations; i++)
+				compressedLength = SerializationCompression::Compress(src.data(), src.size(), compressed.data());
+		});
+
+		bool	ok = true;
+
+		double	decompressTime = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < iterations; i++)
+				ok &= SerializationCompression::Decompress(compressed.data(), compressedLength, decompressed.data(), decompressed.size());
+		});
+
+		CHECK(ok);
+		CHECK(decompressed == src);
+
+		double	megabytes = (double)src.size() * iterations / (1024 * 1024);
+
+		printf("%-10s %9u -> %9u bytes (%5.1f%%)  compress %8.1f MB/s  decompress %8.1f MB/s\n", name,
+			(UInt32)src.size(), compressedLength, 100.0 * compressedLength / src.size(),
+			megabytes / (compressTime / 1000), megabytes / (decompressTime / 1000));
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	UInt32	corpusLength = 8 * 1024 * 1024;
+	UInt32	iterations = 5;
+
+	if(Test::IsQuick(argc, argv))
+	{
+		corpusLength = 256 * 1024;
+		iterations = 1;
+	}
+
+	TestRoundTrip();
+	TestMalformed();
+
+	Benchmark("records", MakeRecords(corpusLength), iterations);
+	Benchmark("text", MakeText(corpusLength), iterations);
+	Benchmark("random", MakeRandom(corpusLength), iterations);
+	Benchmark("zeros", Buffer(corpusLength, 0), iterations);
+
+	return Test::Finish("SerializationCompressionTest");
+}
@@ -0,0 +1,306 @@
+#include "f4se/GameSettings.h"
+#include "support/TestSupport.h"
+#include "support/AllocCounter.h"
+
+#include <new>
+#include <random>
+#include <vector>
+
+// INI setting lookups by name over a collection of a few thousand settings, through SettingCollectionList::Get and
+// through the walk it did before, interning the searched name and each setting's name and comparing the two.
+// Reports lookups per millisecond, both for settings in the first list and for ones GetINISetting finds in the second.
+//
+//	- every setting is found, whatever the case of the name, and a name that isn't there is not
+//	- settings added anywhere in the list are found without invalidating, a node given a new setting finds the new one
+//	- a node unlinked after InvalidateIndex is never looked at again
+//	- a setting renamed by SetString is still found, the first of two settings with one name wins
+//	- a lookup allocates nothing once the index is built
+
+// the game's, the tests only need them to exist
+Setting::~Setting() { }
+SettingCollection::~SettingCollection() { }
+bool SettingCollection::Unk_05() { return false; }
+bool SettingCollection::Unk_06() { return false; }
+bool SettingCollection::Unk_07() { return false; }
+bool SettingCollection::Unk_08() { return false; }
+bool SettingCollection::Unk_09() { return false; }
+SettingCollectionList::~SettingCollectionList() { }
+
+namespace
+{
+	UInt32	s_numSettings = 3000;
+	UInt32	s_numLookups = 1024 * 2000;
+
+	const char	* kSections[] = { "General", "Display", "Interface", "Controls", "Audio", "Papyrus" };
+	const char	* kPrefixes = "ifbs";
+
+	class TestCollection : public SettingCollectionList
+	{
+	public:
+		TestCollection()
+		{
+			unk110 = nullptr;
+			unk118 = nullptr;
+			data = nullptr;
+		}
+
+		~TestCollection()
+		{
+			for(auto node : m_nodes)
+				delete node;
+			for(auto setting : m_settings)
+				delete setting;
+		}
+
+		virtual void Unk_01() { }
+		virtual void Unk_02() { }
+		virtual void Unk_03() { }
+		virtual void Unk_04() { }
+
+		Setting * Append(const std::string & name)	{ return Insert(name, Tail(), false); }
+		Setting * Prepend(const std::string & name)	{ return Insert(name, nullptr, true); }
+
+		// after the given node, for changes the index can't see
+		Setting * InsertAfter(const std::string & name, Node * pred)	{ return Insert(name, pred, false); }
+
+		Node * Tail(void)
+		{
+			Node	* node = data;
+			while(node && node->next)
+				node = node->next;
+			return node;
+		}
+
+	private:
+		Setting * Insert(const std::string & name, Node * pred, bool front)
+		{
+			m_names.emplace_back(name.c_str(), name.c_str() + name.size() + 1);
+
+			Setting	* setting = new Setting;
+			setting->name = m_names.back().data();
+			setting->data.u32 = m_settings.size();
+
+			Node	* node = new Node;
+			node->data = setting;
+
+			if(front || !pred)
+			{
+				node->next = data;
+				data = node;
+			}
+			else
+			{
+				node->next = pred->next;
+				pred->next = node;
+			}
+
+			m_settings.push_back(setting);
+			m_nodes.push_back(node);
+
+			return setting;
+		}
+
+		std::vector <Setting *>				m_settings;
+		std::vector <Node *>				m_nodes;
+		std::vector <std::vector <char>>	m_names;
+	};
+
+	std::string SettingName(UInt32 i)
+	{
+		return std::string(1, kPrefixes[i % 4]) + "Setting" + std::to_string(i) + ":" + kSections[i % 6];
+	}
+
+	std::string Upper(std::string str)
+	{
+		for(auto & c : str)
+			c = toupper(c);
+		return str;
+	}
+
+	// SettingCollectionList::Get as it was
+	Setting * LegacyGet(SettingCollectionList * list, const char * name)
+	{
+		SettingCollectionList::Node	* node = list->data;
+		do
+		{
+			Setting	* setting = node->data;
+			if(setting)
+			{
+				BSAutoFixedString	searchName(name);
+				BSAutoFixedString	settingName(setting->name);
+				if(searchName == settingName)
+					return setting;
+			}
+
+			node = node->next;
+		} while(node);
+
+		return nullptr;
+	}
+
+	void CheckLookups(void)
+	{
+		TestCollection	list;
+
+		// the game's lists start with an empty node
+		list.Prepend("placeholder");
+		list.data->data = nullptr;
+
+		std::vector <Setting *>	settings;
+		for(UInt32 i = 0; i < 500; i++)
+			settings.push_back(list.Append(SettingName(i)));
+
+		bool	found = true;
+		for(UInt32 i = 0; i < settings.size(); i++)
+		{
+			std::string	name = SettingName(i);
+
+			found &= list.Get(name.c_str()) == settings[i];
+			found &= list.Get(Upper(name).c_str()) == settings[i];
+			found &= LegacyGet(&list, name.c_str()) == settings[i];
+		}
+
+		CHECK(found);
+		CHECK(list.Get("iMissing:General") == nullptr);
+		CHECK(list.Get("") == nullptr);
+		CHECK(list.Get(nullptr) == nullptr);
+
+		// the ends of the list
+		Setting	* appended = list.Append("fAppended:Display");
+		Setting	* prepended = list.Prepend("bPrepended:General");
+		CHECK(list.Get("fAppended:Display") == appended);
+		CHECK(list.Get("bPrepended:General") == prepended);
+
+		// the middle, found by the walk after the index misses
+		Setting	* inserted = list.InsertAfter("iInserted:Audio", list.data->next);
+		CHECK(list.Get("iInserted:Audio") == inserted);
+		CHECK(list.Get("fAppended:Display") == appended);
+
+		// a node given a different setting, the old one is gone and its name mustn't be read
+		SettingCollectionList::Node	* replacedNode = list.data;
+		while(replacedNode->data != settings[10])
+			replacedNode = replacedNode->next;
+
+		char	* originalName = settings[10]->name;
+
+		Setting	replacement;
+		replacement.name = originalName;
+		replacement.data.u32 = 12345;
+
+		settings[10]->name = (char *)"iClobbered:General";
+		replacedNode->data = &replacement;
+
+		CHECK(list.Get(SettingName(10).c_str()) == &replacement);
+		CHECK(list.Get("iClobbered:General") == nullptr);
+
+		replacedNode->data = settings[10];
+		settings[10]->name = originalName;
+		CHECK(list.Get(SettingName(10).c_str()) == settings[10]);
+
+		// unlinked, the index is dropped first so the node could be freed
+		SettingCollectionList::Node	* pred = replacedNode;
+		SettingCollectionList::Node	* removedNode = pred->next;
+
+		list.InvalidateIndex();
+		pred->next = removedNode->next;
+		CHECK(list.Get(SettingName(11).c_str()) == nullptr);
+
+		pred->next = removedNode;
+		CHECK(list.Get(SettingName(11).c_str()) == settings[11]);
+
+		// a later setting with the name of an earlier one
+		list.Append(SettingName(7));
+		CHECK(list.Get(SettingName(7).c_str()) == settings[7]);
+
+		// SetString moves a static string setting to a new 'S' name
+		Setting	* str = settings[3];
+		CHECK(str->GetType() == Setting::kType_String);
+		CHECK(str->SetString("changed"));
+		CHECK(str->name[0] == 'S');
+		CHECK(list.Get(SettingName(3).c_str()) == str);
+
+		// an empty list
+		TestCollection	empty;
+		CHECK(empty.Get("iSetting:General") == nullptr);
+
+		// nothing allocated once built
+		std::vector <std::string>	names;
+		for(UInt32 i = 0; i < settings.size(); i++)
+			names.push_back(SettingName(i));
+
+		UInt64	before = Test::GetNumAllocs();
+		UInt32	numFound = 0;
+		for(auto & name : names)
+			numFound += list.Get(name.c_str()) != nullptr;
+
+		CHECK(numFound == names.size());
+		CHECK(Test::GetNumAllocs() == before);
+	}
+
+	void RunBench(void)
+	{
+		TestCollection	ini, prefs;
+
+		for(UInt32 i = 0; i < s_numSettings; i++)
+			(i % 3 ? ini : prefs).Append(SettingName(i));
+
+		std::vector <std::string>	names;
+		std::mt19937				rng(5);
+
+		for(UInt32 i = 0; i < 1024; i++)
+			names.push_back(SettingName(rng() % s_numSettings));
+
+		// GetINISetting, the second list only when the first doesn't have it
+		auto	legacyGet = [&](const char * name)
+		{
+			Setting	* setting = LegacyGet(&ini, name);
+			return setting ? setting : LegacyGet(&prefs, name);
+		};
+
+		auto	indexedGet = [&](const char * name)
+		{
+			Setting	* setting = ini.GetIndexed(name);
+			if(!setting)
+				setting = prefs.GetIndexed(name);
+			if(!setting)
+				setting = ini.Get(name);
+			return setting ? setting : prefs.Get(name);
+		};
+
+		// the legacy walk is linear in the settings, time one pass over the names and scale
+		UInt32	numLegacyLookups = 1024;
+		UInt64	legacySum = 0;
+		UInt64	indexedSum = 0;
+
+		double	legacy = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < numLegacyLookups; i++)
+				legacySum += legacyGet(names[i & 1023].c_str())->data.u32;
+		});
+
+		double	indexed = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < s_numLookups; i++)
+				indexedSum += indexedGet(names[i & 1023].c_str())->data.u32;
+		});
+
+		CHECK(indexedSum == legacySum * (s_numLookups / numLegacyLookups));
+
+		legacy *= (double)s_numLookups / numLegacyLookups;
+
+		printf("INI setting lookups: %u settings over two lists, %u lookups\n", s_numSettings, s_numLookups);
+		printf("  list walk + BSAutoFixedString (old) %9.1f ms  %8.0f lookups/ms\n", legacy, s_numLookups / legacy);
+		printf("  indexes, then the lists (new)       %9.1f ms  %8.0f lookups/ms\n", indexed, s_numLookups / indexed);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+		s_numLookups = 1024 * 100;
+
+	CheckLookups();
+	RunBench();
+
+	return Test::Finish("SettingLookupBench");
+}
@@ -0,0 +1,217 @@
+#include "f4se/SubscriptionIndex.h"
+#include "support/TestSupport.h"
+
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Activate events against scripts registered with FormsPairParameters style filters, through SubscriptionIndex and
+// through the walk over every registration that RegistrationSetHolder::ForEach did, testing each filter. Reports the
+// cost of an event as the number of scripts filtered on other forms grows.
+//
+//	- an event visits exactly the registrations the old filter passed, in the same order, each once
+//	- a registration subscribed to several of an event's keys, and events whose keys repeat, visit it once
+//	- the registrations an event visits don't depend on how many listeners are filtered on other forms
+
+namespace
+{
+	UInt32	s_numEvents = 200000;
+
+	typedef std::pair<UInt32, UInt32>	FormPair;
+
+	struct Registration
+	{
+		UInt32				id;
+		std::set<FormPair>	pairs;		// FormsPairParameters::pairs, empty for no filter
+
+		template <typename F>
+		void ForEachFilterKey(F & functor) const
+		{
+			for (auto & pair : pairs)
+				functor(Key(pair.first, pair.second));
+		}
+
+		static UInt64 Key(UInt32 actor, UInt32 ref) { return ((UInt64)actor << 32) | ref; }
+
+		// the filter f4seee's activate sink applied to every registration
+		bool Passes(UInt32 actor, UInt32 ref) const
+		{
+			return pairs.empty() || pairs.count(FormPair(actor, ref)) || pairs.count(FormPair(0, ref)) || pairs.count(FormPair(actor, 0)) || pairs.count(FormPair(0, 0));
+		}
+	};
+
+	typedef SubscriptionIndex<Registration>	Index;
+
+	UInt32 EventKeys(UInt64 * keys, UInt32 actor, UInt32 ref)
+	{
+		keys[0] = Registration::Key(actor, ref);
+		keys[1] = Registration::Key(0, ref);
+		keys[2] = Registration::Key(actor, 0);
+		keys[3] = Registration::Key(0, 0);
+		return 4;
+	}
+
+	void Build(Index & index, const std::vector<Registration> & regs)
+	{
+		for (auto & reg : regs)
+			index.Add(reg, [&reg](auto functor) { reg.ForEachFilterKey(functor); });
+	}
+
+	std::vector<UInt32> Matching(const Index & index, UInt32 actor, UInt32 ref)
+	{
+		UInt64	keys[Index::kMaxEventKeys];
+		UInt32	numKeys = EventKeys(keys, actor, ref);
+
+		std::vector<UInt32> ids;
+		auto collect = [&ids](const Registration & reg) { ids.push_back(reg.id); };
+		index.ForEachMatching(keys, numKeys, collect);
+
+		return ids;
+	}
+
+	void CheckAgainstFilter(void)
+	{
+		std::mt19937				rng(31);
+		std::vector<Registration>	regs(500);
+
+		// small form ranges so events hit pairs, wildcards and several keys of one registration
+		for (UInt32 i = 0; i < regs.size(); i++)
+		{
+			regs[i].id = i;
+
+			UInt32 numPairs = rng() % 4;
+			for (UInt32 j = 0; j < numPairs; j++)
+				regs[i].pairs.insert(FormPair(rng() % 3 ? rng() % 8 : 0, rng() % 3 ? 0x100 + rng() % 8 : 0));
+		}
+
+		Index index;
+		Build(index, regs);
+
+		CHECK(index.NumRegistrations() == regs.size());
+
+		bool agrees = true;
+
+		for (UInt32 actor = 0; actor < 10; actor++)
+		{
+			for (UInt32 ref = 0x100; ref < 0x10A; ref++)
+			{
+				std::vector<UInt32> expected;
+				for (auto & reg : regs)
+					if (reg.Passes(actor, ref))
+						expected.push_back(reg.id);
+
+				agrees &= Matching(index, actor, ref) == expected;
+			}
+
+			// no furniture, the keys repeat
+			std::vector<UInt32> expected;
+			for (auto & reg : regs)
+				if (reg.Passes(actor, 0))
+					expected.push_back(reg.id);
+
+			agrees &= Matching(index, actor, 0) == expected;
+		}
+
+		CHECK(agrees);
+	}
+
+	void CheckOverlap(void)
+	{
+		std::vector<Registration> regs(3);
+
+		regs[0].id = 0;
+		regs[0].pairs = { FormPair(1, 2), FormPair(0, 2), FormPair(1, 0), FormPair(0, 0) };
+		regs[1].id = 1;
+		regs[2].id = 2;
+		regs[2].pairs = { FormPair(5, 6) };
+
+		Index index;
+		Build(index, regs);
+
+		CHECK(index.NumUnfiltered() == 1);
+		CHECK(index.NumKeys() == 5);
+		CHECK(Matching(index, 1, 2) == std::vector<UInt32>({ 0, 1 }));
+		CHECK(Matching(index, 5, 6) == std::vector<UInt32>({ 0, 1, 2 }));
+		CHECK(Matching(index, 0, 0) == std::vector<UInt32>({ 0, 1 }));
+
+		Index empty;
+		CHECK(Matching(empty, 1, 2).empty());
+	}
+
+	// a few listeners for the activated forms, the rest filtered on other references
+	void RunBench(void)
+	{
+		printf("activate event: %u events, 8 matching listeners\n", s_numEvents);
+
+		for (UInt32 numOthers : { 10, 1000, 100000 })
+		{
+			std::vector<Registration> regs;
+
+			for (UInt32 i = 0; i < numOthers; i++)
+				regs.push_back({ (UInt32)regs.size(), { FormPair(0, 0x10000 + i) } });
+
+			for (UInt32 i = 0; i < 8; i++)
+				regs.push_back({ (UInt32)regs.size(), { FormPair(i % 2, 0x100 + i % 4) } });
+
+			Index index;
+			Build(index, regs);
+
+			UInt64	indexVisits = 0;
+			UInt64	legacyVisits = 0;
+			UInt64	indexCalls = 0;
+			UInt64	legacyCalls = 0;
+
+			double indexed = Test::Time([&]()
+			{
+				auto count = [&](const Registration & reg) { indexVisits++; indexCalls += reg.id; };
+
+				for (UInt32 i = 0; i < s_numEvents; i++)
+				{
+					UInt64	keys[Index::kMaxEventKeys];
+					UInt32	numKeys = EventKeys(keys, i % 2, 0x100 + i % 4);
+
+					index.ForEachMatching(keys, numKeys, count);
+				}
+			});
+
+			// the old walk is linear in the listeners, time fewer events and scale
+			UInt32 numLegacyEvents = numOthers > 1000 ? s_numEvents / 100 : s_numEvents;
+
+			double legacy = Test::Time([&]()
+			{
+				for (UInt32 i = 0; i < numLegacyEvents; i++)
+				{
+					for (auto & reg : regs)
+					{
+						legacyVisits++;
+						if (reg.Passes(i % 2, 0x100 + i % 4))
+							legacyCalls += reg.id;
+					}
+				}
+			});
+
+			legacy *= (double)s_numEvents / numLegacyEvents;
+
+			// each event visits only the registrations it calls
+			CHECK(indexVisits == (UInt64)s_numEvents * 2);
+			CHECK(indexCalls / s_numEvents == legacyCalls / numLegacyEvents);
+			Test::Use(legacyVisits);
+
+			printf("  %6u others  every registration + filter (old) %9.1f ms   SubscriptionIndex %7.1f ms\n", numOthers, legacy, indexed);
+		}
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if (Test::IsQuick(argc, argv))
+		s_numEvents = 20000;
+
+	CheckAgainstFilter();
+	CheckOverlap();
+
+	RunBench();
+
+	return Test::Finish("SubscriptionIndexBench");
+}
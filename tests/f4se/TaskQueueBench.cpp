@@ -0,0 +1,326 @@
+#include "f4se/TaskQueue.h"
+#include "f4se/GameThreads.h"
+#include "common/ICriticalSection.h"
+#include "support/TestSupport.h"
+#include "support/AllocCounter.h"
+
+#include <atomic>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Many producer threads pushing small tasks while one thread pumps, through TaskQueue and through
+// the old std::queue behind an ICriticalSection that was held while every task ran. Reports the
+// time to drain everything and the worst time a producer spent inside AddTask.
+//
+//	- every task runs exactly once, and each producer's tasks run in the order they were pushed
+//	- a pump with no budget, the default, runs everything queued
+//	- a pump with a budget runs no more than its budget and leaves the rest queued
+//	- a task that pumps the queue it is running from doesn't run anything
+//	- once the node pool is warm, pushing small TaskFunctions makes no heap allocations
+//	- a TaskFunction too large to store inline still runs and is destroyed once
+//	- an empty TaskFunction or a null task isn't queued
+
+namespace
+{
+	UInt32	s_numProducers = 16;
+	UInt32	s_tasksPerProducer = 100000;
+	UInt32	s_taskWork = 200;		// simulated work per task
+
+	std::vector <UInt32>	s_lastSeen;		// per producer, consumer only
+	std::atomic <UInt64>	s_numRun(0);
+	bool					s_inOrder = true;
+
+	class CountTask : public ITaskDelegate
+	{
+	public:
+		CountTask(UInt32 producer, UInt32 sequence) : m_producer(producer), m_sequence(sequence) { }
+
+		virtual void Run()
+		{
+			volatile UInt32	sink = m_sequence;
+			for(UInt32 i = 0; i < s_taskWork; i++)
+				sink = sink * 31 + i;
+
+			if(m_sequence != s_lastSeen[m_producer] + 1)
+				s_inOrder = false;
+			s_lastSeen[m_producer] = m_sequence;
+
+			s_numRun++;
+		}
+
+	private:
+		UInt32	m_producer;
+		UInt32	m_sequence;
+	};
+
+	namespace Legacy
+	{
+		ICriticalSection			s_lock;
+		std::queue <ITaskDelegate *>	s_tasks;
+
+		void AddTask(ITaskDelegate * task)
+		{
+			s_lock.Enter();
+			s_tasks.push(task);
+			s_lock.Leave();
+		}
+
+		void Run(void)
+		{
+			s_lock.Enter();
+			while(!s_tasks.empty())
+			{
+				ITaskDelegate	* cmd = s_tasks.front();
+				s_tasks.pop();
+				cmd->Run();
+				delete cmd;
+			}
+			s_lock.Leave();
+		}
+	}
+
+	struct Result
+	{
+		double	milliseconds;
+		double	maxPushMicroseconds;
+	};
+
+	template <typename Push, typename Pump>
+	Result RunProducers(Push push, Pump pump)
+	{
+		s_lastSeen.assign(s_numProducers, 0);
+		s_numRun = 0;
+		s_inOrder = true;
+
+		UInt64					total = (UInt64)s_numProducers * s_tasksPerProducer;
+		std::vector <double>	maxPush(s_numProducers, 0.0);
+		std::vector <std::thread>	producers;
+		Result					result;
+
+		result.milliseconds = Test::Time([&]()
+		{
+			for(UInt32 p = 0; p < s_numProducers; p++)
+			{
+				producers.emplace_back([&, p]()
+				{
+					for(UInt32 i = 1; i <= s_tasksPerProducer; i++)
+					{
+						Test::Timer	timer;
+
+						push(new CountTask(p, i));
+
+						double	elapsed = timer.Elapsed();
+						if(elapsed > maxPush[p])
+							maxPush[p] = elapsed;
+					}
+				});
+			}
+
+			while(s_numRun < total)
+				pump();
+
+			for(auto & thread : producers)
+				thread.join();
+		});
+
+		result.maxPushMicroseconds = 0;
+		for(double elapsed : maxPush)
+			if(elapsed * 1000 > result.maxPushMicroseconds)
+				result.maxPushMicroseconds = elapsed * 1000;
+
+		CHECK(s_numRun == total);
+		CHECK(s_inOrder);
+
+		return result;
+	}
+
+	void Report(const char * name, const Result & result)
+	{
+		UInt64	total = (UInt64)s_numProducers * s_tasksPerProducer;
+
+		printf("  %-28s %9.1f ms  %8.0f tasks/ms  worst push %8.1f us\n",
+			name, result.milliseconds, total / result.milliseconds, result.maxPushMicroseconds);
+	}
+
+	class PumpTask : public ITaskDelegate
+	{
+	public:
+		PumpTask(TaskQueue * queue) : m_queue(queue) { }
+
+		virtual void Run()
+		{
+			UInt64	before = s_numRun;
+			m_queue->Run();
+			CHECK(s_numRun == before);
+		}
+
+	private:
+		TaskQueue	* m_queue;
+	};
+
+	void CheckFunctions(void)
+	{
+		TaskQueue	queue;
+		UInt32		numRun = 0;
+		UInt32		sum = 0;
+
+		auto PushRound = [&](UInt32 count)
+		{
+			for(UInt32 i = 0; i < count; i++)
+			{
+				UInt32	a = i, b = i * 3;
+				queue.Push(TaskFunction([&numRun, &sum, a, b]() { sum += a + b; numRun++; }));
+			}
+
+			queue.Run();
+		};
+
+		// grow the pool to the peak depth, then the same depth again must not allocate
+		PushRound(1000);
+
+		TaskQueue::PoolStats	before;
+		TaskQueue::GetPoolStats(&before);
+		UInt64	allocsBefore = Test::GetNumAllocs();
+
+		for(UInt32 round = 0; round < 10; round++)
+			PushRound(1000);
+
+		TaskQueue::PoolStats	after;
+		TaskQueue::GetPoolStats(&after);
+
+		CHECK(numRun == 11000);
+		CHECK(Test::GetNumAllocs() == allocsBefore);
+		CHECK(after.numSlabs == before.numSlabs);
+		CHECK(after.numAcquired - before.numAcquired == 10000);
+		CHECK(after.numHeapTasks == before.numHeapTasks);
+
+		printf("task functions: %u slabs (%u nodes) for %llu tasks, %llu allocations in steady state\n",
+			after.numSlabs, after.numNodes, after.numAcquired, Test::GetNumAllocs() - allocsBefore);
+
+		// too large to store inline, allocated by TaskFunction and freed after it runs
+		struct Large
+		{
+			UInt32	values[64];
+		};
+
+		static UInt32	s_numLive = 0;
+		struct Tracked
+		{
+			Tracked()					{ s_numLive++; }
+			Tracked(const Tracked &)	{ s_numLive++; }
+			~Tracked()					{ s_numLive--; }
+		};
+
+		Large	large = { };
+		large.values[63] = 7;
+
+		TaskFunction	task([&sum, large, tracked = Tracked()]() { sum += large.values[63]; });
+		CHECK(!task.IsInline());
+
+		sum = 0;
+		queue.Push(std::move(task));
+		CHECK(!task);
+
+		queue.Run();
+		CHECK(sum == 7);
+		CHECK(s_numLive == 0);
+
+		TaskQueue::GetPoolStats(&after);
+		CHECK(after.numHeapTasks == before.numHeapTasks + 1);
+
+		// default constructed, and the one just moved from
+		TaskFunction	empty;
+		TaskQueue::Stats	stats;
+
+		queue.GetStats(&stats);
+		UInt64	numQueued = stats.numQueued;
+
+		queue.Push(std::move(empty));
+		queue.Push(std::move(task));
+		queue.Push((ITaskDelegate *)nullptr);
+		queue.Run();
+
+		queue.GetStats(&stats);
+		CHECK(stats.numQueued == numQueued);
+		CHECK(stats.depth == 0);
+	}
+
+	void CheckBudget(void)
+	{
+		// no budget by default, one pump runs everything queued before it
+		TaskQueue	unbudgeted;
+
+		s_lastSeen.assign(1, 0);
+		s_numRun = 0;
+
+		for(UInt32 i = 1; i <= 1000; i++)
+			unbudgeted.Push(new CountTask(0, i));
+
+		unbudgeted.Run();
+		CHECK(s_numRun == 1000);
+
+		TaskQueue	queue;
+		queue.SetBudget(100, 0);
+
+		s_lastSeen.assign(1, 0);
+		s_numRun = 0;
+		s_inOrder = true;
+
+		queue.Push(new PumpTask(&queue));
+		for(UInt32 i = 1; i <= 1000; i++)
+			queue.Push(new CountTask(0, i));
+
+		queue.Run();
+		CHECK(s_numRun == 99);
+
+		TaskQueue::Stats	stats;
+		queue.GetStats(&stats);
+		CHECK(stats.depth == 901);
+		CHECK(stats.maxDepth == 1001);
+		CHECK(stats.numDeferred == 1);
+
+		while(s_numRun < 1000)
+			queue.Run();
+
+		queue.GetStats(&stats);
+		CHECK(stats.depth == 0);
+		CHECK(stats.numRun == 1001);
+		CHECK(stats.numDeferred == 10);
+		CHECK(s_inOrder);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_numProducers = 4;
+		s_tasksPerProducer = 5000;
+	}
+
+	CheckBudget();
+	CheckFunctions();
+
+	printf("task queue: %u producers x %u tasks\n", s_numProducers, s_tasksPerProducer);
+
+	Result	legacy = RunProducers(Legacy::AddTask, Legacy::Run);
+	Report("locked std::queue (old)", legacy);
+
+	TaskQueue	unlimited;
+	Result	lockFree = RunProducers([&](ITaskDelegate * task) { unlimited.Push(task); }, [&]() { unlimited.Run(); });
+	Report("TaskQueue, no budget", lockFree);
+
+	TaskQueue	budgeted;
+	budgeted.SetBudget(0, 2000);
+	Result	budget = RunProducers([&](ITaskDelegate * task) { budgeted.Push(task); }, [&]() { budgeted.Run(); });
+	Report("TaskQueue, 2 ms budget", budget);
+
+	TaskQueue::Stats	stats;
+	budgeted.GetStats(&stats);
+	printf("  budgeted: max depth %u, %u pumps deferred, latency avg %.1f us max %llu us\n",
+		stats.maxDepth, stats.numDeferred, (double)stats.totalLatency / stats.numRun, stats.maxLatency);
+	CHECK(stats.depth == 0);
+
+	return Test::Finish("TaskQueueBench");
+}
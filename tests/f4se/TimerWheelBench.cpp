@@ -0,0 +1,316 @@
+#include "f4se/TimerWheel.h"
+#include "support/TestSupport.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Pending delay functors waiting on F4SEDelayFunctorWaitList, updated once per 16 ms frame until all
+// have run, through TimerWheel and through the old vector that was decremented and partitioned
+// every frame. Reports the total and the average cost of an update.
+//
+//	- every entry comes out exactly once, never before its deadline and no later than the first
+//	  update a whole slot after it
+//	- entries whose deadline has passed when they're inserted come out on the next update
+//	- delays as long as a Papyrus call can ask for, and longer ones read back from a save
+//	- saving the remaining delays and loading them in to a fresh wheel keeps every deadline
+
+namespace
+{
+	const SInt64	kTicksPerMS = 10000;		// a 10 MHz performance counter
+	const SInt64	kFrameTicks = 16 * kTicksPerMS;
+
+	UInt32	s_numPending = 100000;
+	UInt32	s_maxDelayMS = 60000;
+
+	// ids stand in for the functor pointers, they're never dereferenced
+	IF4SEDelayFunctor * ToFunctor(UInt32 id)	{ return (IF4SEDelayFunctor *)(uintptr_t)(id + 1); }
+	UInt32 ToId(IF4SEDelayFunctor * func)		{ return (UInt32)(uintptr_t)func - 1; }
+
+	std::vector <SInt64> MakeDeadlines(SInt64 start)
+	{
+		std::mt19937			rng(1234);
+		std::vector <SInt64>	deadlines(s_numPending);
+
+		for(auto & deadline : deadlines)
+			deadline = start + (SInt64)(rng() % s_maxDelayMS) * kTicksPerMS + rng() % kTicksPerMS;
+
+		return deadlines;
+	}
+
+	namespace Legacy
+	{
+		typedef std::pair <SInt64, IF4SEDelayFunctor *>	WaitEntryT;
+
+		std::vector <WaitEntryT>	s_waitData;
+
+		void Update(SInt64 dt, std::vector <IF4SEDelayFunctor *> & ready)
+		{
+			for(auto & entry : s_waitData)
+				if(entry.first > 0)
+					entry.first -= dt;
+
+			auto	r = std::partition(s_waitData.begin(), s_waitData.end(), [](const WaitEntryT & e) { return e.first > 0; });
+
+			for(auto it = r; it != s_waitData.end(); ++it)
+				ready.push_back(it->second);
+
+			s_waitData.resize(std::distance(s_waitData.begin(), r));
+		}
+	}
+
+	struct Result
+	{
+		double	milliseconds;
+		UInt32	numUpdates;
+	};
+
+	void Report(const char * name, const Result & result)
+	{
+		printf("  %-24s %9.1f ms  %8.2f us per update\n",
+			name, result.milliseconds, result.milliseconds * 1000 / result.numUpdates);
+	}
+
+	Result RunLegacy(void)
+	{
+		std::vector <SInt64>				deadlines = MakeDeadlines(0);
+		std::vector <IF4SEDelayFunctor *>	ready;
+		Result								result = { 0, 0 };
+		UInt32								numRun = 0;
+
+		Legacy::s_waitData.clear();
+		for(UInt32 i = 0; i < s_numPending; i++)
+			Legacy::s_waitData.emplace_back(deadlines[i], ToFunctor(i));
+
+		result.milliseconds = Test::Time([&]()
+		{
+			while(numRun < s_numPending)
+			{
+				Legacy::Update(kFrameTicks, ready);
+				result.numUpdates++;
+
+				numRun += ready.size();
+				ready.clear();
+			}
+		});
+
+		CHECK(numRun == s_numPending);
+
+		return result;
+	}
+
+	Result RunWheel(void)
+	{
+		SInt64								now = 1000 * kTicksPerMS;
+		std::vector <SInt64>				deadlines = MakeDeadlines(now);
+		std::vector <IF4SEDelayFunctor *>	ready;
+		std::vector <UInt8>					numFired(s_numPending, 0);
+		Result								result = { 0, 0 };
+		UInt32								numRun = 0;
+		bool								onTime = true;
+
+		TimerWheel	wheel(kTicksPerMS, now);
+
+		double	insert = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < s_numPending; i++)
+				wheel.Insert(deadlines[i], ToFunctor(i));
+		});
+		CHECK(wheel.Size() == s_numPending);
+
+		result.milliseconds = Test::Time([&]()
+		{
+			while(numRun < s_numPending)
+			{
+				SInt64	previous = now;
+				now += kFrameTicks;
+
+				wheel.Advance(now, ready);
+				result.numUpdates++;
+
+				for(IF4SEDelayFunctor * func : ready)
+				{
+					UInt32	id = ToId(func);
+					numFired[id]++;
+
+					if(deadlines[id] > now || previous >= deadlines[id] + kTicksPerMS)
+						onTime = false;
+				}
+
+				numRun += ready.size();
+				ready.clear();
+			}
+		});
+
+		CHECK(numRun == s_numPending);
+		CHECK(wheel.Size() == 0);
+		CHECK(onTime);
+		CHECK(std::all_of(numFired.begin(), numFired.end(), [](UInt8 n) { return n == 1; }));
+
+		printf("  %-24s %9.1f ms\n", "TimerWheel, inserting", insert);
+
+		return result;
+	}
+
+	// idle updates with everything still pending, the case that used to cost a pass over every entry
+	void RunIdle(void)
+	{
+		std::vector <IF4SEDelayFunctor *>	ready;
+		UInt32								numUpdates = 1000;
+
+		Legacy::s_waitData.clear();
+		for(UInt32 i = 0; i < s_numPending; i++)
+			Legacy::s_waitData.emplace_back((SInt64)s_maxDelayMS * 1000 * kTicksPerMS, ToFunctor(i));
+
+		double	legacy = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < numUpdates; i++)
+				Legacy::Update(kFrameTicks, ready);
+		});
+
+		SInt64		now = 0;
+		TimerWheel	wheel(kTicksPerMS, now);
+
+		for(UInt32 i = 0; i < s_numPending; i++)
+			wheel.Insert((SInt64)s_maxDelayMS * 1000 * kTicksPerMS, ToFunctor(i));
+
+		double	wheelTime = Test::Time([&]()
+		{
+			for(UInt32 i = 0; i < numUpdates; i++)
+			{
+				now += kFrameTicks;
+				wheel.Advance(now, ready);
+			}
+		});
+
+		CHECK(ready.empty());
+
+		printf("  idle update, old        %9.2f us\n", legacy * 1000 / numUpdates);
+		printf("  idle update, TimerWheel %9.2f us\n", wheelTime * 1000 / numUpdates);
+	}
+
+	void CheckPastDeadline(void)
+	{
+		std::vector <IF4SEDelayFunctor *>	ready;
+		TimerWheel							wheel(kTicksPerMS, 0);
+
+		wheel.Advance(100 * kTicksPerMS, ready);
+
+		wheel.Insert(0, ToFunctor(0));
+		wheel.Insert(100 * kTicksPerMS, ToFunctor(1));
+		wheel.Insert(100 * kTicksPerMS + 1, ToFunctor(2));
+		CHECK(wheel.Size() == 3);
+
+		wheel.Advance(100 * kTicksPerMS, ready);
+		CHECK(ready.size() == 2);
+
+		wheel.Advance(101 * kTicksPerMS - 1, ready);
+		CHECK(ready.size() == 2);
+
+		wheel.Advance(101 * kTicksPerMS, ready);
+		CHECK(ready.size() == 3);
+		CHECK(wheel.Size() == 0);
+	}
+
+	// the longest a Papyrus call can wait, and a remaining delay past what the top level reaches
+	void CheckLongDelays(void)
+	{
+		const SInt64	kTicksPerSlot = 1;
+		const SInt64	delays[] = { 0x7FFFFFFF, 0x123456789LL };
+
+		for(SInt64 delay : delays)
+		{
+			std::vector <IF4SEDelayFunctor *>	ready;
+			TimerWheel							wheel(kTicksPerSlot, 5);
+
+			wheel.Insert(5 + delay, ToFunctor(0));
+
+			SInt64	now = 5;
+			SInt64	step = 0xFFFFFF;		// not a multiple of the slot sizes
+			while(ready.empty() && now < 5 + delay + step)
+			{
+				now += step;
+				wheel.Advance(now, ready);
+			}
+
+			CHECK(ready.size() == 1);
+			CHECK(now >= 5 + delay && now - step < 5 + delay);
+		}
+	}
+
+	// what Save and Load do, remaining delays relative to now in to a wheel started at load time
+	void CheckSaveLoad(void)
+	{
+		std::vector <IF4SEDelayFunctor *>	ready;
+		std::vector <SInt64>				deadlines(1000);
+		TimerWheel							wheel(kTicksPerMS, 0);
+		SInt64								now = 0;
+
+		for(UInt32 i = 0; i < deadlines.size(); i++)
+		{
+			deadlines[i] = (SInt64)i * 997 * kTicksPerMS / 10;
+			wheel.Insert(deadlines[i], ToFunctor(i));
+		}
+
+		now += 20000 * kTicksPerMS;
+		wheel.Advance(now, ready);
+		UInt32	numRun = ready.size();
+		ready.clear();
+
+		std::vector <std::pair <SInt64, IF4SEDelayFunctor *>>	saved;
+		wheel.ForEach([&](SInt64 deadline, IF4SEDelayFunctor * func) { saved.emplace_back(deadline - now, func); });
+		CHECK(saved.size() == wheel.Size());
+		CHECK(numRun + saved.size() == deadlines.size());
+
+		// a new session, the counter doesn't line up with the old one
+		SInt64	offset = 123456789;
+		now += offset;
+
+		TimerWheel	loaded(kTicksPerMS, now);
+		for(auto & entry : saved)
+			loaded.Insert(now + entry.first, entry.second);
+
+		bool	onTime = true;
+		while(loaded.Size())
+		{
+			SInt64	previous = now;
+			now += kFrameTicks;
+
+			loaded.Advance(now, ready);
+			for(IF4SEDelayFunctor * func : ready)
+			{
+				SInt64	deadline = deadlines[ToId(func)] + offset;
+				if(deadline > now || previous >= deadline + kTicksPerMS)
+					onTime = false;
+			}
+
+			numRun += ready.size();
+			ready.clear();
+		}
+
+		CHECK(onTime);
+		CHECK(numRun == deadlines.size());
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+		s_numPending = 10000;
+
+	CheckPastDeadline();
+	CheckLongDelays();
+	CheckSaveLoad();
+
+	printf("delay functor wait list: %u pending, delays up to %u ms, 16 ms updates\n", s_numPending, s_maxDelayMS);
+
+	Result	legacy = RunLegacy();
+	Report("decrement + partition (old)", legacy);
+
+	Result	wheel = RunWheel();
+	Report("TimerWheel", wheel);
+
+	RunIdle();
+
+	return Test::Finish("TimerWheelBench");
+}
@@ -0,0 +1,143 @@
+#include "sscan/Pattern.h"
+#include "support/TestSupport.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// A .sscan file written for this executable but with damaged entries, the way a hand edited or
+// half written cache would look. The cache is read once per process, so this is its own test.
+//
+//	- hints inside the code section are used as they are
+//	- hints whose rva + pattern size falls past SizeOfCode are dropped, the pattern scans instead
+//	  of being compared against memory outside the image
+//	- a hint saved for a pattern of another length isn't tried, the pattern scans instead
+//	- the cache is read from and written to My Games\Fallout4VR\F4SE, not next to the module
+
+namespace
+{
+	enum
+	{
+		kHeaderSize =	0x400,
+		kCodeSize =		0x10000,
+		kPadding =		256,
+	};
+
+	// Pattern.cpp's file layout
+	struct Header
+	{
+		UInt32	signature;
+		UInt32	version;
+		UInt64	executableHash;
+		UInt32	numEntries;
+		UInt32	pad;
+	};
+
+	struct Entry
+	{
+		UInt64	hash;
+		UInt64	rva;
+		UInt32	size;
+		UInt32	pad;
+	};
+
+	std::string Sig(const UInt8 * code, UInt32 length)
+	{
+		std::string	sig;
+
+		for(UInt32 i = 0; i < length; i++)
+		{
+			char	byte[4];
+			sprintf_s(byte, "%02X", code[i]);
+
+			if(i)
+				sig += ' ';
+			sig += byte;
+		}
+
+		return sig;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	std::string	root = Test::MakeTempDir("sscan_cache");
+	std::string	modulePath = root + "/cache.dll";
+	std::string	cacheFolder = root + "/My Games/Fallout4VR/F4SE";
+	std::string	cachePath = cacheFolder + "/cache.sscan";
+
+	std::vector <UInt8>	image(kHeaderSize + kCodeSize + kPadding);
+	std::mt19937		rng(1);
+
+	for(UInt8 & byte : image)
+		byte = rng();
+
+	IMAGE_DOS_HEADER	* dosHeader = (IMAGE_DOS_HEADER *)image.data();
+	memset(image.data(), 0, kHeaderSize);
+	dosHeader->e_magic = IMAGE_DOS_SIGNATURE;
+	dosHeader->e_lfanew = 0x80;
+
+	IMAGE_NT_HEADERS64	* ntHeader = (IMAGE_NT_HEADERS64 *)(image.data() + dosHeader->e_lfanew);
+	ntHeader->Signature = IMAGE_NT_SIGNATURE;
+	ntHeader->OptionalHeader.SizeOfCode = kCodeSize;
+	ntHeader->OptionalHeader.SizeOfHeaders = kHeaderSize;
+
+	TestWin32::SetModuleImage(image.data(), modulePath.c_str());
+	TestWin32::SetFolderPath(root.c_str());
+
+	uintptr_t	base = (uintptr_t)image.data();
+
+	// five patterns planted in the code, each with a cached hint
+	const UInt32	kLength = 16;
+	const UInt32	kOffsets[] = { 0x1000, 0x2000, 0x3000, 0x4000, 0x5000 };
+
+	std::string	sigs[5];
+	for(UInt32 i = 0; i < 5; i++)
+		sigs[i] = Sig(&image[kOffsets[i]], kLength);
+
+	// the last one twice, its hint points at the second copy
+	const UInt32	kCopyOffset = 0x6000;
+	memcpy(&image[kCopyOffset], &image[kOffsets[4]], kLength);
+
+	// right, past the end, straddling the end, wrapped around, saved for a longer pattern
+	Entry	entries[5] =
+	{
+		{ fnv_1()(sigs[0]), kOffsets[0], kLength, 0 },
+		{ fnv_1()(sigs[1]), kCodeSize + 0x100000, kLength, 0 },
+		{ fnv_1()(sigs[2]), kCodeSize - kLength / 2, kLength, 0 },
+		{ fnv_1()(sigs[3]), ~0ull - 4, kLength, 0 },
+		{ fnv_1()(sigs[4]), kCopyOffset, kLength + 4, 0 },
+	};
+
+	Header	header = { 0x4E435353, 3, fnv_1()(std::string((const char *)image.data(), kHeaderSize)), 5, 0 };
+
+	std::string	file((const char *)&header, sizeof(header));
+	file.append((const char *)entries, sizeof(entries));
+	CreateDirectory((root + "/My Games").c_str(), NULL);
+	CreateDirectory((root + "/My Games/Fallout4VR").c_str(), NULL);
+	CreateDirectory(cacheFolder.c_str(), NULL);
+	Test::WriteTextFile(cachePath, file);
+
+	printf("sscan hint cache: 1 good, 3 out of range and 1 wrong length hint\n");
+
+	for(UInt32 i = 0; i < 4; i++)
+	{
+		Utility::pattern	pattern(sigs[i].c_str());
+
+		CHECK(pattern.size() == 1);
+		CHECK((uintptr_t)pattern.get(0).get <void>() == base + kOffsets[i]);
+	}
+
+	// scanned, so both copies, the first one first
+	Utility::pattern	collided(sigs[4].c_str());
+
+	CHECK(collided.size() == 2);
+	CHECK((uintptr_t)collided.get(0).get <void>() == base + kOffsets[4]);
+
+	Utility::pattern::save_hints();
+
+	CHECK(Test::ReadTextFile(cachePath).size() == sizeof(Header) + 6 * sizeof(Entry));
+	CHECK(Test::ReadTextFile(root + "/cache.sscan").empty());
+
+	return Test::Finish("PatternHintCacheTest");
+}
@@ -0,0 +1,213 @@
+#include "sscan/Pattern.h"
+#include "support/TestSupport.h"
+
+#include <random>
+#include <sys/stat.h>
+#include <vector>
+
+// Resolves a few hundred signatures planted in a synthetic multi-MB code section with one
+// Utility::pattern::prefetch pass, and again one pattern at a time with the old byte-by-byte scan,
+// then checks both agree and that the hint cache is only written by save_hints.
+
+namespace
+{
+	UInt32	s_codeSize = 8 * 1024 * 1024;
+	UInt32	s_numPatterns = 300;
+
+	enum
+	{
+		kHeaderSize =	0x400,
+		kPadding =		256,	// patterns are compared past the end of the code section
+	};
+
+	struct Planted
+	{
+		std::string	sig;
+		uintptr_t	address;
+	};
+
+	// code-like bytes, a handful of opcodes and zeros dominate like they do in the real executable
+	void FillCode(UInt8 * code, size_t length, std::mt19937 & rng)
+	{
+		static const UInt8	kCommon[] = { 0x00, 0x48, 0x8B, 0x89, 0xCC, 0xE8, 0x0F, 0x4C, 0x24, 0xFF, 0x83, 0xC3 };
+
+		for(size_t i = 0; i < length; i++)
+		{
+			UInt32	r = rng();
+
+			code[i] = (r & 0x300) ? kCommon[(r >> 12) % sizeof(kCommon)] : (UInt8)r;
+		}
+	}
+
+	// IDA-style signature over the bytes at code[0], with a few wildcards
+	std::string MakeSig(const UInt8 * code, UInt32 length, std::mt19937 & rng)
+	{
+		std::string	sig;
+
+		for(UInt32 i = 0; i < length; i++)
+		{
+			char	byte[4];
+
+			if(i && !(rng() % 5))
+				strcpy_s(byte, "?");
+			else
+				sprintf_s(byte, "%02X", code[i]);
+
+			if(i)
+				sig += ' ';
+			sig += byte;
+		}
+
+		return sig;
+	}
+
+	// the pre-batching scan, one byte at a time over the whole section per pattern
+
+	namespace Legacy
+	{
+		uintptr_t Find(const char * sig, uintptr_t begin, uintptr_t end)
+		{
+			std::string	bytes;
+			std::string	mask;
+
+			Utility::TransformPattern(sig, bytes, mask);
+
+			for(uintptr_t i = begin; i <= end; i++)
+			{
+				const char	* ptr = (const char *)i;
+				size_t		j = 0;
+
+				for(; j < mask.size(); j++)
+					if(mask[j] != '?' && bytes[j] != ptr[j])
+						break;
+
+				if(j == mask.size())
+					return i;
+			}
+
+			return 0;
+		}
+	}
+
+	bool FileExists(const std::string & path)
+	{
+		struct stat	info;
+
+		return stat(path.c_str(), &info) == 0;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if(Test::IsQuick(argc, argv))
+	{
+		s_codeSize = 1024 * 1024;
+		s_numPatterns = 50;
+	}
+
+	std::string	root = Test::MakeTempDir("sscan");
+	std::string	modulePath = root + "/bench.dll";
+	std::string	cachePath = root + "/My Games/Fallout4VR/F4SE/bench.sscan";
+
+	// fake image, the scanned range is [base, base + SizeOfCode] so the headers are in it like in the game
+	std::vector <UInt8>	image(kHeaderSize + s_codeSize + kPadding);
+	std::mt19937		rng(1234);
+
+	FillCode(image.data(), image.size(), rng);
+
+	IMAGE_DOS_HEADER	* dosHeader = (IMAGE_DOS_HEADER *)image.data();
+	memset(image.data(), 0, kHeaderSize);
+	dosHeader->e_magic = IMAGE_DOS_SIGNATURE;
+	dosHeader->e_lfanew = 0x80;
+
+	IMAGE_NT_HEADERS64	* ntHeader = (IMAGE_NT_HEADERS64 *)(image.data() + dosHeader->e_lfanew);
+	ntHeader->Signature = IMAGE_NT_SIGNATURE;
+	ntHeader->OptionalHeader.SizeOfCode = s_codeSize;
+	ntHeader->OptionalHeader.SizeOfHeaders = kHeaderSize;
+
+	TestWin32::SetModuleImage(image.data(), modulePath.c_str());
+	TestWin32::SetFolderPath(root.c_str());
+
+	uintptr_t	begin = (uintptr_t)image.data();
+	uintptr_t	end = begin + s_codeSize;
+
+	// planted at random offsets, long enough that each one is unique in the random filler
+	std::vector <Planted>	planted(s_numPatterns);
+	std::vector <const char *>	sigs;
+
+	for(UInt32 i = 0; i < s_numPatterns; i++)
+	{
+		UInt32	length = 12 + rng() % 20;
+		UInt32	offset = kHeaderSize + rng() % (s_codeSize - kHeaderSize - length);
+
+		planted[i].address = begin + offset;
+		planted[i].sig = MakeSig(&image[offset], length, rng);
+	}
+
+	for(UInt32 i = 0; i < s_numPatterns; i++)
+		sigs.push_back(planted[i].sig.c_str());
+
+	// a pattern that isn't anywhere, both scans go to the end of the section for it
+	std::string	missing = "DE AD ? BE EF 0F 1F 44 00 00 CC CC DE AD BE EF";
+	sigs.push_back(missing.c_str());
+
+	printf("sscan: %u KB code section, %u patterns\n", s_codeSize / 1024, s_numPatterns + 1);
+
+	// old path, results kept to compare against
+	std::vector <uintptr_t>	legacyResults(sigs.size());
+
+	double	legacyTime = Test::Time([&]()
+	{
+		for(size_t i = 0; i < sigs.size(); i++)
+			legacyResults[i] = Legacy::Find(sigs[i], begin, end);
+	});
+
+	printf("%-34s %9.2f ms\n", "one scan per pattern (old)", legacyTime);
+
+	double	batchTime = Test::Time([&]()
+	{
+		Utility::pattern::prefetch(sigs, 1);
+	});
+
+	printf("%-34s %9.2f ms\n", "prefetch, one pass", batchTime);
+
+	// every lookup is now answered from the hints without scanning
+	double	lookupTime = Test::Time([&]()
+	{
+		for(size_t i = 0; i < sigs.size(); i++)
+		{
+			uintptr_t	address = (uintptr_t)Utility::pattern(sigs[i]).count(1).get(0).get <void>();
+
+			CHECK(address == legacyResults[i]);
+		}
+	});
+
+	printf("%-34s %9.2f ms\n", "lookups after prefetch", lookupTime);
+
+	for(UInt32 i = 0; i < s_numPatterns; i++)
+		CHECK(legacyResults[i] == planted[i].address);
+
+	CHECK(!legacyResults[s_numPatterns]);
+
+	// single-pattern scans only add hints, nothing is written until save_hints
+	std::string	extra = planted[0].sig.substr(0, planted[0].sig.size() - 3);
+	uintptr_t	extraAddress = (uintptr_t)Utility::pattern(extra.c_str()).count(1).get(0).get <void>();
+
+	CHECK(extraAddress == Legacy::Find(extra.c_str(), begin, end));
+	CHECK(!FileExists(cachePath));
+
+	Utility::pattern::save_hints();
+
+	CHECK(FileExists(cachePath));
+
+	struct stat	info;
+	stat(cachePath.c_str(), &info);
+
+	// 24 byte header, 24 bytes per hint, the missing pattern has none
+	CHECK(info.st_size == 24 + 24 * (s_numPatterns + 1));
+
+	// with the logs, not next to the module
+	CHECK(!FileExists(root + "/bench.sscan"));
+
+	return Test::Finish("PatternScanBench");
+}
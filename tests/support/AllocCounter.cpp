@@ -0,0 +1,29 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic <UInt64>	s_numAllocs(0);
+
+void * operator new(std::size_t size)
+{
+	s_numAllocs.fetch_add(1, std::memory_order_relaxed);
+
+	void	* result = std::malloc(size ? size : 1);
+	if(!result)
+		throw std::bad_alloc();
+
+	return result;
+}
+
+void operator delete(void * ptr) noexcept				{ std::free(ptr); }
+void operator delete(void * ptr, std::size_t) noexcept	{ std::free(ptr); }
+
+namespace Test
+{
+	UInt64 GetNumAllocs(void)
+	{
+		return s_numAllocs.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// counting global operator new, for the checks that a steady state allocates nothing
+// opt in by linking test_alloccounter, it replaces operator new for the whole executable
+
+namespace Test
+{
+	// every operator new call in the process so far, any thread
+	UInt64	GetNumAllocs(void);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// force-included in to every test source in place of common/IPrefix.h
+// the shim comes first, msvc has the calling convention keywords built in
+
+#include <Windows.h>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "common/ITypes.h"
+#include "common/IErrors.h"
+#include "common/IDynamicCreate.h"
+#include "common/IDebugLog.h"
+#include "common/ISingleton.h"
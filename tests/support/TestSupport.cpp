@@ -0,0 +1,127 @@
+#include "TestSupport.h"
+#include "f4se_common/Utilities.h"
+
+#include <map>
+#include <unistd.h>
+
+IDebugLog	gLog;
+
+namespace
+{
+	UInt32	s_numFailures = 0;
+
+	// the code under test logs freely, only warnings and worse reach the console
+	struct QuietLog
+	{
+		QuietLog() { IDebugLog::SetPrintLevel(IDebugLog::kLevel_Warning); }
+	} s_quietLog;
+
+	std::map <std::string, std::string>	s_config;
+}
+
+namespace Test
+{
+	void Fail(const char * file, int line, const char * expr)
+	{
+		if(s_numFailures++ < 20)
+			fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expr);
+	}
+
+	UInt32 GetNumFailures(void)
+	{
+		return s_numFailures;
+	}
+
+	int Finish(const char * name)
+	{
+		if(s_numFailures)
+		{
+			printf("%s: %u check(s) failed\n", name, s_numFailures);
+			return 1;
+		}
+
+		printf("%s: passed\n", name);
+		return 0;
+	}
+
+	bool IsQuick(int argc, char ** argv)
+	{
+		for(int i = 1; i < argc; i++)
+			if(!strcmp(argv[i], "--quick"))
+				return true;
+
+		return false;
+	}
+
+	std::string MakeTempDir(const char * name)
+	{
+		const char	* base = getenv("TMPDIR");
+
+		std::string	path = base && *base ? base : "/tmp";
+		path += "/f4se_test_";
+		path += name;
+		path += "_";
+		path += std::to_string(getpid());
+
+		std::string	command = "rm -rf '" + path + "' && mkdir -p '" + path + "'";
+		if(system(command.c_str()))
+			fprintf(stderr, "couldn't create %s\n", path.c_str());
+
+		return path;
+	}
+
+	void SetConfigOption(const char * section, const char * key, const char * value)
+	{
+		s_config[std::string(section) + ":" + key] = value;
+	}
+
+	void WriteTextFile(const std::string & path, const std::string & contents)
+	{
+		FILE	* dst = fopen(path.c_str(), "wb");
+		if(!dst)
+		{
+			fprintf(stderr, "couldn't create %s\n", path.c_str());
+			return;
+		}
+
+		fwrite(contents.data(), 1, contents.size(), dst);
+		fclose(dst);
+	}
+
+	std::string ReadTextFile(const std::string & path)
+	{
+		std::string	result;
+
+		FILE	* src = fopen(path.c_str(), "rb");
+		if(src)
+		{
+			char	buf[65536];
+			size_t	length;
+
+			while((length = fread(buf, 1, sizeof(buf), src)) > 0)
+				result.append(buf, length);
+
+			fclose(src);
+		}
+
+		return result;
+	}
+}
+
+// f4se_common/Utilities.cpp reads the real ini next to the executable, the tests set options directly
+
+std::string GetConfigOption(const char * section, const char * key)
+{
+	std::map <std::string, std::string>::iterator	iter = s_config.find(std::string(section) + ":" + key);
+
+	return iter != s_config.end() ? iter->second : std::string();
+}
+
+bool GetConfigOption_UInt32(const char * section, const char * key, UInt32 * dataOut)
+{
+	std::string	data = GetConfigOption(section, key);
+	if(data.empty())
+		return false;
+
+	return sscanf(data.c_str(), "%u", dataOut) == 1;
+}
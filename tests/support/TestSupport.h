@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// checks and timing shared by the tests and benchmarks
+
+namespace Test
+{
+	void	Fail(const char * file, int line, const char * expr);
+	UInt32	GetNumFailures(void);
+
+	// prints the result line and returns the process exit code
+	int		Finish(const char * name);
+
+	// benchmarks run at full size by hand, ctest passes --quick so they only smoke test
+	bool	IsQuick(int argc, char ** argv);
+
+	// fresh scratch directory under $TMPDIR, unique to this process
+	std::string	MakeTempDir(const char * name);
+
+	void	SetConfigOption(const char * section, const char * key, const char * value);
+
+	// whole files, binary, a missing file reads as empty
+	void		WriteTextFile(const std::string & path, const std::string & contents);
+	std::string	ReadTextFile(const std::string & path);
+
+	class Timer
+	{
+	public:
+		Timer() : m_start(std::chrono::steady_clock::now()) { }
+
+		double	Elapsed(void) const	// milliseconds
+		{
+			return std::chrono::duration <double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point	m_start;
+	};
+
+	template <typename F>
+	double Time(F func)
+	{
+		Timer	timer;
+
+		func();
+
+		return timer.Elapsed();
+	}
+
+	// keeps the optimizer from dropping a benchmarked result
+	template <typename T>
+	void Use(const T & value)
+	{
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+}
+
+#define CHECK(expr)	do { if(!(expr)) Test::Fail(__FILE__, __LINE__, #expr); } while(0)
@@ -0,0 +1,25 @@
+#include "f4se/GameSettings.h"
+#include "f4se/InternalSerialization.h"
+
+// game state the serialization code reads, with nothing loaded every mod keeps its index
+// and there are no ini settings, so save paths fall back to the default folder
+
+Setting * GetINISetting(const char * name)
+{
+	return nullptr;
+}
+
+UInt32 Setting::GetType(void) const
+{
+	return kType_Unknown;
+}
+
+UInt8 ResolveModIndex(UInt8 modIndexIn)
+{
+	return modIndexIn;
+}
+
+UInt16 ResolveLightModIndex(UInt16 modIndexIn)
+{
+	return modIndexIn;
+}
@@ -0,0 +1,13 @@
+#include "f4se/GameAPI.h"
+
+// the game heap, backed by the crt
+
+void * Heap_Allocate(size_t size)
+{
+	return malloc(size);
+}
+
+void Heap_Free(void * ptr)
+{
+	free(ptr);
+}
@@ -0,0 +1,33 @@
+#include "f4se/PluginManager.h"
+#include "f4se/Serialization.h"
+
+// the interface table from f4se/PluginManager.cpp, without the rest of the plugin manager
+
+const F4SESerializationInterface	g_F4SESerializationInterface =
+{
+	F4SESerializationInterface::kInterfaceVersion,
+
+	Serialization::SetUniqueID,
+
+	Serialization::SetRevertCallback,
+	Serialization::SetSaveCallback,
+	Serialization::SetLoadCallback,
+	Serialization::SetFormDeleteCallback,
+
+	Serialization::WriteRecord,
+	Serialization::OpenRecord,
+	Serialization::WriteRecordData,
+
+	Serialization::GetNextRecordInfo,
+	Serialization::ReadRecordData,
+	Serialization::ResolveHandle,
+	Serialization::ResolveFormId,
+
+	Serialization::ReadRecordDataSpan,
+	Serialization::FindRecord,
+
+	Serialization::SetThreadSafeLoadCallback,
+
+	Serialization::WriteStringRef,
+	Serialization::ReadStringRef
+};
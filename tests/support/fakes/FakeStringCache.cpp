@@ -0,0 +1,50 @@
+#include "f4se/GameTypes.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace
+{
+	std::mutex							s_lock;
+	std::unordered_set <std::string>	s_strings;
+
+	StringCache::Entry * Intern(const char * buf)
+	{
+		if(!buf)
+			return nullptr;
+
+		std::lock_guard <std::mutex>	lock(s_lock);
+
+		// the game's cache is case insensitive, the tests only need identity
+		return (StringCache::Entry *)s_strings.insert(buf).first->c_str();
+	}
+}
+
+StringCache::Ref::Ref() : data(nullptr)
+{
+}
+
+StringCache::Ref::Ref(const char * buf) : data(Intern(buf))
+{
+}
+
+void StringCache::Ref::Release()
+{
+	data = nullptr;
+}
+
+bool StringCache::Ref::operator==(const char * lhs) const
+{
+	return data == Intern(lhs);
+}
+
+namespace FakeStringCache
+{
+	UInt32 GetNumEntries(void)
+	{
+		std::lock_guard <std::mutex>	lock(s_lock);
+
+		return s_strings.size();
+	}
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// not used by the code under test
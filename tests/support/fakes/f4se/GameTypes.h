@@ -0,0 +1,50 @@
+#pragma once
+
+// stand-in for the game's string cache, only the BSFixedString surface the code under test uses
+// strings are interned in a process-wide pool and never freed
+
+#include "f4se_common/Utilities.h"
+#include "f4se/GameAPI.h"
+
+class StringCache
+{
+public:
+	struct Entry;
+
+	struct Ref
+	{
+		Entry	* data;
+
+		Ref();
+		Ref(const char * buf);
+
+		void Release();
+
+		bool operator==(const char * lhs) const;
+		bool operator==(const Ref & lhs) const { return data == lhs.data; }
+		bool operator<(const Ref & lhs) const { return data < lhs.data; }
+
+		const char * c_str() const { return operator const char *(); }
+		operator const char *() const { return (const char *)data; }
+	};
+};
+
+typedef StringCache::Ref BSFixedString;
+
+class BSAutoFixedString : public BSFixedString
+{
+public:
+	BSAutoFixedString() : BSFixedString() { }
+	BSAutoFixedString(const char * buf) : BSFixedString(buf) { }
+
+	~BSAutoFixedString()
+	{
+		Release();
+	}
+};
+
+namespace FakeStringCache
+{
+	// number of distinct strings created so far
+	UInt32	GetNumEntries(void);
+}
@@ -0,0 +1,1205 @@
+#include "Windows.h"
+#include "shlobj.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+namespace
+{
+	std::atomic <uint64_t>	s_opens(0);
+	std::atomic <uint64_t>	s_reads(0);
+	std::atomic <uint64_t>	s_writes(0);
+	std::atomic <uint64_t>	s_seeks(0);
+	std::atomic <uint64_t>	s_flushes(0);
+	std::atomic <uint64_t>	s_bytesWritten(0);
+
+	std::string				s_folderPath = "/tmp";
+
+	const void				* s_moduleImage = nullptr;
+	std::string				s_modulePath = "/tmp/f4se_test.dll";
+
+	thread_local DWORD		s_lastError = 0;
+
+	void SetErrorFromErrno(void)
+	{
+		switch(errno)
+		{
+			case ENOENT:	s_lastError = ERROR_FILE_NOT_FOUND; break;
+			case EACCES:	s_lastError = ERROR_ACCESS_DENIED; break;
+			case EEXIST:	s_lastError = ERROR_ALREADY_EXISTS; break;
+			default:		s_lastError = 0x10000 | errno; break;
+		}
+	}
+
+	std::string NativePath(const char * path)
+	{
+		std::string	result = path ? path : "";
+
+		for(size_t i = 0; i < result.size(); i++)
+			if(result[i] == '\\')
+				result[i] = '/';
+
+		return result;
+	}
+
+	struct ShimObject
+	{
+		virtual ~ShimObject() { }
+		virtual DWORD Wait(DWORD milliseconds) { return WAIT_FAILED; }
+	};
+
+	struct FileObject : ShimObject
+	{
+		int	fd;
+
+		~FileObject() { close(fd); }
+	};
+
+	struct MappingObject : ShimObject
+	{
+		int			fd;
+		uint64_t	length;
+
+		~MappingObject() { close(fd); }
+	};
+
+	// directory listing taken when the search starts
+	struct FindObject : ShimObject
+	{
+		std::string					dir;
+		std::vector <std::string>	names;
+		size_t						next = 0;
+	};
+
+	bool FillFindData(FindObject * find, WIN32_FIND_DATA * data)
+	{
+		if(find->next >= find->names.size())
+		{
+			s_lastError = ERROR_NO_MORE_FILES;
+			return false;
+		}
+
+		const std::string	& name = find->names[find->next++];
+		struct stat			info;
+
+		memset(data, 0, sizeof(*data));
+		strcpy_s(data->cFileName, name.c_str());
+
+		if(!stat((find->dir + "/" + name).c_str(), &info))
+		{
+			data->dwFileAttributes = S_ISDIR(info.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+			data->nFileSizeLow = (DWORD)info.st_size;
+			data->nFileSizeHigh = (DWORD)((uint64_t)info.st_size >> 32);
+
+			// 100ns ticks since 1601, as GetSystemTimeAsFileTime
+			uint64_t	ticks = (uint64_t)info.st_mtim.tv_sec * 10000000ull + info.st_mtim.tv_nsec / 100 + 116444736000000000ull;
+
+			data->ftLastWriteTime.dwLowDateTime = (DWORD)ticks;
+			data->ftLastWriteTime.dwHighDateTime = (DWORD)(ticks >> 32);
+		}
+
+		return true;
+	}
+
+	template <typename Pred>
+	DWORD WaitFor(std::unique_lock <std::mutex> & lock, std::condition_variable & cv, DWORD milliseconds, Pred pred)
+	{
+		if(milliseconds == INFINITE)
+		{
+			cv.wait(lock, pred);
+			return WAIT_OBJECT_0;
+		}
+
+		return cv.wait_for(lock, std::chrono::milliseconds(milliseconds), pred) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+	}
+
+	// shared with the running thread so the handle can be closed before it finishes
+	struct ThreadState
+	{
+		std::mutex				lock;
+		std::condition_variable	finished;
+		bool					done = false;
+	};
+
+	struct ThreadObject : ShimObject
+	{
+		std::thread						thread;
+		std::shared_ptr <ThreadState>	state;
+
+		~ThreadObject()
+		{
+			if(thread.joinable())
+			{
+				if(Wait(0) == WAIT_OBJECT_0)
+					thread.join();
+				else
+					thread.detach();
+			}
+		}
+
+		DWORD Wait(DWORD milliseconds) override
+		{
+			std::unique_lock <std::mutex>	lock(state->lock);
+			return WaitFor(lock, state->finished, milliseconds, [this] { return state->done; });
+		}
+	};
+
+	struct EventObject : ShimObject
+	{
+		std::mutex				lock;
+		std::condition_variable	signal;
+		bool					manualReset = false;
+		bool					signaled = false;
+
+		DWORD Wait(DWORD milliseconds) override
+		{
+			std::unique_lock <std::mutex>	lock(this->lock);
+			DWORD	result = WaitFor(lock, signal, milliseconds, [this] { return signaled; });
+
+			if(result == WAIT_OBJECT_0 && !manualReset)
+				signaled = false;
+
+			return result;
+		}
+	};
+
+	ShimObject * GetObject(HANDLE handle)
+	{
+		if(!handle || handle == INVALID_HANDLE_VALUE)
+			return nullptr;
+
+		return (ShimObject *)handle;
+	}
+
+	int GetFD(HANDLE handle)
+	{
+		FileObject	* file = dynamic_cast <FileObject *>(GetObject(handle));
+
+		return file ? file->fd : -1;
+	}
+
+	std::mutex									s_viewLock;
+	std::unordered_map <const void *, size_t>	s_views;
+
+	// fls slots, destructors run from a thread_local when the thread exits
+
+	enum
+	{
+		kMaxFlsSlots = 64
+	};
+
+	std::atomic <PFLS_CALLBACK_FUNCTION>	s_flsCallbacks[kMaxFlsSlots];
+	std::atomic <DWORD>						s_nextFlsSlot(0);
+
+	struct FlsValues
+	{
+		PVOID	values[kMaxFlsSlots] = { };
+
+		~FlsValues()
+		{
+			for(DWORD i = 0; i < kMaxFlsSlots; i++)
+			{
+				PFLS_CALLBACK_FUNCTION	callback = s_flsCallbacks[i];
+
+				if(values[i] && callback)
+					callback(values[i]);
+			}
+		}
+	};
+
+	thread_local FlsValues	s_flsValues;
+
+	// ini files are reparsed on every call like the real api does
+
+	bool ReadProfileSection(LPCSTR path, LPCSTR section, std::string * out)
+	{
+		FILE	* src = fopen(NativePath(path).c_str(), "rb");
+		if(!src)
+			return false;
+
+		char	line[4096];
+		bool	inSection = false;
+		bool	found = false;
+
+		while(fgets(line, sizeof(line), src))
+		{
+			char	* start = line;
+			while(*start == ' ' || *start == '\t')
+				start++;
+
+			char	* end = start + strlen(start);
+			while(end > start && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+				*--end = 0;
+
+			if(*start == '[')
+			{
+				char	* close = strchr(start, ']');
+				if(close)
+					*close = 0;
+
+				inSection = !_stricmp(start + 1, section);
+				found |= inSection;
+				continue;
+			}
+
+			if(inSection && *start && *start != ';')
+			{
+				// Windows drops the blanks around the =
+				char	* equals = strchr(start, '=');
+				if(equals)
+				{
+					char	* keyEnd = equals;
+					while(keyEnd > start && (keyEnd[-1] == ' ' || keyEnd[-1] == '\t'))
+						keyEnd--;
+
+					char	* value = equals + 1;
+					while(*value == ' ' || *value == '\t')
+						value++;
+
+					out->append(start, keyEnd);
+					out->push_back('=');
+					out->append(value);
+				}
+				else
+					out->append(start);
+
+				out->push_back(0);
+			}
+		}
+
+		fclose(src);
+
+		return found;
+	}
+
+	DWORD CopyProfileString(const std::string & src, LPSTR buf, DWORD bufLength)
+	{
+		if(!bufLength)
+			return 0;
+
+		DWORD	length = src.size() < bufLength - 1 ? src.size() : bufLength - 1;
+
+		memcpy(buf, src.data(), length);
+		buf[length] = 0;
+
+		return length;
+	}
+}
+
+// errors
+
+DWORD GetLastError(void)
+{
+	return s_lastError;
+}
+
+void SetLastError(DWORD error)
+{
+	s_lastError = error;
+}
+
+// files
+
+HANDLE CreateFile(LPCSTR path, DWORD access, DWORD shareMode, SECURITY_ATTRIBUTES * security, DWORD disposition, DWORD flags, HANDLE templateFile)
+{
+	int	mode = 0;
+
+	if((access & GENERIC_READ) && (access & GENERIC_WRITE))
+		mode = O_RDWR;
+	else if(access & GENERIC_WRITE)
+		mode = O_WRONLY;
+	else
+		mode = O_RDONLY;
+
+	switch(disposition)
+	{
+		case CREATE_NEW:		mode |= O_CREAT | O_EXCL; break;
+		case CREATE_ALWAYS:		mode |= O_CREAT | O_TRUNC; break;
+		case OPEN_ALWAYS:		mode |= O_CREAT; break;
+		case TRUNCATE_EXISTING:	mode |= O_TRUNC; break;
+		default:				break;
+	}
+
+	s_opens++;
+
+	int	fd = open(NativePath(path).c_str(), mode | O_CLOEXEC, 0644);
+	if(fd < 0)
+	{
+		SetErrorFromErrno();
+		return INVALID_HANDLE_VALUE;
+	}
+
+	FileObject	* file = new FileObject;
+	file->fd = fd;
+
+	return file;
+}
+
+BOOL ReadFile(HANDLE file, LPVOID buf, DWORD length, LPDWORD lengthOut, void * overlapped)
+{
+	s_reads++;
+
+	ssize_t	result = read(GetFD(file), buf, length);
+
+	if(lengthOut)
+		*lengthOut = result > 0 ? result : 0;
+
+	if(result < 0)
+	{
+		SetErrorFromErrno();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL WriteFile(HANDLE file, LPCVOID buf, DWORD length, LPDWORD lengthOut, void * overlapped)
+{
+	s_writes++;
+
+	ssize_t	result = write(GetFD(file), buf, length);
+
+	if(lengthOut)
+		*lengthOut = result > 0 ? result : 0;
+
+	if(result < 0)
+	{
+		SetErrorFromErrno();
+		return FALSE;
+	}
+
+	s_bytesWritten += result;
+
+	return TRUE;
+}
+
+BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, LARGE_INTEGER * newPosition, DWORD method)
+{
+	static const int	kWhence[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+
+	s_seeks++;
+
+	off_t	result = lseek(GetFD(file), distance.QuadPart, kWhence[method]);
+	if(result < 0)
+	{
+		SetErrorFromErrno();
+		return FALSE;
+	}
+
+	if(newPosition)
+		newPosition->QuadPart = result;
+
+	return TRUE;
+}
+
+BOOL SetEndOfFile(HANDLE file)
+{
+	int		fd = GetFD(file);
+	off_t	position = lseek(fd, 0, SEEK_CUR);
+
+	return position >= 0 && !ftruncate(fd, position);
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER * size)
+{
+	struct stat	info;
+
+	if(fstat(GetFD(file), &info))
+	{
+		SetErrorFromErrno();
+		return FALSE;
+	}
+
+	size->QuadPart = info.st_size;
+
+	return TRUE;
+}
+
+BOOL FlushFileBuffers(HANDLE file)
+{
+	s_flushes++;
+
+	return !fsync(GetFD(file));
+}
+
+BOOL DeleteFile(LPCSTR path)
+{
+	if(unlink(NativePath(path).c_str()))
+	{
+		SetErrorFromErrno();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL MoveFileEx(LPCSTR from, LPCSTR to, DWORD flags)
+{
+	std::string	dst = NativePath(to);
+
+	if(!(flags & MOVEFILE_REPLACE_EXISTING) && !access(dst.c_str(), F_OK))
+	{
+		s_lastError = ERROR_ALREADY_EXISTS;
+		return FALSE;
+	}
+
+	if(rename(NativePath(from).c_str(), dst.c_str()))
+	{
+		SetErrorFromErrno();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL CreateDirectory(LPCSTR path, SECURITY_ATTRIBUTES * security)
+{
+	if(mkdir(NativePath(path).c_str(), 0755))
+	{
+		SetErrorFromErrno();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+DWORD GetFileAttributes(LPCSTR path)
+{
+	struct stat	info;
+
+	if(stat(NativePath(path).c_str(), &info))
+	{
+		SetErrorFromErrno();
+		return INVALID_FILE_ATTRIBUTES;
+	}
+
+	return S_ISDIR(info.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+}
+
+HANDLE FindFirstFile(LPCSTR pattern, WIN32_FIND_DATA * data)
+{
+	std::string	path = NativePath(pattern);
+	size_t		slash = path.find_last_of('/');
+
+	FindObject	* find = new FindObject;
+	find->dir = slash == std::string::npos ? "." : path.substr(0, slash);
+
+	std::string	spec = slash == std::string::npos ? path : path.substr(slash + 1);
+
+	DIR	* dir = opendir(find->dir.c_str());
+	if(dir)
+	{
+		while(dirent * entry = readdir(dir))
+			if(!fnmatch(spec.c_str(), entry->d_name, FNM_CASEFOLD))
+				find->names.push_back(entry->d_name);
+
+		closedir(dir);
+	}
+
+	// readdir order is arbitrary, ntfs returns names sorted
+	std::sort(find->names.begin(), find->names.end());
+
+	if(!FillFindData(find, data))
+	{
+		delete find;
+		s_lastError = ERROR_FILE_NOT_FOUND;
+		return INVALID_HANDLE_VALUE;
+	}
+
+	return (HANDLE)static_cast <ShimObject *>(find);
+}
+
+BOOL FindNextFile(HANDLE find, WIN32_FIND_DATA * data)
+{
+	FindObject	* object = dynamic_cast <FindObject *>(GetObject(find));
+
+	return object && FillFindData(object, data);
+}
+
+BOOL FindClose(HANDLE find)
+{
+	return CloseHandle(find);
+}
+
+HANDLE CreateFileMapping(HANDLE file, SECURITY_ATTRIBUTES * security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, LPCSTR name)
+{
+	LARGE_INTEGER	size;
+
+	if(!GetFileSizeEx(file, &size) || !size.QuadPart)
+		return NULL;
+
+	MappingObject	* mapping = new MappingObject;
+	mapping->fd = dup(GetFD(file));
+	mapping->length = size.QuadPart;
+
+	return mapping;
+}
+
+LPVOID MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T length)
+{
+	MappingObject	* object = dynamic_cast <MappingObject *>(GetObject(mapping));
+	if(!object)
+		return NULL;
+
+	uint64_t	offset = ((uint64_t)offsetHigh << 32) | offsetLow;
+	if(!length)
+		length = object->length - offset;
+
+	void	* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, object->fd, offset);
+	if(base == MAP_FAILED)
+	{
+		SetErrorFromErrno();
+		return NULL;
+	}
+
+	std::lock_guard <std::mutex>	lock(s_viewLock);
+	s_views[base] = length;
+
+	return base;
+}
+
+BOOL UnmapViewOfFile(LPCVOID base)
+{
+	size_t	length;
+
+	{
+		std::lock_guard <std::mutex>	lock(s_viewLock);
+
+		auto	iter = s_views.find(base);
+		if(iter == s_views.end())
+			return FALSE;
+
+		length = iter->second;
+		s_views.erase(iter);
+	}
+
+	return !munmap((void *)base, length);
+}
+
+BOOL CloseHandle(HANDLE object)
+{
+	ShimObject	* shimObject = GetObject(object);
+	if(!shimObject)
+		return FALSE;
+
+	delete shimObject;
+
+	return TRUE;
+}
+
+// threads and synchronization
+
+HANDLE CreateThread(SECURITY_ATTRIBUTES * security, SIZE_T stackSize, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD flags, LPDWORD threadID)
+{
+	ThreadObject	* object = new ThreadObject;
+	std::shared_ptr <ThreadState>	state = std::make_shared <ThreadState>();
+
+	object->state = state;
+	object->thread = std::thread([start, param, state]()
+	{
+		start(param);
+
+		std::lock_guard <std::mutex>	lock(state->lock);
+		state->done = true;
+		state->finished.notify_all();
+	});
+
+	if(threadID)
+		*threadID = 0;
+
+	return object;
+}
+
+DWORD GetCurrentThreadId(void)
+{
+	return (DWORD)syscall(SYS_gettid);
+}
+
+DWORD GetCurrentProcessId(void)
+{
+	return (DWORD)getpid();
+}
+
+HANDLE GetCurrentProcess(void)
+{
+	return (HANDLE)(intptr_t)-1;
+}
+
+HANDLE CreateEvent(SECURITY_ATTRIBUTES * security, BOOL manualReset, BOOL initialState, LPCSTR name)
+{
+	EventObject	* event = new EventObject;
+
+	event->manualReset = manualReset != FALSE;
+	event->signaled = initialState != FALSE;
+
+	return event;
+}
+
+BOOL SetEvent(HANDLE event)
+{
+	EventObject	* object = dynamic_cast <EventObject *>(GetObject(event));
+	if(!object)
+		return FALSE;
+
+	std::lock_guard <std::mutex>	lock(object->lock);
+	object->signaled = true;
+	object->signal.notify_all();
+
+	return TRUE;
+}
+
+BOOL ResetEvent(HANDLE event)
+{
+	EventObject	* object = dynamic_cast <EventObject *>(GetObject(event));
+	if(!object)
+		return FALSE;
+
+	std::lock_guard <std::mutex>	lock(object->lock);
+	object->signaled = false;
+
+	return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE object, DWORD milliseconds)
+{
+	ShimObject	* shimObject = GetObject(object);
+
+	return shimObject ? shimObject->Wait(milliseconds) : WAIT_FAILED;
+}
+
+void Sleep(DWORD milliseconds)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+BOOL SwitchToThread(void)
+{
+	std::this_thread::yield();
+
+	return TRUE;
+}
+
+void InitializeCriticalSection(CRITICAL_SECTION * section)
+{
+	section->mutex = new std::recursive_mutex;
+}
+
+BOOL InitializeCriticalSectionAndSpinCount(CRITICAL_SECTION * section, DWORD spinCount)
+{
+	InitializeCriticalSection(section);
+
+	return TRUE;
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION * section)
+{
+	delete section->mutex;
+	section->mutex = nullptr;
+}
+
+void EnterCriticalSection(CRITICAL_SECTION * section)
+{
+	section->mutex->lock();
+}
+
+BOOL TryEnterCriticalSection(CRITICAL_SECTION * section)
+{
+	return section->mutex->try_lock();
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION * section)
+{
+	section->mutex->unlock();
+}
+
+void InitializeSRWLock(SRWLOCK * lock)
+{
+	pthread_rwlock_init(&lock->lock, NULL);
+}
+
+void AcquireSRWLockShared(SRWLOCK * lock)
+{
+	pthread_rwlock_rdlock(&lock->lock);
+}
+
+void ReleaseSRWLockShared(SRWLOCK * lock)
+{
+	pthread_rwlock_unlock(&lock->lock);
+}
+
+void AcquireSRWLockExclusive(SRWLOCK * lock)
+{
+	pthread_rwlock_wrlock(&lock->lock);
+}
+
+void ReleaseSRWLockExclusive(SRWLOCK * lock)
+{
+	pthread_rwlock_unlock(&lock->lock);
+}
+
+DWORD FlsAlloc(PFLS_CALLBACK_FUNCTION callback)
+{
+	DWORD	index = s_nextFlsSlot++;
+	if(index >= kMaxFlsSlots)
+		return FLS_OUT_OF_INDEXES;
+
+	s_flsCallbacks[index] = callback;
+
+	return index;
+}
+
+BOOL FlsFree(DWORD index)
+{
+	if(index >= kMaxFlsSlots)
+		return FALSE;
+
+	s_flsCallbacks[index] = nullptr;
+
+	return TRUE;
+}
+
+PVOID FlsGetValue(DWORD index)
+{
+	return index < kMaxFlsSlots ? s_flsValues.values[index] : NULL;
+}
+
+BOOL FlsSetValue(DWORD index, PVOID data)
+{
+	if(index >= kMaxFlsSlots)
+		return FALSE;
+
+	s_flsValues.values[index] = data;
+
+	return TRUE;
+}
+
+// slists
+
+void InitializeSListHead(SLIST_HEADER * list)
+{
+	list->head = nullptr;
+	list->depth = 0;
+	list->mutex = new std::mutex;
+}
+
+PSLIST_ENTRY InterlockedPushEntrySList(SLIST_HEADER * list, PSLIST_ENTRY entry)
+{
+	std::lock_guard <std::mutex>	lock(*list->mutex);
+
+	PSLIST_ENTRY	prev = list->head;
+	entry->Next = prev;
+	list->head = entry;
+	list->depth++;
+
+	return prev;
+}
+
+PSLIST_ENTRY InterlockedPopEntrySList(SLIST_HEADER * list)
+{
+	std::lock_guard <std::mutex>	lock(*list->mutex);
+
+	PSLIST_ENTRY	entry = list->head;
+	if(entry)
+	{
+		list->head = entry->Next;
+		list->depth--;
+	}
+
+	return entry;
+}
+
+WORD QueryDepthSList(SLIST_HEADER * list)
+{
+	std::lock_guard <std::mutex>	lock(*list->mutex);
+
+	return list->depth;
+}
+
+// time
+
+DWORD GetTickCount(void)
+{
+	return (DWORD)std::chrono::duration_cast <std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ULONGLONG GetTickCount64(void)
+{
+	return std::chrono::duration_cast <std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER * count)
+{
+	count->QuadPart = std::chrono::duration_cast <std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER * frequency)
+{
+	frequency->QuadPart = 1000000000;
+
+	return TRUE;
+}
+
+void GetSystemTimeAsFileTime(FILETIME * time)
+{
+	// 100ns ticks since 1601
+	uint64_t	ticks = std::chrono::duration_cast <std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 100 + 116444736000000000ull;
+
+	time->dwLowDateTime = (DWORD)ticks;
+	time->dwHighDateTime = (DWORD)(ticks >> 32);
+}
+
+void GetLocalTime(SYSTEMTIME * time)
+{
+	std::chrono::system_clock::time_point	now = std::chrono::system_clock::now();
+	time_t	seconds = std::chrono::system_clock::to_time_t(now);
+	struct tm	local;
+
+	localtime_r(&seconds, &local);
+
+	time->wYear = local.tm_year + 1900;
+	time->wMonth = local.tm_mon + 1;
+	time->wDayOfWeek = local.tm_wday;
+	time->wDay = local.tm_mday;
+	time->wHour = local.tm_hour;
+	time->wMinute = local.tm_min;
+	time->wSecond = local.tm_sec;
+	time->wMilliseconds = std::chrono::duration_cast <std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+}
+
+// exceptions
+
+PVOID AddVectoredExceptionHandler(UINT first, PVECTORED_EXCEPTION_HANDLER handler)
+{
+	return (PVOID)handler;
+}
+
+UINT RemoveVectoredExceptionHandler(PVOID handle)
+{
+	return handle != NULL;
+}
+
+LPTOP_LEVEL_EXCEPTION_FILTER SetUnhandledExceptionFilter(LPTOP_LEVEL_EXCEPTION_FILTER filter)
+{
+	return NULL;
+}
+
+// ini files
+
+DWORD GetPrivateProfileString(LPCSTR section, LPCSTR key, LPCSTR defaultValue, LPSTR buf, DWORD bufLength, LPCSTR path)
+{
+	std::string	lines;
+
+	if(ReadProfileSection(path, section, &lines))
+	{
+		size_t	keyLength = strlen(key);
+
+		for(const char * line = lines.c_str(); *line; line += strlen(line) + 1)
+		{
+			const char	* equals = strchr(line, '=');
+			if(!equals)
+				continue;
+
+			const char	* keyEnd = equals;
+			while(keyEnd > line && (keyEnd[-1] == ' ' || keyEnd[-1] == '\t'))
+				keyEnd--;
+
+			if((size_t)(keyEnd - line) == keyLength && !_strnicmp(line, key, keyLength))
+			{
+				const char	* value = equals + 1;
+				while(*value == ' ' || *value == '\t')
+					value++;
+
+				return CopyProfileString(value, buf, bufLength);
+			}
+		}
+	}
+
+	return CopyProfileString(defaultValue ? defaultValue : "", buf, bufLength);
+}
+
+UINT GetPrivateProfileInt(LPCSTR section, LPCSTR key, int defaultValue, LPCSTR path)
+{
+	char	buf[64];
+
+	if(!GetPrivateProfileString(section, key, "", buf, sizeof(buf), path))
+		return defaultValue;
+
+	return strtol(buf, NULL, 0);
+}
+
+DWORD GetPrivateProfileSection(LPCSTR section, LPSTR buf, DWORD bufLength, LPCSTR path)
+{
+	std::string	lines;
+
+	if(bufLength < 2 || !ReadProfileSection(path, section, &lines))
+	{
+		if(bufLength)
+			buf[0] = 0;
+		if(bufLength > 1)
+			buf[1] = 0;
+
+		return 0;
+	}
+
+	DWORD	length = lines.size() < bufLength - 1 ? lines.size() : bufLength - 2;
+
+	memcpy(buf, lines.data(), length);
+	buf[length] = 0;
+	buf[length + 1] = 0;
+
+	return length;
+}
+
+DWORD GetPrivateProfileSectionNames(LPSTR buf, DWORD bufLength, LPCSTR path)
+{
+	std::string	names;
+
+	FILE	* src = fopen(NativePath(path).c_str(), "rb");
+	if(src)
+	{
+		char	line[4096];
+
+		while(fgets(line, sizeof(line), src))
+		{
+			char	* start = line;
+			while(*start == ' ' || *start == '\t')
+				start++;
+
+			char	* close = strchr(start, ']');
+			if(*start == '[' && close)
+			{
+				names.append(start + 1, close);
+				names.push_back(0);
+			}
+		}
+
+		fclose(src);
+	}
+
+	if(bufLength < 2)
+		return 0;
+
+	// truncated like GetPrivateProfileSection, the caller sees bufLength - 2
+	DWORD	length = names.size() < bufLength - 1 ? names.size() : bufLength - 2;
+
+	memcpy(buf, names.data(), length);
+	buf[length] = 0;
+	buf[length + 1] = 0;
+
+	return length;
+}
+
+// modules
+
+HMODULE GetModuleHandle(LPCSTR name)
+{
+	return name ? NULL : (HMODULE)s_moduleImage;
+}
+
+BOOL GetModuleHandleEx(DWORD flags, LPCSTR name, HMODULE * module)
+{
+	*module = (HMODULE)s_moduleImage;
+
+	return s_moduleImage != nullptr;
+}
+
+DWORD GetModuleFileName(HMODULE module, LPSTR path, DWORD length)
+{
+	return CopyProfileString(s_modulePath, path, length);
+}
+
+// misc
+
+BOOL IsDebuggerPresent(void)
+{
+	return FALSE;
+}
+
+void OutputDebugString(LPCSTR str)
+{
+	fputs(str, stderr);
+}
+
+HRESULT SHGetFolderPath(HWND owner, int folder, HANDLE token, DWORD flags, LPSTR path)
+{
+	strcpy_s(path, MAX_PATH, s_folderPath.c_str());
+
+	return S_OK;
+}
+
+// msvc crt
+
+int sprintf_s(char * buf, size_t bufLength, const char * fmt, ...)
+{
+	va_list	args;
+	va_start(args, fmt);
+	int	result = vsprintf_s(buf, bufLength, fmt, args);
+	va_end(args);
+
+	return result;
+}
+
+int _snprintf_s(char * buf, size_t bufLength, size_t count, const char * fmt, ...)
+{
+	va_list	args;
+	va_start(args, fmt);
+	int	result = _vsnprintf_s(buf, bufLength, count, fmt, args);
+	va_end(args);
+
+	return result;
+}
+
+int vsprintf_s(char * buf, size_t bufLength, const char * fmt, va_list args)
+{
+	return vsnprintf(buf, bufLength, fmt, args);
+}
+
+int _vsnprintf_s(char * buf, size_t bufLength, size_t count, const char * fmt, va_list args)
+{
+	if(count != _TRUNCATE && count + 1 < bufLength)
+		bufLength = count + 1;
+
+	int	result = vsnprintf(buf, bufLength, fmt, args);
+
+	// truncation is reported as -1 like the msvc version
+	return (result >= (int)bufLength) ? -1 : result;
+}
+
+int strcpy_s(char * dst, size_t dstLength, const char * src)
+{
+	size_t	length = strlen(src);
+	if(length >= dstLength)
+	{
+		if(dstLength)
+			dst[0] = 0;
+
+		return ERANGE;
+	}
+
+	memcpy(dst, src, length + 1);
+
+	return 0;
+}
+
+int strncpy_s(char * dst, size_t dstLength, const char * src, size_t count)
+{
+	size_t	length = strnlen(src, count);
+	if(length >= dstLength)
+	{
+		if(count != _TRUNCATE)
+		{
+			if(dstLength)
+				dst[0] = 0;
+
+			return ERANGE;
+		}
+
+		length = dstLength - 1;
+	}
+
+	memcpy(dst, src, length);
+	dst[length] = 0;
+
+	return 0;
+}
+
+int strcat_s(char * dst, size_t dstLength, const char * src)
+{
+	size_t	length = strnlen(dst, dstLength);
+	if(length == dstLength)
+		return EINVAL;
+
+	return strcpy_s(dst + length, dstLength - length, src);
+}
+
+int fopen_s(FILE ** file, const char * path, const char * mode)
+{
+	*file = fopen(NativePath(path).c_str(), mode);
+
+	return *file ? 0 : errno;
+}
+
+void * _aligned_malloc(size_t size, size_t alignment)
+{
+	void	* block = nullptr;
+
+	return posix_memalign(&block, alignment < sizeof(void *) ? sizeof(void *) : alignment, size) ? nullptr : block;
+}
+
+void _aligned_free(void * block)
+{
+	free(block);
+}
+
+FILE * _fsopen(const char * path, const char * mode, int shareFlag)
+{
+	return fopen(NativePath(path).c_str(), mode);
+}
+
+int _mkdir(const char * path)
+{
+	return mkdir(NativePath(path).c_str(), 0755);
+}
+
+// hooks for the tests
+
+namespace TestWin32
+{
+	IOStats GetIOStats(void)
+	{
+		IOStats	stats;
+
+		stats.opens = s_opens;
+		stats.reads = s_reads;
+		stats.writes = s_writes;
+		stats.seeks = s_seeks;
+		stats.flushes = s_flushes;
+		stats.bytesWritten = s_bytesWritten;
+
+		return stats;
+	}
+
+	void ResetIOStats(void)
+	{
+		s_opens = 0;
+		s_reads = 0;
+		s_writes = 0;
+		s_seeks = 0;
+		s_flushes = 0;
+		s_bytesWritten = 0;
+	}
+
+	void SetFolderPath(const char * path)
+	{
+		s_folderPath = path;
+	}
+
+	void SetModuleImage(const void * image, const char * path)
+	{
+		s_moduleImage = image;
+		s_modulePath = path;
+	}
+}
+
+BOOL WritePrivateProfileString(LPCSTR section, LPCSTR key, LPCSTR value, LPCSTR path)
+{
+	return FALSE;
+}
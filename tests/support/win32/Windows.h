@@ -0,0 +1,501 @@
+#pragma once
+
+// just enough of the Win32 API to build the f4se sources under test on Linux
+// file, thread and sync objects are backed by POSIX, everything touching the game or the PE image is left out
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cwchar>
+#include <climits>
+#include <mutex>
+#include <pthread.h>
+#include <strings.h>
+
+#define WINAPI
+#define CALLBACK
+#define APIENTRY
+#define __stdcall
+#define __cdecl
+#define __forceinline	inline __attribute__((always_inline))
+
+#define __declspec(x)				__declspec_##x
+#define __declspec_noreturn			__attribute__((noreturn))
+#define __declspec_noinline			__attribute__((noinline))
+#define __declspec_dllexport
+#define __declspec_dllimport
+#define __declspec_align(n)			__attribute__((aligned(n)))
+#define __declspec_thread			thread_local
+
+typedef int				BOOL;
+typedef uint8_t			BYTE;
+typedef uint16_t		WORD;
+typedef uint32_t		DWORD;
+typedef int32_t			LONG;
+typedef int64_t			LONGLONG;
+typedef uint64_t		ULONGLONG;
+typedef unsigned int	UINT;
+typedef uintptr_t		UINT_PTR;
+typedef uintptr_t		ULONG_PTR;
+typedef uintptr_t		DWORD_PTR;
+typedef uintptr_t		SIZE_T;
+typedef uintptr_t		WPARAM;
+typedef intptr_t		LPARAM;
+typedef int32_t			HRESULT;
+typedef char			CHAR;
+typedef char			TCHAR;
+typedef wchar_t			WCHAR;
+typedef void			VOID;
+
+typedef void *			HANDLE;
+typedef void *			HMODULE;
+typedef void *			HINSTANCE;
+typedef void *			HWND;
+typedef void *			PVOID;
+typedef void *			LPVOID;
+typedef const void *	LPCVOID;
+typedef char *			LPSTR;
+typedef char *			LPTSTR;
+typedef const char *	LPCSTR;
+typedef DWORD *			LPDWORD;
+typedef LONG *			PLONG;
+
+#define FALSE	0
+#define TRUE	1
+
+#define MAX_PATH	260
+#define INFINITE	0xFFFFFFFF
+
+#define S_OK			((HRESULT)0)
+#define E_FAIL			((HRESULT)0x80004005)
+#define SUCCEEDED(hr)	(((HRESULT)(hr)) >= 0)
+#define FAILED(hr)		(((HRESULT)(hr)) < 0)
+
+#define ERROR_SUCCESS			0
+#define ERROR_FILE_NOT_FOUND	2
+#define ERROR_ACCESS_DENIED		5
+#define ERROR_NO_MORE_FILES		18
+#define ERROR_ALREADY_EXISTS	183
+
+#define _TRUNCATE	((size_t)-1)
+#define _SH_DENYWR	0x20
+#define _SH_DENYNO	0x40
+
+union LARGE_INTEGER
+{
+	struct
+	{
+		DWORD	LowPart;
+		LONG	HighPart;
+	};
+	LONGLONG	QuadPart;
+};
+
+struct FILETIME
+{
+	DWORD	dwLowDateTime;
+	DWORD	dwHighDateTime;
+};
+
+struct SYSTEMTIME
+{
+	WORD	wYear;
+	WORD	wMonth;
+	WORD	wDayOfWeek;
+	WORD	wDay;
+	WORD	wHour;
+	WORD	wMinute;
+	WORD	wSecond;
+	WORD	wMilliseconds;
+};
+
+struct SECURITY_ATTRIBUTES;
+
+// errors
+
+DWORD	GetLastError(void);
+void	SetLastError(DWORD error);
+
+// files
+
+#define INVALID_HANDLE_VALUE	((HANDLE)(intptr_t)-1)
+
+#define GENERIC_READ			0x80000000
+#define GENERIC_WRITE			0x40000000
+
+#define FILE_SHARE_READ			0x00000001
+#define FILE_SHARE_WRITE		0x00000002
+#define FILE_SHARE_DELETE		0x00000004
+
+#define CREATE_NEW				1
+#define CREATE_ALWAYS			2
+#define OPEN_EXISTING			3
+#define OPEN_ALWAYS				4
+#define TRUNCATE_EXISTING		5
+
+#define FILE_ATTRIBUTE_READONLY		0x00000001
+#define FILE_ATTRIBUTE_DIRECTORY	0x00000010
+#define FILE_ATTRIBUTE_NORMAL		0x00000080
+#define FILE_FLAG_SEQUENTIAL_SCAN	0x08000000
+#define FILE_FLAG_WRITE_THROUGH		0x80000000
+#define INVALID_FILE_ATTRIBUTES		((DWORD)-1)
+
+#define FILE_BEGIN		0
+#define FILE_CURRENT	1
+#define FILE_END		2
+
+#define MOVEFILE_REPLACE_EXISTING	0x00000001
+#define MOVEFILE_WRITE_THROUGH		0x00000008
+
+HANDLE	CreateFile(LPCSTR path, DWORD access, DWORD shareMode, SECURITY_ATTRIBUTES * security, DWORD disposition, DWORD flags, HANDLE templateFile);
+BOOL	ReadFile(HANDLE file, LPVOID buf, DWORD length, LPDWORD lengthOut, void * overlapped);
+BOOL	WriteFile(HANDLE file, LPCVOID buf, DWORD length, LPDWORD lengthOut, void * overlapped);
+BOOL	SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, LARGE_INTEGER * newPosition, DWORD method);
+BOOL	SetEndOfFile(HANDLE file);
+BOOL	GetFileSizeEx(HANDLE file, LARGE_INTEGER * size);
+BOOL	FlushFileBuffers(HANDLE file);
+BOOL	DeleteFile(LPCSTR path);
+BOOL	MoveFileEx(LPCSTR from, LPCSTR to, DWORD flags);
+BOOL	CreateDirectory(LPCSTR path, SECURITY_ATTRIBUTES * security);
+DWORD	GetFileAttributes(LPCSTR path);
+
+struct WIN32_FIND_DATA
+{
+	DWORD		dwFileAttributes;
+	FILETIME	ftCreationTime;
+	FILETIME	ftLastAccessTime;
+	FILETIME	ftLastWriteTime;
+	DWORD		nFileSizeHigh;
+	DWORD		nFileSizeLow;
+	char		cFileName[MAX_PATH];
+};
+
+// '*' and '?' in the last path component only, like the real api
+HANDLE	FindFirstFile(LPCSTR pattern, WIN32_FIND_DATA * data);
+BOOL	FindNextFile(HANDLE find, WIN32_FIND_DATA * data);
+BOOL	FindClose(HANDLE find);
+
+#define PAGE_READONLY	0x02
+#define FILE_MAP_READ	0x0004
+
+HANDLE	CreateFileMapping(HANDLE file, SECURITY_ATTRIBUTES * security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, LPCSTR name);
+LPVOID	MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T length);
+BOOL	UnmapViewOfFile(LPCVOID base);
+
+BOOL	CloseHandle(HANDLE object);
+
+// threads and synchronization
+
+typedef DWORD (WINAPI * LPTHREAD_START_ROUTINE)(LPVOID param);
+
+#define WAIT_OBJECT_0	0x00000000
+#define WAIT_TIMEOUT	0x00000102
+#define WAIT_FAILED		0xFFFFFFFF
+
+HANDLE	CreateThread(SECURITY_ATTRIBUTES * security, SIZE_T stackSize, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD flags, LPDWORD threadID);
+DWORD	GetCurrentThreadId(void);
+DWORD	GetCurrentProcessId(void);
+HANDLE	GetCurrentProcess(void);
+
+HANDLE	CreateEvent(SECURITY_ATTRIBUTES * security, BOOL manualReset, BOOL initialState, LPCSTR name);
+BOOL	SetEvent(HANDLE event);
+BOOL	ResetEvent(HANDLE event);
+
+DWORD	WaitForSingleObject(HANDLE object, DWORD milliseconds);
+
+void	Sleep(DWORD milliseconds);
+BOOL	SwitchToThread(void);
+#define YieldProcessor()	__builtin_ia32_pause()
+
+struct CRITICAL_SECTION
+{
+	std::recursive_mutex	* mutex;
+};
+
+void	InitializeCriticalSection(CRITICAL_SECTION * section);
+BOOL	InitializeCriticalSectionAndSpinCount(CRITICAL_SECTION * section, DWORD spinCount);
+void	DeleteCriticalSection(CRITICAL_SECTION * section);
+void	EnterCriticalSection(CRITICAL_SECTION * section);
+BOOL	TryEnterCriticalSection(CRITICAL_SECTION * section);
+void	LeaveCriticalSection(CRITICAL_SECTION * section);
+
+struct SRWLOCK
+{
+	pthread_rwlock_t	lock;
+};
+
+#define SRWLOCK_INIT	{ PTHREAD_RWLOCK_INITIALIZER }
+
+void	InitializeSRWLock(SRWLOCK * lock);
+void	AcquireSRWLockShared(SRWLOCK * lock);
+void	ReleaseSRWLockShared(SRWLOCK * lock);
+void	AcquireSRWLockExclusive(SRWLOCK * lock);
+void	ReleaseSRWLockExclusive(SRWLOCK * lock);
+
+// fiber local storage, destructors run when the owning thread exits
+
+typedef void (WINAPI * PFLS_CALLBACK_FUNCTION)(PVOID data);
+
+#define FLS_OUT_OF_INDEXES	((DWORD)0xFFFFFFFF)
+
+DWORD	FlsAlloc(PFLS_CALLBACK_FUNCTION callback);
+BOOL	FlsFree(DWORD index);
+PVOID	FlsGetValue(DWORD index);
+BOOL	FlsSetValue(DWORD index, PVOID data);
+
+inline LONG InterlockedIncrement(volatile LONG * target)							{ return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedDecrement(volatile LONG * target)							{ return __atomic_sub_fetch(target, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchange(volatile LONG * target, LONG value)					{ return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchangeAdd(volatile LONG * target, LONG value)				{ return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedCompareExchange(volatile LONG * target, LONG value, LONG comparand)
+{
+	__atomic_compare_exchange_n(target, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+// interlocked singly linked lists, a locked list here, the callers only rely on the semantics
+
+#define MEMORY_ALLOCATION_ALIGNMENT	16
+
+struct SLIST_ENTRY
+{
+	SLIST_ENTRY	* Next;
+};
+
+typedef SLIST_ENTRY *	PSLIST_ENTRY;
+
+struct SLIST_HEADER
+{
+	SLIST_ENTRY	* head;
+	WORD		depth;
+	std::mutex	* mutex;
+};
+
+void			InitializeSListHead(SLIST_HEADER * list);
+PSLIST_ENTRY	InterlockedPushEntrySList(SLIST_HEADER * list, PSLIST_ENTRY entry);
+PSLIST_ENTRY	InterlockedPopEntrySList(SLIST_HEADER * list);
+WORD			QueryDepthSList(SLIST_HEADER * list);
+
+// time
+
+DWORD	GetTickCount(void);
+ULONGLONG	GetTickCount64(void);
+BOOL	QueryPerformanceCounter(LARGE_INTEGER * count);
+BOOL	QueryPerformanceFrequency(LARGE_INTEGER * frequency);
+void	GetSystemTimeAsFileTime(FILETIME * time);
+void	GetLocalTime(SYSTEMTIME * time);
+
+// exceptions, nothing is ever raised through these
+
+#define EXCEPTION_ACCESS_VIOLATION		0xC0000005
+#define EXCEPTION_IN_PAGE_ERROR			0xC0000006
+#define EXCEPTION_ILLEGAL_INSTRUCTION	0xC000001D
+#define EXCEPTION_INT_DIVIDE_BY_ZERO	0xC0000094
+#define EXCEPTION_PRIV_INSTRUCTION		0xC0000096
+#define EXCEPTION_STACK_OVERFLOW		0xC00000FD
+
+#define EXCEPTION_NONCONTINUABLE		0x1
+
+#define EXCEPTION_EXECUTE_HANDLER		1
+#define EXCEPTION_CONTINUE_SEARCH		0
+#define EXCEPTION_CONTINUE_EXECUTION	(-1)
+
+struct EXCEPTION_RECORD
+{
+	DWORD	ExceptionCode;
+	DWORD	ExceptionFlags;
+	PVOID	ExceptionAddress;
+};
+
+struct CONTEXT;
+
+struct EXCEPTION_POINTERS
+{
+	EXCEPTION_RECORD	* ExceptionRecord;
+	CONTEXT				* ContextRecord;
+};
+
+typedef EXCEPTION_POINTERS *	PEXCEPTION_POINTERS;
+typedef LONG (WINAPI * PVECTORED_EXCEPTION_HANDLER)(EXCEPTION_POINTERS * info);
+typedef LONG (WINAPI * LPTOP_LEVEL_EXCEPTION_FILTER)(EXCEPTION_POINTERS * info);
+
+PVOID	AddVectoredExceptionHandler(UINT first, PVECTORED_EXCEPTION_HANDLER handler);
+UINT	RemoveVectoredExceptionHandler(PVOID handle);
+LPTOP_LEVEL_EXCEPTION_FILTER	SetUnhandledExceptionFilter(LPTOP_LEVEL_EXCEPTION_FILTER filter);
+
+// ini files
+
+DWORD	GetPrivateProfileString(LPCSTR section, LPCSTR key, LPCSTR defaultValue, LPSTR buf, DWORD bufLength, LPCSTR path);
+UINT	GetPrivateProfileInt(LPCSTR section, LPCSTR key, int defaultValue, LPCSTR path);
+DWORD	GetPrivateProfileSection(LPCSTR section, LPSTR buf, DWORD bufLength, LPCSTR path);
+DWORD	GetPrivateProfileSectionNames(LPSTR buf, DWORD bufLength, LPCSTR path);
+BOOL	WritePrivateProfileString(LPCSTR section, LPCSTR key, LPCSTR value, LPCSTR path);
+
+// common dialogs, never shown
+
+struct OPENFILENAME
+{
+	DWORD		lStructSize;
+	HWND		hwndOwner;
+	HINSTANCE	hInstance;
+	LPCSTR		lpstrFilter;
+	LPSTR		lpstrCustomFilter;
+	DWORD		nMaxCustFilter;
+	DWORD		nFilterIndex;
+	LPSTR		lpstrFile;
+	DWORD		nMaxFile;
+	LPSTR		lpstrFileTitle;
+	DWORD		nMaxFileTitle;
+	LPCSTR		lpstrInitialDir;
+	LPCSTR		lpstrTitle;
+	DWORD		Flags;
+	LPCSTR		lpstrDefExt;
+	LPARAM		lCustData;
+	UINT_PTR	(CALLBACK * lpfnHook)(HWND, UINT, WPARAM, LPARAM);
+	LPCSTR		lpTemplateName;
+};
+
+#define OFN_EXPLORER			0x00080000
+#define OFN_ENABLESIZING		0x00800000
+#define OFN_FILEMUSTEXIST		0x00001000
+#define OFN_PATHMUSTEXIST		0x00000800
+#define OFN_ENABLEHOOK			0x00000020
+#define OFN_NOCHANGEDIR			0x00000008
+#define OFN_OVERWRITEPROMPT		0x00000002
+
+inline BOOL GetOpenFileName(OPENFILENAME *)	{ return FALSE; }
+inline BOOL GetSaveFileName(OPENFILENAME *)	{ return FALSE; }
+
+// modules, the "executable" is whatever image the test hands to TestWin32::SetModuleImage
+
+#define GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT	0x00000002
+#define GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS			0x00000004
+
+HMODULE	GetModuleHandle(LPCSTR name);
+BOOL	GetModuleHandleEx(DWORD flags, LPCSTR name, HMODULE * module);
+DWORD	GetModuleFileName(HMODULE module, LPSTR path, DWORD length);
+
+// pe headers, up to the fields the tree reads
+
+struct IMAGE_DOS_HEADER
+{
+	WORD	e_magic;
+	WORD	e_unused[29];
+	LONG	e_lfanew;
+};
+
+struct IMAGE_FILE_HEADER
+{
+	WORD	Machine;
+	WORD	NumberOfSections;
+	DWORD	TimeDateStamp;
+	DWORD	PointerToSymbolTable;
+	DWORD	NumberOfSymbols;
+	WORD	SizeOfOptionalHeader;
+	WORD	Characteristics;
+};
+
+struct IMAGE_OPTIONAL_HEADER64
+{
+	WORD		Magic;
+	BYTE		MajorLinkerVersion;
+	BYTE		MinorLinkerVersion;
+	DWORD		SizeOfCode;
+	DWORD		SizeOfInitializedData;
+	DWORD		SizeOfUninitializedData;
+	DWORD		AddressOfEntryPoint;
+	DWORD		BaseOfCode;
+	ULONGLONG	ImageBase;
+	DWORD		SectionAlignment;
+	DWORD		FileAlignment;
+	WORD		MajorOperatingSystemVersion;
+	WORD		MinorOperatingSystemVersion;
+	WORD		MajorImageVersion;
+	WORD		MinorImageVersion;
+	WORD		MajorSubsystemVersion;
+	WORD		MinorSubsystemVersion;
+	DWORD		Win32VersionValue;
+	DWORD		SizeOfImage;
+	DWORD		SizeOfHeaders;
+	DWORD		CheckSum;
+};
+
+struct IMAGE_NT_HEADERS64
+{
+	DWORD					Signature;
+	IMAGE_FILE_HEADER		FileHeader;
+	IMAGE_OPTIONAL_HEADER64	OptionalHeader;
+};
+
+typedef IMAGE_NT_HEADERS64	IMAGE_NT_HEADERS;
+
+#define IMAGE_DOS_SIGNATURE	0x5A4D
+#define IMAGE_NT_SIGNATURE	0x00004550
+
+// misc
+
+BOOL	IsDebuggerPresent(void);
+void	OutputDebugString(LPCSTR str);
+
+// msvc crt
+
+#define _stricmp	strcasecmp
+#define _strnicmp	strncasecmp
+#define _strdup		strdup
+
+int		sprintf_s(char * buf, size_t bufLength, const char * fmt, ...) __attribute__((format(printf, 3, 4)));
+int		_snprintf_s(char * buf, size_t bufLength, size_t count, const char * fmt, ...) __attribute__((format(printf, 4, 5)));
+int		vsprintf_s(char * buf, size_t bufLength, const char * fmt, va_list args);
+int		_vsnprintf_s(char * buf, size_t bufLength, size_t count, const char * fmt, va_list args);
+int		strcpy_s(char * dst, size_t dstLength, const char * src);
+int		strncpy_s(char * dst, size_t dstLength, const char * src, size_t count);
+int		strcat_s(char * dst, size_t dstLength, const char * src);
+int		fopen_s(FILE ** file, const char * path, const char * mode);
+void *	_aligned_malloc(size_t size, size_t alignment);
+void	_aligned_free(void * block);
+FILE *	_fsopen(const char * path, const char * mode, int shareFlag);
+int		_mkdir(const char * path);
+
+template <size_t N>
+int sprintf_s(char (& buf)[N], const char * fmt, ...)
+{
+	va_list	args;
+	va_start(args, fmt);
+	int	result = vsprintf_s(buf, N, fmt, args);
+	va_end(args);
+	return result;
+}
+
+template <size_t N>
+int strcpy_s(char (& dst)[N], const char * src)
+{
+	return strcpy_s(dst, N, src);
+}
+
+// hooks for the tests themselves
+
+namespace TestWin32
+{
+	// counted at the api boundary, each call is one syscall in the real implementation
+	struct IOStats
+	{
+		uint64_t	opens;
+		uint64_t	reads;
+		uint64_t	writes;
+		uint64_t	seeks;
+		uint64_t	flushes;
+		uint64_t	bytesWritten;
+	};
+
+	IOStats	GetIOStats(void);
+	void	ResetIOStats(void);
+
+	// SHGetFolderPath returns this for every folder, backslashes in paths are treated as separators
+	void	SetFolderPath(const char * path);
+
+	// GetModuleHandle(NULL) returns image, GetModuleFileName returns path for any module
+	void	SetModuleImage(const void * image, const char * path);
+}
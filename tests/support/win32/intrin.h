@@ -0,0 +1,35 @@
+#pragma once
+
+// the msvc intrinsics the tree uses, on top of the gcc ones
+
+#include <immintrin.h>
+
+inline void __cpuidex(int info[4], int leaf, int subleaf)
+{
+	asm volatile("cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(leaf), "c"(subleaf));
+}
+
+inline void __cpuid(int info[4], int leaf)
+{
+	__cpuidex(info, leaf, 0);
+}
+
+inline unsigned char _BitScanForward(unsigned long * index, unsigned long mask)
+{
+	if(!mask)
+		return 0;
+
+	*index = __builtin_ctzl(mask);
+
+	return 1;
+}
+
+inline unsigned char _BitScanForward64(unsigned long * index, unsigned long long mask)
+{
+	if(!mask)
+		return 0;
+
+	*index = __builtin_ctzll(mask);
+
+	return 1;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Windows.h"
+
+#define CSIDL_PERSONAL		0x0005
+#define CSIDL_MYDOCUMENTS	CSIDL_PERSONAL
+#define CSIDL_APPDATA		0x001A
+#define CSIDL_FLAG_CREATE	0x8000
+
+#define SHGFP_TYPE_CURRENT	0
+
+HRESULT	SHGetFolderPath(HWND owner, int folder, HANDLE token, DWORD flags, LPSTR path);